@@ -0,0 +1,540 @@
+//
+//  Abc.cpp
+//  treeducken
+//
+
+#include "Abc.h"
+#include "Simulator.h"
+#include "TreeStats.h"
+#include "TreeDistances.h"
+#include "ParaFit.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+PhyloTree keepTips(const PhyloTree &tree, const std::vector<bool> &keep){
+    int numTips = tree.tipNames.size();
+    int numNodes = numTips;
+    for(unsigned e = 0; e < tree.edges.anc.size(); e++)
+        numNodes = std::max(numNodes, std::max(tree.edges.anc[e], tree.edges.des[e]));
+    std::vector< std::vector<int> > children(numNodes + 1);
+    std::vector<double> edgeLength(numNodes + 1, 0.0);
+    for(unsigned e = 0; e < tree.edges.anc.size(); e++){
+        children[tree.edges.anc[e]].push_back(tree.edges.des[e]);
+        edgeLength[tree.edges.des[e]] = tree.edgeLengths[e];
+    }
+    PhyloTree kept;
+    kept.numInternal = 0;
+    kept.rootEdge = tree.rootEdge;
+    std::vector<int> newNumber(numTips + 1, 0);
+    for(int i = 0; i < numTips; i++){
+        if(keep[i]){
+            kept.tipNames.push_back(tree.tipNames[i]);
+            newNumber[i + 1] = kept.tipNames.size();
+        }
+    }
+    int numKept = kept.tipNames.size();
+    if(numKept == 0)
+        return kept;
+    // nodes from the root down, read backwards this is a postorder
+    std::vector<int> preorder(1, numTips + 1);
+    for(unsigned k = 0; k < preorder.size(); k++)
+        for(auto c : children[preorder[k]])
+            preorder.push_back(c);
+    std::vector<int> keptBelow(numNodes + 1, 0);
+    for(auto it = preorder.rbegin(); it != preorder.rend(); ++it){
+        if(*it <= numTips)
+            keptBelow[*it] = keep[*it - 1];
+        for(auto c : children[*it])
+            keptBelow[*it] += keptBelow[c];
+    }
+    // renumbers from the root down, nodes with kept tips below one child only
+    // are skipped and their branch added to the one below
+    struct Pending
+    {
+        int     node, parent;
+        double  length;
+    };
+    std::vector<Pending> stack(1, Pending{numTips + 1, 0, 0.0});
+    std::vector<int> keptChildren;
+    while(!(stack.empty())){
+        Pending p = stack.back();
+        stack.pop_back();
+        keptChildren.clear();
+        for(auto c : children[p.node])
+            if(keptBelow[c] > 0)
+                keptChildren.push_back(c);
+        if(keptChildren.size() == 1){
+            stack.push_back(Pending{keptChildren[0], p.parent, p.length + edgeLength[keptChildren[0]]});
+            continue;
+        }
+        int number = (p.node <= numTips) ? newNumber[p.node] : numKept + (++kept.numInternal);
+        if(p.parent == 0)
+            kept.rootEdge = tree.rootEdge + p.length;
+        else{
+            kept.edges.anc.push_back(p.parent);
+            kept.edges.des.push_back(number);
+            kept.edgeLengths.push_back(p.length);
+        }
+        for(auto it = keptChildren.rbegin(); it != keptChildren.rend(); ++it)
+            stack.push_back(Pending{*it, number, edgeLength[*it]});
+    }
+    return kept;
+}
+
+std::vector<double> cophyloSummary(const PhyloTree &hostTree,
+                                   const PhyloTree &symbTree,
+                                   const std::vector<double> &assoc){
+    int numHosts = hostTree.tipNames.size();
+    int numSymbs = symbTree.tipNames.size();
+    if(assoc.size() != (size_t) numHosts * numSymbs)
+        throw std::runtime_error("the association matrix must have a row for each host and a column for each symbiont");
+    TreeShapeStats hostStats = calculateTreeShapeStats(hostTree.edges.anc,
+                                                       hostTree.edges.des,
+                                                       hostTree.edgeLengths,
+                                                       numHosts);
+    TreeShapeStats symbStats = calculateTreeShapeStats(symbTree.edges.anc,
+                                                       symbTree.edges.des,
+                                                       symbTree.edgeLengths,
+                                                       numSymbs);
+    double numAssociations = 0.0;
+    for(auto a : assoc)
+        numAssociations += a;
+    // as parafit_stat, which needs 3 tips in each tree
+    double parafit = NAN;
+    if(numHosts > 2 && numSymbs > 2){
+        arma::mat hostDist(numHosts, numHosts), symbDist(numSymbs, numSymbs);
+        copheneticDistances(hostTree.edges.anc, hostTree.edges.des, hostTree.edgeLengths,
+                            numHosts, hostDist.memptr());
+        copheneticDistances(symbTree.edges.anc, symbTree.edges.des, symbTree.edgeLengths,
+                            numSymbs, symbDist.memptr());
+        arma::mat assocMat(assoc.data(), numHosts, numSymbs);
+        parafit = ParaFit(hostDist, symbDist).statistic(assocMat);
+    }
+    return {(double) numHosts,
+            (double) numSymbs,
+            hostStats.colless,
+            symbStats.colless,
+            hostStats.gamma,
+            symbStats.gamma,
+            numSymbs > 0 ? numAssociations / numSymbs : NAN,
+            parafit};
+}
+
+std::vector<double> geneTreeSummary(const std::vector<PhyloTree> &geneTrees){
+    double n = geneTrees.size();
+    double colless = 0.0, sackin = 0.0, cherries = 0.0;
+    double tmrca = 0.0, tmrcaSq = 0.0, meanBrlen = 0.0;
+    for(auto &gt : geneTrees){
+        TreeShapeStats stats = calculateTreeShapeStats(gt.edges.anc,
+                                                       gt.edges.des,
+                                                       gt.edgeLengths,
+                                                       gt.tipNames.size());
+        colless += stats.colless;
+        sackin += stats.sackin;
+        cherries += stats.cherries;
+        tmrca += stats.treeDepth;
+        tmrcaSq += stats.treeDepth * stats.treeDepth;
+        meanBrlen += stats.meanBranchLength;
+    }
+    double sdTmrca = (n > 1) ? std::sqrt(std::max(0.0, (tmrcaSq - tmrca * tmrca / n) / (n - 1))) : NAN;
+    return {colless / n, sackin / n, cherries / n, tmrca / n, sdTmrca, meanBrlen / n};
+}
+
+// the tree of the extant tips of a simulated tree, extinct tips have an X in
+// their names as in getExtantHostNames
+static PhyloTree extantTree(Tree &tree){
+    PhyloTree whole;
+    whole.edges = tree.getEdges();
+    whole.edgeLengths = tree.getEdgeLengths();
+    whole.tipNames = tree.getTipNames();
+    whole.numInternal = tree.getNnodes();
+    whole.rootEdge = tree.getRootEdge();
+    std::vector<bool> keep(whole.tipNames.size());
+    for(unsigned i = 0; i < keep.size(); i++)
+        keep[i] = whole.tipNames[i].find("X") == std::string::npos;
+    return keepTips(whole, keep);
+}
+
+std::vector<std::string> cophyloSummaryNames(){
+    return {"host_tips", "symb_tips", "host_colless", "symb_colless",
+            "host_gamma", "symb_gamma", "hosts_per_symb", "parafit"};
+}
+
+std::vector<double> CophyloAbcModel::simulate(const std::vector<double> &parameters,
+                                              std::shared_ptr<Rng> rng,
+                                              std::shared_ptr<Cancellation> cancellation) const {
+    double rho = 1.0;
+    std::shared_ptr<Simulator> phySimulator;
+    if(anagenesis)
+        phySimulator = std::make_shared<Simulator>(timeToSim,
+                                                   parameters[0],
+                                                   parameters[1],
+                                                   parameters[2],
+                                                   parameters[3],
+                                                   parameters[6],
+                                                   parameters[7],
+                                                   parameters[4],
+                                                   parameters[5],
+                                                   rho,
+                                                   hostLimit,
+                                                   hsMode);
+    else
+        phySimulator = std::make_shared<Simulator>(timeToSim,
+                                                   parameters[0],
+                                                   parameters[1],
+                                                   parameters[2],
+                                                   parameters[3],
+                                                   parameters[4],
+                                                   parameters[5],
+                                                   rho,
+                                                   hostLimit,
+                                                   hsMode);
+    phySimulator->setRng(rng);
+    phySimulator->setCancellation(cancellation);
+    if(anagenesis)
+        phySimulator->simHostSymbSpeciesTreePairWithAnagenesis();
+    else
+        phySimulator->simHostSymbSpeciesTreePair();
+    std::vector<int> assoc = phySimulator->getAssociationMatrix();
+    return cophyloSummary(extantTree(*(phySimulator->getSpeciesTree())),
+                          extantTree(*(phySimulator->getSymbiontTree())),
+                          std::vector<double>(assoc.begin(), assoc.end()));
+}
+
+std::vector<std::string> geneTreeSummaryNames(){
+    return {"colless", "sackin", "cherries", "tmrca", "sd_tmrca", "mean_brlen"};
+}
+
+std::vector<double> MscAbcModel::simulate(const std::vector<double> &parameters,
+                                          std::shared_ptr<Rng> rng,
+                                          std::shared_ptr<Cancellation> cancellation) const {
+    // as sim_msc
+    double theta = rescale ? 4 * parameters[0] * mutationsPerTime : parameters[0];
+    auto specTree = std::make_shared<SpeciesTree>(speciesTree);
+    if(rescale)
+        specTree->scaleTree(theta);
+    int ntax = specTree->getNumExtant();
+    auto phySimulator = std::make_shared<Simulator>(ntax,
+                                                    0.0,
+                                                    0.0,
+                                                    1.0,
+                                                    1,
+                                                    0.0,
+                                                    0.0,
+                                                    0.0,
+                                                    samplesPerLineage,
+                                                    theta,
+                                                    1.0,
+                                                    numGenes,
+                                                    0.0,
+                                                    1.0,
+                                                    false);
+    phySimulator->setRng(rng);
+    phySimulator->setCancellation(cancellation);
+    phySimulator->setSpeciesTree(specTree);
+    phySimulator->setLocusTree(std::shared_ptr<LocusTree>(new LocusTree(*specTree, ntax, 0.0, 0.0, 0.0)));
+    phySimulator->simGeneTrees(1);
+    std::vector<PhyloTree> geneTrees(numGenes);
+    for(int j = 0; j < numGenes; j++){
+        geneTrees[j].edges = phySimulator->getGeneEdges(j);
+        geneTrees[j].edgeLengths = phySimulator->getGeneEdgeLengths(j);
+        geneTrees[j].tipNames = phySimulator->getGeneTipNames(j);
+        geneTrees[j].numInternal = phySimulator->getGeneNnodes(j);
+        geneTrees[j].rootEdge = 0.0;
+    }
+    return geneTreeSummary(geneTrees);
+}
+
+AbcSampler::AbcSampler(const AbcModel &m,
+                       const std::vector<double> &fixed,
+                       const std::vector<AbcPrior> &p,
+                       const std::vector<double> &obs,
+                       int nt,
+                       std::shared_ptr<Cancellation> c) : model(m),
+                                                          fixedParameters(fixed),
+                                                          priors(p),
+                                                          observed(obs),
+                                                          numThreads(nt),
+                                                          cancellation(c) {
+    if(observed.size() != model.getStatisticNames().size())
+        throw std::runtime_error("the observed statistics must be those of the model");
+}
+
+static double priorLower(const AbcPrior &p){ return p.logScale ? std::log(p.lower) : p.lower; }
+static double priorUpper(const AbcPrior &p){ return p.logScale ? std::log(p.upper) : p.upper; }
+
+std::vector<double> AbcSampler::drawFromPriors(Rng &rng) const {
+    std::vector<double> proposal(priors.size());
+    for(unsigned k = 0; k < priors.size(); k++)
+        proposal[k] = priorLower(priors[k]) + (priorUpper(priors[k]) - priorLower(priors[k])) * rng.uniform();
+    return proposal;
+}
+
+bool AbcSampler::inPriors(const std::vector<double> &proposal) const {
+    for(unsigned k = 0; k < priors.size(); k++)
+        if(proposal[k] < priorLower(priors[k]) || proposal[k] > priorUpper(priors[k]))
+            return false;
+    return true;
+}
+
+std::vector< std::vector<double> > AbcSampler::simulateBatch(const std::vector< std::vector<double> > &proposals,
+                                                             const std::vector<uint64_t> &seeds){
+    int numProposals = proposals.size();
+    std::vector< std::vector<double> > stats(numProposals);
+    std::vector<std::string> errors(numProposals);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1) num_threads(numThreads)
+#endif
+    for(int i = 0; i < numProposals; i++){
+        if(cancellation && cancellation->requested())
+            continue;
+        try{
+            std::vector<double> parameters = fixedParameters;
+            for(unsigned k = 0; k < priors.size(); k++)
+                parameters[priors[k].parameter] = priors[k].logScale ? std::exp(proposals[i][k]) : proposals[i][k];
+            stats[i] = model.simulate(parameters, std::make_shared<Rng>(seeds[i]), cancellation);
+        }
+        catch(std::exception &e){
+            errors[i] = e.what();
+        }
+    }
+    // the proposals that were interrupted have an error too
+    if(cancellation)
+        cancellation->check();
+    for(int i = 0; i < numProposals; i++)
+        if(!(errors[i].empty()))
+            throw std::runtime_error(errors[i]);
+    return stats;
+}
+
+// median absolute deviation of each statistic as in mad(), its standard
+// deviation if that is 0 and 1 if both are
+void AbcSampler::setScale(const std::vector< std::vector<double> > &stats){
+    unsigned numStats = observed.size();
+    scale.assign(numStats, 1.0);
+    std::vector<double> values;
+    for(unsigned j = 0; j < numStats; j++){
+        values.clear();
+        for(auto &s : stats)
+            if(!(std::isnan(s[j])))
+                values.push_back(s[j]);
+        if(values.size() < 2)
+            continue;
+        auto middle = values.begin() + values.size() / 2;
+        std::nth_element(values.begin(), middle, values.end());
+        double median = *middle;
+        double mean = 0.0, sumSq = 0.0;
+        for(auto v : values)
+            mean += v / values.size();
+        for(auto &v : values){
+            sumSq += (v - mean) * (v - mean);
+            v = std::abs(v - median);
+        }
+        std::nth_element(values.begin(), middle, values.end());
+        double mad = 1.4826 * (*middle);
+        double sd = std::sqrt(sumSq / (values.size() - 1));
+        if(mad > 0.0)
+            scale[j] = mad;
+        else if(sd > 0.0)
+            scale[j] = sd;
+    }
+}
+
+// Euclidean distance of the scaled statistics. A statistic that could not be
+// calculated (e.g. ParaFit of a tree with two tips) only matches one that
+// could not be calculated either.
+double AbcSampler::distance(const std::vector<double> &stats) const {
+    double sumSq = 0.0;
+    for(unsigned j = 0; j < observed.size(); j++){
+        bool simNaN = std::isnan(stats[j]), obsNaN = std::isnan(observed[j]);
+        if(simNaN && obsNaN)
+            continue;
+        if(simNaN || obsNaN)
+            return std::numeric_limits<double>::infinity();
+        double d = (stats[j] - observed[j]) / scale[j];
+        sumSq += d * d;
+    }
+    return std::sqrt(sumSq);
+}
+
+AbcResult AbcSampler::closest(long numSims, long numAccept, Rng &rng){
+    struct Candidate
+    {
+        double  distance;
+        long    number;
+        std::vector<double>     proposal, stats;
+    };
+    // the closest so far in a heap with the farthest on top, ties go to the
+    // earlier proposal
+    auto closer = [](const Candidate &a, const Candidate &b){
+        return a.distance < b.distance || (a.distance == b.distance && a.number < b.number);
+    };
+    std::vector<Candidate> heap;
+    heap.reserve(numAccept);
+    int batchSize = std::max(64 * numThreads, 256);
+    long done = 0;
+    while(done < numSims){
+        long numInBatch = std::min<long>((done == 0) ? std::max(batchSize, 1000) : batchSize,
+                                         numSims - done);
+        std::vector< std::vector<double> > proposals(numInBatch);
+        std::vector<uint64_t> seeds(numInBatch);
+        for(long i = 0; i < numInBatch; i++){
+            proposals[i] = drawFromPriors(rng);
+            seeds[i] = rng.nextSeed();
+        }
+        std::vector< std::vector<double> > stats = simulateBatch(proposals, seeds);
+        if(done == 0)
+            setScale(stats);
+        for(long i = 0; i < numInBatch; i++){
+            Candidate c{distance(stats[i]), done + i, std::move(proposals[i]), std::move(stats[i])};
+            if((long) heap.size() < numAccept){
+                heap.push_back(std::move(c));
+                std::push_heap(heap.begin(), heap.end(), closer);
+            }
+            else if(closer(c, heap.front())){
+                std::pop_heap(heap.begin(), heap.end(), closer);
+                heap.back() = std::move(c);
+                std::push_heap(heap.begin(), heap.end(), closer);
+            }
+        }
+        done += numInBatch;
+    }
+    std::sort_heap(heap.begin(), heap.end(), closer);
+    AbcResult result;
+    for(auto &c : heap){
+        result.parameters.push_back(std::move(c.proposal));
+        result.statistics.push_back(std::move(c.stats));
+        result.distances.push_back(c.distance);
+    }
+    result.weights.assign(heap.size(), 1.0 / heap.size());
+    result.tolerances.push_back(result.distances.back());
+    result.numSimulations.push_back(numSims);
+    result.scale = scale;
+    result.completed = true;
+    return result;
+}
+
+void AbcSampler::toParameterScale(AbcResult &result) const {
+    for(auto &proposal : result.parameters)
+        for(unsigned k = 0; k < priors.size(); k++)
+            if(priors[k].logScale)
+                proposal[k] = std::exp(proposal[k]);
+}
+
+AbcResult AbcSampler::rejection(long numSims, long numAccept, Rng &rng){
+    AbcResult result = closest(numSims, numAccept, rng);
+    toParameterScale(result);
+    return result;
+}
+
+AbcResult AbcSampler::smc(int numParticles,
+                          int numGenerations,
+                          double alpha,
+                          long maxSims,
+                          Rng &rng){
+    long firstSims = (long) std::ceil(numParticles / alpha);
+    AbcResult result = closest(firstSims, numParticles, rng);
+    long totalSims = firstSims;
+    unsigned numFree = priors.size();
+    int batchSize = std::max(64 * numThreads, 256);
+    for(int g = 1; g < numGenerations; g++){
+        std::vector<double> sorted = result.distances;
+        std::sort(sorted.begin(), sorted.end());
+        double tolerance = sorted[std::max(0, (int) std::ceil(alpha * numParticles) - 1)];
+        // Gaussian perturbations with twice the weighted variance of the
+        // population (Beaumont et al. 2009)
+        std::vector<double> kernelSd(numFree);
+        for(unsigned k = 0; k < numFree; k++){
+            double mean = 0.0, var = 0.0;
+            for(int i = 0; i < numParticles; i++)
+                mean += result.weights[i] * result.parameters[i][k];
+            for(int i = 0; i < numParticles; i++)
+                var += result.weights[i] * (result.parameters[i][k] - mean) * (result.parameters[i][k] - mean);
+            kernelSd[k] = std::sqrt(2.0 * var);
+            if(!(kernelSd[k] > 0.0))
+                kernelSd[k] = 1e-8 * (priorUpper(priors[k]) - priorLower(priors[k]));
+        }
+        std::vector<double> cumWeights(numParticles);
+        double totalWeight = 0.0;
+        for(int i = 0; i < numParticles; i++)
+            cumWeights[i] = (totalWeight += result.weights[i]);
+
+        AbcResult next;
+        long generationSims = 0;
+        while((int) next.parameters.size() < numParticles){
+            if(totalSims >= maxSims){
+                result.completed = false;
+                break;
+            }
+            long numInBatch = std::min<long>(batchSize, maxSims - totalSims);
+            std::vector< std::vector<double> > proposals(numInBatch);
+            std::vector<uint64_t> seeds(numInBatch);
+            for(long i = 0; i < numInBatch; i++){
+                do{
+                    int j = std::upper_bound(cumWeights.begin(),
+                                             cumWeights.end(),
+                                             rng.uniform() * totalWeight) - cumWeights.begin();
+                    j = std::min(j, numParticles - 1);
+                    proposals[i] = result.parameters[j];
+                    for(unsigned k = 0; k < numFree; k++)
+                        proposals[i][k] += kernelSd[k] * rng.normal();
+                } while(!(inPriors(proposals[i])));
+                seeds[i] = rng.nextSeed();
+            }
+            std::vector< std::vector<double> > stats = simulateBatch(proposals, seeds);
+            totalSims += numInBatch;
+            generationSims += numInBatch;
+            // accepted in the order they were proposed so threads do not matter
+            for(long i = 0; i < numInBatch && (int) next.parameters.size() < numParticles; i++){
+                double d = distance(stats[i]);
+                if(d <= tolerance){
+                    next.parameters.push_back(std::move(proposals[i]));
+                    next.statistics.push_back(std::move(stats[i]));
+                    next.distances.push_back(d);
+                }
+            }
+        }
+        if(!(result.completed))
+            break;
+        // importance weights, the priors are flat on the scale of the proposals
+        next.weights.resize(numParticles);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) num_threads(numThreads)
+#endif
+        for(int i = 0; i < numParticles; i++){
+            std::vector<double> logTerms(numParticles);
+            double maxTerm = -std::numeric_limits<double>::infinity();
+            for(int j = 0; j < numParticles; j++){
+                double logKernel = 0.0;
+                for(unsigned k = 0; k < numFree; k++){
+                    double z = (next.parameters[i][k] - result.parameters[j][k]) / kernelSd[k];
+                    logKernel -= 0.5 * z * z;
+                }
+                logTerms[j] = std::log(result.weights[j]) + logKernel;
+                maxTerm = std::max(maxTerm, logTerms[j]);
+            }
+            double sumExp = 0.0;
+            for(auto lt : logTerms)
+                sumExp += std::exp(lt - maxTerm);
+            next.weights[i] = -(maxTerm + std::log(sumExp));
+        }
+        // from log weights to weights that sum to 1
+        double maxLogWeight = *std::max_element(next.weights.begin(), next.weights.end());
+        double weightSum = 0.0;
+        for(auto &w : next.weights)
+            weightSum += (w = std::exp(w - maxLogWeight));
+        for(auto &w : next.weights)
+            w /= weightSum;
+        next.tolerances = result.tolerances;
+        next.tolerances.push_back(tolerance);
+        next.numSimulations = result.numSimulations;
+        next.numSimulations.push_back(generationSims);
+        next.scale = scale;
+        next.completed = true;
+        result = std::move(next);
+    }
+    toParameterScale(result);
+    return result;
+}
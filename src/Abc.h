@@ -0,0 +1,163 @@
+//
+//  Abc.h
+//  treeducken
+//
+//  Approximate Bayesian computation that stays in C++. Parameters are drawn
+//  from their priors, simulated and reduced to summary statistics on worker
+//  threads, and only the accepted parameter and statistic vectors are kept,
+//  never the trees. Rejection keeps the proposals closest to the observed
+//  statistics, SMC is the population Monte Carlo sampler of Beaumont et al.
+//  (2009) with tolerances set from the distances of the previous generation.
+//
+//  Proposals are made in batches on the calling thread from one stream and
+//  every proposal has its own stream seeded from it, so the results do not
+//  depend on the number of threads.
+//
+
+#ifndef Abc_h
+#define Abc_h
+
+#include "Tree.h"
+#include "Cancellation.h"
+#include <vector>
+#include <string>
+#include <memory>
+
+// uniform prior of one parameter of the model, on the log scale with logScale
+struct AbcPrior
+{
+    int     parameter; // index into the parameters of the model
+    double  lower, upper;
+    bool    logScale;
+};
+
+// statistics of the models, also used on observed data. The trees only have
+// extant tips and assoc has a row for each host and a column for each
+// symbiont, in column major order.
+std::vector<double> cophyloSummary(const PhyloTree &hostTree,
+                                   const PhyloTree &symbTree,
+                                   const std::vector<double> &assoc);
+std::vector<double> geneTreeSummary(const std::vector<PhyloTree> &geneTrees);
+std::vector<std::string> cophyloSummaryNames();
+std::vector<std::string> geneTreeSummaryNames();
+
+// the tree of the tips with keep set, with unbranched nodes removed
+PhyloTree keepTips(const PhyloTree &tree, const std::vector<bool> &keep);
+
+// a simulation model reduced to its summary statistics
+class AbcModel
+{
+    public:
+        virtual         ~AbcModel() {}
+        virtual std::vector<std::string>    getStatisticNames() const = 0;
+        // statistics of one simulation, called from worker threads
+        virtual std::vector<double>         simulate(const std::vector<double> &parameters,
+                                                     std::shared_ptr<Rng> rng,
+                                                     std::shared_ptr<Cancellation> cancellation) const = 0;
+};
+
+// host and symbiont trees to time timeToSim as in sim_cophyBD, or
+// sim_cophyBD_ana with anagenesis. The parameters are the host and symbiont
+// birth and death rates, host expansion and cospeciation rates and with
+// anagenesis the dispersal and extirpation rates.
+class CophyloAbcModel : public AbcModel
+{
+    private:
+        bool    anagenesis;
+        double  timeToSim;
+        int     hostLimit;
+        bool    hsMode;
+
+    public:
+                CophyloAbcModel(bool ana, double t, int hl, bool hs) : anagenesis(ana),
+                                                                       timeToSim(t),
+                                                                       hostLimit(hl),
+                                                                       hsMode(hs) {}
+        std::vector<std::string>    getStatisticNames() const { return cophyloSummaryNames(); }
+        std::vector<double>         simulate(const std::vector<double> &parameters,
+                                             std::shared_ptr<Rng> rng,
+                                             std::shared_ptr<Cancellation> cancellation) const;
+};
+
+// gene trees of the multispecies coalescent in a fixed species tree as in
+// sim_msc, the only parameter is the effective population size
+class MscAbcModel : public AbcModel
+{
+    private:
+        PhyloTree   speciesTree;
+        bool        rescale;
+        double      mutationsPerTime;
+        int         samplesPerLineage;
+        int         numGenes;
+
+    public:
+                MscAbcModel(const PhyloTree &st, bool r, double u, int spl, int ng) : speciesTree(st),
+                                                                                      rescale(r),
+                                                                                      mutationsPerTime(u),
+                                                                                      samplesPerLineage(spl),
+                                                                                      numGenes(ng) {}
+        std::vector<std::string>    getStatisticNames() const { return geneTreeSummaryNames(); }
+        std::vector<double>         simulate(const std::vector<double> &parameters,
+                                             std::shared_ptr<Rng> rng,
+                                             std::shared_ptr<Cancellation> cancellation) const;
+};
+
+struct AbcResult
+{
+    // accepted proposals in order of their distance (rejection) or
+    // acceptance (SMC), parameters on their own scale
+    std::vector< std::vector<double> >  parameters;
+    std::vector< std::vector<double> >  statistics;
+    std::vector<double>     distances;
+    std::vector<double>     weights;
+    // one per generation, the one generation of rejection included
+    std::vector<double>     tolerances;
+    std::vector<long>       numSimulations;
+    // what the differences in each statistic are divided by
+    std::vector<double>     scale;
+    // false if SMC ran out of simulations before its last generation
+    bool                    completed;
+};
+
+class AbcSampler
+{
+    private:
+        const AbcModel          &model;
+        std::vector<double>     fixedParameters;
+        std::vector<AbcPrior>   priors;
+        std::vector<double>     observed;
+        std::vector<double>     scale;
+        int                     numThreads;
+        std::shared_ptr<Cancellation>   cancellation;
+
+        // proposals are on the scale their prior is uniform on
+        std::vector<double>     drawFromPriors(Rng &rng) const;
+        bool                    inPriors(const std::vector<double> &proposal) const;
+        std::vector< std::vector<double> >  simulateBatch(const std::vector< std::vector<double> > &proposals,
+                                                          const std::vector<uint64_t> &seeds);
+        void                    setScale(const std::vector< std::vector<double> > &stats);
+        double                  distance(const std::vector<double> &stats) const;
+        AbcResult               closest(long numSims, long numAccept, Rng &rng);
+        void                    toParameterScale(AbcResult &result) const;
+
+    public:
+                                AbcSampler(const AbcModel &m,
+                                           const std::vector<double> &fixed,
+                                           const std::vector<AbcPrior> &p,
+                                           const std::vector<double> &obs,
+                                           int nt,
+                                           std::shared_ptr<Cancellation> c);
+        // the numAccept closest of numSims proposals, the statistics are
+        // scaled by their median absolute deviation in the first batch
+        AbcResult               rejection(long numSims, long numAccept, Rng &rng);
+        // the first generation is the numParticles closest of
+        // numParticles / alpha proposals and the tolerance of each later one
+        // is the alpha quantile of the distances of the one before
+        AbcResult               smc(int numParticles,
+                                    int numGenerations,
+                                    double alpha,
+                                    long maxSims,
+                                    Rng &rng);
+};
+
+#endif /* Abc_h */
@@ -0,0 +1,138 @@
+//
+//  AssociationHistory.cpp
+//  treeducken
+//
+
+#include "AssociationHistory.h"
+#include <algorithm>
+#include <set>
+#include <utility>
+
+AssociationHistory::AssociationHistory(){
+    currentTime = 0.0;
+    minInterval = 64;
+    numCheckpoints = 0;
+}
+
+void AssociationHistory::clear(){
+    currentTime = 0.0;
+    times.clear();
+    changes.clear();
+    symbLabels.clear();
+    hostLabels.clear();
+    checkpointAt.clear();
+    numCheckpoints = 0;
+}
+
+void AssociationHistory::addChange(Change c, int symb, int host){
+    times.push_back(currentTime);
+    changes.push_back(c);
+    symbLabels.push_back(symb);
+    hostLabels.push_back(host);
+}
+
+bool AssociationHistory::needsCheckpoint(unsigned stateSize) const {
+    unsigned lastAt = checkpointAt.empty() ? 0 : checkpointAt.back();
+    return changes.size() - lastAt >= std::max(minInterval, stateSize);
+}
+
+void AssociationHistory::addCheckpoint(const State &st){
+    addCheckpoint() = st;
+}
+
+AssociationHistory::State& AssociationHistory::addCheckpoint(){
+    checkpointAt.push_back(changes.size());
+    if(numCheckpoints == checkpoints.size())
+        checkpoints.push_back(State());
+    State &st = checkpoints[numCheckpoints++];
+    st.symbionts.clear();
+    st.hosts.clear();
+    st.pairs.clear();
+    return st;
+}
+
+static void sortState(AssociationHistory::State &st){
+    std::sort(st.symbionts.begin(), st.symbionts.end());
+    std::sort(st.hosts.begin(), st.hosts.end());
+    std::vector< std::pair<int,int> > pairs(st.pairs.size() / 2);
+    for(unsigned i = 0; i < pairs.size(); i++)
+        pairs[i] = std::make_pair(st.pairs[2 * i], st.pairs[2 * i + 1]);
+    std::sort(pairs.begin(), pairs.end());
+    for(unsigned i = 0; i < pairs.size(); i++){
+        st.pairs[2 * i] = pairs[i].first;
+        st.pairs[2 * i + 1] = pairs[i].second;
+    }
+}
+
+void AssociationHistory::relabel(const std::vector<int> &symbMap,
+                                 const std::vector<int> &hostMap){
+    for(unsigned i = 0; i < changes.size(); i++){
+        if(symbLabels[i] >= 0)
+            symbLabels[i] = symbMap[symbLabels[i]];
+        if(hostLabels[i] >= 0)
+            hostLabels[i] = hostMap[hostLabels[i]];
+    }
+    for(unsigned k = 0; k < numCheckpoints; k++){
+        State &st = checkpoints[k];
+        for(auto &s : st.symbionts)
+            s = symbMap[s];
+        for(auto &h : st.hosts)
+            h = hostMap[h];
+        for(unsigned i = 0; i < st.pairs.size(); i += 2){
+            st.pairs[i] = symbMap[st.pairs[i]];
+            st.pairs[i + 1] = hostMap[st.pairs[i + 1]];
+        }
+        sortState(st);
+    }
+}
+
+AssociationHistory::State AssociationHistory::getStateAt(double t) const {
+    // changes up to and including those at t
+    unsigned numApplied = std::upper_bound(times.begin(), times.end(), t) - times.begin();
+    // last checkpoint taken at or before that change
+    unsigned k = std::upper_bound(checkpointAt.begin(), checkpointAt.end(), numApplied) - checkpointAt.begin();
+    std::set<int> symbs, hosts;
+    std::set< std::pair<int,int> > pairs;
+    unsigned start = 0;
+    if(k > 0){
+        const State &cp = checkpoints[k - 1];
+        symbs.insert(cp.symbionts.begin(), cp.symbionts.end());
+        hosts.insert(cp.hosts.begin(), cp.hosts.end());
+        for(unsigned i = 0; i < cp.pairs.size(); i += 2)
+            pairs.insert(std::make_pair(cp.pairs[i], cp.pairs[i + 1]));
+        start = checkpointAt[k - 1];
+    }
+    for(unsigned i = start; i < numApplied; i++){
+        switch(changes[i]){
+            case SymbiontBirth:
+                symbs.insert(symbLabels[i]);
+                break;
+            case SymbiontDeath:
+                symbs.erase(symbLabels[i]);
+                break;
+            case HostBirth:
+                hosts.insert(hostLabels[i]);
+                break;
+            case HostDeath:
+                hosts.erase(hostLabels[i]);
+                break;
+            case Gain:
+                pairs.insert(std::make_pair(symbLabels[i], hostLabels[i]));
+                break;
+            case Loss:
+                pairs.erase(std::make_pair(symbLabels[i], hostLabels[i]));
+                break;
+            default:
+                break;
+        }
+    }
+    State st;
+    st.symbionts.assign(symbs.begin(), symbs.end());
+    st.hosts.assign(hosts.begin(), hosts.end());
+    st.pairs.reserve(2 * pairs.size());
+    for(auto &p : pairs){
+        st.pairs.push_back(p.first);
+        st.pairs.push_back(p.second);
+    }
+    return st;
+}
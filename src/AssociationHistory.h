@@ -0,0 +1,84 @@
+//
+//  AssociationHistory.h
+//  treeducken
+//
+//  Record of every change to the host-symbiont associations of a
+//  cophylogenetic simulation with checkpoints of the full state. Lineages are
+//  identified by integer labels that are never reused.
+//
+//  A checkpoint is taken at an event boundary once the changes since the last
+//  one outnumber the lineages and associations in the current state, so the
+//  checkpoints take memory proportional to the number of changes. The state at
+//  time t is found with a binary search for the last checkpoint before t and
+//  by replaying the changes after it, and there are at most as many of those
+//  as the size of a checkpoint.
+//
+
+#ifndef AssociationHistory_h
+#define AssociationHistory_h
+
+#include <vector>
+#include <cstdint>
+
+class AssociationHistory
+{
+    public:
+        enum Change : uint8_t
+        {
+            SymbiontBirth = 0,
+            SymbiontDeath,
+            HostBirth,
+            HostDeath,
+            Gain,
+            Loss,
+            NumChanges
+        };
+
+        struct State
+        {
+            std::vector<int>    symbionts; // sorted
+            std::vector<int>    hosts; // sorted
+            std::vector<int>    pairs; // symbiont, host pairs sorted
+            unsigned            size() const { return symbionts.size() + hosts.size() + pairs.size() / 2; }
+        };
+
+    private:
+        double                  currentTime;
+        std::vector<double>     times;
+        std::vector<uint8_t>    changes;
+        std::vector<int32_t>    symbLabels; // -1 for host births and deaths
+        std::vector<int32_t>    hostLabels; // -1 for symbiont births and deaths
+        std::vector<unsigned>   checkpointAt; // number of changes before each checkpoint
+        // the first numCheckpoints are in use, the rest are kept from before
+        // the last clear so their vectors can be filled again
+        std::vector<State>      checkpoints;
+        unsigned                numCheckpoints;
+        unsigned                minInterval;
+
+    public:
+                    AssociationHistory();
+        void        clear();
+        void        setTime(double t) { currentTime = t; }
+        void        addChange(Change c, int symb, int host);
+        // whether the changes since the last checkpoint call for a new one
+        bool        needsCheckpoint(unsigned stateSize) const;
+        void        addCheckpoint(const State &st);
+        // an empty checkpoint at the current change to be filled in
+        State&      addCheckpoint();
+        // labels of lineages after the simulation, e.g. their ape node numbers
+        void        relabel(const std::vector<int> &symbMap, const std::vector<int> &hostMap);
+
+        unsigned    getNumChanges() const { return changes.size(); }
+        double      getTime(unsigned i) const { return times[i]; }
+        Change      getChange(unsigned i) const { return static_cast<Change>(changes[i]); }
+        int         getSymbiont(unsigned i) const { return symbLabels[i]; }
+        int         getHost(unsigned i) const { return hostLabels[i]; }
+        unsigned    getNumCheckpoints() const { return numCheckpoints; }
+        unsigned    getCheckpointAt(unsigned k) const { return checkpointAt[k]; }
+        const State&    getCheckpoint(unsigned k) const { return checkpoints[k]; }
+
+        // the state after all of the changes at or before t
+        State       getStateAt(double t) const;
+};
+
+#endif /* AssociationHistory_h */
@@ -0,0 +1,473 @@
+//
+//  AssociationMatrix.cpp
+//  treeducken
+//
+
+#include "AssociationMatrix.h"
+#include <algorithm>
+
+static inline unsigned lowestBit(uint64_t w){
+    return __builtin_ctzll(w);
+}
+
+// swap-and-pop removal from an unordered list
+static inline bool eraseValue(std::vector<unsigned> &v, unsigned x){
+    for(unsigned i = 0; i < v.size(); i++){
+        if(v[i] == x){
+            v[i] = v.back();
+            v.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void SlotSet::insert(unsigned slot){
+    if(slot >= pos.size())
+        pos.resize(slot + 1, -1);
+    if(pos[slot] >= 0)
+        return;
+    pos[slot] = members.size();
+    members.push_back(slot);
+}
+
+void SlotSet::erase(unsigned slot){
+    if(slot >= pos.size() || pos[slot] < 0)
+        return;
+    unsigned last = members.back();
+    members[pos[slot]] = last;
+    pos[last] = pos[slot];
+    members.pop_back();
+    pos[slot] = -1;
+}
+
+AssociationMatrix::AssociationMatrix(){
+    sparse = false;
+    hostLimit = 0;
+    nextSymbId = 0;
+    nextHostId = 0;
+    numAssociations = 0;
+    history = nullptr;
+    numWords = 1;
+    liveHosts.assign(1, 0);
+}
+
+void AssociationMatrix::clear(){
+    numWords = 1;
+    rows.clear();
+    liveHosts.assign(1, 0);
+    rowCounts.clear();
+    colCounts.clear();
+    symbOrder.clear();
+    hostOrder.clear();
+    symbPos.clear();
+    hostPos.clear();
+    freeSymbSlots.clear();
+    freeHostSlots.clear();
+    symbHosts.clear();
+    hostSymbs.clear();
+    occupiedHosts.clear();
+    overLimitSymbs.clear();
+    symbIds.clear();
+    hostIds.clear();
+    nextSymbId = 0;
+    nextHostId = 0;
+    numAssociations = 0;
+}
+
+void AssociationMatrix::reset(unsigned numSymbs, unsigned numHosts){
+    clear();
+    numWords = std::max(1u, (numHosts + 63) / 64);
+    liveHosts.assign(numWords, 0);
+    for(unsigned h = 0; h < numHosts; h++)
+        addHost();
+    for(unsigned s = 0; s < numSymbs; s++){
+        addSymbiont();
+        for(unsigned h = 0; h < numHosts; h++)
+            associate(s, h);
+    }
+}
+
+void AssociationMatrix::incrementColCount(unsigned hostSlot){
+    if(colCounts[hostSlot]++ == 0)
+        occupiedHosts.insert(hostSlot);
+}
+
+void AssociationMatrix::decrementColCount(unsigned hostSlot){
+    if(--colCounts[hostSlot] == 0)
+        occupiedHosts.erase(hostSlot);
+}
+
+void AssociationMatrix::recordChange(AssociationHistory::Change c, int symbSlot, int hostSlot){
+    history->addChange(c,
+                       symbSlot < 0 ? -1 : symbIds[symbSlot],
+                       hostSlot < 0 ? -1 : hostIds[hostSlot]);
+}
+
+void AssociationMatrix::updateOverLimit(unsigned symbSlot){
+    if(hostLimit > 0 && rowCounts[symbSlot] > hostLimit)
+        overLimitSymbs.insert(symbSlot);
+    else
+        overLimitSymbs.erase(symbSlot);
+}
+
+// doubles the number of host slots, the only time rows are copied
+void AssociationMatrix::growHostSlots(){
+    unsigned newNumWords = 2 * numWords;
+    std::vector<uint64_t> newRows(rowCounts.size() * newNumWords, 0);
+    for(unsigned slot = 0; slot < rowCounts.size(); slot++)
+        std::copy(getRow(slot), getRow(slot) + numWords, &newRows[slot * newNumWords]);
+    rows.swap(newRows);
+    liveHosts.resize(newNumWords, 0);
+    numWords = newNumWords;
+}
+
+unsigned AssociationMatrix::newSymbiontSlot(){
+    if(!(freeSymbSlots.empty())){
+        unsigned slot = freeSymbSlots.back();
+        freeSymbSlots.pop_back();
+        return slot;
+    }
+    if(sparse)
+        symbHosts.push_back(std::vector<unsigned>());
+    else
+        rows.resize(rows.size() + numWords, 0);
+    rowCounts.push_back(0);
+    symbPos.push_back(0);
+    symbIds.push_back(0);
+    return rowCounts.size() - 1;
+}
+
+unsigned AssociationMatrix::newHostSlot(){
+    if(!(freeHostSlots.empty())){
+        unsigned slot = freeHostSlots.back();
+        freeHostSlots.pop_back();
+        return slot;
+    }
+    if(sparse)
+        hostSymbs.push_back(std::vector<unsigned>());
+    else if(colCounts.size() == 64 * numWords)
+        growHostSlots();
+    colCounts.push_back(0);
+    hostPos.push_back(0);
+    hostIds.push_back(0);
+    return colCounts.size() - 1;
+}
+
+void AssociationMatrix::addSymbiont(){
+    unsigned slot = newSymbiontSlot();
+    symbIds[slot] = nextSymbId++;
+    symbPos[slot] = symbOrder.size();
+    symbOrder.push_back(slot);
+    if(history)
+        recordChange(AssociationHistory::SymbiontBirth, slot, -1);
+}
+
+void AssociationMatrix::addHost(){
+    unsigned slot = newHostSlot();
+    hostIds[slot] = nextHostId++;
+    if(!sparse)
+        liveHosts[slot >> 6] |= uint64_t(1) << (slot & 63);
+    hostPos[slot] = hostOrder.size();
+    hostOrder.push_back(slot);
+    if(history)
+        recordChange(AssociationHistory::HostBirth, -1, slot);
+}
+
+void AssociationMatrix::removeSymbiont(unsigned s){
+    unsigned slot = symbOrder[s];
+    if(history){
+        for(auto h : getHostsOf(s))
+            recordChange(AssociationHistory::Loss, slot, hostOrder[h]);
+        recordChange(AssociationHistory::SymbiontDeath, slot, -1);
+    }
+    if(sparse){
+        // in slot order like the bit sets so both modes update the
+        // occupied hosts in the same order
+        std::sort(symbHosts[slot].begin(), symbHosts[slot].end());
+        for(auto hostSlot : symbHosts[slot]){
+            eraseValue(hostSymbs[hostSlot], slot);
+            decrementColCount(hostSlot);
+        }
+        symbHosts[slot].clear();
+    }
+    else{
+        uint64_t *row = getRow(slot);
+        for(unsigned w = 0; w < numWords; w++){
+            for(uint64_t bits = row[w]; bits != 0; bits &= bits - 1)
+                decrementColCount(64 * w + lowestBit(bits));
+            row[w] = 0;
+        }
+    }
+    numAssociations -= rowCounts[slot];
+    rowCounts[slot] = 0;
+    overLimitSymbs.erase(slot);
+    symbOrder.erase(symbOrder.begin() + s);
+    for(unsigned i = s; i < symbOrder.size(); i++)
+        symbPos[symbOrder[i]] = i;
+    freeSymbSlots.push_back(slot);
+}
+
+void AssociationMatrix::removeHost(unsigned h){
+    unsigned slot = hostOrder[h];
+    if(history){
+        for(auto s : getSymbiontsOn(h))
+            recordChange(AssociationHistory::Loss, symbOrder[s], slot);
+        recordChange(AssociationHistory::HostDeath, -1, slot);
+    }
+    if(sparse){
+        for(auto symbSlot : hostSymbs[slot]){
+            eraseValue(symbHosts[symbSlot], slot);
+            rowCounts[symbSlot]--;
+            updateOverLimit(symbSlot);
+        }
+        hostSymbs[slot].clear();
+    }
+    else{
+        unsigned w = slot >> 6;
+        uint64_t bit = uint64_t(1) << (slot & 63);
+        if(colCounts[slot] > 0){
+            for(auto symbSlot : symbOrder){
+                uint64_t &word = getRow(symbSlot)[w];
+                if(word & bit){
+                    word &= ~bit;
+                    rowCounts[symbSlot]--;
+                    updateOverLimit(symbSlot);
+                }
+            }
+        }
+        liveHosts[w] &= ~bit;
+    }
+    numAssociations -= colCounts[slot];
+    colCounts[slot] = 0;
+    occupiedHosts.erase(slot);
+    hostOrder.erase(hostOrder.begin() + h);
+    for(unsigned i = h; i < hostOrder.size(); i++)
+        hostPos[hostOrder[i]] = i;
+    freeHostSlots.push_back(slot);
+}
+
+bool AssociationMatrix::isAssociated(unsigned s, unsigned h) const {
+    unsigned symbSlot = symbOrder[s];
+    unsigned hostSlot = hostOrder[h];
+    if(sparse){
+        // search the shorter of the two lists
+        if(rowCounts[symbSlot] <= colCounts[hostSlot]){
+            const std::vector<unsigned> &hosts = symbHosts[symbSlot];
+            return std::find(hosts.begin(), hosts.end(), hostSlot) != hosts.end();
+        }
+        const std::vector<unsigned> &symbs = hostSymbs[hostSlot];
+        return std::find(symbs.begin(), symbs.end(), symbSlot) != symbs.end();
+    }
+    return (getRow(symbSlot)[hostSlot >> 6] >> (hostSlot & 63)) & 1;
+}
+
+void AssociationMatrix::associate(unsigned s, unsigned h){
+    if(isAssociated(s, h))
+        return;
+    unsigned symbSlot = symbOrder[s];
+    unsigned hostSlot = hostOrder[h];
+    if(sparse){
+        symbHosts[symbSlot].push_back(hostSlot);
+        hostSymbs[hostSlot].push_back(symbSlot);
+    }
+    else{
+        getRow(symbSlot)[hostSlot >> 6] |= uint64_t(1) << (hostSlot & 63);
+    }
+    rowCounts[symbSlot]++;
+    incrementColCount(hostSlot);
+    numAssociations++;
+    updateOverLimit(symbSlot);
+    if(history)
+        recordChange(AssociationHistory::Gain, symbSlot, hostSlot);
+}
+
+void AssociationMatrix::dissociate(unsigned s, unsigned h){
+    unsigned symbSlot = symbOrder[s];
+    unsigned hostSlot = hostOrder[h];
+    if(sparse){
+        if(!(eraseValue(symbHosts[symbSlot], hostSlot)))
+            return;
+        eraseValue(hostSymbs[hostSlot], symbSlot);
+    }
+    else{
+        uint64_t &word = getRow(symbSlot)[hostSlot >> 6];
+        uint64_t bit = uint64_t(1) << (hostSlot & 63);
+        if(!(word & bit))
+            return;
+        word &= ~bit;
+    }
+    rowCounts[symbSlot]--;
+    decrementColCount(hostSlot);
+    numAssociations--;
+    updateOverLimit(symbSlot);
+    if(history)
+        recordChange(AssociationHistory::Loss, symbSlot, hostSlot);
+}
+
+// slots to sorted extant indices
+std::vector<unsigned> AssociationMatrix::toHostIndices(std::vector<unsigned> slots) const {
+    for(auto &h : slots)
+        h = hostPos[h];
+    std::sort(slots.begin(), slots.end());
+    return slots;
+}
+
+std::vector<unsigned> AssociationMatrix::toSymbiontIndices(std::vector<unsigned> slots) const {
+    for(auto &s : slots)
+        s = symbPos[s];
+    std::sort(slots.begin(), slots.end());
+    return slots;
+}
+
+std::vector<unsigned> AssociationMatrix::getHostsOf(unsigned s) const {
+    unsigned symbSlot = symbOrder[s];
+    if(sparse)
+        return toHostIndices(symbHosts[symbSlot]);
+    const uint64_t *row = getRow(symbSlot);
+    std::vector<unsigned> hosts;
+    hosts.reserve(rowCounts[symbSlot]);
+    for(unsigned w = 0; w < numWords; w++)
+        for(uint64_t bits = row[w]; bits != 0; bits &= bits - 1)
+            hosts.push_back(64 * w + lowestBit(bits));
+    return toHostIndices(hosts);
+}
+
+unsigned AssociationMatrix::getUnoccupiedHostOf(unsigned s, unsigned k) const {
+    // step over the occupied hosts at or before the k-th free one
+    unsigned h = k;
+    for(auto occ : getHostsOf(s)){
+        if(occ > h)
+            break;
+        h++;
+    }
+    return h;
+}
+
+std::vector<unsigned> AssociationMatrix::getSymbiontsOn(unsigned h) const {
+    unsigned hostSlot = hostOrder[h];
+    if(sparse)
+        return toSymbiontIndices(hostSymbs[hostSlot]);
+    unsigned w = hostSlot >> 6;
+    uint64_t bit = uint64_t(1) << (hostSlot & 63);
+    std::vector<unsigned> symbs;
+    unsigned numLeft = colCounts[hostSlot];
+    symbs.reserve(numLeft);
+    for(unsigned s = 0; s < symbOrder.size() && numLeft > 0; s++){
+        if(getRow(symbOrder[s])[w] & bit){
+            symbs.push_back(s);
+            numLeft--;
+        }
+    }
+    return symbs;
+}
+
+std::vector<unsigned> AssociationMatrix::getSymbiontsOverLimit() const {
+    std::vector<unsigned> slots(overLimitSymbs.size());
+    for(unsigned i = 0; i < overLimitSymbs.size(); i++)
+        slots[i] = overLimitSymbs[i];
+    return toSymbiontIndices(slots);
+}
+
+// the daughters take over the parent's hosts without the counts of those
+// hosts passing through 0
+void AssociationMatrix::splitSymbiont(unsigned s){
+    unsigned parentSlot = symbOrder[s];
+    std::vector<unsigned> hostsOfParent;
+    if(history){
+        hostsOfParent = getHostsOf(s);
+        for(auto h : hostsOfParent)
+            recordChange(AssociationHistory::Loss, parentSlot, hostOrder[h]);
+        recordChange(AssociationHistory::SymbiontDeath, parentSlot, -1);
+    }
+    unsigned numHostsOfParent = rowCounts[parentSlot];
+    bool parentOverLimit = hostLimit > 0 && numHostsOfParent > hostLimit;
+    std::vector<unsigned> parentHosts;
+    std::vector<uint64_t> parentRow;
+    if(sparse){
+        parentHosts.swap(symbHosts[parentSlot]);
+        std::sort(parentHosts.begin(), parentHosts.end());
+    }
+    else{
+        parentRow.assign(getRow(parentSlot), getRow(parentSlot) + numWords);
+        std::fill(getRow(parentSlot), getRow(parentSlot) + numWords, 0);
+    }
+    rowCounts[parentSlot] = 0;
+    overLimitSymbs.erase(parentSlot);
+    numAssociations += numHostsOfParent;
+    symbOrder.erase(symbOrder.begin() + s);
+    for(unsigned i = s; i < symbOrder.size(); i++)
+        symbPos[symbOrder[i]] = i;
+    freeSymbSlots.push_back(parentSlot);
+
+    unsigned daughterSlots[2];
+    for(int d = 0; d < 2; d++){
+        addSymbiont();
+        daughterSlots[d] = symbOrder.back();
+        rowCounts[daughterSlots[d]] = numHostsOfParent;
+        if(parentOverLimit)
+            overLimitSymbs.insert(daughterSlots[d]);
+    }
+    if(sparse){
+        for(auto hostSlot : parentHosts){
+            std::vector<unsigned> &symbs = hostSymbs[hostSlot];
+            std::replace(symbs.begin(), symbs.end(), parentSlot, daughterSlots[0]);
+            symbs.push_back(daughterSlots[1]);
+            colCounts[hostSlot]++;
+        }
+        symbHosts[daughterSlots[0]] = parentHosts;
+        symbHosts[daughterSlots[1]].swap(parentHosts);
+    }
+    else{
+        for(int d = 0; d < 2; d++)
+            std::copy(parentRow.begin(), parentRow.end(), getRow(daughterSlots[d]));
+        for(unsigned w = 0; w < numWords; w++)
+            for(uint64_t bits = parentRow[w]; bits != 0; bits &= bits - 1)
+                colCounts[64 * w + lowestBit(bits)]++;
+    }
+    if(history){
+        for(int d = 0; d < 2; d++)
+            for(auto h : hostsOfParent)
+                recordChange(AssociationHistory::Gain, daughterSlots[d], hostOrder[h]);
+    }
+}
+
+void AssociationMatrix::splitHost(unsigned h){
+    removeHost(h);
+    addHost();
+    addHost();
+}
+
+void AssociationMatrix::getIdState(AssociationHistory::State &st) const {
+    // the pairs are sorted when the history is relabelled, so they are
+    // taken in slot order straight from the rows
+    for(unsigned s = 0; s < symbOrder.size(); s++){
+        unsigned symbSlot = symbOrder[s];
+        st.symbionts.push_back(symbIds[symbSlot]);
+        if(sparse){
+            for(auto hostSlot : symbHosts[symbSlot]){
+                st.pairs.push_back(symbIds[symbSlot]);
+                st.pairs.push_back(hostIds[hostSlot]);
+            }
+            continue;
+        }
+        const uint64_t *row = getRow(symbSlot);
+        for(unsigned w = 0; w < numWords; w++){
+            for(uint64_t bits = row[w]; bits != 0; bits &= bits - 1){
+                st.pairs.push_back(symbIds[symbSlot]);
+                st.pairs.push_back(hostIds[64 * w + lowestBit(bits)]);
+            }
+        }
+    }
+    for(unsigned h = 0; h < hostOrder.size(); h++)
+        st.hosts.push_back(hostIds[hostOrder[h]]);
+}
+
+std::vector<int> AssociationMatrix::getMatrix() const {
+    size_t numHosts = getNumHosts();
+    std::vector<int> assoc(numHosts * getNumSymbionts(), 0);
+    for(unsigned s = 0; s < symbOrder.size(); s++)
+        for(auto h : getHostsOf(s))
+            assoc[s * numHosts + h] = 1;
+    return assoc;
+}
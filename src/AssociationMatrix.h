@@ -0,0 +1,141 @@
+//
+//  AssociationMatrix.h
+//  treeducken
+//
+//  Associations between the extant symbionts (rows) and extant hosts (columns)
+//  of a cophylogenetic simulation. Rows and columns are kept in the same order
+//  as the extant lineages of the symbiont and host trees, so a speciation
+//  removes the parent and appends its two daughters at the end.
+//
+//  Each lineage lives in a slot that does not move while it is extant. Rows
+//  are bit sets over host slots and freed slots are reused, so births and
+//  deaths never copy the matrix. Only the extant order (extant index -> slot)
+//  is shifted, and the dense matrix is built in extant order on export. That
+//  shift is the same erase the trees do on their extant nodes for the event,
+//  and keeping it means an extant index is always one lookup away.
+//
+//  In sparse mode rows are instead lists of host slots and every host keeps a
+//  list of its symbiont slots, so updates cost O(degree) rather than O(hosts)
+//  when each symbiont only uses a handful of hosts.
+//
+//  The hosts with at least one symbiont and the symbionts over the host limit
+//  are kept as indexed sets that are updated whenever a count changes, so
+//  drawing an occupied host or enforcing the host limit does not scan the
+//  matrix.
+//
+//  Every lineage also gets an id in order of creation that is never reused.
+//  When a history is attached each change is recorded against those ids.
+//
+
+#ifndef AssociationMatrix_h
+#define AssociationMatrix_h
+
+#include <vector>
+#include <cstdint>
+#include "AssociationHistory.h"
+
+// set of slots with O(1) insert, erase and access by position
+class SlotSet
+{
+    private:
+        std::vector<unsigned>   members;
+        std::vector<int>        pos; // slot -> position in members or -1
+
+    public:
+        void        insert(unsigned slot);
+        void        erase(unsigned slot);
+        void        clear() { members.clear(); pos.clear(); }
+        unsigned    size() const { return members.size(); }
+        unsigned    operator[](unsigned i) const { return members[i]; }
+};
+
+class AssociationMatrix
+{
+    private:
+        bool                    sparse;
+        unsigned                hostLimit; // 0 for no limit
+        unsigned                numWords; // 64 bit words per row
+        std::vector<uint64_t>   rows; // numWords words per symbiont slot
+        std::vector<uint64_t>   liveHosts; // mask of host slots in use
+        std::vector<unsigned>   rowCounts, colCounts; // by slot
+        std::vector<unsigned>   symbOrder, hostOrder; // extant index -> slot
+        std::vector<unsigned>   symbPos, hostPos; // slot -> extant index
+        std::vector<unsigned>   freeSymbSlots, freeHostSlots;
+        // sparse mode adjacency lists by slot (unordered)
+        std::vector< std::vector<unsigned> >    symbHosts, hostSymbs;
+        SlotSet                 occupiedHosts; // host slots with symbionts
+        SlotSet                 overLimitSymbs; // symbiont slots over hostLimit
+        std::vector<int>        symbIds, hostIds; // by slot
+        int                     nextSymbId, nextHostId;
+        unsigned                numAssociations;
+        AssociationHistory*     history;
+
+        uint64_t*   getRow(unsigned slot) { return &rows[slot * numWords]; }
+        const uint64_t* getRow(unsigned slot) const { return &rows[slot * numWords]; }
+        unsigned    newSymbiontSlot();
+        unsigned    newHostSlot();
+        void        growHostSlots();
+        void        incrementColCount(unsigned hostSlot);
+        void        decrementColCount(unsigned hostSlot);
+        void        updateOverLimit(unsigned symbSlot);
+        void        recordChange(AssociationHistory::Change c, int symbSlot, int hostSlot);
+        std::vector<unsigned>   toHostIndices(std::vector<unsigned> slots) const;
+        std::vector<unsigned>   toSymbiontIndices(std::vector<unsigned> slots) const;
+
+    public:
+                    AssociationMatrix();
+        // every symbiont associated with every host
+        void        reset(unsigned numSymbs, unsigned numHosts);
+        void        clear();
+        // switches between bit set and adjacency list storage, must be
+        // called before reset
+        void        setSparse(bool s) { sparse = s; }
+        bool        getIsSparse() const { return sparse; }
+        // symbionts with more hosts than this are reported by
+        // getSymbiontsOverLimit, must be called before reset
+        void        setHostLimit(unsigned limit) { hostLimit = limit; }
+        // changes are recorded to h (if not null) from the next reset on
+        void        setHistory(AssociationHistory *h) { history = h; }
+        unsigned    getNumSymbionts() const { return symbOrder.size(); }
+        unsigned    getNumHosts() const { return hostOrder.size(); }
+        int         getSymbiontId(unsigned s) const { return symbIds[symbOrder[s]]; }
+        int         getHostId(unsigned h) const { return hostIds[hostOrder[h]]; }
+        unsigned    getNumAssociations() const { return numAssociations; }
+        // slots ever allocated, the most lineages extant at once
+        unsigned    getNumSymbiontSlots() const { return rowCounts.size(); }
+        unsigned    getNumHostSlots() const { return colCounts.size(); }
+        int         getNumSymbiontIds() const { return nextSymbId; }
+        int         getNumHostIds() const { return nextHostId; }
+        // the extant lineages and associations by id, added to the empty
+        // state st of a checkpoint
+        void        getIdState(AssociationHistory::State &st) const;
+        bool        isAssociated(unsigned s, unsigned h) const;
+        void        associate(unsigned s, unsigned h);
+        void        dissociate(unsigned s, unsigned h);
+        unsigned    getNumHostsOf(unsigned s) const { return rowCounts[symbOrder[s]]; }
+        unsigned    getNumSymbiontsOn(unsigned h) const { return colCounts[hostOrder[h]]; }
+        // indices in increasing order
+        std::vector<unsigned>   getHostsOf(unsigned s) const;
+        std::vector<unsigned>   getSymbiontsOn(unsigned h) const;
+        std::vector<unsigned>   getSymbiontsOverLimit() const;
+        // the k-th host, in extant order, that s is not associated with
+        unsigned    getUnoccupiedHostOf(unsigned s, unsigned k) const;
+        // hosts with at least one symbiont, in no particular order
+        unsigned    getNumOccupiedHosts() const { return occupiedHosts.size(); }
+        unsigned    getOccupiedHost(unsigned k) const { return hostPos[occupiedHosts[k]]; }
+
+        void        addSymbiont();
+        void        addHost();
+        void        removeSymbiont(unsigned s);
+        void        removeHost(unsigned h);
+        // the parent is removed and two daughters with its hosts are appended
+        void        splitSymbiont(unsigned s);
+        // the parent is removed and two daughters without symbionts are appended
+        void        splitHost(unsigned h);
+
+        // dense hosts x symbionts 0/1 matrix in extant order, stored column
+        // by column (one symbiont after another)
+        std::vector<int>    getMatrix() const;
+};
+
+#endif /* AssociationMatrix_h */
@@ -0,0 +1,50 @@
+//
+//  Cancellation.h
+//  treeducken
+//
+//  Cooperative cancellation of long simulations. The event loops of a
+//  Simulator check every so many events, any thread stops once cancel() is
+//  called and the thread that made the Cancellation also asks poll whether
+//  to stop (the R functions look for a user interrupt there, which can only
+//  be done on R's thread).
+//
+
+#ifndef Cancellation_h
+#define Cancellation_h
+
+#include <atomic>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+
+class SimulationCancelled : public std::runtime_error
+{
+    public:
+        SimulationCancelled() : std::runtime_error("the simulation was interrupted") {}
+};
+
+class Cancellation
+{
+    private:
+        std::atomic<bool>       cancelled;
+        std::function<bool()>   poll;
+        std::thread::id         owner;
+
+    public:
+        Cancellation(std::function<bool()> p = nullptr) : cancelled(false),
+                                                          poll(p),
+                                                          owner(std::this_thread::get_id()) {}
+        void    cancel() { cancelled = true; }
+        // polls when called from the thread that made this, safe from any thread
+        bool    requested() {
+            if(!cancelled && poll && std::this_thread::get_id() == owner && poll())
+                cancelled = true;
+            return cancelled;
+        }
+        void    check() {
+            if(requested())
+                throw SimulationCancelled();
+        }
+};
+
+#endif /* Cancellation_h */
@@ -1,138 +1,359 @@
-#include <RcppArmadillo.h>
-#include "SymbiontTree.h"
-#include "Simulator.h"
+#include "Treeducken.h"
+#include <algorithm>
+#include <string>
+#include <functional>
 using namespace Rcpp;
 
-Rcpp::List sim_host_symb_treepair_ana(double hostbr,
-                                  double hostdr,
-                                  double symbbr,
-                                  double symbdr,
-                                  double symb_dispersal,
-                                  double symb_extirpation,
-                                  double switchRate,
-                                  double cospeciationRate,
-                                  double timeToSimTo,
-                                  int host_limit,
-                                  int numbsim,
-                                  bool hsMode){
-    double rho = 1.0;
-    Rcpp::List multiphy;
-    Rcpp::List hostSymbPair;
-    for(int i = 0; i < numbsim; i++){
-        auto phySimulator = std::shared_ptr<Simulator>(new Simulator( timeToSimTo,
-                                                                      hostbr,
-                                                                      hostdr,
-                                                                      symbbr,
-                                                                      symbdr,
-                                                                      symb_dispersal,
-                                                                      symb_extirpation,
-                                                                      switchRate,
-                                                                      cospeciationRate,
-                                                                      rho,
-                                                                      host_limit,
-                                                                      hsMode));
-
-        phySimulator->simHostSymbSpeciesTreePairWithAnagenesis();
-
-
-
-
-
-        List phyHost = List::create(Named("edge") = phySimulator->getSpeciesEdges(),
-                                    Named("edge.length") = phySimulator->getSpeciesEdgeLengths(),
-                                    Named("Nnode") = phySimulator->getSpeciesNnodes(),
-                                    Named("tip.label") = phySimulator->getSpeciesTipNames(),
-                                    Named("root.edge") = phySimulator->getSpeciesTreeRootEdge());
-        phyHost.attr("class") = "phylo";
-
-
-        List phySymb = List::create(Named("edge") = phySimulator->getSymbiontEdges(),
-                                    Named("edge.length") = phySimulator->getSymbiontEdgeLengths(),
-                                    Named("Nnode") = phySimulator->getSymbiontNnodes(),
-                                    Named("tip.label") = phySimulator->getSymbiontTipNames(),
-                                    Named("root.edge") = phySimulator->getSymbiontTreeRootEdge());
-        phySymb.attr("class") = "phylo";
-        Rcpp::NumericMatrix assocMat = Rcpp::wrap(phySimulator->getAssociationMatrix());
-        assocMat = Rcpp::transpose(assocMat);
-        Rcpp::CharacterVector hostNames = phySimulator->getExtantHostNames(phySimulator->getSpeciesTipNames());
-        Rcpp::CharacterVector symbNames = phySimulator->getExtantSymbNames(phySimulator->getSymbiontTipNames());
-        Rcpp::rownames(assocMat) = hostNames;
-        Rcpp::colnames(assocMat) = symbNames;
-        hostSymbPair = List::create(Named("host_tree") = phyHost,
-                                    Named("symb_tree") = phySymb,
-                                    Named("association_mat") = assocMat,
-                                    Named("event_history") = phySimulator->createEventDF());
-        hostSymbPair.attr("class") = "cophy";
-        multiphy.push_back(hostSymbPair);
+// event log as a data frame, from the C++ node indexing where the root is
+// index 0 to the APE package indexing where the root is numTips+1
+Rcpp::DataFrame eventLogToR(const EventLog &eventLog,
+                            const std::vector<int> &hostNumbers,
+                            const std::vector<int> &symbNumbers){
+    unsigned numEvents = eventLog.size();
+    Rcpp::IntegerVector symbIndx(numEvents), hostIndx(numEvents), eventType(numEvents);
+    Rcpp::NumericVector eventTimes(numEvents);
+    for(unsigned i = 0; i < numEvents; i++){
+        int s = eventLog.getSymbiontIndex(i);
+        int h = eventLog.getHostIndex(i);
+        symbIndx[i] = symbNumbers.empty() ? s : symbNumbers[s];
+        hostIndx[i] = hostNumbers.empty() ? h : hostNumbers[h];
+        eventType[i] = eventLog.getType(i) + 1;
+        eventTimes[i] = eventLog.getTime(i);
     }
+    Rcpp::CharacterVector levels(EventLog::NumTypes);
+    for(int e = 0; e < EventLog::NumTypes; e++)
+        levels[e] = EventLog::getTypeName(static_cast<EventLog::Type>(e));
+    eventType.attr("levels") = levels;
+    eventType.attr("class") = "factor";
+    DataFrame df = DataFrame::create(Named("Symbiont_Index") = symbIndx,
+                                     Named("Host_Index") = hostIndx,
+                                     Named("Event_Type") = eventType,
+                                     Named("Event_Time") = eventTimes);
+    return df;
+}
+
+// ape numbers of the nodes of a simulated tree
+static std::vector<int> nodeNumbers(Tree &tree){
+    std::vector<int> numbers(tree.getNodesSize());
+    for(int i = 0; i < tree.getNodesSize(); i++)
+        numbers[i] = tree.getIndexFromNodes(i);
+    return numbers;
+}
+
+// rates of the scheduler channels before each event of a tree pair, see
+// Simulator::getEventRateLog
+static Rcpp::DataFrame eventRatesToR(const std::vector<double> &rateLog){
+    int width = EventScheduler::NumChannels + 1;
+    int numEvents = rateLog.size() / width;
+    Rcpp::List columns(width);
+    Rcpp::CharacterVector names(width);
+    for(int c = 0; c < width; c++){
+        Rcpp::NumericVector column(numEvents);
+        for(int i = 0; i < numEvents; i++)
+            column[i] = rateLog[i * width + c];
+        columns[c] = column;
+        if(c == 0)
+            names[c] = "Event_Time";
+        else
+            names[c] = EventScheduler::getChannelName(static_cast<EventScheduler::Channel>(c - 1));
+    }
+    columns.attr("names") = names;
+    return Rcpp::DataFrame(columns);
+}
 
+// R objects of a finished tree pair, only on the main thread
+static Rcpp::List cophyToList(Simulator &phySimulator){
+    List phyHost = List::create(Named("edge") = edgesToR(phySimulator.getSpeciesEdges()),
+                                Named("edge.length") = phySimulator.getSpeciesEdgeLengths(),
+                                Named("Nnode") = phySimulator.getSpeciesNnodes(),
+                                Named("tip.label") = phySimulator.getSpeciesTipNames(),
+                                Named("root.edge") = phySimulator.getSpeciesTreeRootEdge());
+    phyHost.attr("class") = "phylo";
 
+
+    List phySymb = List::create(Named("edge") = edgesToR(phySimulator.getSymbiontEdges()),
+                                Named("edge.length") = phySimulator.getSymbiontEdgeLengths(),
+                                Named("Nnode") = phySimulator.getSymbiontNnodes(),
+                                Named("tip.label") = phySimulator.getSymbiontTipNames(),
+                                Named("root.edge") = phySimulator.getSymbiontTreeRootEdge());
+    phySymb.attr("class") = "phylo";
+    Rcpp::CharacterVector hostNames = Rcpp::wrap(phySimulator.getExtantHostNames(phySimulator.getSpeciesTipNames()));
+    Rcpp::CharacterVector symbNames = Rcpp::wrap(phySimulator.getExtantSymbNames(phySimulator.getSymbiontTipNames()));
+    std::vector<int> assoc = phySimulator.getAssociationMatrix();
+    Rcpp::NumericMatrix assocMat(hostNames.size(), symbNames.size(), assoc.begin());
+    Rcpp::rownames(assocMat) = hostNames;
+    Rcpp::colnames(assocMat) = symbNames;
+    Rcpp::List hostSymbPair = List::create(Named("host_tree") = phyHost,
+                                           Named("symb_tree") = phySymb,
+                                           Named("association_mat") = assocMat,
+                                           Named("event_history") = eventLogToR(phySimulator.getEventLog(),
+                                                                                nodeNumbers(*(phySimulator.getSpeciesTree())),
+                                                                                nodeNumbers(*(phySimulator.getSymbiontTree()))));
+    if(phySimulator.getKeepsAssociationHistory())
+        hostSymbPair.attr("association_history") = associationHistoryToList(phySimulator.getAssociationHistory());
+    if(phySimulator.getStats())
+        hostSymbPair.attr("event_rates") = eventRatesToR(phySimulator.getEventRateLog());
+    hostSymbPair.attr("class") = "cophy";
+    return hostSymbPair;
+}
+
+// adds the records of a finished tree pair to an archive
+static void addCophyToArchive(Simulator &phySimulator, TreeArchiveWriter &archive, long replicate){
+    std::vector<int> hostNumbers, symbNumbers;
+    archive.add(treeRecord(*(phySimulator.getSpeciesTree()), false, &hostNumbers), replicate);
+    archive.add(treeRecord(*(phySimulator.getSymbiontTree()), false, &symbNumbers), replicate);
+    archive.add(associationRecord(phySimulator.getExtantHostNames(phySimulator.getSpeciesTipNames()),
+                                  phySimulator.getExtantSymbNames(phySimulator.getSymbiontTipNames()),
+                                  phySimulator.getAssociationMatrix()),
+                replicate);
+    archive.add(eventRecord(phySimulator.getEventLog(), hostNumbers, symbNumbers), replicate);
+}
+
+// Runs every replicate, retries included, on numThreads threads. Replicates
+// are handed out one at a time so threads that finish early take the next
+// one, since the number of retries varies a lot between replicates. Each
+// replicate has its own stream seeded from R up front so results under
+// set.seed do not depend on numThreads. Finished pairs are turned into R
+// objects, or added to the archive at file, on the main thread after every
+// batch so only a batch is kept in memory at once. The simulators of a batch
+// run the replicates at the same places in the next one, reusing the trees and
+// buffers of the last replicate. With stats every replicate counts into its
+// own and they are added to stats after the batch.
+static SEXP simulateReplicates(std::function<std::shared_ptr<Simulator>()> newSimulator,
+                               bool withAnagenesis,
+                               int numbsim,
+                               int numThreads,
+                               const std::string &file,
+                               std::shared_ptr<SimulationStats> stats){
+    std::vector<uint64_t> seeds(numbsim);
+    for(int i = 0; i < numbsim; i++)
+        seeds[i] = drawSeedFromR();
+    std::unique_ptr<TreeArchiveWriter> archive;
+    if(!(file.empty()))
+        archive.reset(new TreeArchiveWriter(file, ArchiveCophylo));
+    Rcpp::List multiphy(archive ? 0 : numbsim);
+    auto cancellation = cancellationFromR();
+    int batchSize = std::max(64 * numThreads, 256);
+    std::vector<std::shared_ptr<Simulator> > sims(std::min(batchSize, numbsim));
+    for(int first = 0; first < numbsim; first += batchSize){
+        int numInBatch = std::min(batchSize, numbsim - first);
+        std::vector<std::string> errors(numInBatch);
+        for(int k = 0; k < numInBatch; k++){
+            if(!sims[k]){
+                sims[k] = newSimulator();
+                sims[k]->setCancellation(cancellation);
+            }
+            sims[k]->setRng(std::make_shared<Rng>(seeds[first + k]));
+            if(stats)
+                sims[k]->setStats(std::make_shared<SimulationStats>());
+        }
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1) num_threads(numThreads)
+#endif
+        for(int k = 0; k < numInBatch; k++){
+            try{
+                if(withAnagenesis)
+                    sims[k]->simHostSymbSpeciesTreePairWithAnagenesis();
+                else
+                    sims[k]->simHostSymbSpeciesTreePair();
+            }
+            catch(std::exception &e){
+                errors[k] = e.what();
+            }
+        }
+        // the replicates that were interrupted have an error too
+        cancellation->check();
+        PhaseTimer timer(stats.get(), SimulationStats::Export);
+        for(int k = 0; k < numInBatch; k++){
+            if(!(errors[k].empty()))
+                stop(errors[k]);
+            if(stats)
+                stats->merge(*(sims[k]->getStats()));
+            if(archive)
+                addCophyToArchive(*sims[k], *archive, first + k);
+            else
+                multiphy[first + k] = cophyToList(*sims[k]);
+        }
+        Rcpp::checkUserInterrupt();
+    }
+    if(archive){
+        archive->close();
+        return wrap(file);
+    }
     multiphy.attr("class") = "multiCophy";
     return multiphy;
 }
 
-Rcpp::List sim_host_symb_treepair(double hostbr,
-                                  double hostdr,
-                                  double symbbr,
-                                  double symbdr,
-                                  double switchRate,
-                                  double cospeciationRate,
-                                  double timeToSimTo,
-                                  int host_limit,
-                                  int numbsim,
-                                  bool hsMode){
+SEXP sim_host_symb_treepair_ana(double hostbr,
+                                double hostdr,
+                                double symbbr,
+                                double symbdr,
+                                double symb_dispersal,
+                                double symb_extirpation,
+                                double switchRate,
+                                double cospeciationRate,
+                                double timeToSimTo,
+                                int host_limit,
+                                int numbsim,
+                                bool hsMode,
+                                int numThreads,
+                                std::string file,
+                                std::shared_ptr<SimulationStats> stats,
+                                bool keepHistory){
+    double rho = 1.0;
+    auto newSimulator = [&](){
+        auto phySimulator = std::make_shared<Simulator>(timeToSimTo,
+                                                        hostbr,
+                                                        hostdr,
+                                                        symbbr,
+                                                        symbdr,
+                                                        symb_dispersal,
+                                                        symb_extirpation,
+                                                        switchRate,
+                                                        cospeciationRate,
+                                                        rho,
+                                                        host_limit,
+                                                        hsMode);
+        phySimulator->setKeepAssociationHistory(keepHistory);
+        return phySimulator;
+    };
+    return simulateReplicates(newSimulator, true, numbsim, numThreads, file, stats);
+}
+
+SEXP sim_host_symb_treepair(double hostbr,
+                            double hostdr,
+                            double symbbr,
+                            double symbdr,
+                            double switchRate,
+                            double cospeciationRate,
+                            double timeToSimTo,
+                            int host_limit,
+                            int numbsim,
+                            bool hsMode,
+                            bool sparseAssoc,
+                            int numThreads,
+                            std::string file,
+                            std::shared_ptr<SimulationStats> stats,
+                            bool keepHistory){
 
     double rho = 1.0;
-    Rcpp::List multiphy;
-    Rcpp::List hostSymbPair;
-    for(int i = 0; i < numbsim; i++){
-        auto phySimulator = std::shared_ptr<Simulator>(new Simulator( timeToSimTo,
-                                                 hostbr,
-                                                 hostdr,
-                                                 symbbr,
-                                                 symbdr,
-                                                 switchRate,
-                                                 cospeciationRate,
-                                                 rho,
-                                                 host_limit,
-                                                 hsMode));
-
-        phySimulator->simHostSymbSpeciesTreePair();
-
-
-
-
-
-        List phyHost = List::create(Named("edge") = phySimulator->getSpeciesEdges(),
-                                    Named("edge.length") = phySimulator->getSpeciesEdgeLengths(),
-                                    Named("Nnode") = phySimulator->getSpeciesNnodes(),
-                                    Named("tip.label") = phySimulator->getSpeciesTipNames(),
-                                    Named("root.edge") = phySimulator->getSpeciesTreeRootEdge());
-        phyHost.attr("class") = "phylo";
-
-
-        List phySymb = List::create(Named("edge") = phySimulator->getSymbiontEdges(),
-                                Named("edge.length") = phySimulator->getSymbiontEdgeLengths(),
-                                Named("Nnode") = phySimulator->getSymbiontNnodes(),
-                                Named("tip.label") = phySimulator->getSymbiontTipNames(),
-                                Named("root.edge") = phySimulator->getSymbiontTreeRootEdge());
-        phySymb.attr("class") = "phylo";
-        Rcpp::NumericMatrix assocMat = Rcpp::wrap(phySimulator->getAssociationMatrix());
-        assocMat = Rcpp::transpose(assocMat);
-        Rcpp::CharacterVector hostNames = phySimulator->getExtantHostNames(phySimulator->getSpeciesTipNames());
-        Rcpp::CharacterVector symbNames = phySimulator->getExtantSymbNames(phySimulator->getSymbiontTipNames());
-        Rcpp::rownames(assocMat) = hostNames;
-        Rcpp::colnames(assocMat) = symbNames;
-        hostSymbPair = List::create(Named("host_tree") = phyHost,
-                                    Named("symb_tree") = phySymb,
-                                    Named("association_mat") = assocMat,
-                                    Named("event_history") = phySimulator->createEventDF());
-        hostSymbPair.attr("class") = "cophy";
-        multiphy.push_back(hostSymbPair);
+    auto newSimulator = [&](){
+        auto phySimulator = std::make_shared<Simulator>(timeToSimTo,
+                                                        hostbr,
+                                                        hostdr,
+                                                        symbbr,
+                                                        symbdr,
+                                                        switchRate,
+                                                        cospeciationRate,
+                                                        rho,
+                                                        host_limit,
+                                                        hsMode);
+        phySimulator->setSparseAssociations(sparseAssoc);
+        phySimulator->setKeepAssociationHistory(keepHistory);
+        return phySimulator;
+    };
+    return simulateReplicates(newSimulator, false, numbsim, numThreads, file, stats);
+}
+static const char* changeNames[AssociationHistory::NumChanges] = {"symbiont_birth",
+                                                                  "symbiont_death",
+                                                                  "host_birth",
+                                                                  "host_death",
+                                                                  "gain",
+                                                                  "loss"};
+
+Rcpp::List associationHistoryToList(const AssociationHistory &hist){
+    unsigned numChanges = hist.getNumChanges();
+    Rcpp::NumericVector times(numChanges);
+    Rcpp::IntegerVector changes(numChanges), symbs(numChanges), hosts(numChanges);
+    for(unsigned i = 0; i < numChanges; i++){
+        times[i] = hist.getTime(i);
+        changes[i] = hist.getChange(i) + 1;
+        symbs[i] = hist.getSymbiont(i) < 0 ? NA_INTEGER : hist.getSymbiont(i);
+        hosts[i] = hist.getHost(i) < 0 ? NA_INTEGER : hist.getHost(i);
     }
+    Rcpp::CharacterVector levels(AssociationHistory::NumChanges);
+    for(int c = 0; c < AssociationHistory::NumChanges; c++)
+        levels[c] = changeNames[c];
+    changes.attr("levels") = levels;
+    changes.attr("class") = "factor";
 
+    unsigned numCheckpoints = hist.getNumCheckpoints();
+    Rcpp::IntegerVector checkpointAt(numCheckpoints);
+    Rcpp::List checkpoints(numCheckpoints);
+    for(unsigned k = 0; k < numCheckpoints; k++){
+        const AssociationHistory::State &st = hist.getCheckpoint(k);
+        checkpointAt[k] = hist.getCheckpointAt(k);
+        Rcpp::IntegerMatrix pairs(st.pairs.size() / 2, 2);
+        for(unsigned i = 0; i < st.pairs.size() / 2; i++){
+            pairs(i, 0) = st.pairs[2 * i];
+            pairs(i, 1) = st.pairs[2 * i + 1];
+        }
+        checkpoints[k] = List::create(Named("symbionts") = st.symbionts,
+                                      Named("hosts") = st.hosts,
+                                      Named("pairs") = pairs);
+    }
+    Rcpp::List history = List::create(Named("changes") = DataFrame::create(Named("Time") = times,
+                                                                            Named("Change") = changes,
+                                                                            Named("Symbiont_Index") = symbs,
+                                                                            Named("Host_Index") = hosts),
+                                      Named("checkpoint_at") = checkpointAt,
+                                      Named("checkpoints") = checkpoints);
+    history.attr("class") = "assocHistory";
+    return history;
+}
 
-    multiphy.attr("class") = "multiCophy";
+// rebuilds the history from its R form and finds the associations at each of
+// the times, hosts are rows and symbionts columns as in association_mat
+Rcpp::List association_history_at(Rcpp::List history, Rcpp::NumericVector times){
+    Rcpp::DataFrame changes = Rcpp::as<Rcpp::DataFrame>(history["changes"]);
+    Rcpp::NumericVector changeTimes = changes["Time"];
+    Rcpp::IntegerVector changeTypes = changes["Change"];
+    Rcpp::IntegerVector symbs = changes["Symbiont_Index"];
+    Rcpp::IntegerVector hosts = changes["Host_Index"];
+    Rcpp::IntegerVector checkpointAt = history["checkpoint_at"];
+    Rcpp::List checkpoints = history["checkpoints"];
 
-    return multiphy;
-}
\ No newline at end of file
+    AssociationHistory hist;
+    unsigned k = 0;
+    for(int i = 0; i <= changeTimes.size(); i++){
+        while(k < (unsigned) checkpointAt.size() && checkpointAt[k] == i){
+            Rcpp::List cp = checkpoints[k];
+            Rcpp::IntegerMatrix pairs = cp["pairs"];
+            AssociationHistory::State st;
+            st.symbionts = Rcpp::as< std::vector<int> >(cp["symbionts"]);
+            st.hosts = Rcpp::as< std::vector<int> >(cp["hosts"]);
+            for(int j = 0; j < pairs.nrow(); j++){
+                st.pairs.push_back(pairs(j, 0));
+                st.pairs.push_back(pairs(j, 1));
+            }
+            hist.addCheckpoint(st);
+            k++;
+        }
+        if(i == changeTimes.size())
+            break;
+        hist.setTime(changeTimes[i]);
+        hist.addChange(static_cast<AssociationHistory::Change>(changeTypes[i] - 1),
+                       symbs[i] == NA_INTEGER ? -1 : symbs[i],
+                       hosts[i] == NA_INTEGER ? -1 : hosts[i]);
+    }
+
+    Rcpp::List mats(times.size());
+    for(int q = 0; q < times.size(); q++){
+        AssociationHistory::State st = hist.getStateAt(times[q]);
+        Rcpp::IntegerMatrix assoc(st.hosts.size(), st.symbionts.size());
+        for(unsigned i = 0; i < st.pairs.size(); i += 2){
+            int s = std::lower_bound(st.symbionts.begin(), st.symbionts.end(), st.pairs[i]) - st.symbionts.begin();
+            int h = std::lower_bound(st.hosts.begin(), st.hosts.end(), st.pairs[i + 1]) - st.hosts.begin();
+            assoc(h, s) = 1;
+        }
+        Rcpp::CharacterVector hostNames(st.hosts.size()), symbNames(st.symbionts.size());
+        for(unsigned h = 0; h < st.hosts.size(); h++)
+            hostNames[h] = std::to_string(st.hosts[h]);
+        for(unsigned s = 0; s < st.symbionts.size(); s++)
+            symbNames[s] = std::to_string(st.symbionts[s]);
+        Rcpp::rownames(assoc) = hostNames;
+        Rcpp::colnames(assoc) = symbNames;
+        mats[q] = assoc;
+    }
+    return mats;
+}
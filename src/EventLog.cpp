@@ -0,0 +1,34 @@
+//
+//  EventLog.cpp
+//  treeducken
+//
+
+#include "EventLog.h"
+
+void EventLog::reserve(unsigned n){
+    hostIndices.reserve(n);
+    symbIndices.reserve(n);
+    types.reserve(n);
+    times.reserve(n);
+}
+
+// keeps the capacity for the next attempt at a tree pair
+void EventLog::clear(){
+    hostIndices.clear();
+    symbIndices.clear();
+    types.clear();
+    times.clear();
+}
+
+void EventLog::addEvent(int h, int s, Type e, double time){
+    hostIndices.push_back(h);
+    symbIndices.push_back(s);
+    types.push_back(e);
+    times.push_back(time);
+}
+
+const char* EventLog::getTypeName(Type e){
+    static const char* names[NumTypes] = {"I", "SX", "HX", "SSP", "HSP", "AG",
+                                          "AL", "CSP", "DISP", "EXTP", "SHE"};
+    return (e < NumTypes) ? names[e] : "";
+}
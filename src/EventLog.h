@@ -0,0 +1,56 @@
+//
+//  EventLog.h
+//  treeducken
+//
+//  Event history of a cophylogenetic simulation stored column by column in
+//  native vectors. Lineages are recorded by their node index in the host and
+//  symbiont trees and each event type takes a single byte.
+//
+
+#ifndef EventLog_h
+#define EventLog_h
+
+#include <vector>
+#include <cstdint>
+
+class EventLog
+{
+    public:
+        // codes are the order of the factor levels of Event_Type
+        enum Type : uint8_t
+        {
+            Initial = 0, // I
+            SymbiontLoss, // SX
+            HostLoss, // HX
+            SymbiontSpeciation, // SSP
+            HostSpeciation, // HSP
+            AssociationGain, // AG
+            AssociationLoss, // AL
+            Cospeciation, // CSP
+            Dispersal, // DISP
+            Extirpation, // EXTP
+            HostExpansion, // SHE
+            NumTypes
+        };
+
+    private:
+        std::vector<int32_t>    hostIndices;
+        std::vector<int32_t>    symbIndices;
+        std::vector<uint8_t>    types;
+        std::vector<double>     times;
+
+    public:
+        void        reserve(unsigned n);
+        void        clear();
+        void        addEvent(int h, int s, Type e, double time);
+        unsigned    size() const { return types.size(); }
+
+        int         getHostIndex(unsigned i) const { return hostIndices[i]; }
+        int         getSymbiontIndex(unsigned i) const { return symbIndices[i]; }
+        Type        getType(unsigned i) const { return static_cast<Type>(types[i]); }
+        double      getTime(unsigned i) const { return times[i]; }
+
+        static const char*  getTypeName(Type e);
+};
+
+#endif /* EventLog_h */
@@ -0,0 +1,77 @@
+//
+//  EventScheduler.cpp
+//  treeducken
+//
+
+#include "EventScheduler.h"
+#include <cmath>
+#include <limits>
+
+static const char* channelNames[EventScheduler::NumChannels] = {"Host",
+                                                                 "Symbiont",
+                                                                 "Cospeciation",
+                                                                 "Dispersal",
+                                                                 "Extirpation"};
+
+const char* EventScheduler::getChannelName(Channel c){
+    return channelNames[c];
+}
+
+EventScheduler::EventScheduler(){
+    perLineageRates.assign(NumChannels, 0.0);
+    counts.assign(NumChannels, 0);
+    channelRates.assign(NumChannels, 0.0);
+    totalRate = 0.0;
+}
+
+void EventScheduler::updateChannel(Channel c){
+    channelRates[c] = perLineageRates[c] * counts[c];
+    // summed again rather than adjusted so rounding does not accumulate
+    totalRate = 0.0;
+    for(auto r : channelRates)
+        totalRate += r;
+}
+
+void EventScheduler::setRate(Channel c, double rate){
+    perLineageRates[c] = rate;
+    updateChannel(c);
+}
+
+void EventScheduler::setCount(Channel c, unsigned n){
+    if(counts[c] == n)
+        return;
+    counts[c] = n;
+    updateChannel(c);
+}
+
+void EventScheduler::setNumHosts(unsigned n){
+    setCount(HostEvent, n);
+    setCount(Cospeciation, n);
+}
+
+void EventScheduler::setNumSymbionts(unsigned n){
+    setCount(SymbiontEvent, n);
+    setCount(Dispersal, n);
+    setCount(Extirpation, n);
+}
+
+double EventScheduler::getWaitingTime(double u) const {
+    if(totalRate <= 0.0)
+        return std::numeric_limits<double>::infinity();
+    return -std::log(u) / totalRate;
+}
+
+EventScheduler::Channel EventScheduler::chooseChannel(double u) const {
+    double target = u * totalRate;
+    double cumRate = 0.0;
+    int last = HostEvent;
+    for(int c = 0; c < NumChannels; c++){
+        if(channelRates[c] <= 0.0)
+            continue;
+        cumRate += channelRates[c];
+        last = c;
+        if(target < cumRate)
+            break;
+    }
+    return static_cast<Channel>(last);
+}
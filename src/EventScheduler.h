@@ -0,0 +1,58 @@
+//
+//  EventScheduler.h
+//  treeducken
+//
+//  Gillespie scheduler for the cophylogenetic simulations. Every kind of
+//  event is a channel with a per lineage rate and the number of lineages it
+//  applies to. Only the counts of the channels touched by an event are
+//  updated, one exponential waiting time is drawn per step and the channel
+//  of the event is drawn in proportion to its total rate.
+//
+
+#ifndef EventScheduler_h
+#define EventScheduler_h
+
+#include <vector>
+
+class EventScheduler
+{
+    public:
+        enum Channel
+        {
+            HostEvent = 0, // host speciation or extinction, per host
+            SymbiontEvent, // symbiont speciation, extinction or expansion, per symbiont
+            Cospeciation, // per host
+            Dispersal, // per symbiont
+            Extirpation, // per symbiont
+            NumChannels
+        };
+
+    private:
+        std::vector<double>     perLineageRates;
+        std::vector<unsigned>   counts;
+        std::vector<double>     channelRates;
+        double                  totalRate;
+
+        void        updateChannel(Channel c);
+
+    public:
+                    EventScheduler();
+        void        setRate(Channel c, double rate);
+        void        setCount(Channel c, unsigned n);
+        void        setNumHosts(unsigned n);
+        void        setNumSymbionts(unsigned n);
+
+        double      getRate(Channel c) const { return perLineageRates[c]; }
+        unsigned    getCount(Channel c) const { return counts[c]; }
+        // per lineage rate times count
+        double      getChannelRate(Channel c) const { return channelRates[c]; }
+        double      getTotalRate() const { return totalRate; }
+        std::vector<double> getChannelRates() const { return channelRates; }
+        static const char*  getChannelName(Channel c);
+
+        // u is uniform on (0,1)
+        double      getWaitingTime(double u) const;
+        Channel     chooseChannel(double u) const;
+};
+
+#endif /* EventScheduler_h */
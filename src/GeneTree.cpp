@@ -9,25 +9,64 @@
 #include "GeneTree.h"
 #include <iostream>
 #include <cmath>
+#include <stdexcept>
 
 #include "math.h"
 
 #include "math.h"
-#include <Rcpp.h>
 
-GeneTree::GeneTree(unsigned nt, unsigned ipp, double ne, double genTime) : Tree(nt){
+GeneTree::GeneTree(unsigned nt, unsigned ipp, double ne, double genTime, std::shared_ptr<Rng> r) : Tree(nt){
     numTaxa = nt;
     individualsPerPop = ipp;
     popSize = ne;
     generationTime = genTime;
+    nodePool = nullptr;
+    nodePoolNext = 0;
+    rng = r;
 }
 
 GeneTree::~GeneTree(){
+    // pooled nodes all share one control block so the anc/des links
+    // between them have to be broken for the pool to be freed
+    for(auto node : nodes){
+        node->setAnc(nullptr);
+        node->setLdes(nullptr);
+        node->setRdes(nullptr);
+    }
+}
+
+// a gene tree with n sampled tips has exactly 2n - 1 nodes, so allocate them
+// all at once rather than one new Node per coalescent event
+void GeneTree::reserveNodes(unsigned numTips){
+    if(numTips == 0)
+        return;
+    unsigned numTotalNodes = 2 * numTips - 1;
+    nodePool = std::make_shared<std::vector<Node>>(numTotalNodes);
+    nodePoolNext = 0;
+    nodes.reserve(numTotalNodes);
+    extantNodes.reserve(numTips);
+}
+
+std::shared_ptr<Node> GeneTree::getNewNode(){
+    if(nodePool == nullptr || nodePoolNext == nodePool->size())
+        return std::make_shared<Node>();
+    // aliasing constructor, the node is kept alive by the pool
+    std::shared_ptr<Node> p(nodePool, &(*nodePool)[nodePoolNext]);
+    nodePoolNext++;
+    return p;
+}
 
+// swap a random lineage from extantNodes[lineagesStart:] to the back and pop it
+std::shared_ptr<Node> GeneTree::popRandomLineage(unsigned lineagesStart){
+    unsigned numLineages = extantNodes.size() - lineagesStart;
+    unsigned indx = lineagesStart + rng->uniformIndex(numLineages);
+    std::swap(extantNodes[indx], extantNodes.back());
+    std::shared_ptr<Node> p = std::move(extantNodes.back());
+    extantNodes.pop_back();
+    return p;
 }
 
 
-//TODO:  go back and speed this up by removing push_back calls
 void GeneTree::initializeTree(std::vector< std::vector<int> > extantLociInd, double presentTime){
     int num_loci_in_prsent = 0;
     nodes.clear();
@@ -45,7 +84,7 @@ void GeneTree::initializeTree(std::vector< std::vector<int> > extantLociInd, dou
     }
     for(int i = 0; i < num_loci_in_prsent; i++){
         for(int j = 0; j < individualsPerPop; j++){
-            auto p = std::shared_ptr<Node>(new Node());
+            auto p = getNewNode();
             p->setDeathTime(presentTime);
             p->setLindx(extantLociInd[k][i]);
             p->setLdes(NULL);
@@ -65,115 +104,217 @@ void GeneTree::initializeTree(std::vector< std::vector<int> > extantLociInd, dou
 double GeneTree::getCoalTime(int n){
     double ct = NAN;
     double lambda = (double)(n * (n - 1)) / (popSize) ;
-    ct = -log(unif_rand()) / (lambda);
+    ct = rng->exponential(lambda);
     return ct;
 }
 
 bool GeneTree::censorCoalescentProcess(double startTime, double stopTime, int contempSpeciesIndx, int ancSpIndx, bool chck){
-    int leftInd = 0;
-    int rightInd = 0;
-    int leftIndExtN = 0;
-    int rightIndExtN = 0;
-    int extIndx = 0;
-    std::shared_ptr<Node> l = nullptr;
-    std::shared_ptr<Node> r = nullptr;
-    std::shared_ptr<Node> n = nullptr;
     double t = startTime;
     bool all_coalesced = false;
-    // search extantNodes for members with Lindx = contempSpecisIndx
-    std::vector<int> indInExtNodes;
-    for(auto it = extantNodes.begin(); it != extantNodes.end(); ++it){
-        if((*it)->getLindx() == contempSpeciesIndx){
-            extIndx = std::distance(extantNodes.begin(), it);
-            indInExtNodes.push_back(extIndx);
-        }
-    }
+    // move the members of extantNodes with Lindx = contempSpeciesIndx to the back
+    // so the coalescent below only works on extantNodes[lineagesStart:]
+    auto firstInLocus = std::partition(extantNodes.begin(),
+                                       extantNodes.end(),
+                                       [contempSpeciesIndx](const std::shared_ptr<Node> &p){
+                                           return p->getLindx() != contempSpeciesIndx;
+                                       });
+    unsigned lineagesStart = std::distance(extantNodes.begin(), firstInLocus);
+    unsigned numLineages = extantNodes.size() - lineagesStart;
   // the coalescent part
-    if(indInExtNodes.size() > 1){
+    if(numLineages > 1){
         while(t > stopTime){
-            t -= getCoalTime(indInExtNodes.size()); // dra a time
+            t -= getCoalTime(numLineages); // dra a time
             // is the time older than the end point?
             if(t < stopTime){
-                if(chck){
-                    t = stopTime;
-                    all_coalesced = true;
-                    break;
-                }
-                else{
-                    t = stopTime;
-                    all_coalesced = false;
-                    break;
-                }
+                t = stopTime;
+                all_coalesced = chck;
+                break;
             }
             // randomly choose two nodes to coalesce in this locus
-            rightInd = unif_rand() * (indInExtNodes.size() - 1);
-            iter_swap(indInExtNodes.begin() + rightInd, indInExtNodes.begin());
-            rightIndExtN = indInExtNodes[0];
-            r = extantNodes[rightIndExtN];
-
-            std::reverse(indInExtNodes.begin(), indInExtNodes.end());
-            leftInd = unif_rand() * (indInExtNodes.size() - 2);
-            iter_swap(indInExtNodes.begin() + leftInd, indInExtNodes.begin());
-            leftIndExtN = indInExtNodes[0];
-            l = extantNodes[leftIndExtN];
-            std::reverse(indInExtNodes.begin(), indInExtNodes.end());
-            // do the coalescing
-            n = coalescentEvent(t, l, r);
-            // book-keeping that almost certainly could be done better:
-            // delete two nodes from erase
-            if(leftIndExtN > rightIndExtN){
-                extantNodes.erase(extantNodes.begin() + leftIndExtN);
-                extantNodes.erase(extantNodes.begin() + rightIndExtN);
-            }
-            else{
-                extantNodes.erase(extantNodes.begin() + rightIndExtN);
-                extantNodes.erase(extantNodes.begin() + leftIndExtN);
-            }
-            // clear the indices in extant nodes vector
-            indInExtNodes.clear();
-            // put in the new node
-            extantNodes.insert(extantNodes.begin(), n);
-
-            // populate the indices in extant nodes vector again, this time to see if it is empty
-            for(auto it = extantNodes.begin(); it != extantNodes.end(); ++it){
-                if((*it)->getLindx() == contempSpeciesIndx){
-                    extIndx = std::distance(extantNodes.begin(), it);
-                    indInExtNodes.push_back(extIndx);
-                }
-            }
+            auto r = popRandomLineage(lineagesStart);
+            auto l = popRandomLineage(lineagesStart);
+            // do the coalescing, the new node stays with the rest of this locus
+            extantNodes.push_back(coalescentEvent(t, l, r));
+            numLineages--;
             // if only one is left get out of the loop
-            if(indInExtNodes.size() == 1){
+            if(numLineages == 1){
                 all_coalesced = true;
                 break;
             }
         }
     }
     // only one member so nothing to do besides progress time
-    else if (indInExtNodes.size() == 1){
-        t = stopTime;
-        all_coalesced = true;
-        extantNodes[indInExtNodes[0]]->setLindx(ancSpIndx);
-    }
+    // if this is 0 it catches any stragglers and in Simulator::simulateCoalescentProcess those will be deleted from the contempSpecies listing
     else{
-        // this is 0 to catch any stragglers and in Simulator::simulateCoalescentProcess those will be deleted from the contempSpecies listing
         all_coalesced = true;
     }
     // if everything coalesced loop through and change the locus indices in geneTree.nodes
     // TODO: refactor this to make clear when species indices are being used (they aren't) and locus indices are (they are)
     if(all_coalesced == true){
-        for(int i = 0; i < indInExtNodes.size(); ++i){
-            extantNodes[indInExtNodes[i]]->setLindx(ancSpIndx);
+        for(unsigned i = lineagesStart; i < extantNodes.size(); ++i){
+            extantNodes[i]->setLindx(ancSpIndx);
         }
     }
-    // clear this again
-    indInExtNodes.clear();
     return all_coalesced;
 }
 
+// coalesces the lineages of a locus between startTime and stopTime so that
+// exactly numLeft of them are left at stopTime and moves those to ancSpIndx
+void GeneTree::bridgeCoalescentProcess(double startTime, double stopTime, unsigned numLeft, int contempSpeciesIndx, int ancSpIndx){
+    auto firstInLocus = std::partition(extantNodes.begin(),
+                                       extantNodes.end(),
+                                       [contempSpeciesIndx](const std::shared_ptr<Node> &p){
+                                           return p->getLindx() != contempSpeciesIndx;
+                                       });
+    unsigned lineagesStart = std::distance(extantNodes.begin(), firstInLocus);
+    unsigned numLineages = extantNodes.size() - lineagesStart;
+    for(auto wt : conditionedCoalescentTimes(numLineages, numLeft, startTime - stopTime)){
+        auto r = popRandomLineage(lineagesStart);
+        auto l = popRandomLineage(lineagesStart);
+        extantNodes.push_back(coalescentEvent(startTime - wt, l, r));
+    }
+    for(unsigned i = lineagesStart; i < extantNodes.size(); ++i){
+        extantNodes[i]->setLindx(ancSpIndx);
+    }
+}
+
+// times (from the start) of the coalescences that take from lineages down to
+// exactly to lineages in length. Unconditioned draws are kept if they end with
+// to lineages; if 100 of them do not, the uniformized chain of the coalescent
+// is sampled conditioned on its end points (Hobolth and Stone 2009). Either
+// way the times are a draw from the conditioned coalescent.
+std::vector<double> GeneTree::conditionedCoalescentTimes(unsigned from, unsigned to, double length){
+    std::vector<double> times;
+    if(from <= to)
+        return times;
+    for(int attempt = 0; attempt < 100; attempt++){
+        times.clear();
+        double t = 0.0;
+        unsigned n = from;
+        while(n > to){
+            t += getCoalTime(n);
+            if(t > length)
+                break;
+            times.push_back(t);
+            n--;
+        }
+        if(n == to && (to < 2 || t + getCoalTime(to) > length))
+            return times;
+    }
+    // jumps of the uniformized chain happen at rate maxRate, each one is a
+    // coalescence with probability rate(n) / maxRate
+    auto jumpProb = [from](unsigned n){ return (double) (n * (n - 1)) / (double) (from * (from - 1)); };
+    double mu = (double) (from * (from - 1)) / popSize * length;
+    if(!(mu > 0.0))
+        throw std::runtime_error("the coalescent can not go from " + std::to_string(from) +
+                                 " to " + std::to_string(to) + " lineages");
+    unsigned numSteps = from - to;
+    // reach[m][i] is the probability of going from to + i lineages to to in m jumps
+    std::vector< std::vector<double> > reach(1, std::vector<double>(numSteps + 1, 0.0));
+    reach[0][0] = 1.0;
+    std::vector<double> weights;
+    double total = 0.0;
+    for(unsigned m = 0; ; m++){
+        if(m > 0){
+            std::vector<double> next(numSteps + 1);
+            for(unsigned i = 0; i <= numSteps; i++){
+                double p = jumpProb(to + i);
+                next[i] = (1.0 - p) * reach[m - 1][i] + (i > 0 ? p * reach[m - 1][i - 1] : 0.0);
+            }
+            reach.push_back(std::move(next));
+        }
+        double pois = std::exp(-mu + m * std::log(mu) - std::lgamma(m + 1.0));
+        weights.push_back(pois * reach[m][numSteps]);
+        total += weights.back();
+        // the rest of the Poisson tail bounds what is left
+        if(m > mu && (pois == 0.0 || pois * (m + 1.0) / (m + 1.0 - mu) < 1e-14 * total))
+            break;
+    }
+    if(!(total > 0.0))
+        throw std::runtime_error("the coalescent can not go from " + std::to_string(from) +
+                                 " to " + std::to_string(to) + " lineages");
+    unsigned numJumps = 0;
+    double u = rng->uniform() * total;
+    while(numJumps < weights.size() - 1 && u > weights[numJumps]){
+        u -= weights[numJumps];
+        numJumps++;
+    }
+    std::vector<double> jumpTimes(numJumps);
+    for(auto &jt : jumpTimes)
+        jt = rng->uniform() * length;
+    std::sort(jumpTimes.begin(), jumpTimes.end());
+    times.clear();
+    unsigned i = numSteps;
+    for(unsigned k = 0; k < numJumps && i > 0; k++){
+        unsigned jumpsLeft = numJumps - k - 1;
+        double p = jumpProb(to + i) * reach[jumpsLeft][i - 1] / reach[jumpsLeft + 1][i];
+        if(rng->uniform() < p){
+            times.push_back(jumpTimes[k]);
+            i--;
+        }
+    }
+    return times;
+}
+
+// probabilities that a lineages coalesce into b lineages in time t, entry
+// a * (n + 1) + b for a, b <= n. The uniformized series of a short step has
+// only positive terms and is squared up to t, so small probabilities keep
+// their precision.
+std::vector<double> coalescentCountProbabilities(unsigned n, double t, double popSize){
+    unsigned dim = n + 1;
+    std::vector<double> probs(dim * dim, 0.0);
+    for(unsigned a = 0; a < dim; a++)
+        probs[a * dim + a] = 1.0;
+    if(n < 2 || !(t > 0.0))
+        return probs;
+    double maxRate = (double) (n * (n - 1)) / popSize;
+    double h = t;
+    int numSquarings = 0;
+    while(maxRate * h > 0.5){
+        h /= 2.0;
+        numSquarings++;
+    }
+    std::vector<double> jumpProb(dim, 0.0);
+    for(unsigned a = 2; a < dim; a++)
+        jumpProb[a] = (double) (a * (a - 1)) / (double) (n * (n - 1));
+    std::vector<double> term(probs), next(dim * dim);
+    double scale = std::exp(-maxRate * h);
+    for(auto &p : probs)
+        p *= scale;
+    for(auto &p : term)
+        p *= scale;
+    for(int m = 1; m < 30; m++){
+        // term = term * Q * maxRate * h / m, Q only moves one lineage down
+        double f = maxRate * h / m;
+        for(unsigned a = 0; a < dim; a++){
+            for(unsigned b = 0; b <= a; b++){
+                double stay = term[a * dim + b] * (1.0 - jumpProb[b]);
+                double down = b < a ? term[a * dim + b + 1] * jumpProb[b + 1] : 0.0;
+                next[a * dim + b] = (stay + down) * f;
+            }
+        }
+        term.swap(next);
+        for(unsigned k = 0; k < dim * dim; k++)
+            probs[k] += term[k];
+    }
+    for(int s = 0; s < numSquarings; s++){
+        for(unsigned a = 0; a < dim; a++){
+            for(unsigned b = 0; b <= a; b++){
+                double sum = 0.0;
+                for(unsigned k = b; k <= a; k++)
+                    sum += probs[a * dim + k] * probs[k * dim + b];
+                next[a * dim + b] = sum;
+            }
+        }
+        probs.swap(next);
+    }
+    return probs;
+}
+
 std::shared_ptr<Node> GeneTree::coalescentEvent(double t, 
                                 std::shared_ptr<Node> p,
                                 std::shared_ptr<Node> q){
-    auto n = std::shared_ptr<Node>(new Node());
+    auto n = getNewNode();
     n->setDeathTime(t);
     n->setLdes(p);
     n->setRdes(q);
@@ -217,16 +358,10 @@ void GeneTree::rootCoalescentProcess(double startTime){
     while(extantNodes.size() > 1){
         t -= getCoalTime(extantNodes.size());
 
-        int rightInd = unif_rand() * (extantNodes.size() - 1);
-        auto r = std::move(extantNodes[rightInd]);
-        extantNodes.erase(extantNodes.begin() + rightInd);
-
-        int leftInd = unif_rand() * (extantNodes.size() - 1);
-        auto l = std::move(extantNodes[leftInd]);
-        extantNodes.erase(extantNodes.begin() + leftInd);
+        auto r = popRandomLineage(0);
+        auto l = popRandomLineage(0);
 
-        auto n = coalescentEvent(t, l, r);
-        extantNodes.push_back(n);
+        extantNodes.push_back(coalescentEvent(t, l, r));
     }
     extantNodes[0]->setAsRoot(true);
     extantNodes[0]->setBirthTime(t);
@@ -255,6 +390,7 @@ void GeneTree::recursiveRescaleTimes(std::shared_ptr<Node> r, double add){
 
 void GeneTree::setBranchLengths(){
     double brlen = NAN;
+    branchLengths.clear();
     numExtant = 0;
     numExtinct = 0;
     for(auto node : nodes){
@@ -279,9 +415,8 @@ void GeneTree::setBranchLengths(){
 }
 
 void GeneTree::addExtinctSpecies(double bt, int indx){
-    std::shared_ptr<Node> p = nullptr;
     for(int i = 0; i < individualsPerPop; i++){
-        std::shared_ptr<Node> p = std::shared_ptr<Node>(new Node());
+        std::shared_ptr<Node> p = getNewNode();
         p->setDeathTime(bt);
         p->setLindx(indx);
         p->setLdes(NULL);
@@ -353,15 +488,19 @@ void GeneTree::setTreeTipNames(){
 
 }
 
+// tips are numbered in node order to match getTipNames, internal nodes
+// backwards so the root (the last node) is numTips + 1
 void GeneTree::reindexForR(){
   unsigned int intNodeCount = numExtant + numExtinct + 1;
   int tipCount = 1;
-  for(int i = nodes.size() - 1; i > -1; i--){
+  for(int i = 0; i < (int) nodes.size(); i++){
     if(nodes[i]->getIsTip()){
       nodes[i]->setIndx(tipCount);
       tipCount++;
     }
-    else{
+  }
+  for(int i = nodes.size() - 1; i > -1; i--){
+    if(!(nodes[i]->getIsTip())){
       nodes[i]->setIndx(intNodeCount);
       intNodeCount++;
     }
@@ -369,17 +508,16 @@ void GeneTree::reindexForR(){
 }
 
 
-NumericMatrix GeneTree::getGeneEdges(){
+EdgeMatrix GeneTree::getGeneEdges(){
   this->GeneTree::reindexForR();
   int numRows = (int) nodes.size() - 1;
-  NumericMatrix edgeMat(numRows, 2);
+  EdgeMatrix edgeMat;
+  edgeMat.anc.assign(numRows, 0);
+  edgeMat.des.assign(numRows, 0);
   for(int i=0; i < nodes.size()-1; i++){
     if(!(nodes[i]->getIsRoot())){
-
-      NumericMatrix::Row row = edgeMat(i, _);
-
-      row[0] = nodes[i]->getAnc()->getIndex();
-      row[1] = nodes[i]->getIndex();
+      edgeMat.anc[i] = nodes[i]->getAnc()->getIndex();
+      edgeMat.des[i] = nodes[i]->getIndex();
     }
   }
   return edgeMat;
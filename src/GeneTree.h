@@ -12,18 +12,31 @@
 #include "LocusTree.h"
 #include <algorithm>
 
+// probabilities of the numbers of lineages left after time t of the coalescent
+// (see GeneTree.cpp)
+std::vector<double> coalescentCountProbabilities(unsigned n, double t, double popSize);
+
 class GeneTree : public Tree {
     private:
         unsigned individualsPerPop;
         double   popSize;
         double   generationTime; // specified in generations per unit time
+        // nodes of a gene tree are allocated once from this pool (2n - 1 of them)
+        std::shared_ptr<std::vector<Node>> nodePool;
+        unsigned nodePoolNext;
 
     public:
-                    GeneTree(unsigned nt, unsigned ipp, double ne, double genTime);
+                    // each gene tree draws from its own stream so they can be simulated in parallel
+                    GeneTree(unsigned nt, unsigned ipp, double ne, double genTime, std::shared_ptr<Rng> r);
         virtual     ~GeneTree();
         double      getCoalTime(int n); // what do you need to determine this?
+        void        reserveNodes(unsigned numTips);
+        std::shared_ptr<Node>      getNewNode();
+        std::shared_ptr<Node>      popRandomLineage(unsigned lineagesStart);
         std::shared_ptr<Node>      coalescentEvent(double t, std::shared_ptr<Node> p, std::shared_ptr<Node> q);
         bool        censorCoalescentProcess(double startTime, double stopTime, int contempSpIndx, int newSpIndx, bool chck);
+        void        bridgeCoalescentProcess(double startTime, double stopTime, unsigned numLeft, int contempSpIndx, int newSpIndx);
+        std::vector<double>     conditionedCoalescentTimes(unsigned from, unsigned to, double length);
         void        initializeTree(std::vector< std::vector<int> > extantLociIndx, double presentTime);
         std::multimap<int,double> rescaleTimes(std::multimap<int, double> timeMap);
         void        rootCoalescentProcess(double startTime);
@@ -32,7 +45,8 @@ class GeneTree : public Tree {
         void        setIndicesBySpecies(std::map<int,int> spToLocusMap);
         void        setTreeTipNames() override;
         void        addExtinctSpecies(double bt, int indx);
-        NumericMatrix        getGeneEdges();
+        EdgeMatrix  getGeneEdges();
+        double      getRootEdge() override { return root->getBranchLength(); }
         void        reindexForR();
 
 };
@@ -1,4 +1,6 @@
 #include <iostream>
+#include <cstdlib>
+#include <stdexcept>
 
 #include "math.h"
 #include "LocusTree.h"
@@ -16,6 +18,20 @@ LocusTree::LocusTree(unsigned nt, double stop, double gbr, double gdr, double lg
     getRoot()->setLocusID(0);
 }
 
+void LocusTree::reset(unsigned nt, double stop, double gbr, double gdr, double lgtrate){
+    resetToRoot(nt, 0.0);
+    numTaxa = 1;
+    stopTime = stop;
+    geneBirthRate = gbr;
+    geneDeathRate = gdr;
+    transferRate = lgtrate;
+    numTransfers = 0;
+    numDuplications = 0;
+    speciesNames.clear();
+    getRoot()->setLindx(0);
+    getRoot()->setLocusID(0);
+}
+
 LocusTree::LocusTree(const LocusTree& locustree, unsigned numTaxa) : Tree(numTaxa) {
   nodes = locustree.nodes;
   extantNodes = locustree.extantNodes;
@@ -105,8 +121,8 @@ void LocusTree::setNewLineageInfo(int indx,
 }
 
 void LocusTree::lineageBirthEvent(unsigned indx){
-    std::shared_ptr<Node> right =  std::shared_ptr<Node>(new Node());
-    std::shared_ptr<Node> sis =  std::shared_ptr<Node>(new Node());
+    std::shared_ptr<Node> right = getNewNode();
+    std::shared_ptr<Node> sis = getNewNode();
     setNewLineageInfo(indx, right, sis);
 }
 
@@ -134,7 +150,7 @@ int LocusTree::chooseRecipientSpeciesID(std::shared_ptr<Node> d) {
         sum += (double) stepCounter;
         sums.push_back(sum);
     }
-    randNum = unif_rand();
+    randNum = rng->uniform();
     int elem = 0;
     for(std::vector<double>::iterator it = sums.begin(); it != sums.end(); ++it){
         (*it) = (*it) / sum;
@@ -174,8 +190,8 @@ void LocusTree::lineageTransferEvent(int indx, bool randTrans = true){
     if(allSameSpInExtNodes == 0)
       return;
     //first a birth event
-    std::shared_ptr<Node> donor = std::shared_ptr<Node>(new Node());
-    std::shared_ptr<Node> rec = std::shared_ptr<Node>(new Node());
+    std::shared_ptr<Node> donor = getNewNode();
+    std::shared_ptr<Node> rec = getNewNode();
     numTransfers++;
     // donor keeps all the attributes  of the Node at extantNodes[indx]
     donor->setAnc(extantNodes[indx]);
@@ -212,7 +228,7 @@ void LocusTree::lineageTransferEvent(int indx, bool randTrans = true){
     }
 
     if( randTrans )
-        randomSpeciesID = unif_rand() * (speciesIndx.size() - 1);
+        randomSpeciesID = rng->uniform() * (speciesIndx.size() - 1);
     else
         randomSpeciesID = chooseRecipientSpeciesID(donor);
     std::map<int,int>::iterator item = speciesIndx.begin();
@@ -270,9 +286,9 @@ double LocusTree::getTimeToNextEvent(){
     double sumrt = geneBirthRate + geneDeathRate + transferRate;
     double returnTime = 0.0;
     if(std::abs(sumrt - 0.0) <= epsilon * std::abs(sumrt))
-      returnTime = -log(unif_rand()) / (double(numExtant));
+      returnTime = -log(rng->uniform()) / (double(numExtant));
     else{
-      returnTime = -log(unif_rand()) / (double(numExtant) * sumrt);
+      returnTime = -log(rng->uniform()) / (double(numExtant) * sumrt);
     }
     currentTime += returnTime;
     return returnTime;
@@ -281,9 +297,9 @@ double LocusTree::getTimeToNextEvent(){
 void LocusTree::ermEvent(double ct){
     double relBr = geneBirthRate / (geneDeathRate + geneBirthRate + transferRate);
     double relLGTr = transferRate / (geneBirthRate + geneDeathRate + transferRate) + relBr;
-    double whichEvent = unif_rand();
+    double whichEvent = rng->uniform();
     unsigned long extantSize = extantNodes.size();
-    unsigned nodeInd = unif_rand() * (extantSize - 1);
+    unsigned nodeInd = rng->uniform() * (extantSize - 1);
     currentTime = ct;
     if(whichEvent < relBr){
         lineageBirthEvent(nodeInd);
@@ -309,8 +325,8 @@ int LocusTree::speciationEvent(int indx, double time, std::pair<int,int> sibs){
     for(auto it = extantNodes.begin(); it != extantNodes.end();){
         lociExtNodesIndx = (*it)->getIndex();
         if(lociExtNodesIndx == indx){
-            r = std::shared_ptr<Node>(new Node());
-            l = std::shared_ptr<Node>(new Node());
+            r = getNewNode();
+            l = getNewNode();
             r->setLdes(NULL);
             r->setRdes(NULL);
             r->setSib(l);
@@ -471,6 +487,7 @@ void LocusTree::recTipNamer(std::shared_ptr<Node> p, unsigned &copyNumber){
 
 void LocusTree::setBranchLengths(){
   double bl;
+  branchLengths.clear();
   for(auto node : nodes){
     bl = node->getDeathTime() - node->getBirthTime();
     branchLengths.push_back(bl);
@@ -648,6 +665,9 @@ void LocusTree::recursiveSetNamesBySpeciesID(std::shared_ptr<Node> n,
 void LocusTree::setNamesBySpeciesID(std::map<int,std::string> tipMap)
 {
   std::stringstream tn;
+  // recount the tips so internal nodes start after the last one
+  setNumExtant();
+  setNumExtinct();
   unsigned nodeIndx = numExtant + numExtinct;
   unsigned tipIndx = 0;
   //int numDuplications = this->getNumberDuplications();
@@ -677,3 +697,108 @@ void LocusTree::setNamesBySpeciesID(std::map<int,std::string> tipMap)
   }
 }
 
+
+// sets the locus of every tip from its name, <species>_<locus> as named by
+// setNamesBySpeciesID, for locus trees that come back without their loci
+void LocusTree::setLocusIDsFromTipNames(){
+    for(auto node : nodes){
+        if(!(node->getIsTip()))
+            continue;
+        const std::string &name = node->getName();
+        std::size_t pos = name.find_last_of('_');
+        const char *number = pos == std::string::npos ? nullptr : name.c_str() + pos + 1;
+        char *end = nullptr;
+        long locus = number ? std::strtol(number, &end, 10) : 0;
+        if(number == nullptr || end == number || *end != '\0' || locus < 1)
+            throw std::runtime_error("tip '" + name + "' of the locus tree is not named <species>_<locus>");
+        node->setLocusID((int) locus - 1);
+    }
+}
+
+// smallest locus among the tips below p
+int LocusTree::recMinTipLocus(std::shared_ptr<Node> p){
+    if(p->getIsTip())
+        return p->getLocusID();
+    return std::min(recMinTipLocus(p->getLdes()), recMinTipLocus(p->getRdes()));
+}
+
+// the daughter of a duplication that carries the new copy of the locus
+// new copies always get a larger locus number than the one they came from
+// so this is the daughter whose tips have the larger locus numbers
+// (transfers keep the same locus on both sides, then ldes is used)
+std::shared_ptr<Node> LocusTree::getNewLocusChild(std::shared_ptr<Node> dup){
+    if(recMinTipLocus(dup->getRdes()) > recMinTipLocus(dup->getLdes()))
+        return dup->getRdes();
+    return dup->getLdes();
+}
+
+std::shared_ptr<Node> LocusTree::recCopyCollapsedClade(std::shared_ptr<Node> p,
+                                                       const std::set<std::shared_ptr<Node>> &collapsed,
+                                                       std::vector<std::shared_ptr<Node>> &copies){
+    std::shared_ptr<Node> q = std::shared_ptr<Node>(new Node(*p));
+    q->setAnc(nullptr);
+    q->setSib(nullptr);
+    q->setLindx((int) copies.size());
+    copies.push_back(q);
+    if(p->getIsTip())
+        return q;
+    if(copies.size() > 1 && collapsed.count(p)){
+        // collapse to one tip named after the first (extant if possible) tip of the clade
+        std::shared_ptr<Node> tip = nullptr;
+        std::vector<std::shared_ptr<Node>> stack(1, p);
+        while(!(stack.empty())){
+            std::shared_ptr<Node> n = stack.back();
+            stack.pop_back();
+            if(n->getIsTip()){
+                if(tip == nullptr || (!(tip->getIsExtant()) && n->getIsExtant()))
+                    tip = n;
+                if(tip->getIsExtant())
+                    break;
+            }
+            else{
+                stack.push_back(n->getRdes());
+                stack.push_back(n->getLdes());
+            }
+        }
+        q->setName(tip->getName());
+        q->setDeathTime(tip->getDeathTime());
+        q->setBranchLength(q->getDeathTime() - q->getBirthTime());
+        q->setIsTip(true);
+        q->setIsExtant(tip->getIsExtant());
+        q->setIsExtinct(tip->getIsExtinct());
+        q->setIsDuplication(false);
+        q->setLdes(nullptr);
+        q->setRdes(nullptr);
+        return q;
+    }
+    std::shared_ptr<Node> l = recCopyCollapsedClade(p->getLdes(), collapsed, copies);
+    std::shared_ptr<Node> r = recCopyCollapsedClade(p->getRdes(), collapsed, copies);
+    l->setAnc(q);
+    r->setAnc(q);
+    l->setSib(r);
+    r->setSib(l);
+    q->setLdes(l);
+    q->setRdes(r);
+    return q;
+}
+
+// copy of the clade below subRoot as its own locus tree, where each clade
+// rooted at a member of collapsed (other than subRoot) becomes a single tip
+std::shared_ptr<LocusTree> LocusTree::getCollapsedSubtree(std::shared_ptr<Node> subRoot,
+                                                          const std::set<std::shared_ptr<Node>> &collapsed){
+    std::shared_ptr<LocusTree> subtree = std::shared_ptr<LocusTree>(new LocusTree(*this, numTaxa));
+    std::vector<std::shared_ptr<Node>> copies;
+    std::shared_ptr<Node> r = recCopyCollapsedClade(subRoot, collapsed, copies);
+    r->setAsRoot(true);
+    subtree->root = r;
+    subtree->extantRoot = r;
+    subtree->nodes = copies;
+    subtree->extantNodes.clear();
+    for(auto node : copies){
+        if(node->getIsTip() && node->getIsExtant())
+            subtree->extantNodes.push_back(node);
+    }
+    subtree->setNumExtant();
+    subtree->setNumExtinct();
+    return subtree;
+}
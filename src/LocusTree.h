@@ -21,6 +21,8 @@ class LocusTree : public Tree
         LocusTree(const LocusTree& locustree, unsigned numTaxa);
         LocusTree(const SpeciesTree& speciestree, unsigned numTaxa, double gbr, double gdr, double ltr);
         virtual         ~LocusTree();
+        // back to a new LocusTree(nt, stop, gbr, gdr, lgtr)
+        void    reset(unsigned nt, double stop, double gbr, double gdr, double lgtr);
         double  getTimeToNextEvent() override;
         void    lineageBirthEvent(unsigned indx) override;
         void    lineageDeathEvent(unsigned indx) override;
@@ -33,10 +35,8 @@ class LocusTree : public Tree
         void    setNewIndices(int indx, std::pair<int,int> sibs, int count);
         void    setSpeciesNames(std::vector<std::string> spNames) { speciesNames = spNames; }
         std::vector<std::string> getSpeciesNames() {return speciesNames;}
-        std::string   printNewickTree();
         void    setTreeTipNames() override;
         void    recTipNamer(std::shared_ptr<Node> p, unsigned &copyNumber);
-        void    recGetNewickTree(std::shared_ptr<Node> r, std::stringstream &ss);
         void    setBranchLengths() override;
         void    setPresentTime(double currentT);
         void    setStopTime(double st) {stopTime = st; currentTime = 0;}
@@ -54,6 +54,14 @@ class LocusTree : public Tree
         std::vector< std::vector<int> >     getExtantLoci(std::set<double, std::greater<double> > epochSet);
         std::vector< std::string >    printSubTrees();
         int     postOrderTraversalStep(int indx);
+        void    setLocusIDsFromTipNames();
+        int     recMinTipLocus(std::shared_ptr<Node> p);
+        std::shared_ptr<Node>   getNewLocusChild(std::shared_ptr<Node> dup);
+        std::shared_ptr<Node>   recCopyCollapsedClade(std::shared_ptr<Node> p,
+                                                      const std::set<std::shared_ptr<Node>> &collapsed,
+                                                      std::vector<std::shared_ptr<Node>> &copies);
+        std::shared_ptr<LocusTree>  getCollapsedSubtree(std::shared_ptr<Node> subRoot,
+                                                        const std::set<std::shared_ptr<Node>> &collapsed);
         void   setNamesBySpeciesID(std::map<int,std::string> tipMap);
         void   recursiveSetNamesBySpeciesID(std::shared_ptr<Node> n,
                                             int duplicationCount,
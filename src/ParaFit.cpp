@@ -0,0 +1,70 @@
+//
+//  ParaFit.cpp
+//  treeducken
+//
+
+#include "ParaFit.h"
+#include "Rng.h"
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+arma::mat principalCoordinates(const arma::mat &dist){
+    arma::uword n = dist.n_rows;
+    arma::mat delta = -0.5 * arma::square(dist);
+    arma::rowvec colMeans = arma::mean(delta, 0);
+    arma::colvec rowMeans = arma::mean(delta, 1);
+    double grandMean = arma::accu(delta) / (n * n);
+    delta.each_row() -= colMeans;
+    delta.each_col() -= rowMeans;
+    delta += grandMean;
+    arma::vec values;
+    arma::mat vectors;
+    arma::eig_sym(values, vectors, delta);
+    // same tolerance as ape::pcoa, eig_sym gives the values in increasing order
+    double epsilon = std::sqrt(std::numeric_limits<double>::epsilon());
+    arma::uword k = 0;
+    for(arma::uword i = 0; i < n; i++)
+        if(values(i) > epsilon)
+            k++;
+    arma::mat axes(n, k);
+    for(arma::uword j = 0; j < k; j++)
+        axes.col(j) = vectors.col(n - 1 - j) * std::sqrt(values(n - 1 - j));
+    return axes;
+}
+
+ParaFit::ParaFit(const arma::mat &hostDist, const arma::mat &symbDist){
+    hostAxes = principalCoordinates(hostDist);
+    symbAxes = principalCoordinates(symbDist);
+    arma::uword k = std::min(hostAxes.n_cols, symbAxes.n_cols);
+    hostAxes.resize(hostAxes.n_rows, k);
+    symbAxes.resize(symbAxes.n_rows, k);
+}
+
+double ParaFit::statistic(const arma::mat &assoc) const {
+    // diagonal of t(H) A S without forming the whole product
+    arma::rowvec diagonal = arma::sum(hostAxes % (assoc * symbAxes), 0);
+    return arma::accu(arma::square(diagonal));
+}
+
+std::vector<double> ParaFit::permutationStatistics(const arma::mat &assoc,
+                                                   const std::vector<uint64_t> &seeds,
+                                                   int numThreads) const {
+    int reps = seeds.size();
+    std::vector<double> stats(reps);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(numThreads)
+#endif
+    for(int r = 0; r < reps; r++){
+        Rng rng(seeds[r]);
+        arma::mat shuffled = assoc;
+        for(arma::uword i = 0; i < shuffled.n_rows; i++){
+            for(arma::uword j = shuffled.n_cols; j > 1; j--){
+                arma::uword k = rng.uniformIndex(j);
+                std::swap(shuffled(i, j - 1), shuffled(i, k));
+            }
+        }
+        stats[r] = statistic(shuffled);
+    }
+    return stats;
+}
@@ -0,0 +1,46 @@
+//
+//  ParaFit.h
+//  treeducken
+//
+//  ParaFitGlobal statistic of Legendre et al. (2002) and its row permutation
+//  null distribution. The principal coordinates of the host and symbiont
+//  distance matrices are found once, so a permuted association matrix costs
+//  one matrix product rather than two eigen decompositions.
+//
+
+#ifndef ParaFit_h
+#define ParaFit_h
+
+// Armadillo comes from RcppArmadillo in the R package and from a system
+// installation in the command line build (see standalone/CMakeLists.txt)
+#ifdef TREEDUCKEN_STANDALONE
+#include <armadillo>
+#else
+#include <RcppArmadillo.h>
+#endif
+#include <vector>
+#include <cstdint>
+
+// principal coordinates of a distance matrix as in ape::pcoa, i.e. the
+// eigenvectors of the double centred -D^2 / 2 scaled by the square root of
+// their positive eigenvalues in decreasing order
+arma::mat principalCoordinates(const arma::mat &dist);
+
+class ParaFit
+{
+    private:
+        // only the axes that appear on the diagonal of t(H) A S are kept
+        arma::mat   hostAxes;
+        arma::mat   symbAxes;
+
+    public:
+                    ParaFit(const arma::mat &hostDist, const arma::mat &symbDist);
+        // hosts are rows and symbionts are columns of assoc
+        double      statistic(const arma::mat &assoc) const;
+        // statistic of assoc with every row permuted, one seed per permutation
+        std::vector<double> permutationStatistics(const arma::mat &assoc,
+                                                  const std::vector<uint64_t> &seeds,
+                                                  int numThreads) const;
+};
+
+#endif /* ParaFit_h */
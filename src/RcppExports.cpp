@@ -7,8 +7,8 @@
 using namespace Rcpp;
 
 // sim_stBD
-Rcpp::List sim_stBD(SEXP sbr, SEXP sdr, SEXP numbsim, Rcpp::NumericVector n_tips, Rcpp::NumericVector gsa_stop_mult);
-RcppExport SEXP _treeducken_sim_stBD(SEXP sbrSEXP, SEXP sdrSEXP, SEXP numbsimSEXP, SEXP n_tipsSEXP, SEXP gsa_stop_multSEXP) {
+SEXP sim_stBD(SEXP sbr, SEXP sdr, SEXP numbsim, Rcpp::NumericVector n_tips, Rcpp::NumericVector gsa_stop_mult, SEXP file, std::string format, int precision, bool sim_stats);
+RcppExport SEXP _treeducken_sim_stBD(SEXP sbrSEXP, SEXP sdrSEXP, SEXP numbsimSEXP, SEXP n_tipsSEXP, SEXP gsa_stop_multSEXP, SEXP fileSEXP, SEXP formatSEXP, SEXP precisionSEXP, SEXP sim_statsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -17,13 +17,17 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< SEXP >::type numbsim(numbsimSEXP);
     Rcpp::traits::input_parameter< Rcpp::NumericVector >::type n_tips(n_tipsSEXP);
     Rcpp::traits::input_parameter< Rcpp::NumericVector >::type gsa_stop_mult(gsa_stop_multSEXP);
-    rcpp_result_gen = Rcpp::wrap(sim_stBD(sbr, sdr, numbsim, n_tips, gsa_stop_mult));
+    Rcpp::traits::input_parameter< SEXP >::type file(fileSEXP);
+    Rcpp::traits::input_parameter< std::string >::type format(formatSEXP);
+    Rcpp::traits::input_parameter< int >::type precision(precisionSEXP);
+    Rcpp::traits::input_parameter< bool >::type sim_stats(sim_statsSEXP);
+    rcpp_result_gen = Rcpp::wrap(sim_stBD(sbr, sdr, numbsim, n_tips, gsa_stop_mult, file, format, precision, sim_stats));
     return rcpp_result_gen;
 END_RCPP
 }
 // sim_stBD_t
-Rcpp::List sim_stBD_t(SEXP sbr, SEXP sdr, SEXP numbsim, SEXP t);
-RcppExport SEXP _treeducken_sim_stBD_t(SEXP sbrSEXP, SEXP sdrSEXP, SEXP numbsimSEXP, SEXP tSEXP) {
+SEXP sim_stBD_t(SEXP sbr, SEXP sdr, SEXP numbsim, SEXP t, SEXP file, std::string format, int precision, bool sim_stats);
+RcppExport SEXP _treeducken_sim_stBD_t(SEXP sbrSEXP, SEXP sdrSEXP, SEXP numbsimSEXP, SEXP tSEXP, SEXP fileSEXP, SEXP formatSEXP, SEXP precisionSEXP, SEXP sim_statsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -31,29 +35,37 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< SEXP >::type sdr(sdrSEXP);
     Rcpp::traits::input_parameter< SEXP >::type numbsim(numbsimSEXP);
     Rcpp::traits::input_parameter< SEXP >::type t(tSEXP);
-    rcpp_result_gen = Rcpp::wrap(sim_stBD_t(sbr, sdr, numbsim, t));
+    Rcpp::traits::input_parameter< SEXP >::type file(fileSEXP);
+    Rcpp::traits::input_parameter< std::string >::type format(formatSEXP);
+    Rcpp::traits::input_parameter< int >::type precision(precisionSEXP);
+    Rcpp::traits::input_parameter< bool >::type sim_stats(sim_statsSEXP);
+    rcpp_result_gen = Rcpp::wrap(sim_stBD_t(sbr, sdr, numbsim, t, file, format, precision, sim_stats));
     return rcpp_result_gen;
 END_RCPP
 }
 // sim_ltBD
-Rcpp::List sim_ltBD(Rcpp::List species_tree, SEXP gbr, SEXP gdr, SEXP lgtr, SEXP num_loci, Rcpp::String transfer_type);
-RcppExport SEXP _treeducken_sim_ltBD(SEXP species_treeSEXP, SEXP gbrSEXP, SEXP gdrSEXP, SEXP lgtrSEXP, SEXP num_lociSEXP, SEXP transfer_typeSEXP) {
+SEXP sim_ltBD(SEXP species_tree, SEXP gbr, SEXP gdr, SEXP lgtr, SEXP num_loci, Rcpp::String transfer_type, SEXP file, std::string format, int precision, bool sim_stats);
+RcppExport SEXP _treeducken_sim_ltBD(SEXP species_treeSEXP, SEXP gbrSEXP, SEXP gdrSEXP, SEXP lgtrSEXP, SEXP num_lociSEXP, SEXP transfer_typeSEXP, SEXP fileSEXP, SEXP formatSEXP, SEXP precisionSEXP, SEXP sim_statsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
-    Rcpp::traits::input_parameter< Rcpp::List >::type species_tree(species_treeSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type species_tree(species_treeSEXP);
     Rcpp::traits::input_parameter< SEXP >::type gbr(gbrSEXP);
     Rcpp::traits::input_parameter< SEXP >::type gdr(gdrSEXP);
     Rcpp::traits::input_parameter< SEXP >::type lgtr(lgtrSEXP);
     Rcpp::traits::input_parameter< SEXP >::type num_loci(num_lociSEXP);
     Rcpp::traits::input_parameter< Rcpp::String >::type transfer_type(transfer_typeSEXP);
-    rcpp_result_gen = Rcpp::wrap(sim_ltBD(species_tree, gbr, gdr, lgtr, num_loci, transfer_type));
+    Rcpp::traits::input_parameter< SEXP >::type file(fileSEXP);
+    Rcpp::traits::input_parameter< std::string >::type format(formatSEXP);
+    Rcpp::traits::input_parameter< int >::type precision(precisionSEXP);
+    Rcpp::traits::input_parameter< bool >::type sim_stats(sim_statsSEXP);
+    rcpp_result_gen = Rcpp::wrap(sim_ltBD(species_tree, gbr, gdr, lgtr, num_loci, transfer_type, file, format, precision, sim_stats));
     return rcpp_result_gen;
 END_RCPP
 }
 // sim_cophyBD_ana
-Rcpp::List sim_cophyBD_ana(SEXP hbr, SEXP hdr, SEXP sbr, SEXP sdr, SEXP s_disp_r, SEXP s_extp_r, SEXP host_exp_rate, SEXP cosp_rate, SEXP time_to_sim, SEXP numbsim, Rcpp::NumericVector host_limit, Rcpp::LogicalVector hs_mode);
-RcppExport SEXP _treeducken_sim_cophyBD_ana(SEXP hbrSEXP, SEXP hdrSEXP, SEXP sbrSEXP, SEXP sdrSEXP, SEXP s_disp_rSEXP, SEXP s_extp_rSEXP, SEXP host_exp_rateSEXP, SEXP cosp_rateSEXP, SEXP time_to_simSEXP, SEXP numbsimSEXP, SEXP host_limitSEXP, SEXP hs_modeSEXP) {
+SEXP sim_cophyBD_ana(SEXP hbr, SEXP hdr, SEXP sbr, SEXP sdr, SEXP s_disp_r, SEXP s_extp_r, SEXP host_exp_rate, SEXP cosp_rate, SEXP time_to_sim, SEXP numbsim, Rcpp::NumericVector host_limit, Rcpp::LogicalVector hs_mode, Rcpp::IntegerVector num_threads, SEXP file, bool sim_stats, bool keep_history);
+RcppExport SEXP _treeducken_sim_cophyBD_ana(SEXP hbrSEXP, SEXP hdrSEXP, SEXP sbrSEXP, SEXP sdrSEXP, SEXP s_disp_rSEXP, SEXP s_extp_rSEXP, SEXP host_exp_rateSEXP, SEXP cosp_rateSEXP, SEXP time_to_simSEXP, SEXP numbsimSEXP, SEXP host_limitSEXP, SEXP hs_modeSEXP, SEXP num_threadsSEXP, SEXP fileSEXP, SEXP sim_statsSEXP, SEXP keep_historySEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -69,13 +81,17 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< SEXP >::type numbsim(numbsimSEXP);
     Rcpp::traits::input_parameter< Rcpp::NumericVector >::type host_limit(host_limitSEXP);
     Rcpp::traits::input_parameter< Rcpp::LogicalVector >::type hs_mode(hs_modeSEXP);
-    rcpp_result_gen = Rcpp::wrap(sim_cophyBD_ana(hbr, hdr, sbr, sdr, s_disp_r, s_extp_r, host_exp_rate, cosp_rate, time_to_sim, numbsim, host_limit, hs_mode));
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type num_threads(num_threadsSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type file(fileSEXP);
+    Rcpp::traits::input_parameter< bool >::type sim_stats(sim_statsSEXP);
+    Rcpp::traits::input_parameter< bool >::type keep_history(keep_historySEXP);
+    rcpp_result_gen = Rcpp::wrap(sim_cophyBD_ana(hbr, hdr, sbr, sdr, s_disp_r, s_extp_r, host_exp_rate, cosp_rate, time_to_sim, numbsim, host_limit, hs_mode, num_threads, file, sim_stats, keep_history));
     return rcpp_result_gen;
 END_RCPP
 }
 // sim_cophyBD
-Rcpp::List sim_cophyBD(SEXP hbr, SEXP hdr, SEXP sbr, SEXP sdr, SEXP host_exp_rate, SEXP cosp_rate, SEXP time_to_sim, SEXP numbsim, Rcpp::NumericVector host_limit, Rcpp::LogicalVector hs_mode);
-RcppExport SEXP _treeducken_sim_cophyBD(SEXP hbrSEXP, SEXP hdrSEXP, SEXP sbrSEXP, SEXP sdrSEXP, SEXP host_exp_rateSEXP, SEXP cosp_rateSEXP, SEXP time_to_simSEXP, SEXP numbsimSEXP, SEXP host_limitSEXP, SEXP hs_modeSEXP) {
+SEXP sim_cophyBD(SEXP hbr, SEXP hdr, SEXP sbr, SEXP sdr, SEXP host_exp_rate, SEXP cosp_rate, SEXP time_to_sim, SEXP numbsim, Rcpp::NumericVector host_limit, Rcpp::LogicalVector hs_mode, Rcpp::LogicalVector sparse_assoc, Rcpp::IntegerVector num_threads, SEXP file, bool sim_stats, bool keep_history);
+RcppExport SEXP _treeducken_sim_cophyBD(SEXP hbrSEXP, SEXP hdrSEXP, SEXP sbrSEXP, SEXP sdrSEXP, SEXP host_exp_rateSEXP, SEXP cosp_rateSEXP, SEXP time_to_simSEXP, SEXP numbsimSEXP, SEXP host_limitSEXP, SEXP hs_modeSEXP, SEXP sparse_assocSEXP, SEXP num_threadsSEXP, SEXP fileSEXP, SEXP sim_statsSEXP, SEXP keep_historySEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -89,13 +105,18 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< SEXP >::type numbsim(numbsimSEXP);
     Rcpp::traits::input_parameter< Rcpp::NumericVector >::type host_limit(host_limitSEXP);
     Rcpp::traits::input_parameter< Rcpp::LogicalVector >::type hs_mode(hs_modeSEXP);
-    rcpp_result_gen = Rcpp::wrap(sim_cophyBD(hbr, hdr, sbr, sdr, host_exp_rate, cosp_rate, time_to_sim, numbsim, host_limit, hs_mode));
+    Rcpp::traits::input_parameter< Rcpp::LogicalVector >::type sparse_assoc(sparse_assocSEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type num_threads(num_threadsSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type file(fileSEXP);
+    Rcpp::traits::input_parameter< bool >::type sim_stats(sim_statsSEXP);
+    Rcpp::traits::input_parameter< bool >::type keep_history(keep_historySEXP);
+    rcpp_result_gen = Rcpp::wrap(sim_cophyBD(hbr, hdr, sbr, sdr, host_exp_rate, cosp_rate, time_to_sim, numbsim, host_limit, hs_mode, sparse_assoc, num_threads, file, sim_stats, keep_history));
     return rcpp_result_gen;
 END_RCPP
 }
 // sim_msc
-Rcpp::List sim_msc(SEXP species_tree, SEXP ne, SEXP num_sampled_individuals, SEXP num_genes, Rcpp::LogicalVector rescale, Rcpp::NumericVector mutation_rate, Rcpp::NumericVector generation_time);
-RcppExport SEXP _treeducken_sim_msc(SEXP species_treeSEXP, SEXP neSEXP, SEXP num_sampled_individualsSEXP, SEXP num_genesSEXP, SEXP rescaleSEXP, SEXP mutation_rateSEXP, SEXP generation_timeSEXP) {
+Rcpp::List sim_msc(SEXP species_tree, SEXP ne, SEXP num_sampled_individuals, SEXP num_genes, Rcpp::LogicalVector rescale, Rcpp::NumericVector mutation_rate, Rcpp::NumericVector generation_time, Rcpp::IntegerVector num_threads, bool sim_stats);
+RcppExport SEXP _treeducken_sim_msc(SEXP species_treeSEXP, SEXP neSEXP, SEXP num_sampled_individualsSEXP, SEXP num_genesSEXP, SEXP rescaleSEXP, SEXP mutation_rateSEXP, SEXP generation_timeSEXP, SEXP num_threadsSEXP, SEXP sim_statsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -106,18 +127,253 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< Rcpp::LogicalVector >::type rescale(rescaleSEXP);
     Rcpp::traits::input_parameter< Rcpp::NumericVector >::type mutation_rate(mutation_rateSEXP);
     Rcpp::traits::input_parameter< Rcpp::NumericVector >::type generation_time(generation_timeSEXP);
-    rcpp_result_gen = Rcpp::wrap(sim_msc(species_tree, ne, num_sampled_individuals, num_genes, rescale, mutation_rate, generation_time));
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type num_threads(num_threadsSEXP);
+    Rcpp::traits::input_parameter< bool >::type sim_stats(sim_statsSEXP);
+    rcpp_result_gen = Rcpp::wrap(sim_msc(species_tree, ne, num_sampled_individuals, num_genes, rescale, mutation_rate, generation_time, num_threads, sim_stats));
+    return rcpp_result_gen;
+END_RCPP
+}
+// sim_mlc_native
+Rcpp::List sim_mlc_native(SEXP locus_tree, double ne, double generation_time, double mutation_rate, int num_reps, int num_threads);
+RcppExport SEXP _treeducken_sim_mlc_native(SEXP locus_treeSEXP, SEXP neSEXP, SEXP generation_timeSEXP, SEXP mutation_rateSEXP, SEXP num_repsSEXP, SEXP num_threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type locus_tree(locus_treeSEXP);
+    Rcpp::traits::input_parameter< double >::type ne(neSEXP);
+    Rcpp::traits::input_parameter< double >::type generation_time(generation_timeSEXP);
+    Rcpp::traits::input_parameter< double >::type mutation_rate(mutation_rateSEXP);
+    Rcpp::traits::input_parameter< int >::type num_reps(num_repsSEXP);
+    Rcpp::traits::input_parameter< int >::type num_threads(num_threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(sim_mlc_native(locus_tree, ne, generation_time, mutation_rate, num_reps, num_threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// sim_seqs_native
+Rcpp::List sim_seqs_native(Rcpp::List trees, int num_sites, std::vector<double> exchangeabilities, std::vector<double> base_freqs, std::vector<double> category_rates, std::vector<std::string> files, std::string format, int num_threads);
+RcppExport SEXP _treeducken_sim_seqs_native(SEXP treesSEXP, SEXP num_sitesSEXP, SEXP exchangeabilitiesSEXP, SEXP base_freqsSEXP, SEXP category_ratesSEXP, SEXP filesSEXP, SEXP formatSEXP, SEXP num_threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::List >::type trees(treesSEXP);
+    Rcpp::traits::input_parameter< int >::type num_sites(num_sitesSEXP);
+    Rcpp::traits::input_parameter< std::vector<double> >::type exchangeabilities(exchangeabilitiesSEXP);
+    Rcpp::traits::input_parameter< std::vector<double> >::type base_freqs(base_freqsSEXP);
+    Rcpp::traits::input_parameter< std::vector<double> >::type category_rates(category_ratesSEXP);
+    Rcpp::traits::input_parameter< std::vector<std::string> >::type files(filesSEXP);
+    Rcpp::traits::input_parameter< std::string >::type format(formatSEXP);
+    Rcpp::traits::input_parameter< int >::type num_threads(num_threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(sim_seqs_native(trees, num_sites, exchangeabilities, base_freqs, category_rates, files, format, num_threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+
+// tree_shape_stats_native
+Rcpp::List tree_shape_stats_native(Rcpp::List trees, int num_threads);
+RcppExport SEXP _treeducken_tree_shape_stats_native(SEXP treesSEXP, SEXP num_threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::List >::type trees(treesSEXP);
+    Rcpp::traits::input_parameter< int >::type num_threads(num_threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(tree_shape_stats_native(trees, num_threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+
+// assoc_at_native
+Rcpp::List assoc_at_native(Rcpp::List history, Rcpp::NumericVector times);
+RcppExport SEXP _treeducken_assoc_at_native(SEXP historySEXP, SEXP timesSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::List >::type history(historySEXP);
+    Rcpp::traits::input_parameter< Rcpp::NumericVector >::type times(timesSEXP);
+    rcpp_result_gen = Rcpp::wrap(assoc_at_native(history, times));
+    return rcpp_result_gen;
+END_RCPP
+}
+
+// assoc_matrix_ops_native
+Rcpp::List assoc_matrix_ops_native(Rcpp::CharacterVector ops, Rcpp::IntegerVector symbionts, Rcpp::IntegerVector hosts, bool sparse);
+RcppExport SEXP _treeducken_assoc_matrix_ops_native(SEXP opsSEXP, SEXP symbiontsSEXP, SEXP hostsSEXP, SEXP sparseSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::CharacterVector >::type ops(opsSEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type symbionts(symbiontsSEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type hosts(hostsSEXP);
+    Rcpp::traits::input_parameter< bool >::type sparse(sparseSEXP);
+    rcpp_result_gen = Rcpp::wrap(assoc_matrix_ops_native(ops, symbionts, hosts, sparse));
+    return rcpp_result_gen;
+END_RCPP
+}
+
+// parafit_native
+Rcpp::List parafit_native(arma::mat host_dist, arma::mat symb_dist, arma::mat assoc_mat, int reps, int num_threads);
+RcppExport SEXP _treeducken_parafit_native(SEXP host_distSEXP, SEXP symb_distSEXP, SEXP assoc_matSEXP, SEXP repsSEXP, SEXP num_threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< arma::mat >::type host_dist(host_distSEXP);
+    Rcpp::traits::input_parameter< arma::mat >::type symb_dist(symb_distSEXP);
+    Rcpp::traits::input_parameter< arma::mat >::type assoc_mat(assoc_matSEXP);
+    Rcpp::traits::input_parameter< int >::type reps(repsSEXP);
+    Rcpp::traits::input_parameter< int >::type num_threads(num_threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(parafit_native(host_dist, symb_dist, assoc_mat, reps, num_threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+
+// cophenetic_native
+Rcpp::NumericMatrix cophenetic_native(Rcpp::List tree);
+RcppExport SEXP _treeducken_cophenetic_native(SEXP treeSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::List >::type tree(treeSEXP);
+    rcpp_result_gen = Rcpp::wrap(cophenetic_native(tree));
+    return rcpp_result_gen;
+END_RCPP
+}
+// sim_tip_distances_native
+Rcpp::List sim_tip_distances_native(double sbr, double sdr, int n_tips);
+RcppExport SEXP _treeducken_sim_tip_distances_native(SEXP sbrSEXP, SEXP sdrSEXP, SEXP n_tipsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< double >::type sbr(sbrSEXP);
+    Rcpp::traits::input_parameter< double >::type sdr(sdrSEXP);
+    Rcpp::traits::input_parameter< int >::type n_tips(n_tipsSEXP);
+    rcpp_result_gen = Rcpp::wrap(sim_tip_distances_native(sbr, sdr, n_tips));
+    return rcpp_result_gen;
+END_RCPP
+}
+// tree_archive_open
+SEXP tree_archive_open(SEXP file);
+RcppExport SEXP _treeducken_tree_archive_open(SEXP fileSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type file(fileSEXP);
+    rcpp_result_gen = Rcpp::wrap(tree_archive_open(file));
+    return rcpp_result_gen;
+END_RCPP
+}
+// tree_archive_info
+Rcpp::List tree_archive_info(SEXP archive);
+RcppExport SEXP _treeducken_tree_archive_info(SEXP archiveSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type archive(archiveSEXP);
+    rcpp_result_gen = Rcpp::wrap(tree_archive_info(archive));
+    return rcpp_result_gen;
+END_RCPP
+}
+// tree_archive_get
+Rcpp::List tree_archive_get(SEXP archive, Rcpp::IntegerVector replicates);
+RcppExport SEXP _treeducken_tree_archive_get(SEXP archiveSEXP, SEXP replicatesSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type archive(archiveSEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type replicates(replicatesSEXP);
+    rcpp_result_gen = Rcpp::wrap(tree_archive_get(archive, replicates));
+    return rcpp_result_gen;
+END_RCPP
+}
+
+// abc_cophy_native
+SEXP abc_cophy_native(Rcpp::NumericVector parameters, Rcpp::List priors, Rcpp::NumericVector observed, Rcpp::List settings, bool anagenesis, double time_to_sim, int host_limit, bool hs_mode, int num_threads);
+RcppExport SEXP _treeducken_abc_cophy_native(SEXP parametersSEXP, SEXP priorsSEXP, SEXP observedSEXP, SEXP settingsSEXP, SEXP anagenesisSEXP, SEXP time_to_simSEXP, SEXP host_limitSEXP, SEXP hs_modeSEXP, SEXP num_threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::NumericVector >::type parameters(parametersSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type priors(priorsSEXP);
+    Rcpp::traits::input_parameter< Rcpp::NumericVector >::type observed(observedSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type settings(settingsSEXP);
+    Rcpp::traits::input_parameter< bool >::type anagenesis(anagenesisSEXP);
+    Rcpp::traits::input_parameter< double >::type time_to_sim(time_to_simSEXP);
+    Rcpp::traits::input_parameter< int >::type host_limit(host_limitSEXP);
+    Rcpp::traits::input_parameter< bool >::type hs_mode(hs_modeSEXP);
+    Rcpp::traits::input_parameter< int >::type num_threads(num_threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(abc_cophy_native(parameters, priors, observed, settings, anagenesis, time_to_sim, host_limit, hs_mode, num_threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+
+// abc_msc_native
+SEXP abc_msc_native(Rcpp::NumericVector parameters, Rcpp::List priors, Rcpp::NumericVector observed, Rcpp::List settings, Rcpp::List species_tree, bool rescale, double mutation_rate, double generation_time, int num_sampled_individuals, int num_genes, int num_threads);
+RcppExport SEXP _treeducken_abc_msc_native(SEXP parametersSEXP, SEXP priorsSEXP, SEXP observedSEXP, SEXP settingsSEXP, SEXP species_treeSEXP, SEXP rescaleSEXP, SEXP mutation_rateSEXP, SEXP generation_timeSEXP, SEXP num_sampled_individualsSEXP, SEXP num_genesSEXP, SEXP num_threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::NumericVector >::type parameters(parametersSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type priors(priorsSEXP);
+    Rcpp::traits::input_parameter< Rcpp::NumericVector >::type observed(observedSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type settings(settingsSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type species_tree(species_treeSEXP);
+    Rcpp::traits::input_parameter< bool >::type rescale(rescaleSEXP);
+    Rcpp::traits::input_parameter< double >::type mutation_rate(mutation_rateSEXP);
+    Rcpp::traits::input_parameter< double >::type generation_time(generation_timeSEXP);
+    Rcpp::traits::input_parameter< int >::type num_sampled_individuals(num_sampled_individualsSEXP);
+    Rcpp::traits::input_parameter< int >::type num_genes(num_genesSEXP);
+    Rcpp::traits::input_parameter< int >::type num_threads(num_threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(abc_msc_native(parameters, priors, observed, settings, species_tree, rescale, mutation_rate, generation_time, num_sampled_individuals, num_genes, num_threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+
+// abc_summary_cophy
+Rcpp::NumericVector abc_summary_cophy(Rcpp::List host_tree, Rcpp::List symb_tree, Rcpp::NumericMatrix assoc_mat);
+RcppExport SEXP _treeducken_abc_summary_cophy(SEXP host_treeSEXP, SEXP symb_treeSEXP, SEXP assoc_matSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::List >::type host_tree(host_treeSEXP);
+    Rcpp::traits::input_parameter< Rcpp::List >::type symb_tree(symb_treeSEXP);
+    Rcpp::traits::input_parameter< Rcpp::NumericMatrix >::type assoc_mat(assoc_matSEXP);
+    rcpp_result_gen = Rcpp::wrap(abc_summary_cophy(host_tree, symb_tree, assoc_mat));
+    return rcpp_result_gen;
+END_RCPP
+}
+
+// abc_summary_gt
+Rcpp::NumericVector abc_summary_gt(Rcpp::List trees);
+RcppExport SEXP _treeducken_abc_summary_gt(SEXP treesSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::List >::type trees(treesSEXP);
+    rcpp_result_gen = Rcpp::wrap(abc_summary_gt(trees));
     return rcpp_result_gen;
 END_RCPP
 }
 
 static const R_CallMethodDef CallEntries[] = {
-    {"_treeducken_sim_stBD", (DL_FUNC) &_treeducken_sim_stBD, 5},
-    {"_treeducken_sim_stBD_t", (DL_FUNC) &_treeducken_sim_stBD_t, 4},
-    {"_treeducken_sim_ltBD", (DL_FUNC) &_treeducken_sim_ltBD, 6},
-    {"_treeducken_sim_cophyBD_ana", (DL_FUNC) &_treeducken_sim_cophyBD_ana, 12},
-    {"_treeducken_sim_cophyBD", (DL_FUNC) &_treeducken_sim_cophyBD, 10},
-    {"_treeducken_sim_msc", (DL_FUNC) &_treeducken_sim_msc, 7},
+    {"_treeducken_sim_stBD", (DL_FUNC) &_treeducken_sim_stBD, 9},
+    {"_treeducken_sim_stBD_t", (DL_FUNC) &_treeducken_sim_stBD_t, 8},
+    {"_treeducken_sim_ltBD", (DL_FUNC) &_treeducken_sim_ltBD, 10},
+    {"_treeducken_sim_cophyBD_ana", (DL_FUNC) &_treeducken_sim_cophyBD_ana, 16},
+    {"_treeducken_sim_cophyBD", (DL_FUNC) &_treeducken_sim_cophyBD, 15},
+    {"_treeducken_sim_msc", (DL_FUNC) &_treeducken_sim_msc, 9},
+    {"_treeducken_sim_mlc_native", (DL_FUNC) &_treeducken_sim_mlc_native, 6},
+    {"_treeducken_sim_seqs_native", (DL_FUNC) &_treeducken_sim_seqs_native, 8},
+    {"_treeducken_tree_shape_stats_native", (DL_FUNC) &_treeducken_tree_shape_stats_native, 2},
+    {"_treeducken_assoc_at_native", (DL_FUNC) &_treeducken_assoc_at_native, 2},
+    {"_treeducken_assoc_matrix_ops_native", (DL_FUNC) &_treeducken_assoc_matrix_ops_native, 4},
+    {"_treeducken_parafit_native", (DL_FUNC) &_treeducken_parafit_native, 5},
+    {"_treeducken_cophenetic_native", (DL_FUNC) &_treeducken_cophenetic_native, 1},
+    {"_treeducken_sim_tip_distances_native", (DL_FUNC) &_treeducken_sim_tip_distances_native, 3},
+    {"_treeducken_tree_archive_open", (DL_FUNC) &_treeducken_tree_archive_open, 1},
+    {"_treeducken_tree_archive_info", (DL_FUNC) &_treeducken_tree_archive_info, 1},
+    {"_treeducken_tree_archive_get", (DL_FUNC) &_treeducken_tree_archive_get, 2},
+    {"_treeducken_abc_cophy_native", (DL_FUNC) &_treeducken_abc_cophy_native, 9},
+    {"_treeducken_abc_msc_native", (DL_FUNC) &_treeducken_abc_msc_native, 11},
+    {"_treeducken_abc_summary_cophy", (DL_FUNC) &_treeducken_abc_summary_cophy, 3},
+    {"_treeducken_abc_summary_gt", (DL_FUNC) &_treeducken_abc_summary_gt, 1},
     {NULL, NULL, 0}
 };
 
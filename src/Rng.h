@@ -0,0 +1,36 @@
+//
+//  Rng.h
+//  treeducken
+//
+//  Random number stream that does not go through R's generator, so that
+//  simulations can run on worker threads and outside of R. The R functions
+//  seed streams from R's generator on the main thread which keeps set.seed()
+//  reproducibility.
+//
+
+#ifndef Rng_h
+#define Rng_h
+
+#include <random>
+#include <cmath>
+#include <cstdint>
+
+class Rng
+{
+    private:
+        std::mt19937_64 engine;
+
+    public:
+                Rng(uint64_t seed) : engine(seed) {}
+        void    setSeed(uint64_t seed) { engine.seed(seed); }
+        // uniform on the open interval (0,1) like R's unif_rand
+        double  uniform() { return ((engine() >> 11) + 0.5) * (1.0 / 9007199254740992.0); }
+        double  exponential(double rate) { return -std::log(uniform()) / rate; }
+        // standard normal by Box-Muller, two uniforms per draw
+        double  normal() { return std::sqrt(-2.0 * std::log(uniform())) * std::cos(6.283185307179586 * uniform()); }
+        // uniform index in [0, n)
+        unsigned uniformIndex(unsigned n) { return (unsigned) (uniform() * n); }
+        uint64_t nextSeed() { return engine(); }
+};
+
+#endif /* Rng_h */
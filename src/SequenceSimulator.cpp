@@ -0,0 +1,244 @@
+//
+//  SequenceSimulator.cpp
+//  treeducken
+//
+
+#include "SequenceSimulator.h"
+#include <cmath>
+#include <algorithm>
+
+static const char nucleotides[4] = {'A', 'C', 'G', 'T'};
+
+char PackedAlignment::getSite(unsigned i, unsigned site) const {
+    return nucleotides[(seqs[i][site >> 5] >> (2 * (site & 31))) & 3];
+}
+
+std::string PackedAlignment::getSequence(unsigned i) const {
+    std::string seq(numSites, 'A');
+    for(unsigned s = 0; s < numSites; s++)
+        seq[s] = getSite(i, s);
+    return seq;
+}
+
+// cyclic Jacobi rotations for the 4x4 symmetric matrix a
+// on return the eigenvalues are in vals and the eigenvectors are the columns of vecs
+static void jacobiEigen(double a[4][4], double vals[4], double vecs[4][4]){
+    for(int i = 0; i < 4; i++)
+        for(int j = 0; j < 4; j++)
+            vecs[i][j] = (i == j) ? 1.0 : 0.0;
+    for(int sweep = 0; sweep < 100; sweep++){
+        double offDiag = 0.0;
+        for(int p = 0; p < 4; p++)
+            for(int q = p + 1; q < 4; q++)
+                offDiag += a[p][q] * a[p][q];
+        if(offDiag < 1e-30)
+            break;
+        for(int p = 0; p < 4; p++){
+            for(int q = p + 1; q < 4; q++){
+                if(std::fabs(a[p][q]) < 1e-300)
+                    continue;
+                double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+                double t = (theta >= 0 ? 1.0 : -1.0) / (std::fabs(theta) + std::sqrt(theta * theta + 1.0));
+                double c = 1.0 / std::sqrt(t * t + 1.0);
+                double s = t * c;
+                for(int k = 0; k < 4; k++){
+                    double akp = a[k][p];
+                    double akq = a[k][q];
+                    a[k][p] = c * akp - s * akq;
+                    a[k][q] = s * akp + c * akq;
+                }
+                for(int k = 0; k < 4; k++){
+                    double apk = a[p][k];
+                    double aqk = a[q][k];
+                    a[p][k] = c * apk - s * aqk;
+                    a[q][k] = s * apk + c * aqk;
+                }
+                for(int k = 0; k < 4; k++){
+                    double vkp = vecs[k][p];
+                    double vkq = vecs[k][q];
+                    vecs[k][p] = c * vkp - s * vkq;
+                    vecs[k][q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+    for(int i = 0; i < 4; i++)
+        vals[i] = a[i][i];
+}
+
+// exchangeabilities are in the order AC, AG, AT, CG, CT, GT
+// the rate matrix is scaled to one expected substitution per unit time
+SequenceSimulator::SequenceSimulator(std::vector<double> exchangeabilities,
+                                     std::vector<double> freqs,
+                                     std::vector<double> catRates,
+                                     unsigned nsites){
+    numSites = nsites;
+    categoryRates = catRates;
+    double freqSum = 0.0;
+    for(int i = 0; i < 4; i++)
+        freqSum += freqs[i];
+    for(int i = 0; i < 4; i++)
+        baseFreqs[i] = freqs[i] / freqSum;
+    double R[4][4] = {{0.0}};
+    int k = 0;
+    for(int i = 0; i < 4; i++){
+        for(int j = i + 1; j < 4; j++){
+            R[i][j] = exchangeabilities[k];
+            R[j][i] = exchangeabilities[k];
+            k++;
+        }
+    }
+    // mean rate of the unscaled Q
+    double mu = 0.0;
+    for(int i = 0; i < 4; i++)
+        for(int j = 0; j < 4; j++)
+            if(i != j)
+                mu += baseFreqs[i] * R[i][j] * baseFreqs[j];
+    // S = D^1/2 Q D^-1/2 is symmetric and has the same eigenvalues as Q
+    double S[4][4];
+    for(int i = 0; i < 4; i++){
+        double rowSum = 0.0;
+        for(int j = 0; j < 4; j++){
+            if(i != j){
+                S[i][j] = R[i][j] * std::sqrt(baseFreqs[i] * baseFreqs[j]) / mu;
+                rowSum += R[i][j] * baseFreqs[j] / mu;
+            }
+        }
+        S[i][i] = -rowSum;
+    }
+    jacobiEigen(S, eigVals, eigVecs);
+}
+
+void SequenceSimulator::transitionMatrix(double t, double P[4][4]) const {
+    double expL[4];
+    for(int k = 0; k < 4; k++)
+        expL[k] = std::exp(eigVals[k] * t);
+    for(int i = 0; i < 4; i++){
+        for(int j = 0; j < 4; j++){
+            double p = 0.0;
+            for(int k = 0; k < 4; k++)
+                p += eigVecs[i][k] * expL[k] * eigVecs[j][k];
+            p *= std::sqrt(baseFreqs[j] / baseFreqs[i]);
+            P[i][j] = std::max(p, 0.0);
+        }
+    }
+}
+
+// for every rate category and starting base the first three entries of the
+// cumulative row of P, laid out as cumP[(category * 4 + from) * 3 + to]
+void SequenceSimulator::setCumulativeMatrices(double brlen, std::vector<double> &cumP) const {
+    double P[4][4];
+    cumP.resize(categoryRates.size() * 12);
+    for(unsigned c = 0; c < categoryRates.size(); c++){
+        transitionMatrix(brlen * categoryRates[c], P);
+        for(int i = 0; i < 4; i++){
+            double rowSum = P[i][0] + P[i][1] + P[i][2] + P[i][3];
+            double cum = 0.0;
+            for(int j = 0; j < 3; j++){
+                cum += P[i][j] / rowSum;
+                cumP[(c * 4 + i) * 3 + j] = cum;
+            }
+        }
+    }
+}
+
+PackedAlignment SequenceSimulator::simulate(const std::vector<int> &anc,
+                                            const std::vector<int> &des,
+                                            const std::vector<double> &brlens,
+                                            const std::vector<std::string> &tipNames,
+                                            Rng &rng) const {
+    int numTips = (int) tipNames.size();
+    int numNodes = 0;
+    for(unsigned e = 0; e < anc.size(); e++)
+        numNodes = std::max(numNodes, std::max(anc[e], des[e]));
+    int rootNode = numTips + 1;
+    unsigned numWords = (numSites + 31) / 32;
+
+    // edges from the root down so every parent sequence exists before its children
+    std::vector< std::vector<int> > edgesFrom(numNodes + 1);
+    for(unsigned e = 0; e < anc.size(); e++)
+        edgesFrom[anc[e]].push_back(e);
+    std::vector<int> edgeOrder;
+    edgeOrder.reserve(anc.size());
+    std::vector<int> nodeQueue(1, rootNode);
+    for(unsigned i = 0; i < nodeQueue.size(); i++){
+        for(auto e : edgesFrom[nodeQueue[i]]){
+            edgeOrder.push_back(e);
+            nodeQueue.push_back(des[e]);
+        }
+    }
+
+    std::vector< std::vector<uint64_t> > nodeSeqs(numNodes + 1);
+    std::vector<uint8_t> from(numSites), to(numSites), cats(numSites, 0);
+    std::vector<double> u(numSites);
+    unsigned numCats = categoryRates.size();
+    if(numCats > 1)
+        for(unsigned s = 0; s < numSites; s++)
+            cats[s] = (uint8_t) rng.uniformIndex(numCats);
+
+    // root sequence from the stationary frequencies
+    double cumFreqs[3] = {baseFreqs[0],
+                          baseFreqs[0] + baseFreqs[1],
+                          baseFreqs[0] + baseFreqs[1] + baseFreqs[2]};
+    for(unsigned s = 0; s < numSites; s++){
+        double x = rng.uniform();
+        to[s] = (uint8_t) ((x > cumFreqs[0]) + (x > cumFreqs[1]) + (x > cumFreqs[2]));
+    }
+    nodeSeqs[rootNode].assign(numWords, 0);
+    for(unsigned s = 0; s < numSites; s++)
+        nodeSeqs[rootNode][s >> 5] |= (uint64_t) to[s] << (2 * (s & 31));
+
+    std::vector<double> cumP;
+    for(auto e : edgeOrder){
+        const std::vector<uint64_t> &parentSeq = nodeSeqs[anc[e]];
+        for(unsigned s = 0; s < numSites; s++)
+            from[s] = (uint8_t) ((parentSeq[s >> 5] >> (2 * (s & 31))) & 3);
+        setCumulativeMatrices(brlens[e], cumP);
+        for(unsigned s = 0; s < numSites; s++)
+            u[s] = rng.uniform();
+        // new base = number of cumulative probabilities below the draw
+        const double *cp = cumP.data();
+        for(unsigned s = 0; s < numSites; s++){
+            const double *c = cp + (cats[s] * 4 + from[s]) * 3;
+            double x = u[s];
+            to[s] = (uint8_t) ((x > c[0]) + (x > c[1]) + (x > c[2]));
+        }
+        std::vector<uint64_t> &childSeq = nodeSeqs[des[e]];
+        childSeq.assign(numWords, 0);
+        for(unsigned s = 0; s < numSites; s++)
+            childSeq[s >> 5] |= (uint64_t) to[s] << (2 * (s & 31));
+        // internal sequences are not needed once both children are done
+        if(anc[e] != rootNode && e == edgesFrom[anc[e]].back())
+            std::vector<uint64_t>().swap(nodeSeqs[anc[e]]);
+    }
+
+    PackedAlignment aln;
+    aln.numSites = numSites;
+    aln.names = tipNames;
+    aln.seqs.resize(numTips);
+    for(int i = 0; i < numTips; i++)
+        aln.seqs[i].swap(nodeSeqs[i + 1]);
+    return aln;
+}
+
+void writeFasta(std::ostream &out, const PackedAlignment &aln){
+    const unsigned lineWidth = 60;
+    std::string line;
+    for(unsigned i = 0; i < aln.seqs.size(); i++){
+        out << '>' << aln.names[i] << '\n';
+        for(unsigned start = 0; start < aln.numSites; start += lineWidth){
+            unsigned end = std::min(start + lineWidth, aln.numSites);
+            line.resize(end - start);
+            for(unsigned s = start; s < end; s++)
+                line[s - start] = aln.getSite(i, s);
+            out << line << '\n';
+        }
+    }
+}
+
+// relaxed sequential PHYLIP (names are not padded to 10 characters)
+void writePhylip(std::ostream &out, const PackedAlignment &aln){
+    out << aln.seqs.size() << ' ' << aln.numSites << '\n';
+    for(unsigned i = 0; i < aln.seqs.size(); i++)
+        out << aln.names[i] << "  " << aln.getSequence(i) << '\n';
+}
@@ -0,0 +1,58 @@
+//
+//  SequenceSimulator.h
+//  treeducken
+//
+//  Nucleotide sequence evolution (GTR family with discrete gamma rates)
+//  along a tree given as an ape style edge list.
+//
+
+#ifndef SequenceSimulator_h
+#define SequenceSimulator_h
+
+#include "Rng.h"
+#include <vector>
+#include <string>
+#include <ostream>
+#include <cstdint>
+
+// sequences of an alignment packed 2 bits per site (A = 0, C = 1, G = 2, T = 3)
+struct PackedAlignment
+{
+    unsigned numSites;
+    std::vector<std::string> names;
+    std::vector< std::vector<uint64_t> > seqs;
+
+    char    getSite(unsigned i, unsigned site) const;
+    std::string getSequence(unsigned i) const;
+};
+
+class SequenceSimulator
+{
+    private:
+        unsigned numSites;
+        double   baseFreqs[4];
+        // eigen decomposition of the symmetrized rate matrix
+        double   eigVals[4];
+        double   eigVecs[4][4];
+        std::vector<double> categoryRates;
+
+        void     setCumulativeMatrices(double brlen, std::vector<double> &cumP) const;
+
+    public:
+                 SequenceSimulator(std::vector<double> exchangeabilities,
+                                   std::vector<double> freqs,
+                                   std::vector<double> catRates,
+                                   unsigned nsites);
+        void     transitionMatrix(double t, double P[4][4]) const;
+        // edges use ape numbering (tips 1..numTips, root numTips + 1)
+        PackedAlignment simulate(const std::vector<int> &anc,
+                                 const std::vector<int> &des,
+                                 const std::vector<double> &brlens,
+                                 const std::vector<std::string> &tipNames,
+                                 Rng &rng) const;
+};
+
+void writeFasta(std::ostream &out, const PackedAlignment &aln);
+void writePhylip(std::ostream &out, const PackedAlignment &aln);
+
+#endif /* SequenceSimulator_h */
@@ -0,0 +1,84 @@
+//
+//  SimulationStats.cpp
+//  treeducken
+//
+
+#include "SimulationStats.h"
+
+SimulationStats::SimulationStats(){
+    events.assign(NumEvents, 0);
+    phaseSeconds.assign(NumPhases, 0.0);
+    attempts = 0;
+    rejections = 0;
+    nodesAllocated = 0;
+    phase = NoPhase;
+}
+
+void SimulationStats::countEvent(EventLog::Type e){
+    switch(e){
+        case EventLog::HostSpeciation:
+            events[HostSpeciation]++;
+            break;
+        case EventLog::HostLoss:
+            events[HostLoss]++;
+            break;
+        case EventLog::SymbiontSpeciation:
+            events[SymbiontSpeciation]++;
+            break;
+        case EventLog::SymbiontLoss:
+            events[SymbiontLoss]++;
+            break;
+        case EventLog::HostExpansion:
+            events[HostExpansion]++;
+            break;
+        case EventLog::Cospeciation:
+            events[Cospeciation]++;
+            break;
+        case EventLog::Dispersal:
+            events[Dispersal]++;
+            break;
+        case EventLog::Extirpation:
+            events[Extirpation]++;
+            break;
+        default:
+            break;
+    }
+}
+
+SimulationStats::Phase SimulationStats::enterPhase(Phase p){
+    Clock::time_point now = Clock::now();
+    if(phase != NoPhase)
+        phaseSeconds[phase] += std::chrono::duration<double>(now - phaseStart).count();
+    Phase previous = phase;
+    phase = p;
+    phaseStart = now;
+    return previous;
+}
+
+void SimulationStats::merge(const SimulationStats &other){
+    for(int e = 0; e < NumEvents; e++)
+        events[e] += other.events[e];
+    for(int p = 0; p < NumPhases; p++)
+        phaseSeconds[p] += other.phaseSeconds[p];
+    attempts += other.attempts;
+    rejections += other.rejections;
+    nodesAllocated += other.nodesAllocated;
+}
+
+const char* SimulationStats::getEventName(Event e){
+    static const char* names[NumEvents] = {"speciation", "extinction",
+                                           "duplication", "loss", "transfer",
+                                           "coalescence", "host_speciation",
+                                           "host_loss", "symbiont_speciation",
+                                           "symbiont_loss", "host_expansion",
+                                           "cospeciation", "dispersal",
+                                           "extirpation"};
+    return (e < NumEvents) ? names[e] : "";
+}
+
+const char* SimulationStats::getPhaseName(Phase p){
+    static const char* names[NumPhases] = {"simulation", "reconstruction",
+                                           "coalescent_setup", "coalescent",
+                                           "export"};
+    return (p < NumPhases) ? names[p] : "";
+}
@@ -0,0 +1,112 @@
+//
+//  SimulationStats.h
+//  treeducken
+//
+//  Opt-in instrumentation of a Simulator: events by type, attempts and
+//  rejections of the retry wrappers (simSpeciesTree and friends), nodes
+//  allocated and wall time per phase. A Simulator without stats only pays
+//  a null pointer check at each of the places that count.
+//
+
+#ifndef SimulationStats_h
+#define SimulationStats_h
+
+#include "Tree.h"
+#include "EventLog.h"
+#include <chrono>
+
+class SimulationStats
+{
+    public:
+        enum Event
+        {
+            Speciation = 0,
+            Extinction,
+            Duplication,
+            Loss,
+            Transfer,
+            Coalescence,
+            HostSpeciation,
+            HostLoss,
+            SymbiontSpeciation,
+            SymbiontLoss,
+            HostExpansion,
+            Cospeciation,
+            Dispersal,
+            Extirpation,
+            NumEvents
+        };
+        // phases are exclusive, time spent in a phase entered from another
+        // one is only counted once
+        enum Phase
+        {
+            Simulation = 0, // the event loops, retries included
+            Reconstruction, // pruning and relabelling GSA trees
+            CoalescentSetup, // epochs of the locus tree
+            Coalescent, // the gene trees
+            Export, // building R objects or writing files
+            NumPhases,
+            NoPhase = NumPhases
+        };
+
+    private:
+        typedef std::chrono::steady_clock   Clock;
+        // events of rejected attempts are counted too
+        std::vector<unsigned long>  events;
+        std::vector<double>         phaseSeconds;
+        unsigned long   attempts, rejections;
+        unsigned long   nodesAllocated;
+        Phase           phase;
+        Clock::time_point   phaseStart;
+
+    public:
+                        SimulationStats();
+        void            countEvent(Event e, unsigned long n = 1) { events[e] += n; }
+        // the cophylogenetic events as they are written to the event log
+        void            countEvent(EventLog::Type e);
+        void            countAttempt(bool good) { attempts++; rejections += !good; }
+        unsigned long*  getNodeCounter() { return &nodesAllocated; }
+        // charges the time since the last switch to the current phase and
+        // returns it so a PhaseTimer can switch back
+        Phase           enterPhase(Phase p);
+        // adds the counts of another simulator, e.g. one per thread
+        void            merge(const SimulationStats &other);
+
+        unsigned long   getEventCount(Event e) const { return events[e]; }
+        unsigned long   getAttempts() const { return attempts; }
+        unsigned long   getRejections() const { return rejections; }
+        unsigned long   getNodesAllocated() const { return nodesAllocated; }
+        double          getPhaseSeconds(Phase p) const { return phaseSeconds[p]; }
+
+        static const char*  getEventName(Event e);
+        static const char*  getPhaseName(Phase p);
+};
+
+// Times a phase for as long as it is in scope and counts the nodes allocated
+// on this thread meanwhile. Does nothing when stats is null.
+class PhaseTimer
+{
+    private:
+        SimulationStats         *stats;
+        SimulationStats::Phase  previousPhase;
+        unsigned long           *previousCounter;
+
+    public:
+        PhaseTimer(SimulationStats *s, SimulationStats::Phase p) : stats(s) {
+            if(stats){
+                previousPhase = stats->enterPhase(p);
+                previousCounter = Node::allocationCounter;
+                Node::allocationCounter = stats->getNodeCounter();
+            }
+        }
+        ~PhaseTimer(){
+            if(stats){
+                stats->enterPhase(previousPhase);
+                Node::allocationCounter = previousCounter;
+            }
+        }
+        PhaseTimer(const PhaseTimer&) = delete;
+        PhaseTimer& operator=(const PhaseTimer&) = delete;
+};
+
+#endif /* SimulationStats_h */
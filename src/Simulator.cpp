@@ -1,12 +1,11 @@
 #include "Simulator.h"
 #include <iostream>
 #include <algorithm>
+#include <stdexcept>
 
-#include <RcppArmadillo.h>
-
-// [[Rcpp::depends(RcppArmadillo)]]
 Simulator::Simulator(unsigned nt, double lambda, double mu, double rho)
 {
+    rng = std::make_shared<Rng>(5489u);
     spTree = nullptr;
     geneTree = nullptr;
     lociTree = nullptr;
@@ -40,6 +39,7 @@ Simulator::Simulator(unsigned ntax,
                      double lgtr,
                      std::string transfType)
 {
+    rng = std::make_shared<Rng>(5489u);
     spTree = nullptr;
     geneTree = nullptr;
     lociTree = nullptr;
@@ -78,6 +78,7 @@ Simulator::Simulator(unsigned ntax,
                      double ts,
                      bool sout)
 {
+    rng = std::make_shared<Rng>(5489u);
     spTree = nullptr;
     geneTree = nullptr;
     lociTree = nullptr;
@@ -111,6 +112,7 @@ Simulator::Simulator(double stopTime,
           double rho,
           int hl,
           bool hsMode){
+    rng = std::make_shared<Rng>(5489u);
     host_switch_mode = hsMode;
     speciationRate = hostSpeciationRate;
     extinctionRate = hostExtinctionRate;
@@ -119,9 +121,12 @@ Simulator::Simulator(double stopTime,
     geneBirthRate = symbSpeciationRate;
     geneDeathRate = symbExtinctionRate;
     transferRate = switchingRate;
+    dispersalRate = 0.0;
+    extirpationRate = 0.0;
     timeToSim = stopTime;
 
     hostLimit = hl;
+    keepHistory = false;
 
     spTree = nullptr;
     geneTree = nullptr;
@@ -143,6 +148,7 @@ Simulator::Simulator(double stopTime,
                      double rho,
                      int hl,
                      bool hsMode){
+  rng = std::make_shared<Rng>(5489u);
   speciationRate = hostSpeciationRate;
   extinctionRate = hostExtinctionRate;
   samplingRate = rho;
@@ -153,7 +159,7 @@ Simulator::Simulator(double stopTime,
   timeToSim = stopTime;
 
   hostLimit = hl;
-
+  keepHistory = false;
 
   host_switch_mode = hsMode;
 
@@ -175,16 +181,53 @@ Simulator::~Simulator(){
     assocMat.clear();
 }
 
+void Simulator::resetReplicate(){
+    currentSimTime = 0.0;
+    gsaTrees.clear();
+    eventLog.clear();
+}
+
+void Simulator::renewSpeciesTree(std::shared_ptr<SpeciesTree> &tree, unsigned nt){
+    if(tree && tree.use_count() == 1)
+        tree->reset(nt, currentSimTime, speciationRate, extinctionRate);
+    else
+        tree = std::make_shared<SpeciesTree>(nt, currentSimTime, speciationRate, extinctionRate);
+    tree->setRng(rng);
+}
+
+void Simulator::renewSymbiontTree(){
+    if(symbiontTree && symbiontTree.use_count() == 1)
+        symbiontTree->reset(1, currentSimTime, geneBirthRate, geneDeathRate, transferRate, hostLimit);
+    else
+        symbiontTree = std::make_shared<SymbiontTree>(1,
+                                                      currentSimTime,
+                                                      geneBirthRate,
+                                                      geneDeathRate,
+                                                      transferRate,
+                                                      hostLimit);
+    symbiontTree->setRng(rng);
+}
+
+void Simulator::renewLocusTree(){
+    if(lociTree && lociTree.use_count() == 1)
+        lociTree->reset(numTaxaToSim, currentSimTime, geneBirthRate, geneDeathRate, transferRate);
+    else
+        lociTree = std::make_shared<LocusTree>(numTaxaToSim,
+                                               currentSimTime,
+                                               geneBirthRate,
+                                               geneDeathRate,
+                                               transferRate);
+    lociTree->setRng(rng);
+}
+
 void Simulator::initializeSim(){
     spTree = std::shared_ptr<SpeciesTree>(new SpeciesTree(numTaxaToSim, currentSimTime, speciationRate, extinctionRate));
+    spTree->setRng(rng);
 }
 
 
 void Simulator::initializeEventVector(){
-  inOrderVecOfHostIndx.push_back(0);
-  inOrderVecOfSymbIndx.push_back(0);
-  inOrderVecOfEvent.push_back("I");
-  inOrderVecOfEventTimes.push_back(0.0);
+  eventLog.addEvent(0, 0, EventLog::Initial, 0.0);
 }
 /*
  Main general sampling algorithm (GSA) for simulating a species tree to an expected number
@@ -198,8 +241,10 @@ bool Simulator::gsaBDSim(){
     double sampTime = NAN;
     bool treeComplete = false;
     // make a species tree object with the number of taxa to sim to, currsimtime (0.0)
-    // and speciation and extinction rate
-    spTree = std::shared_ptr<SpeciesTree>(new SpeciesTree(numTaxaToSim, currentSimTime, speciationRate, extinctionRate));
+    // and speciation and extinction rate, reusing the one of the last attempt
+    spTree = nullptr;
+    renewSpeciesTree(gsaSimTree, numTaxaToSim);
+    spTree = gsaSimTree;
     double eventTime = NAN;
     // runs until the number of extant tips reaches gsaStop (set by users, default is 10*number to sim to)
     while(spTree->getNumExtant() < gsaStop){
@@ -208,7 +253,12 @@ bool Simulator::gsaBDSim(){
         // add this to the sim time tracker
         currentSimTime += eventTime;
         // speciation or extinction occurs
+        unsigned numExtantBefore = spTree->getNumExtant();
         spTree->ermEvent(currentSimTime);
+        if(stats)
+            stats->countEvent(spTree->getNumExtant() > numExtantBefore ?
+                              SimulationStats::Speciation : SimulationStats::Extinction);
+        checkCancellation();
         if(spTree->getNumExtant() < 1){
             // if the tree goes to 0 tips prematurely end
             // return false for a non-tree
@@ -220,18 +270,20 @@ bool Simulator::gsaBDSim(){
             timeIntv = spTree->getTimeToNextEvent();
             // randomly choose some proportion of the above 'timeIntv' and add
             // to the sim time tracker
-            sampTime = (unif_rand() * timeIntv) + currentSimTime;
+            sampTime = (drawUniform() * timeIntv) + currentSimTime;
             // set this as the present time for this sub-tree
             spTree->setPresentTime(sampTime);
             // reconstruct this tree from the root of the whole tree to the
             // number of extant tips (i.e. numTaxaToSim) and add to a vector
             // gsaTrees
+            PhaseTimer timer(stats.get(), SimulationStats::Reconstruction);
             processGSASim();
         }
 
     }
+    PhaseTimer timer(stats.get(), SimulationStats::Reconstruction);
     // randomly pick one of the gsaTrees
-    unsigned gsaRandomTreeID = unif_rand() * (gsaTrees.size() - 1);
+    unsigned gsaRandomTreeID = drawUniform() * (gsaTrees.size() - 1);
     spTree = gsaTrees[gsaRandomTreeID];
     // process this one
     processSpTreeSim();
@@ -286,9 +338,13 @@ void Simulator::prepGSATreeForReconstruction(){
 // Wrapper to make sure that the tree output by gsaBDSim is a proper tree with
 // the correct number of tips and not just a tree with no tips
 bool Simulator::simSpeciesTree(){
+    PhaseTimer timer(stats.get(), SimulationStats::Simulation);
+    resetReplicate();
     bool good = false;
     while(!good){
         good = gsaBDSim();
+        if(stats)
+            stats->countAttempt(good);
     }
     return good;
 }
@@ -296,9 +352,13 @@ bool Simulator::simSpeciesTree(){
 // Wrapper to make sure that the tree output by bdSimpleSim is a proper tree with
 //  tips and not just a tree with no tips
 bool Simulator::simSpeciesTreeTime(){
+  PhaseTimer timer(stats.get(), SimulationStats::Simulation);
+  resetReplicate();
   bool good = false;
   while(!good){
     good = bdSimpleSim();
+    if(stats)
+      stats->countAttempt(good);
   }
   return good;
 }
@@ -313,10 +373,7 @@ bool Simulator::bdSimpleSim(){
   double eventTime = NAN;
   // make a variable SpeciesTree to hold our tree. numTaxaToSim is set to 1 here.
   // this is arbitrary and I should've planned out my classes and constructors better
-  spTree = std::shared_ptr<SpeciesTree>(new SpeciesTree(numTaxaToSim,
-                                                        currentSimTime,
-                                                        speciationRate,
-                                                        extinctionRate));
+  renewSpeciesTree(spTree, numTaxaToSim);
   while(currentSimTime < stopTime){
     // get the time to the next event as a function of speciation and extinction rates and number of currently alive
     // tips
@@ -328,7 +385,12 @@ bool Simulator::bdSimpleSim(){
       currentSimTime = stopTime;
     }
     else{ // otherwise choose an event at random
+      unsigned numExtantBefore = spTree->getNumExtant();
       spTree->ermEvent(currentSimTime);
+      if(stats)
+        stats->countEvent(spTree->getNumExtant() > numExtantBefore ?
+                          SimulationStats::Speciation : SimulationStats::Extinction);
+      checkCancellation();
     }
     // if tree goes to 0 living tips end prematurely
     if(spTree->getNumExtant() < 1){
@@ -352,227 +414,83 @@ bool Simulator::bdSimpleSim(){
 }
 // TODO: actually add the anagenetic part into this.
 bool Simulator::simHostSymbSpeciesTreePairWithAnagenesis() {
+  PhaseTimer timer(stats.get(), SimulationStats::Simulation);
+  resetReplicate();
   bool good = false;
   while(!good) {
-    good = pairedBDPSimAna();
+    good = pairedBDPSim();
+    if(stats)
+      stats->countAttempt(good);
   }
   return good;
 }
 
-double Simulator::getTimeToAnaEvent(double dispersalRate,
-                                    double extirpationRate,
-                                    arma::umat assocMat) {
-  arma::uword numSymbs = assocMat.n_rows;
-  Rcpp::NumericVector randNum = Rcpp::runif(1);
-  double sumrt = dispersalRate + extirpationRate;
-  //double t = -log(randNum[0]) / (sumrt);
-  double t = -log(randNum[0]) / (double(numSymbs) * sumrt);
-
-  return t;
-}
-
-arma::umat Simulator::symbiontDispersalEvent(int symbInd, arma::umat assocMat) {
+void Simulator::symbiontDispersalEvent(int symbInd) {
   // check if symbiont row has max number of hosts if so delete one at random
-
-  arma::urowvec symbiontHosts = assocMat.row(symbInd);
-  arma::uvec occupiedIndices = arma::find(symbiontHosts > 0);
-  arma::uword numHosts = arma::sum(symbiontHosts);
+  std::vector<unsigned> occupiedIndices = assocMat.getHostsOf(symbInd);
+  unsigned numHosts = occupiedIndices.size();
   if(numHosts >= hostLimit){
-    int nodeInd = arma::randi<arma::uword>(arma::distr_param(0, occupiedIndices.size() - 1));
-    symbiontHosts(occupiedIndices(nodeInd)) = 0;
+    int nodeInd = drawIndex(occupiedIndices.size());
+    assocMat.dissociate(symbInd, occupiedIndices[nodeInd]);
   }
-
-  arma::uvec unoccupiedIndices = arma::find(symbiontHosts < 1);
-  if(unoccupiedIndices.size() > 0) {
-    int nodeInd = arma::randi<arma::uword>(arma::distr_param(0, unoccupiedIndices.size() - 1));
-    symbiontHosts(unoccupiedIndices(nodeInd)) = 1;
+  // then add one at random
+  unsigned numUnoccupied = assocMat.getNumHosts() - assocMat.getNumHostsOf(symbInd);
+  if(numUnoccupied > 0) {
+    int nodeInd = drawIndex(numUnoccupied);
+    assocMat.associate(symbInd, assocMat.getUnoccupiedHostOf(symbInd, nodeInd));
   }
-  assocMat.row(symbInd) = symbiontHosts;
-        // then add one at rrandom
-
-
-  return assocMat;
 }
 
-arma::umat Simulator::symbiontExtirpationEvent(int symbInd, arma::umat assocMat) {
+void Simulator::symbiontExtirpationEvent(int symbInd) {
   // find symbiont's hosts
-  arma::urowvec symbiontHosts = assocMat.row(symbInd);
-  arma::uvec occupiedIndices = arma::find(symbiontHosts > 0);
-  // so now im getting an error where occupiedindices is empty
-  // what does this mean???
-  // this means that there are no 1's in this row.
-
+  std::vector<unsigned> occupiedIndices = assocMat.getHostsOf(symbInd);
+  int nodeInd = drawIndex(occupiedIndices.size());
+  assocMat.dissociate(symbInd, occupiedIndices[nodeInd]); // deletes a host association
 
-  int nodeInd = arma::randi<arma::uword>(arma::distr_param(0, occupiedIndices.size() - 1));
-
-
-  symbiontHosts(occupiedIndices(nodeInd)) = 0; // deletes a host association
-  arma::uword numHosts = arma::sum(symbiontHosts);
-
-  if(numHosts == 0){
+  if(assocMat.getNumHostsOf(symbInd) == 0){
     updateEventVector(spTree->getNodesIndxFromExtantIndx(0),
                       symbiontTree->getNodesIndxFromExtantIndx(symbInd),
-                      0,
+                      EventLog::SymbiontLoss,
                       currentSimTime);
     // this means that the symbiont now has no hosts so extinction occurs
     symbiontTree->lineageDeathEvent(symbInd);
-    assocMat.shed_row(symbInd); // gets rid of row in association matrix
-
+    assocMat.removeSymbiont(symbInd); // gets rid of row in association matrix
   }
-  else{
-
-    assocMat.row(symbInd) = symbiontHosts;
-
-
-  }
-  // check if there are no more hosts if so extinction event here
-
-  return assocMat;
 }
 
-arma::umat Simulator::anageneticEvent(double dispersalRate,
-                                      double extirpationRate,
-                                      double currTime,
-                                       arma::umat assocMat) {
-  // 1 - which event
-  Rcpp::NumericVector randNum = Rcpp::runif(2);
-  double relaDispersalRate = dispersalRate / (dispersalRate + extirpationRate);
-  bool isDispersal = (randNum[0] < relaDispersalRate ? true : false);
-  // 2 - which lineage does event happen to
-  int nodeInd = randNum[1]*(assocMat.n_rows - 1);
-
-
+// dispersal (a new host) or extirpation (losing a host) of a random symbiont
+void Simulator::anageneticEvent(bool isDispersal, double currTime) {
+  unsigned numSymbs = assocMat.getNumSymbionts();
+  int nodeInd = 0;
+  if(numSymbs > 1)
+    nodeInd = drawIndex(numSymbs);
+  spTree->setCurrentTime(currTime);
+  symbiontTree->setCurrentTime(currTime);
   if(isDispersal){
     updateEventVector(spTree->getNodesIndxFromExtantIndx(0),
                       symbiontTree->getNodesIndxFromExtantIndx(nodeInd),
-                      7,
+                      EventLog::Dispersal,
                       currTime);
-    assocMat = symbiontDispersalEvent(nodeInd, assocMat);
-
-    }
+    symbiontDispersalEvent(nodeInd);
+  }
   else{
     updateEventVector(spTree->getNodesIndxFromExtantIndx(0),
                       symbiontTree->getNodesIndxFromExtantIndx(nodeInd),
-                      8,
+                      EventLog::Extirpation,
                       currTime);
-    assocMat = symbiontExtirpationEvent(nodeInd, assocMat);
+    symbiontExtirpationEvent(nodeInd);
   }
-
-  // need to make sure hostLimit is respected.
-
-  return assocMat;
-}
-
-bool Simulator::pairedBDPSimAna() {
-  bool treePairGood = false;
-
-  currentSimTime = 0.0;
-  // set stopTime
-  double stopTime = this->getTimeToSim();
-  // make a SpeciesTree (this is the host tree)
-  spTree = std::shared_ptr<SpeciesTree>(new SpeciesTree(1, currentSimTime, speciationRate, extinctionRate));
-
-  // and a SymbiontTree (this is the symbiont tree)
-  symbiontTree = std::shared_ptr<SymbiontTree>( new SymbiontTree(1,
-                                                                 currentSimTime,
-                                                                 geneBirthRate,
-                                                                 geneDeathRate,
-                                                                 transferRate,
-                                                                 hostLimit));
-
-  double eventTime = NAN;
-  double anageneticEventTime = NAN;
-  // initialize the four vectors that are output in R as the event dataframe lsa
-  this->initializeEventVector();
-  // set the association matrix to start with the host and symbiont being associated
-  // a 1x1 matrix of 1
-  assocMat = arma::ones<arma::umat>(1,1);
-  while(currentSimTime < stopTime){
-    // get time to the the next joint event based on the speciation rate, extinction rate,
-    // and cospeciation rate
-    eventTime = symbiontTree->getTimeToNextJointEvent(speciationRate,
-                                                      extinctionRate,
-                                                      cospeciationRate,
-                                                      assocMat);
-
-
-    double anaTimeTrack = currentSimTime;
-
-
-    currentSimTime += eventTime;
-
-
-    // if we exceed the sim time set to stopTime so as not to go over
-    if(currentSimTime >= stopTime){
-      currentSimTime = stopTime;
-    }
-    else{
-
-      while(anaTimeTrack < currentSimTime) {
-        anageneticEventTime = this->getTimeToAnaEvent(dispersalRate,
-                                                      extirpationRate,
-                                                      assocMat);
-        anaTimeTrack += anageneticEventTime;
-
-        if(spTree->getNumExtant() < 1 ||
-           symbiontTree->getNumExtant() < 1 ||
-           assocMat.n_rows < 1 ||
-           assocMat.n_cols < 1){
-          treePairGood = false;
-          this->clearEventDFVecs();
-          return treePairGood;
-        }
-
-        if(anaTimeTrack > currentSimTime)
-          break;
-        else
-          assocMat = this->anageneticEvent(dispersalRate,
-                                           extirpationRate,
-                                           anaTimeTrack,
-                                           assocMat);
-
-      }
-      // otherwise a cophylogenetic event occurs, this can be three things:
-      // host event (host speciation or extinction)
-      // symbiont event (symbiont speciation or extinction)
-      // or a joint event (a.k.a. a cospeciation)
-      // this returns the association matrix
-      assocMat = this->cophyloEvent(currentSimTime, assocMat);
-
-      if(hostLimit > 0)
-        assocMat = this->hostLimitCheck(assocMat, hostLimit);
-    }
-    // if either tree goes to 0 or the association matrix becomes malformed
-    // prematurely end the simulation, clearing the event dataframe vectors
-    if(spTree->getNumExtant() < 1 ||
-       symbiontTree->getNumExtant() < 1 ||
-       assocMat.n_rows < 1 ||
-       assocMat.n_cols < 1){
-      treePairGood = false;
-      this->clearEventDFVecs();
-      return treePairGood;
-    }
-  }
-  // TODO: not sure if this is needed
-  if(spTree->getNumExtant() <= 1 || symbiontTree->getNumExtant() <= 1){
-    treePairGood = false;
-    this->clearEventDFVecs();
-    return treePairGood;
-  }
-  treePairGood = true;
-  currentSimTime = stopTime;
-  // set the present time in both host and symbiont tree
-  symbiontTree->setPresentTime(currentSimTime);
-  spTree->setPresentTime(currentSimTime);
-
-  return treePairGood;
 }
 
 // wrapper for the paired birth-death process
 bool Simulator::simHostSymbSpeciesTreePair(){
+  PhaseTimer timer(stats.get(), SimulationStats::Simulation);
+  resetReplicate();
   bool good = false;
   while(!good){
     good = pairedBDPSim();
+    if(stats)
+      stats->countAttempt(good);
 
   }
   return good;
@@ -586,51 +504,60 @@ bool Simulator::pairedBDPSim(){
   // set stopTime
   double stopTime = this->getTimeToSim();
   // make a SpeciesTree (this is the host tree)
-  spTree = std::shared_ptr<SpeciesTree>(new SpeciesTree(1, currentSimTime, speciationRate, extinctionRate));
+  renewSpeciesTree(spTree, 1);
 
   // and a SymbiontTree (this is the symbiont tree)
-  symbiontTree = std::shared_ptr<SymbiontTree>( new SymbiontTree(1,
-                                                                currentSimTime,
-                                                                geneBirthRate,
-                                                                geneDeathRate,
-                                                                transferRate,
-                                                                hostLimit));
+  renewSymbiontTree();
 
   double eventTime = NAN;
   // initialize the four vectors that are output in R as the event dataframe
   this->initializeEventVector();
   // set the association matrix to start with the host and symbiont being associated
   // a 1x1 matrix of 1
-  assocMat = arma::ones<arma::umat>(1,1);
+  assocMat.setHostLimit(hostLimit);
+  assocHistory.clear();
+  eventRateLog.clear();
+  symbNodeOfId.clear();
+  hostNodeOfId.clear();
+  assocMat.setHistory(keepHistory ? &assocHistory : nullptr);
+  assocMat.reset(1, 1);
+  if(keepHistory)
+    this->recordNewLineages();
+  this->initializeScheduler();
   while(currentSimTime < stopTime){
-    // get time to the the next joint event based on the speciation rate, extinction rate,
-    // and cospeciation rate
-    eventTime = symbiontTree->getTimeToNextJointEvent(speciationRate,
-                                                 extinctionRate,
-                                                 cospeciationRate,
-                                                 assocMat);
+    // one waiting time for all of the events of all extant lineages
+    eventTime = scheduler.getWaitingTime(drawUniform());
     currentSimTime += eventTime;
     // if we exceed the sim time set to stopTime so as not to go over
     if(currentSimTime >= stopTime){
       currentSimTime = stopTime;
     }
     else{
-      // otherwise a cophylogenetic event occurs, this can be three things:
+      // otherwise an event occurs on the channel drawn in proportion to its rate:
       // host event (host speciation or extinction)
-      // symbiont event (symbiont speciation or extinction)
-      // or a joint event (a.k.a. a cospeciation)
-      // this returns the association matrix
-      assocMat = this->cophyloEvent(currentSimTime, assocMat);
+      // symbiont event (symbiont speciation, extinction or host expansion)
+      // a joint event (a.k.a. a cospeciation)
+      // or a symbiont dispersal or extirpation
+      if(stats)
+        this->recordEventRates(currentSimTime);
+      this->cophyloEvent(scheduler.chooseChannel(drawUniform()), currentSimTime);
 
       if(hostLimit > 0)
-        assocMat = this->hostLimitCheck(assocMat, hostLimit);
+        this->hostLimitCheck(hostLimit);
+      if(keepHistory){
+        this->recordNewLineages();
+        this->recordAssociationCheckpoint();
+      }
+      scheduler.setNumHosts(assocMat.getNumHosts());
+      scheduler.setNumSymbionts(assocMat.getNumSymbionts());
+      checkCancellation();
     }
     // if either tree goes to 0 or the association matrix becomes malformed
     // prematurely end the simulation, clearing the event dataframe vectors
     if(spTree->getNumExtant() < 1 ||
        symbiontTree->getNumExtant() < 1 ||
-       assocMat.n_rows < 1 ||
-       assocMat.n_cols < 1){
+       assocMat.getNumSymbionts() < 1 ||
+       assocMat.getNumHosts() < 1){
       treePairGood = false;
       this->clearEventDFVecs();
       return treePairGood;
@@ -651,148 +578,115 @@ bool Simulator::pairedBDPSim(){
   return treePairGood;
 }
 
-// cophyloEvent - chooses which event occurs based on the rates of the 6 different events
-// note that this can likely be simplified mathematically
-arma::umat Simulator::cophyloEvent(double eventTime, arma::umat assocMat){
-  double hostEvent = speciationRate + extinctionRate;
-  double symbEvent = geneBirthRate + geneDeathRate + transferRate;
-  double cospecEvent = cospeciationRate;
-  // which tree then ermEvent whichever or cospeciation event
-  // probability of a host event
-  double hostEventProb = hostEvent / (hostEvent + symbEvent + cospecEvent);
-  // probability of symb event
-  double symbEventProb = symbEvent / (hostEvent + symbEvent + cospecEvent);
-  symbEventProb += hostEventProb;
-  double whichEvent = unif_rand();
-  // randomly chooose host, symb, or cospeciation event
-  if(whichEvent < hostEventProb){
-    assocMat = this->cophyloERMEvent(eventTime, assocMat);
-  }
-  else if(whichEvent < symbEventProb){
-    assocMat = this->symbiontTreeEvent(eventTime, assocMat);
-  }
-  else{
-
-    assocMat = this->cospeciationEvent(eventTime, assocMat);
-  }
-  return assocMat;
-}
-
-// Function that creates the dataframe out of the vectors that record events
-Rcpp::DataFrame Simulator::createEventDF(){
-  this->updateEventIndices();
-  DataFrame df = DataFrame::create(Named("Symbiont_Index") = inOrderVecOfSymbIndx,
-                                   Named("Host_Index") = inOrderVecOfHostIndx,
-                                   Named("Event_Type") = inOrderVecOfEvent,
-                                   Named("Event_Time") = inOrderVecOfEventTimes);
-  return df;
+// per lineage rates of every kind of event for the scheduler, the counts
+// start at the one host and one symbiont of the root
+void Simulator::initializeScheduler(){
+  scheduler.setRate(EventScheduler::HostEvent, speciationRate + extinctionRate);
+  scheduler.setRate(EventScheduler::SymbiontEvent, geneBirthRate + geneDeathRate + transferRate);
+  scheduler.setRate(EventScheduler::Cospeciation, cospeciationRate);
+  scheduler.setRate(EventScheduler::Dispersal, dispersalRate);
+  scheduler.setRate(EventScheduler::Extirpation, extirpationRate);
+  scheduler.setNumHosts(assocMat.getNumHosts());
+  scheduler.setNumSymbionts(assocMat.getNumSymbionts());
 }
 
-// Function that clears the vectors that record events
-void Simulator::clearEventDFVecs(){
-  inOrderVecOfHostIndx.erase(inOrderVecOfHostIndx.begin(),
-                             inOrderVecOfHostIndx.end());
-  inOrderVecOfSymbIndx.erase(inOrderVecOfSymbIndx.begin(),
-                             inOrderVecOfSymbIndx.end());
-  inOrderVecOfEvent.erase(inOrderVecOfEvent.begin(),
-                          inOrderVecOfEvent.end());
-  inOrderVecOfEventTimes.erase(inOrderVecOfEventTimes.begin(),
-                               inOrderVecOfEventTimes.end());
+void Simulator::recordEventRates(double time){
+  eventRateLog.push_back(time);
+  for(int c = 0; c < EventScheduler::NumChannels; c++)
+    eventRateLog.push_back(scheduler.getChannelRate(static_cast<EventScheduler::Channel>(c)));
 }
 
-
-// update the indices of the event vector from the C++ indexing where the root is
-// index 0, to the APE package indexing where the root is numTips+1
-void Simulator::updateEventIndices(){
-
-  for(int i = 0; i < inOrderVecOfHostIndx.size(); i++){
-    int oldHostIndx = inOrderVecOfHostIndx(i);
-    int oldSymbIndx = inOrderVecOfSymbIndx(i);
-    int newHostIndx = spTree->getIndexFromNodes(oldHostIndx);
-
-    int newSymbIndx = symbiontTree->getIndexFromNodes(oldSymbIndx);
-    inOrderVecOfHostIndx(i) = newHostIndx;
-    inOrderVecOfSymbIndx(i) = newSymbIndx;
-  }
-}
-
-// add an element to each event vector for an event
-void Simulator::updateEventVector(int h, int s, int e, double time){
-  inOrderVecOfHostIndx.push_back(h);
-  inOrderVecOfSymbIndx.push_back(s);
-  switch(e) {
-    case 0:
-      // symbiont loss
-      inOrderVecOfEvent.push_back(std::move("SX"));
-      break;
-    case 1:
-      // host loss
-      inOrderVecOfEvent.push_back(std::move("HX"));
-      break;
-    case 2:
-      // symbiont gain
-      inOrderVecOfEvent.push_back(std::move("SSP"));
-      break;
-    case 3:
-      // host gain
-      inOrderVecOfEvent.push_back("HSP");
-      break;
-    case 4:
-      // association gain
-      inOrderVecOfEvent.push_back("AG");
+// cophyloEvent - carries out an event of the channel chosen by the scheduler
+void Simulator::cophyloEvent(EventScheduler::Channel channel, double eventTime){
+  if(keepHistory)
+    assocHistory.setTime(eventTime);
+  switch(channel) {
+    case EventScheduler::HostEvent:
+      this->cophyloERMEvent(eventTime);
       break;
-    case 5:
-      // association loss
-      inOrderVecOfEvent.push_back("AL");
+    case EventScheduler::SymbiontEvent:
+      this->symbiontTreeEvent(eventTime);
       break;
-    case 6:
-      // cospeciation
-      inOrderVecOfEvent.push_back("CSP");
+    case EventScheduler::Cospeciation:
+      this->cospeciationEvent(eventTime);
       break;
-    case 7:
-      // dispersal
-      inOrderVecOfEvent.push_back("DISP");
+    case EventScheduler::Dispersal:
+      this->anageneticEvent(true, eventTime);
       break;
-    case 8:
-      // extirpation
-      inOrderVecOfEvent.push_back("EXTP");
-      break;
-    case 9:
-      // host expansion or switching
-      inOrderVecOfEvent.push_back("SHE");
+    case EventScheduler::Extirpation:
+      this->anageneticEvent(false, eventTime);
       break;
     default:
-      Rcout << "not sure what happened there folks." << std::endl;
+      break;
   }
-  inOrderVecOfEventTimes.push_back(time);
 }
 
-arma::umat Simulator::hostLimitCheck(arma::umat assocMat, int hostLimit) {
-  arma::uvec hostCounts = arma::sum(assocMat, 1); // I.e. the sums of each row
-  arma::uvec tooManyHostsIndices = find(hostCounts > hostLimit); // index of rows with too many hosts
-  for(arma::uword i = 0; i < tooManyHostsIndices.n_rows; i++) {
-    arma::urowvec symbWithTooMany = assocMat.row(tooManyHostsIndices(i));
-    int howManyOver =  sum(symbWithTooMany) - hostLimit;
+// the lineages an event adds are appended to the extant lineages of both the
+// trees and the association matrix and none of them die in the same event
+void Simulator::recordNewLineages(){
+  int oldNumIds = symbNodeOfId.size();
+  symbNodeOfId.resize(assocMat.getNumSymbiontIds(), -1);
+  for(int s = assocMat.getNumSymbionts() - 1; s >= 0 && assocMat.getSymbiontId(s) >= oldNumIds; s--)
+    symbNodeOfId[assocMat.getSymbiontId(s)] = symbiontTree->getNodesIndxFromExtantIndx(s);
+  oldNumIds = hostNodeOfId.size();
+  hostNodeOfId.resize(assocMat.getNumHostIds(), -1);
+  for(int h = assocMat.getNumHosts() - 1; h >= 0 && assocMat.getHostId(h) >= oldNumIds; h--)
+    hostNodeOfId[assocMat.getHostId(h)] = spTree->getNodesIndxFromExtantIndx(h);
+}
+
+void Simulator::recordAssociationCheckpoint(){
+  unsigned stateSize = assocMat.getNumSymbionts()
+                       + assocMat.getNumHosts()
+                       + assocMat.getNumAssociations();
+  if(assocHistory.needsCheckpoint(stateSize))
+    assocMat.getIdState(assocHistory.addCheckpoint());
+}
+
+// association history with lineages labelled by their ape node numbers
+AssociationHistory Simulator::getAssociationHistory(){
+  std::vector<int> symbMap(symbNodeOfId.size()), hostMap(hostNodeOfId.size());
+  for(unsigned i = 0; i < symbMap.size(); i++)
+    symbMap[i] = symbiontTree->getIndexFromNodes(symbNodeOfId[i]);
+  for(unsigned i = 0; i < hostMap.size(); i++)
+    hostMap[i] = spTree->getIndexFromNodes(hostNodeOfId[i]);
+  AssociationHistory hist = assocHistory;
+  hist.relabel(symbMap, hostMap);
+  return hist;
+}
+
+// Function that clears the vectors that record events
+void Simulator::clearEventDFVecs(){
+  eventLog.clear();
+}
+
+// add a row to the event log
+void Simulator::updateEventVector(int h, int s, EventLog::Type e, double time){
+  eventLog.addEvent(h, s, e, time);
+  if(stats)
+    stats->countEvent(e);
+}
+
+void Simulator::hostLimitCheck(int hostLimit) {
+  // only the symbionts whose count went over the limit since the last check
+  for(auto s : assocMat.getSymbiontsOverLimit()) {
+    int howManyOver = (int) assocMat.getNumHostsOf(s) - hostLimit;
     while(howManyOver > 0) {
-      arma::uvec inhabiteSymbs = find(symbWithTooMany > 0);
-      int nodeInd = arma::randi<arma::uword>(arma::distr_param(0, inhabiteSymbs.size() - 1));
-      symbWithTooMany(inhabiteSymbs(nodeInd)) = 0;
-      assocMat.row(tooManyHostsIndices(i)) = symbWithTooMany;
-      howManyOver =  sum(symbWithTooMany) - hostLimit;
+      std::vector<unsigned> inhabitedHosts = assocMat.getHostsOf(s);
+      int nodeInd = drawIndex(inhabitedHosts.size());
+      assocMat.dissociate(s, inhabitedHosts[nodeInd]);
+      howManyOver--;
     }
   }
-  return assocMat;
 }
 
-// Event occurring on the symbiont tree at eventTiem with matrix assocMat
-arma::umat Simulator::symbiontTreeEvent(double eventTime, arma::umat assocMat){
+// Event occurring on the symbiont tree at eventTime
+void Simulator::symbiontTreeEvent(double eventTime){
   // get the number of tips on the symbiont tree
   unsigned int numExtantSymbs = symbiontTree->getNumExtant();
   // randomly choose one of these to have an event on
-  // arma::uword nodeInd = unif_rand()*(numExtantSymbs - 1);
-  arma::uword nodeInd = 0;
+  unsigned nodeInd = 0;
   if(numExtantSymbs > 1)
-    nodeInd = arma::randi<arma::uword>(arma::distr_param(0, numExtantSymbs - 1));
+    nodeInd = drawIndex(numExtantSymbs);
 
   // relative birth rate, uses geneBirthRate, geneDeathRate and transferRate
   // for the only purpose so that I did not need to add more members to the class
@@ -806,592 +700,193 @@ arma::umat Simulator::symbiontTreeEvent(double eventTime, arma::umat assocMat){
   double relDr = relBr + (geneDeathRate / (geneBirthRate
                                             + geneDeathRate
                                             + transferRate));
-  double decid = unif_rand();
+  double decid = drawUniform();
   // make sure our times are correctly set
   spTree->setCurrentTime(eventTime);
   symbiontTree->setCurrentTime(eventTime);
 
   unsigned int numExtantHosts = spTree->getNumExtant();
 
-  arma::urowvec rvec = assocMat.row(nodeInd);
-
-  // delete the appropriate row of the association matrix
-  assocMat.shed_row(nodeInd);
   // randomly decide between birth, death, and transfer
   if(decid < relBr){
     // update the event vectors
-    updateEventVector(spTree->getNodesIndxFromExtantIndx(assocMat.n_cols - 1),
+    updateEventVector(spTree->getNodesIndxFromExtantIndx(numExtantHosts - 1),
                       symbiontTree->getNodesIndxFromExtantIndx(nodeInd),
-                      2,
+                      EventLog::SymbiontSpeciation,
                       eventTime);
-    // birth event on the symbiont tree
+    // birth event on the symbiont tree, both new symbionts keep the hosts
     symbiontTree->lineageBirthEvent(nodeInd);
-    numExtantSymbs = symbiontTree->getNumExtant();
-
-
-    assocMat.resize(numExtantSymbs, numExtantHosts);
-    // add two new rows to the association matrix that are identical to the deleted row
-    assocMat(numExtantSymbs-2, arma::span::all) = rvec;
-    assocMat(numExtantSymbs-1, arma::span::all) = rvec;
-
-    // sort symbs on new hosts
-    // for(arma::uword i = 0; i < rvec.n_cols; i++){
-    //   if(rvec(i) == 1){
-    //     // update the event vectors for the sorting events
-    //     updateEventVector(spTree->getNodesIndxFromExtantIndx((int) i),
-    //                       symbiontTree->getNodesIndxFromExtantIndx(numExtantSymbs - 2),
-    //                       4,
-    //                       eventTime);
-
-    //     updateEventVector(spTree->getNodesIndxFromExtantIndx((int) i),
-    //                       symbiontTree->getNodesIndxFromExtantIndx(numExtantSymbs - 1),
-    //                       4,
-    //                       eventTime);
-    //   }
-    // }
+    assocMat.splitSymbiont(nodeInd);
   }
   else if(decid < relDr){
     // update the event vectors for the main event
-    updateEventVector(spTree->getNodesIndxFromExtantIndx(assocMat.n_cols - 1),
+    updateEventVector(spTree->getNodesIndxFromExtantIndx(numExtantHosts - 1),
                       symbiontTree->getNodesIndxFromExtantIndx(nodeInd),
-                      0,
+                      EventLog::SymbiontLoss,
                       eventTime);
-    numExtantSymbs = symbiontTree->getNumExtant();
-/*     for(arma::uword i = 0; i< rvec.n_cols; i++){
-      if(rvec(i) == 1){
-        // update the event vectors for the sorting events
-        updateEventVector(spTree->getNodesIndxFromExtantIndx((int) i),
-                              symbiontTree->getNodesIndxFromExtantIndx(nodeInd),
-                              4,
-                              eventTime);
-      }
-    } */
-
     // death event
     symbiontTree->lineageDeathEvent(nodeInd);
+    assocMat.removeSymbiont(nodeInd);
   }
   else{
     // expansion event (a.k.a. birth event with the addition of one host in a descendent symbiont lineage)
-
-    // check if the sum of the row equals the number of columns
-    // in other words is the symbiont at rvec occupying all the hosts already?
-    // if no: here, if yes go to else
-    if(hostLimit == 0) {
-      if(sum(rvec) != numExtantHosts){
-        //std::vector<arma::uword> hostIndices;
-        arma::urowvec hostIndices(rvec.n_cols, arma::fill::zeros);
-
-        // make a list of unoccupied hosts
-        for(arma::uword i = 0; i < rvec.n_cols; i++){
-          if(rvec(i) < 1)
-            hostIndices(i) = 1;
-        }
-        // randomly choose from one of those unoccupied hosts
-        arma::uvec unoccupiedHosts = arma::find(hostIndices > 0);
-        //  arma::uvec hostsWithSymbs = arma::find(hostIndices > 0);
-        arma::uword hostEndpoint = unoccupiedHosts.n_elem - 1;
-        arma::uword hostInd = 0;
-        if(unoccupiedHosts.n_elem > 1)
-          hostInd = arma::randi<arma::uword>(arma::distr_param(0, hostEndpoint)); //col of assocMat
-
-        // birth event
-        symbiontTree->lineageBirthEvent(nodeInd);
-        numExtantSymbs = symbiontTree->getNumExtant();
-        // add two rows
-        assocMat.resize(numExtantSymbs, numExtantHosts);
-        if(host_switch_mode) {
-          // host switch mode on so one symbiont desc gets range
-          assocMat(numExtantSymbs - 2, arma::span::all) = rvec;
-          // and the other gets the random event
-          arma::urowvec nRowVec(rvec.n_cols, arma::fill::zeros);
-          nRowVec(hostIndices(hostInd)) = 1;
-          assocMat(numExtantSymbs-1, arma::span::all) = nRowVec;
-
-        }
-        else {
-          // make one of these rows the same as the deleted row
-          assocMat(numExtantSymbs-2, arma::span::all) = rvec;
-          // change that row to have an extra one where the randomly picked unoccupied host was
-
-          rvec(hostIndices(hostInd)) = 1;
-          // make that a new row
-          assocMat(numExtantSymbs-1, arma::span::all) = rvec;
-        }
-        // sort symbs on new hosts
-/*         for(arma::uword i = 0; i < rvec.n_cols; i++){
-          if(rvec(i) == 1){
-            updateEventVector(spTree->getNodesIndxFromExtantIndx((int) i),
-                              symbiontTree->getNodesIndxFromExtantIndx(numExtantSymbs-2),
-                              4,
-                              eventTime);
-              updateEventVector(spTree->getNodesIndxFromExtantIndx((int) i),
-                                symbiontTree->getNodesIndxFromExtantIndx(numExtantSymbs-1),
-                                4,
-                                eventTime);
-          }
-        } */
-        updateEventVector(hostIndices(hostInd),
-                  symbiontTree->getNodesIndxFromExtantIndx(nodeInd),
-                  9,
-                  eventTime);
-      }
-      else{ // if all hosts are occupied (i.e the row is all 1's) this is just a regular birth event
-        symbiontTree->lineageBirthEvent(nodeInd);
-        numExtantSymbs = symbiontTree->getNumExtant();
-        updateEventVector(spTree->getNodesIndxFromExtantIndx(assocMat.n_cols - 1),
-                          symbiontTree->getNodesIndxFromExtantIndx(nodeInd),
-                          2,
-                          eventTime);
-
-        assocMat.resize(numExtantSymbs, numExtantHosts);
-
-        assocMat(numExtantSymbs-2, arma::span::all) = rvec;
-        assocMat(numExtantSymbs-1, arma::span::all) = rvec;
-
-        // sort symbs on new hosts
-/*         for(arma::uword i = 0; i < rvec.n_cols; i++){
-          if(rvec(i) == 1){
-            // shuffle might be better here?
-            updateEventVector(spTree->getNodesIndxFromExtantIndx(i),
-                              symbiontTree->getNodesIndxFromExtantIndx(numExtantSymbs-2),
-                              4,
-                              eventTime);
-
-            updateEventVector(spTree->getNodesIndxFromExtantIndx(i),
-                              symbiontTree->getNodesIndxFromExtantIndx(numExtantSymbs-1),
-                              4,
-                              eventTime);
-          }
-        } */
+    // in host switch mode the second descendant gets only the new host instead
+    // if there is no unoccupied host to go to (or the host limit is reached
+    // without host switching) this is just a regular birth event
+    unsigned numUnoccupied = assocMat.getNumHosts() - assocMat.getNumHostsOf(nodeInd);
+    bool belowHostLimit = (hostLimit == 0 || (int) assocMat.getNumHostsOf(nodeInd) < hostLimit);
+    if(numUnoccupied > 0 && (belowHostLimit || host_switch_mode)){
+      // randomly choose from one of those unoccupied hosts
+      unsigned hostInd = 0;
+      if(numUnoccupied > 1)
+        hostInd = drawIndex(numUnoccupied);
+      unsigned newHost = assocMat.getUnoccupiedHostOf(nodeInd, hostInd);
+      updateEventVector(spTree->getNodesIndxFromExtantIndx(newHost),
+                        symbiontTree->getNodesIndxFromExtantIndx(nodeInd),
+                        EventLog::HostExpansion,
+                        eventTime);
+      symbiontTree->lineageBirthEvent(nodeInd);
+      assocMat.splitSymbiont(nodeInd);
+      numExtantSymbs = symbiontTree->getNumExtant();
+      if(host_switch_mode) {
+        for(auto h : assocMat.getHostsOf(numExtantSymbs - 1))
+          assocMat.dissociate(numExtantSymbs - 1, h);
       }
+      assocMat.associate(numExtantSymbs - 1, newHost);
     }
     else{
-      if(sum(rvec) < hostLimit){
-        //std::vector<arma::uword> hostIndices;
-        arma::urowvec hostIndices(rvec.n_cols, arma::fill::zeros);
-
-        // make a list of unoccupied hosts
-        for(arma::uword i = 0; i < rvec.n_cols; i++){
-          if(rvec(i) < 1)
-            hostIndices(i) = 1;
-        }
-        // randomly choose from one of those unoccupied hosts
-        arma::uvec unoccupiedHosts = arma::find(hostIndices > 0);
-        //  arma::uvec hostsWithSymbs = arma::find(hostIndices > 0);
-        arma::uword hostEndpoint = unoccupiedHosts.n_elem - 1;
-        arma::uword hostInd = 0;
-        if(unoccupiedHosts.n_elem > 1)
-          hostInd = arma::randi<arma::uword>(arma::distr_param(0, hostEndpoint)); //col of assocMat
-
-        // birth event
-        symbiontTree->lineageBirthEvent(nodeInd);
-        numExtantSymbs = symbiontTree->getNumExtant();
-        // add two rows
-        assocMat.resize(numExtantSymbs, numExtantHosts);
-        if(host_switch_mode) {
-          // host switch mode on so one symbiont desc gets range
-          assocMat(numExtantSymbs - 2, arma::span::all) = rvec;
-          // and the other gets the random event
-          arma::urowvec nRowVec(rvec.n_cols, arma::fill::zeros);
-          nRowVec(hostIndices(hostInd)) = 1;
-          assocMat(numExtantSymbs-1, arma::span::all) = nRowVec;
-
-        }
-        else {
-          // make one of these rows the same as the deleted row
-          assocMat(numExtantSymbs-2, arma::span::all) = rvec;
-          // change that row to have an extra one where the randomly picked unoccupied host was
-
-          rvec(hostIndices(hostInd)) = 1;
-          // make that a new row
-          assocMat(numExtantSymbs-1, arma::span::all) = rvec;
-        }
-        // sort symbs on new hosts
-/*         for(arma::uword i = 0; i < rvec.n_cols; i++){
-          if(rvec(i) == 1){
-            updateEventVector(spTree->getNodesIndxFromExtantIndx((int) i),
-                              symbiontTree->getNodesIndxFromExtantIndx(numExtantSymbs-2),
-                              4,
-                              eventTime);
-            updateEventVector(spTree->getNodesIndxFromExtantIndx((int) i),
-                              symbiontTree->getNodesIndxFromExtantIndx(numExtantSymbs-1),
-                              4,
-                              eventTime);
-          }
-        } */
-        updateEventVector(hostIndices(hostInd),
-                  symbiontTree->getNodesIndxFromExtantIndx(nodeInd),
-                  9,
-                  eventTime);
-      }
-      else{ // if all hosts are occupied this is just a regular birth event
-        symbiontTree->lineageBirthEvent(nodeInd);
-        numExtantSymbs = symbiontTree->getNumExtant();
-
-
-        assocMat.resize(numExtantSymbs, numExtantHosts);
-        if(host_switch_mode) {
-          arma::urowvec hostIndices(rvec.n_cols, arma::fill::zeros);
-
-          // make a list of unoccupied hosts
-          for(arma::uword i = 0; i < rvec.n_cols; i++){
-            if(rvec(i) < 1)
-              hostIndices(i) = 1;
-          }
-          // randomly choose from one of those unoccupied hosts
-          arma::uvec unoccupiedHosts = arma::find(hostIndices > 0);
-          //  arma::uvec hostsWithSymbs = arma::find(hostIndices > 0);
-          arma::uword hostEndpoint = unoccupiedHosts.n_elem - 1;
-          arma::uword hostInd = 0;
-          if(unoccupiedHosts.n_elem > 1)
-            hostInd = arma::randi<arma::uword>(arma::distr_param(0, hostEndpoint)); //col of assocMat
-
-          // host switch mode on so one symbiont desc gets range
-          assocMat(numExtantSymbs - 2, arma::span::all) = rvec;
-          // and the other gets the random event
-          arma::urowvec nRowVec(rvec.n_cols, arma::fill::zeros);
-          nRowVec(hostIndices(hostInd)) = 1;
-          assocMat(numExtantSymbs-1, arma::span::all) = nRowVec;
-          updateEventVector(hostIndices(hostInd),
-                            symbiontTree->getNodesIndxFromExtantIndx(nodeInd),
-                            9,
-                            eventTime);
-        }
-        else {
-          // if host switching off here we just get a speciation basically (since its just replacemtn)
-          assocMat(numExtantSymbs-2, arma::span::all) = rvec;
-          // change that row to have an extra one where the randomly picked unoccupied host was
-
-          // make that a new row
-          assocMat(numExtantSymbs-1, arma::span::all) = rvec;
-          updateEventVector(spTree->getNodesIndxFromExtantIndx(assocMat.n_cols - 1),
-                            symbiontTree->getNodesIndxFromExtantIndx(nodeInd),
-                            2,
-                            eventTime);
-        }
-
-        // sort symbs on new hosts
-/*         for(arma::uword i = 0; i < rvec.n_cols; i++){
-          if(rvec(i) == 1){
-            // shuffle might be better here?
-            updateEventVector(spTree->getNodesIndxFromExtantIndx(i),
-                              symbiontTree->getNodesIndxFromExtantIndx(numExtantSymbs-2),
-                              4,
-                              eventTime);
-
-            updateEventVector(spTree->getNodesIndxFromExtantIndx(i),
-                              symbiontTree->getNodesIndxFromExtantIndx(numExtantSymbs-1),
-                              4,
-                              eventTime);
-          }
-        } */
-
-      }
-
+      updateEventVector(spTree->getNodesIndxFromExtantIndx(numExtantHosts - 1),
+                        symbiontTree->getNodesIndxFromExtantIndx(nodeInd),
+                        EventLog::SymbiontSpeciation,
+                        eventTime);
+      symbiontTree->lineageBirthEvent(nodeInd);
+      assocMat.splitSymbiont(nodeInd);
     }
   }
-  return assocMat;
 }
 
 
 // cophylogenetic erm event is actually the function for the host event
 // apologies for the misleading name
-arma::umat Simulator::cophyloERMEvent(double eventTime, arma::umat assocMat){
+void Simulator::cophyloERMEvent(double eventTime){
   unsigned numExtantHosts = spTree->getNumExtant();
   // randomly pick a host
-  arma::uword nodeInd = 0;
+  unsigned nodeInd = 0;
   if(numExtantHosts > 1)
-    nodeInd = arma::randi<arma::uword>(arma::distr_param(0, numExtantHosts - 1));
+    nodeInd = drawIndex(numExtantHosts);
   // choose event based on the relative birth rate
   double relBr = speciationRate / (speciationRate + extinctionRate);
-  bool isBirth = (unif_rand() < relBr ? true : false);
+  bool isBirth = (drawUniform() < relBr ? true : false);
   // set the times to keep up
   spTree->setCurrentTime(eventTime);
   symbiontTree->setCurrentTime(eventTime);
   unsigned numExtantSymbs = symbiontTree->getNumExtant();
-  // delete a column
-  arma::ucolvec cvec = assocMat.col(nodeInd);
-
-  assocMat.shed_col(nodeInd);
+  std::vector<unsigned> symbsOnHost = assocMat.getSymbiontsOn(nodeInd);
 
   if(isBirth){
     // add the birth event to event vectors
     updateEventVector(spTree->getNodesIndxFromExtantIndx(nodeInd),
                       symbiontTree->getNodesIndxFromExtantIndx(numExtantSymbs - 1),
-                      3,
+                      EventLog::HostSpeciation,
                       eventTime);
     // birth event occur
     spTree->lineageBirthEvent(nodeInd);
+    assocMat.splitHost(nodeInd);
     // recalculate num extant hosts
     numExtantHosts = spTree->getNumExtant();
-    // add two rows
-    assocMat.resize(numExtantSymbs, numExtantHosts);
-    // make two new rows of data frame to be clear about which host speciated into what
-/*     updateEventVector(spTree->getNodesIndxFromExtantIndx(numExtantHosts - 2),
-                      symbiontTree->getNodesIndxFromExtantIndx(numExtantSymbs - 1),
-                      4,
-                      eventTime);
-    updateEventVector(spTree->getNodesIndxFromExtantIndx(numExtantHosts - 1),
-                      symbiontTree->getNodesIndxFromExtantIndx(numExtantSymbs - 1),
-                      4,
-                      eventTime); */
-
-   // sort symbs on new hosts
-   for(arma::uword i = 0; i < cvec.n_rows; ++i) {
-      if(cvec(i) == 1){
-        arma::umat rr = arma::randi<arma::umat>(1,2, arma::distr_param(0,1));
-         if(rr(0,0) == 0 && rr(0,1) == 1){
-/*           updateEventVector(spTree->getNodesIndxFromExtantIndx(numExtantHosts-2),
-                            symbiontTree->getNodesIndxFromExtantIndx(i),
-                            5,
-                            eventTime);
-
-          updateEventVector(spTree->getNodesIndxFromExtantIndx(numExtantHosts-1),
-                            symbiontTree->getNodesIndxFromExtantIndx(i),
-                            4,
-                            eventTime); */
-
-        }
-        else if(rr(0,0) == 1 && rr(0,1) == 0){
-
-/*           updateEventVector(spTree->getNodesIndxFromExtantIndx(numExtantHosts-2),
-                            symbiontTree->getNodesIndxFromExtantIndx(i),
-                            4,
-                            eventTime);
-
-            updateEventVector(spTree->getNodesIndxFromExtantIndx(numExtantHosts-1),
-                            symbiontTree->getNodesIndxFromExtantIndx(i),
-                            5,
-                            eventTime); */
-
-        }
-        else if(rr(0,0) == 1 && rr(0,1) == 1){
-/*           updateEventVector(spTree->getNodesIndxFromExtantIndx(numExtantHosts-2),
-                            symbiontTree->getNodesIndxFromExtantIndx(i),
-                            4,
-                            eventTime);
-
-          updateEventVector(spTree->getNodesIndxFromExtantIndx(numExtantHosts-1),
-                            symbiontTree->getNodesIndxFromExtantIndx(i),
-                            4,
-                            eventTime); */
-        }
-        else{
-          rr.replace(0,1);
-/*           updateEventVector(spTree->getNodesIndxFromExtantIndx(numExtantHosts-2),
-                            symbiontTree->getNodesIndxFromExtantIndx(i),
-                            4,
-                            eventTime);
-
-          updateEventVector(spTree->getNodesIndxFromExtantIndx(numExtantHosts-1),
-                            symbiontTree->getNodesIndxFromExtantIndx(i),
-                            4,
-                            eventTime); */
-
-        }
-
-        assocMat(i, arma::span(numExtantHosts-2, numExtantHosts-1)) = rr;
-
-      }
-      else{
-        arma::umat rr(1,2,arma::fill::zeros);// = arma::zeros<arma::umat>(1,2);
-
-        assocMat(i, arma::span(numExtantHosts-2, numExtantHosts-1)) = rr;
-/*         updateEventVector(spTree->getNodesIndxFromExtantIndx(numExtantHosts-1),
-                          symbiontTree->getNodesIndxFromExtantIndx(i),
-                          5,
-                          eventTime); */
-
-      }
+    // sort symbs on new hosts, each keeps at least one of the two
+    for(auto s : symbsOnHost) {
+      unsigned onLeft = drawIndex(2);
+      unsigned onRight = drawIndex(2);
+      if(onLeft == 0 && onRight == 0)
+        onLeft = onRight = 1;
+      if(onLeft == 1)
+        assocMat.associate(s, numExtantHosts - 2);
+      if(onRight == 1)
+        assocMat.associate(s, numExtantHosts - 1);
     }
   }
   else{ // otherwise death occurs
     // update event vectors
     updateEventVector(spTree->getNodesIndxFromExtantIndx(nodeInd),
                       symbiontTree->getNodesIndxFromExtantIndx(numExtantSymbs - 1),
-                      1,
+                      EventLog::HostLoss,
                       eventTime);
-    numExtantSymbs = symbiontTree->getNumExtant();
-    // check rows for 0's, rows with 0s get deleted in symbiont tree
-    arma::uword numRows = assocMat.n_rows;
-    arma::uvec hostless(numExtantSymbs, arma::fill::zeros);// = arma::zeros<arma::uvec>(numExtantSymbs);
-    for(arma::uword i = numRows; i != 0; i--){
-      if(!(any(assocMat.row(i-1)))){
+    assocMat.removeHost(nodeInd);
+    // symbionts that were only on this host go extinct with it, last first
+    // so the extant indices of the others do not change
+    for(auto s = symbsOnHost.rbegin(); s != symbsOnHost.rend(); ++s){
+      if(assocMat.getNumHostsOf(*s) == 0){
         updateEventVector(spTree->getNodesIndxFromExtantIndx(nodeInd),
-                          symbiontTree->getNodesIndxFromExtantIndx(i-1),
-                          0,
+                          symbiontTree->getNodesIndxFromExtantIndx(*s),
+                          EventLog::SymbiontLoss,
                           eventTime);
-        symbiontTree->lineageDeathEvent(i-1);
-
-        hostless(i-1) = 1;
+        symbiontTree->lineageDeathEvent(*s);
+        assocMat.removeSymbiont(*s);
       }
     }
     // host tree death event
     spTree->lineageDeathEvent(nodeInd);
-    // delete the rows from the association matrix
-    arma::uvec toBeDeleted = arma::find(hostless);
-    assocMat.shed_rows(toBeDeleted);
   }
-  return assocMat;
 }
 
 // Cospeciation event occur
-arma::umat Simulator::cospeciationEvent(double eventTime, arma::umat assocMat){
+void Simulator::cospeciationEvent(double eventTime){
   // draw index of host
   spTree->setCurrentTime(eventTime);
   symbiontTree->setCurrentTime(eventTime);
-  unsigned numExtantHosts = spTree->getNumExtant();
-  arma::urowvec hostIndices(assocMat.n_cols, arma::fill::zeros);
   // pick a host with symbionts at random
-  for(arma::uword i = 0; i < assocMat.n_cols; i++){
-    if(sum(assocMat.col(i)) > 0)
-      hostIndices(i) = 1;
-  }
-
-  arma::uvec hostsWithSymbs = arma::find(hostIndices > 0);
-  arma::uword hostEndpoint = hostsWithSymbs.n_elem - 1;
-  arma::uword indxOfHost = 0;
-  if(hostsWithSymbs.n_elem > 1)
-    indxOfHost = arma::randi<arma::uword>(arma::distr_param(0, hostEndpoint)); //col of assocMat
-
-
-  arma::ucolvec cvec = assocMat.col(hostsWithSymbs(indxOfHost));
-
-  arma::uvec symbIndices = arma::find(cvec);
-  arma::uword symbEndpoint = symbIndices.n_elem - 1;
-
-  arma::uword indxOfSymb = 0;
-  if(symbIndices.n_elem > 1)
-    indxOfSymb = arma::randi<arma::uword>(arma::distr_param(0, symbEndpoint));
-  arma::urowvec rvec = assocMat.row(symbIndices(indxOfSymb));
+  unsigned numOccupied = assocMat.getNumOccupiedHosts();
+  unsigned indxOfHost = 0;
+  if(numOccupied > 1)
+    indxOfHost = drawIndex(numOccupied);
+  unsigned hostIndx = assocMat.getOccupiedHost(indxOfHost);
+  // and one of its symbionts
+  std::vector<unsigned> symbIndices = assocMat.getSymbiontsOn(hostIndx);
+  unsigned indxOfSymb = 0;
+  if(symbIndices.size() > 1)
+    indxOfSymb = drawIndex(symbIndices.size());
+  unsigned symbIndx = symbIndices[indxOfSymb];
+  // the other symbionts of the host and the other hosts of the symbiont,
+  // indexed as they will be once the ancestors are removed
+  std::vector<unsigned> otherSymbs, otherHosts;
+  for(auto s : symbIndices)
+    if(s != symbIndx)
+      otherSymbs.push_back(s > symbIndx ? s - 1 : s);
+  for(auto h : assocMat.getHostsOf(symbIndx))
+    if(h != hostIndx)
+      otherHosts.push_back(h > hostIndx ? h - 1 : h);
   // add a C to the event vectors
-  updateEventVector(spTree->getNodesIndxFromExtantIndx(hostsWithSymbs(indxOfHost)),
-                    symbiontTree->getNodesIndxFromExtantIndx(symbIndices(indxOfSymb)),
-                    6,
+  updateEventVector(spTree->getNodesIndxFromExtantIndx(hostIndx),
+                    symbiontTree->getNodesIndxFromExtantIndx(symbIndx),
+                    EventLog::Cospeciation,
                     eventTime);
   // birth in both trees at the same time
-  spTree->lineageBirthEvent(hostsWithSymbs(indxOfHost));
-  symbiontTree->lineageBirthEvent(symbIndices(indxOfSymb));
+  spTree->lineageBirthEvent(hostIndx);
+  symbiontTree->lineageBirthEvent(symbIndx);
 
-  numExtantHosts = spTree->getNumExtant();
+  unsigned numExtantHosts = spTree->getNumExtant();
   unsigned numExtantSymbs = symbiontTree->getNumExtant();
-  // delete a row and column of assocaition matrix
-
-  assocMat.shed_row(symbIndices(indxOfSymb));
-  if(!(assocMat.is_empty()))
-    assocMat.shed_col(hostsWithSymbs(indxOfHost));
-
-
-  cvec.shed_row(symbIndices(indxOfSymb));
-
-  rvec.shed_col(hostsWithSymbs(indxOfHost));
-  // add 2 new rows and 2 new cols
-  assocMat.resize(numExtantSymbs, numExtantHosts);
-  // throw the identity matrix into the bottom right corner representing
-  // that each new host is associated with one new symbiont
-
-  assocMat(arma::span(numExtantSymbs - 2, numExtantSymbs - 1),
-           arma::span(numExtantHosts - 2, numExtantHosts -1)) = arma::eye<arma::umat>(2,2);
-
-  // record in event vector
-/*   updateEventVector(spTree->getNodesIndxFromExtantIndx(numExtantHosts-2),
-                    symbiontTree->getNodesIndxFromExtantIndx(numExtantSymbs-2),
-                    4,
-                    eventTime);
-
-  updateEventVector(spTree->getNodesIndxFromExtantIndx(numExtantHosts-1),
-                    symbiontTree->getNodesIndxFromExtantIndx(numExtantSymbs-1),
-                    4,
-                    eventTime); */
-  // loop through cvec to sort the old hosts of the ancestor symbiont on new symbionts
-  for(arma::uword i = 0; i < cvec.n_rows; i++){
-    if(cvec(i) == 1){
-
-      arma::umat rr(1,2,arma::fill::ones);// = arma::ones<arma::umat>(1,2);
-      int randOne = unif_rand() * 2;
-      if(randOne == 0){
-        rr(0, 0) = 0;
-/*         updateEventVector(spTree->getNodesIndxFromExtantIndx(numExtantHosts-2),
-                          symbiontTree->getNodesIndxFromExtantIndx(i),
-                          5,
-                          eventTime);
-
-        updateEventVector(spTree->getNodesIndxFromExtantIndx(numExtantHosts-1),
-                          symbiontTree->getNodesIndxFromExtantIndx(i),
-                          4,
-                          eventTime); */
-      }
-      else{
-        rr(0, 1) = 0;
-/*         updateEventVector(spTree->getNodesIndxFromExtantIndx(numExtantHosts-2),
-                          symbiontTree->getNodesIndxFromExtantIndx(i),
-                          4,
-                          eventTime);
-
-        updateEventVector(spTree->getNodesIndxFromExtantIndx(numExtantHosts-1),
-                          symbiontTree->getNodesIndxFromExtantIndx(i),
-                          5,
-                          eventTime); */
-      }
-      assocMat(i, arma::span(numExtantHosts - 2, numExtantHosts - 1)) = rr;
-      // assocMat.submat(i, numExtantHosts-2, i, numExtantHosts-1) = rr;
-    }
-    else{
-      arma::umat rr(1,2,arma::fill::zeros);// = arma::zeros<arma::umat>(1,2);
-      assocMat(i, arma::span(numExtantHosts - 2, numExtantHosts - 1)) = rr;
-/*       updateEventVector(spTree->getNodesIndxFromExtantIndx(numExtantHosts-2),
-                        symbiontTree->getNodesIndxFromExtantIndx(i),
-                        5,
-                        eventTime);
-      updateEventVector(spTree->getNodesIndxFromExtantIndx(numExtantHosts-1),
-                        symbiontTree->getNodesIndxFromExtantIndx(i),
-                        5,
-                        eventTime); */
-    }
+  // replace the ancestors with two new rows and two new cols
+  assocMat.removeSymbiont(symbIndx);
+  assocMat.removeHost(hostIndx);
+  assocMat.addSymbiont();
+  assocMat.addSymbiont();
+  assocMat.addHost();
+  assocMat.addHost();
+  // each new host is associated with one new symbiont
+  assocMat.associate(numExtantSymbs - 2, numExtantHosts - 2);
+  assocMat.associate(numExtantSymbs - 1, numExtantHosts - 1);
+  // sort the old symbionts of the ancestor host on the new hosts
+  for(auto s : otherSymbs){
+    int randOne = drawIndex(2);
+    assocMat.associate(s, (randOne == 0) ? numExtantHosts - 1 : numExtantHosts - 2);
   }
-
-
-
-  // loop through rvec to sort the old symbs of the ancestor host on new hosts
-  for(arma::uword i = 0; i < rvec.n_elem; i++){
-    if(rvec(i) == 1){
-      arma::umat cr(2,1,arma::fill::ones); //= arma::ones<arma::umat>(1,2);
-
-      int randOne = unif_rand() * 2;
-      if(randOne == 0){
-        cr(0,0) = 0;
-/*         updateEventVector(spTree->getNodesIndxFromExtantIndx(i),
-                          symbiontTree->getNodesIndxFromExtantIndx(numExtantSymbs-2),
-                          5,
-                          eventTime);
-
-        updateEventVector(spTree->getNodesIndxFromExtantIndx(i),
-                          symbiontTree->getNodesIndxFromExtantIndx(numExtantSymbs-1),
-                          4,
-                          eventTime); */
-      }
-      else{
-        cr(1, 0) = 0;
-/*         updateEventVector(spTree->getNodesIndxFromExtantIndx(i),
-                          symbiontTree->getNodesIndxFromExtantIndx(numExtantSymbs-2),
-                          4,
-                          eventTime);
-
-        updateEventVector(spTree->getNodesIndxFromExtantIndx(i),
-                          symbiontTree->getNodesIndxFromExtantIndx(numExtantSymbs-1),
-                          5,
-                          eventTime); */
-      }
-
-      assocMat(arma::span(numExtantSymbs - 2, numExtantSymbs - 1), i) = cr;
-      // assocMat.submat(numExtantSymbs-2, i, numExtantSymbs-1,i) = rr;
-    }
-    else{
-      arma::umat cr(2,1,arma::fill::zeros);// = arma::zeros<arma::umat>(1,2);
-      assocMat(arma::span(numExtantSymbs - 2, numExtantSymbs - 1), i) = cr;
-    }
+  // sort the old hosts of the ancestor symbiont on the new symbionts
+  for(auto h : otherHosts){
+    int randOne = drawIndex(2);
+    assocMat.associate((randOne == 0) ? numExtantSymbs - 1 : numExtantSymbs - 2, h);
   }
-  return assocMat;
 }
 
 // locus tree simulation function, probably should be renamed
@@ -1403,11 +898,7 @@ bool Simulator::bdsaBDSim(){
     bool isSpeciation = 0;
     // start a new locus tree
 
-    lociTree = std::shared_ptr<LocusTree>( new LocusTree(numTaxaToSim,
-                                                        currentSimTime,
-                                                        geneBirthRate,
-                                                        geneDeathRate,
-                                                        transferRate));
+    renewLocusTree();
 
 
     // species tree is read in from r so convert index from R to C++ indexing
@@ -1498,8 +989,15 @@ bool Simulator::bdsaBDSim(){
       // if parameters are all 0 no locus tree events occur and we get
       // the species tree back (relabeld)
       if(lociTree->checkLocusTreeParams()){
+        int numTipsBefore = lociTree->getNumTips();
         lociTree->ermEvent(currentSimTime);
+        if(stats){
+          int change = lociTree->getNumTips() - numTipsBefore;
+          stats->countEvent(change > 0 ? SimulationStats::Duplication :
+                            (change < 0 ? SimulationStats::Loss : SimulationStats::Transfer));
+        }
       }
+      checkCancellation();
 
     }
 
@@ -1517,10 +1015,14 @@ bool Simulator::bdsaBDSim(){
 }
 // wrapper around locus tree sim to make sure we get a proper tree
 bool Simulator::simLocusTree(){
+  PhaseTimer timer(stats.get(), SimulationStats::Simulation);
+  resetReplicate();
   bool good = false;
 
   while(!good){
     good = bdsaBDSim();
+    if(stats)
+      stats->countAttempt(good);
   }
   return good;
 
@@ -1542,62 +1044,119 @@ std::set<double, std::greater<double> > Simulator::getEpochs(){
     return epochs;
 }
 
+// collect the epochs, extinct loci, stop times and ancestors of lociTree
+void Simulator::prepareCoalescentSim(){
+    PhaseTimer timer(stats.get(), SimulationStats::CoalescentSetup);
+    std::set<double, std::greater<double> > epochs = getEpochs();
+    locusEpochs.epochs.assign(epochs.begin(), epochs.end());
+  // get ContempLoci - the ones alive at the end of the locus tree sim (tips at present)
+    locusEpochs.contempLoci = lociTree->getExtantLoci(epochs);
+    int numLocusNodes = lociTree->getNodesSize();
+    int maxLindx = numLocusNodes - 1;
+    for(auto &lociInEpoch : locusEpochs.contempLoci)
+        for(auto locus : lociInEpoch)
+            maxLindx = std::max(maxLindx, locus);
+  // get the indices of extinct loci
+    std::set<int> extinctFolks = lociTree->getExtLociIndx();
+    locusEpochs.isExtinctLocus.assign(maxLindx + 1, 0);
+    for(auto locus : extinctFolks)
+        locusEpochs.isExtinctLocus[locus] = 1;
+    // stop times of loci, loci missing from the map stop at 0.0
+    std::map<int, double> stopTimes = lociTree->getBirthTimesFromNodes();
+    locusEpochs.stopTimes.assign(maxLindx + 1, 0.0);
+    for(auto &st : stopTimes)
+        locusEpochs.stopTimes[st.first] = st.second;
+    locusEpochs.rootLocus = lociTree->getRoot()->getLindx();
+    locusEpochs.rootStartTime = lociTree->getRoot()->getDeathTime();
+    locusEpochs.ancIndices.assign(maxLindx + 1, 0);
+    for(int i = 0; i < numLocusNodes; i++)
+        locusEpochs.ancIndices[i] = lociTree->postOrderTraversalStep(i);
+    // every sampled individual (extant and extinct) ends up as a tip so we
+    // know the size of the gene tree before simulating it
+    locusEpochs.numLociSampled = extinctFolks.size();
+    for(auto &lociInEpoch : locusEpochs.contempLoci){
+        if(!(lociInEpoch.empty())){
+            locusEpochs.numLociSampled += lociInEpoch.size();
+            break;
+        }
+    }
+}
+
 // multispecies coalescent simulator
 bool Simulator::coalescentSim(){
-    bool treeGood = false;
-    geneTree = std::shared_ptr<GeneTree>(new GeneTree(numTaxaToSim, indPerPop, popSize, generationTime));
-    std::map<int,int> spToLo;
+    prepareCoalescentSim();
+    PhaseTimer timer(stats.get(), SimulationStats::Coalescent);
+    geneTree = coalescentGeneTree(std::make_shared<Rng>(rng->nextSeed()));
+    if(stats && geneTree)
+        stats->countEvent(SimulationStats::Coalescence, geneTree->getNnodes());
+    return geneTree != nullptr;
+}
 
-    int ancIndx = -1;
-    int epochCount = 0;
+// index drawn in proportion to weights
+static unsigned drawWeightedIndex(Rng &rng, const std::vector<double> &weights){
+    double total = 0.0;
+    for(auto w : weights)
+        total += w;
+    if(!(total > 0.0))
+        throw std::runtime_error("the gene tree can not coalesce within its bound");
+    double u = rng.uniform() * total;
+    unsigned last = 0;
+    for(unsigned i = 0; i < weights.size(); i++){
+        if(weights[i] <= 0.0)
+            continue;
+        last = i;
+        if(u < weights[i])
+            return i;
+        u -= weights[i];
+    }
+    return last;
+}
 
+// simulates one gene tree in the locus tree described by locusEpochs
+// this only reads from the Simulator so it is safe to call from several threads
+std::shared_ptr<GeneTree> Simulator::coalescentGeneTree(std::shared_ptr<Rng> rng) const {
+    const LocusTreeEpochs &le = locusEpochs;
+    if(le.epochs.empty())
+        return nullptr;
+    std::shared_ptr<GeneTree> gt = std::shared_ptr<GeneTree>(new GeneTree(numTaxaToSim, indPerPop, popSize, generationTime, rng));
+
+    int ancIndx = -1;
+    double simTime = NAN;
     double stopTime = NAN;
     double stopTimeEpoch = NAN;
     double stopTimeLoci = NAN;
     bool allCoalesced = false, deathCheck = false;
-    bool is_ext = 0;
-  // get the coalescent breakpoints from lociTree
-    std::set<double, std::greater<double> > epochs = getEpochs();
     // how many epochs
-    int numEpochs = (int) epochs.size();
-  // get the indices of extinct loci
-    std::set<int> extinctFolks = lociTree->getExtLociIndx();
-    // this function is for adding in multilocus coalescent later
-    std::set<int> coalescentBounds = lociTree->getCoalBounds();
-  // get ContempLoci - the ones alive at the end of the locus tree sim (tips at present)
-    std::vector< std::vector<int> > contempLoci = lociTree->getExtantLoci(epochs);
-    // get the stop times of loci as a map with indices as keys
-    std::map<int, double> stopTimes = lociTree->getBirthTimesFromNodes();
+    int numEpochs = (int) le.epochs.size();
+    // loci whose lineages have all coalesced are skipped in later epochs and
+    // extinct loci only get their tips added once
+    std::vector<char> isCoalesced(le.isExtinctLocus.size(), 0);
+    std::vector<char> extinctAdded(le.isExtinctLocus.size(), 0);
+    gt->reserveNodes(le.numLociSampled * indPerPop);
     // intialize the tree with individuals sampled from contempLoci and starting with the first coalescent bound
-    geneTree->initializeTree(contempLoci, *(epochs.begin()));
-    std::set<int>::iterator extFolksIt;
+    gt->initializeTree(le.contempLoci, le.epochs[0]);
     //loop through the epochs in order
-    for(std::set<double, std::greater<double> >::iterator epIter = epochs.begin(); epIter != epochs.end(); ++epIter){
+    for(int epochCount = 0; epochCount < numEpochs; epochCount++){
         // set the time as the current epoch
-        currentSimTime = *epIter;
+        simTime = le.epochs[epochCount];
       // if we aren't in the last epoch
         if(epochCount != numEpochs - 1){
-          // iterate
-            epIter = std::next(epIter, 1);
-            stopTimeEpoch = *epIter;
+            stopTimeEpoch = le.epochs[epochCount + 1];
             // loop through the contempLoci that are around during this epoch
-            for(unsigned int j = 0; j < contempLoci[epochCount].size(); ++j){
-                // find the extinct folks in this epoch
-                extFolksIt = extinctFolks.find(contempLoci[epochCount][j]);
-                // check if there were any found extinct
-                is_ext = (extFolksIt != extinctFolks.end());
-                // if so
-                if(is_ext){
-                  // add tips for the extinct species
-                    geneTree->addExtinctSpecies(currentSimTime, contempLoci[epochCount][j]);
-                  // erase from the extinct folks to mark that it was added
-                    extinctFolks.erase(extFolksIt);
+            for(auto locus : le.contempLoci[epochCount]){
+                if(isCoalesced[locus])
+                    continue;
+                // add tips for the extinct species
+                if(le.isExtinctLocus[locus] && !(extinctAdded[locus])){
+                    gt->addExtinctSpecies(simTime, locus);
+                    extinctAdded[locus] = 1;
                 }
                 // get the stopTime
-                stopTimeLoci = stopTimes[contempLoci[epochCount][j]];
-                // if the current stop time is greater than the stop time of the epoch
-                // it will not go extinct during this epoch so deathCheck keeps track of that
-                if(stopTimeLoci > stopTimeEpoch){
+                stopTimeLoci = le.stopTimes[locus];
+                // if the locus begins during this epoch or at its end (loci begin
+                // at epoch boundaries) its lineages move to its ancestor at its
+                // beginning, deathCheck keeps track of that
+                if(stopTimeLoci >= stopTimeEpoch){
                     stopTime = stopTimeLoci;
                     deathCheck = true;
                 }
@@ -1605,48 +1164,150 @@ bool Simulator::coalescentSim(){
                     stopTime = stopTimeEpoch;
                     deathCheck = false;
                 }
-                // get the index of the ancestor of contempLoci[epochCount][j]
-                ancIndx = lociTree->postOrderTraversalStep(contempLoci[epochCount][j]);
-                // run the censored coalescent on memebers of geneTree with Lindx of contempLoci[epochCount][j]
-                allCoalesced = geneTree->censorCoalescentProcess(currentSimTime,
-                                                                 stopTime,
-                                                                 contempLoci[epochCount][j],
-                                                                 ancIndx,
-                                                                 deathCheck);
-
-
-                // if all coalesced remove that loci from the matrix of loci
-                if(allCoalesced){
-                    int check = contempLoci[epochCount][j];
-                    for(unsigned int k = epochCount + 1; k <  (unsigned) numEpochs; k++){
-                        for(unsigned m = 0; m < contempLoci[k].size(); ++m){
-                            if(contempLoci[k][m] == check){
-                                contempLoci[k].erase(contempLoci[k].begin() + m);
-                                break;
-                            }
-                        }
-                    }
-                }
-                // reset these
-                allCoalesced = false;
-                is_ext = false;
+                // get the index of the ancestor of the locus
+                ancIndx = le.ancIndices[locus];
+                // run the censored coalescent on memebers of geneTree with Lindx of locus
+                allCoalesced = gt->censorCoalescentProcess(simTime,
+                                                           stopTime,
+                                                           locus,
+                                                           ancIndx,
+                                                           deathCheck);
+                // if all coalesced that locus is done for the rest of the epochs
+                if(allCoalesced)
+                    isCoalesced[locus] = 1;
             }
-            // go back one in epIter
-            epIter = std::prev(epIter, 1);
         }
         else{
           // if we are in the last epoch do a coalescent until we have one lineage
             // finish coalescing
-            geneTree->rootCoalescentProcess(currentSimTime);
-            treeGood = true;
-            geneTree->setBranchLengths();
+            gt->rootCoalescentProcess(simTime);
+            gt->setBranchLengths();
         }
-        // post incremenet
-        epochCount++;
+    }
+
+    return gt;
+}
 
+// gene tree of a locus that began at a duplication, all of its lineages must
+// coalesce before the duplication (the birth of the root of lociTree). The
+// numbers of lineages at the ends of every locus are drawn from the root down
+// conditioned on one lineage at the duplication, and then the coalescences
+// along each locus conditioned on those numbers, so this is a draw from the
+// multispecies coalescent conditioned on the bound (Rasmussen and Kellis 2012)
+// rather than a rejection sampler. Needs prepareBoundedCoalescentSim.
+std::shared_ptr<GeneTree> Simulator::boundedCoalescentGeneTree(std::shared_ptr<Rng> rng) const {
+    const LocusTreeEpochs &le = locusEpochs;
+    if(le.epochs.empty() || le.postOrderLoci.empty())
+        return nullptr;
+    int numLoci = (int) le.bottomCounts.size();
+    std::vector<unsigned> bottom(numLoci, 0), top(numLoci, 0);
+    std::vector<double> weights;
+    top[le.rootLocus] = 1;
+    for(auto it = le.postOrderLoci.rbegin(); it != le.postOrderLoci.rend(); ++it){
+        int locus = *it;
+        const std::vector<double> &counts = le.bottomCounts[locus];
+        unsigned dim = counts.size();
+        weights.assign(dim, 0.0);
+        for(unsigned k = top[locus]; k < dim; k++)
+            weights[k] = counts[k] * le.countProbs[locus][k * dim + top[locus]];
+        bottom[locus] = drawWeightedIndex(*rng, weights);
+        if(le.ldesLoci[locus] < 0)
+            continue;
+        // split the lineages at the death of the locus between its daughters
+        const std::vector<double> &ltop = le.topCounts[le.ldesLoci[locus]];
+        const std::vector<double> &rtop = le.topCounts[le.rdesLoci[locus]];
+        weights.assign(bottom[locus], 0.0);
+        for(unsigned j = 1; j < bottom[locus]; j++)
+            if(j < ltop.size() && bottom[locus] - j < rtop.size())
+                weights[j] = ltop[j] * rtop[bottom[locus] - j];
+        top[le.ldesLoci[locus]] = drawWeightedIndex(*rng, weights);
+        top[le.rdesLoci[locus]] = bottom[locus] - top[le.ldesLoci[locus]];
     }
+    std::shared_ptr<GeneTree> gt = std::shared_ptr<GeneTree>(new GeneTree(numTaxaToSim, indPerPop, popSize, generationTime, rng));
+    gt->reserveNodes(le.numLociSampled * indPerPop);
+    gt->initializeTree(le.contempLoci, le.epochs[0]);
+    // extinct tips are added in the same order as in coalescentGeneTree so
+    // the tips are named the same way
+    std::vector<char> extinctAdded(le.isExtinctLocus.size(), 0);
+    for(int epochCount = 0; epochCount < (int) le.epochs.size() - 1; epochCount++){
+        for(auto locus : le.contempLoci[epochCount]){
+            if(le.isExtinctLocus[locus] && !(extinctAdded[locus])){
+                gt->addExtinctSpecies(le.epochs[epochCount], locus);
+                extinctAdded[locus] = 1;
+            }
+        }
+    }
+    for(auto locus : le.postOrderLoci)
+        gt->bridgeCoalescentProcess(le.deathTimes[locus],
+                                    le.birthTimes[locus],
+                                    top[locus],
+                                    locus,
+                                    le.ancIndices[locus]);
+    gt->rootCoalescentProcess(le.epochs.back());
+    gt->setBranchLengths();
+    return gt;
+}
 
-    return treeGood;
+// the numbers of lineages of the bounded coalescent: the distribution at the
+// death of each locus (its sampled individuals for a tip, otherwise the sum of
+// its daughters at their births) is carried to its birth with the coalescent
+// probabilities along its branch. The root locus is born at the last epoch.
+void Simulator::prepareBoundedCoalescentSim(){
+    prepareCoalescentSim();
+    PhaseTimer timer(stats.get(), SimulationStats::CoalescentSetup);
+    LocusTreeEpochs &le = locusEpochs;
+    int numLoci = (int) le.ancIndices.size();
+    le.postOrderLoci.clear();
+    le.ldesLoci.assign(numLoci, -1);
+    le.rdesLoci.assign(numLoci, -1);
+    le.deathTimes.assign(numLoci, 0.0);
+    le.birthTimes.assign(numLoci, 0.0);
+    le.bottomCounts.assign(numLoci, std::vector<double>());
+    le.topCounts.assign(numLoci, std::vector<double>());
+    le.countProbs.assign(numLoci, std::vector<double>());
+    // post order without recursion, daughters before their ancestor
+    std::vector<std::shared_ptr<Node>> stack(1, lociTree->getRoot());
+    std::vector<std::shared_ptr<Node>> order;
+    while(!(stack.empty())){
+        std::shared_ptr<Node> p = stack.back();
+        stack.pop_back();
+        order.push_back(p);
+        if(!(p->getIsTip())){
+            stack.push_back(p->getLdes());
+            stack.push_back(p->getRdes());
+        }
+    }
+    for(auto it = order.rbegin(); it != order.rend(); ++it){
+        std::shared_ptr<Node> p = *it;
+        int locus = p->getLindx();
+        le.postOrderLoci.push_back(locus);
+        le.deathTimes[locus] = p->getDeathTime();
+        le.birthTimes[locus] = p == lociTree->getRoot() ? le.epochs.back() : p->getBirthTime();
+        std::vector<double> &bottom = le.bottomCounts[locus];
+        if(p->getIsTip()){
+            bottom.assign(indPerPop + 1, 0.0);
+            bottom[indPerPop] = 1.0;
+        }
+        else{
+            int l = p->getLdes()->getLindx(), r = p->getRdes()->getLindx();
+            le.ldesLoci[locus] = l;
+            le.rdesLoci[locus] = r;
+            const std::vector<double> &ltop = le.topCounts[l], &rtop = le.topCounts[r];
+            bottom.assign(ltop.size() + rtop.size() - 1, 0.0);
+            for(unsigned i = 0; i < ltop.size(); i++)
+                for(unsigned j = 0; j < rtop.size(); j++)
+                    bottom[i + j] += ltop[i] * rtop[j];
+        }
+        unsigned dim = bottom.size();
+        le.countProbs[locus] = coalescentCountProbabilities(dim - 1,
+                                                            le.deathTimes[locus] - le.birthTimes[locus],
+                                                            popSize);
+        std::vector<double> &top = le.topCounts[locus];
+        top.assign(dim, 0.0);
+        for(unsigned k = 0; k < dim; k++)
+            for(unsigned j = 0; j <= k; j++)
+                top[j] += bottom[k] * le.countProbs[locus][k * dim + j];
+    }
 }
 
 // wrapper around simGeneTree takes the index of geneTrees as an argument and
@@ -1654,37 +1315,73 @@ bool Simulator::coalescentSim(){
 // this assumes that most are simulating >1 geneTrees
 bool Simulator::simGeneTree(int j){
   bool gGood = false;
-  RNGScope scope;
 
   while(!gGood){
     gGood = coalescentSim();
+    if(stats)
+      stats->countAttempt(gGood);
   }
   geneTrees[j] = geneTree;
   return gGood;
 }
 
-Rcpp::CharacterVector  Simulator::getExtantHostNames(std::vector<std::string> hostNames){
+// simulates all numGenes gene trees of lociTree, the locus tree is only
+// processed once and the gene trees are split over numThreads threads
+// each gene tree has its own seed drawn up front so results do not depend on numThreads
+bool Simulator::simGeneTrees(int numThreads){
+  prepareCoalescentSim();
+  PhaseTimer timer(stats.get(), SimulationStats::Coalescent);
+  std::vector<uint64_t> seeds(numGenes);
+  for(unsigned j = 0; j < numGenes; j++)
+    seeds[j] = rng->nextSeed();
+  geneTrees.resize(numGenes);
+  bool allGood = true;
+  // the nodes of the worker threads are counted separately and added up
+  unsigned long numNodes = 0;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(numThreads) reduction(&&:allGood) reduction(+:numNodes)
+#endif
+  for(int j = 0; j < (int) numGenes; j++){
+    // exceptions can not leave the threads so the rest are skipped instead
+    if(cancellation && cancellation->requested())
+      continue;
+    unsigned long *threadCounter = Node::allocationCounter;
+    Node::allocationCounter = stats ? &numNodes : nullptr;
+    geneTrees[j] = coalescentGeneTree(std::make_shared<Rng>(seeds[j]));
+    Node::allocationCounter = threadCounter;
+    allGood = allGood && (geneTrees[j] != nullptr);
+  }
+  if(cancellation)
+    cancellation->check();
+  if(stats){
+    *(stats->getNodeCounter()) += numNodes;
+    for(auto &gt : geneTrees)
+      if(gt)
+        stats->countEvent(SimulationStats::Coalescence, gt->getNnodes());
+  }
+  return allGood;
+}
+
+std::vector<std::string>  Simulator::getExtantHostNames(std::vector<std::string> hostNames){
   std::vector<std::string> extantHostNames;
   for(int i = 0; i < hostNames.size(); i++) {
     if (hostNames[i].find("X") == std::string::npos) {
         extantHostNames.push_back(hostNames[i]);
     }
   }
-  Rcpp::CharacterVector outVec = Rcpp::wrap(extantHostNames);
-  return outVec;
+  return extantHostNames;
 }
 
 
 
-Rcpp::CharacterVector  Simulator::getExtantSymbNames(std::vector<std::string> symbNames){
+std::vector<std::string>  Simulator::getExtantSymbNames(std::vector<std::string> symbNames){
   std::vector<std::string> extantSymbNames;
   for(int i = 0; i < symbNames.size(); i++) {
     if (symbNames[i].find("X") == std::string::npos) {
         extantSymbNames.push_back(symbNames[i]);
     }
   }
-  Rcpp::CharacterVector outVec = Rcpp::wrap(extantSymbNames);
-  return outVec;
+  return extantSymbNames;
 }
 // ##################################
 //
@@ -1718,19 +1415,19 @@ int Simulator::findNumberTransfers(){
 
 // wrappers for SpeciesTree, symbionTree, lociTree, geneTree root edge calculation
 double Simulator::getSpeciesTreeRootEdge(){
-  return spTree->getRoot()->getDeathTime() - spTree->getRoot()->getBirthTime();
+  return spTree->getRootEdge();
 }
 
 double Simulator::getLocusTreeRootEdge(){
-  return lociTree->getRoot()->getDeathTime() - lociTree->getRoot()->getBirthTime();
+  return lociTree->getRootEdge();
 }
 
 double Simulator::getSymbiontTreeRootEdge(){
-  return symbiontTree->getRoot()->getDeathTime() - symbiontTree->getRoot()->getBirthTime();
+  return symbiontTree->getRootEdge();
 }
 
 
 double Simulator::getGeneTreeRootEdge(int j){
-  return geneTrees[j]->getRoot()->getBranchLength();
+  return geneTrees[j]->getRootEdge();
 }
 
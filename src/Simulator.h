@@ -2,9 +2,36 @@
 #define Simulator_h
 #include "GeneTree.h"
 #include "SymbiontTree.h"
+#include "AssociationMatrix.h"
+#include "EventScheduler.h"
+#include "EventLog.h"
+#include "SimulationStats.h"
+#include "Cancellation.h"
 #include <set>
 #include <map>
-#include <RcppArmadillo.h>
+#include <string>
+
+// what the coalescent needs from a locus tree, computed once per locus tree
+// rather than once per gene tree; entries of the per-locus vectors are indexed by Lindx
+struct LocusTreeEpochs
+{
+    std::vector<double> epochs; // coalescent breakpoints, oldest first
+    std::vector< std::vector<int> > contempLoci; // loci alive in each epoch
+    std::vector<char>   isExtinctLocus;
+    std::vector<double> stopTimes;
+    std::vector<int>    ancIndices;
+    int                 rootLocus;
+    double              rootStartTime; // death time of the root of the locus tree
+    unsigned            numLociSampled;
+    // for gene trees bounded by the birth of the locus tree (prepareBoundedCoalescentSim):
+    // the daughters and the death and birth times of each locus, and the
+    // distributions of its number of lineages at its death and birth with the
+    // probabilities of going from one to the other
+    std::vector<int>    postOrderLoci;
+    std::vector<int>    ldesLoci, rdesLoci;
+    std::vector<double> deathTimes, birthTimes;
+    std::vector< std::vector<double> >  bottomCounts, topCounts, countProbs;
+};
 
 class Simulator
 {
@@ -26,23 +53,56 @@ class Simulator
         bool        printSOUT;
         bool        host_switch_mode;
         std::vector<std::shared_ptr<SpeciesTree>>   gsaTrees;
+        // the whole tree the GSA grows before the trees above are cut from it
+        std::shared_ptr<SpeciesTree>    gsaSimTree;
         std::shared_ptr<SpeciesTree>    spTree;
         std::shared_ptr<LocusTree>      lociTree;
         std::vector<std::shared_ptr<LocusTree>> locusTrees;
         std::shared_ptr<GeneTree>       geneTree;
         std::vector<std::shared_ptr<GeneTree>> geneTrees;
+        LocusTreeEpochs locusEpochs;
         // symbiont tree varibles
         std::shared_ptr<SymbiontTree>   symbiontTree;
         double      cospeciationRate;
         double      timeToSim;
         int         hostLimit;
-        arma::umat   assocMat;
+        AssociationMatrix   assocMat;
+        EventScheduler      scheduler;
         std::string  transferType;
 
-        Rcpp::IntegerVector inOrderVecOfHostIndx;
-        Rcpp::IntegerVector inOrderVecOfSymbIndx;
-        Rcpp::CharacterVector inOrderVecOfEvent;
-        Rcpp::NumericVector inOrderVecOfEventTimes;
+        EventLog            eventLog;
+        // time and channel rates of the scheduler before each of its events,
+        // NumChannels + 1 values per event and only kept with stats
+        std::vector<double> eventRateLog;
+        void        recordEventRates(double time);
+        // the changes to the associations are only recorded when asked for
+        bool                keepHistory;
+        AssociationHistory  assocHistory;
+        // tree node of each association matrix lineage id
+        std::vector<int>    symbNodeOfId, hostNodeOfId;
+        // every random draw of the simulations comes from this stream (or
+        // from streams seeded by it), a fixed seed unless setRng is called
+        std::shared_ptr<Rng>    rng;
+        double      drawUniform() { return rng->uniform(); }
+        unsigned    drawIndex(unsigned n) { return rng->uniformIndex(n); }
+        // counters of the simulation, nothing is counted when null
+        std::shared_ptr<SimulationStats>    stats;
+        // the event loops stop with SimulationCancelled when this asks them to,
+        // it is polled every cancellationInterval events
+        std::shared_ptr<Cancellation>   cancellation;
+        unsigned    eventsSinceCheck;
+        static const unsigned   cancellationInterval = 1024;
+        void        checkCancellation() {
+            if(cancellation && ++eventsSinceCheck >= cancellationInterval){
+                eventsSinceCheck = 0;
+                cancellation->check();
+            }
+        }
+        // the tree each attempt starts from, the one of the last attempt is
+        // reset and reused when the simulator is all that still holds it
+        void        renewSpeciesTree(std::shared_ptr<SpeciesTree> &tree, unsigned numTaxa);
+        void        renewSymbiontTree();
+        void        renewLocusTree();
 
     public:
         // Simulating species tree only
@@ -115,17 +175,32 @@ class Simulator
         void    setGSAStop(int g) { gsaStop = g; }
         void    setSpeciesTree(std::shared_ptr<SpeciesTree> st) { spTree = st; }
         void    setLocusTree(std::shared_ptr<LocusTree> lt) { lociTree = lt; }
+        void    setSparseAssociations(bool s) { assocMat.setSparse(s); }
+        void    setKeepAssociationHistory(bool k) { keepHistory = k; }
+        bool    getKeepsAssociationHistory() const { return keepHistory; }
+        void    setRng(std::shared_ptr<Rng> r) { rng = r; }
+        void    setStats(std::shared_ptr<SimulationStats> s) { stats = s; }
+        std::shared_ptr<SimulationStats>    getStats() { return stats; }
+        void    setCancellation(std::shared_ptr<Cancellation> c) { cancellation = c; eventsSinceCheck = 0; }
+        // starts the next replicate as a new Simulator would, keeping the
+        // memory of the last one; the sim* functions below call it first so
+        // one Simulator can run any number of replicates
+        void    resetReplicate();
 
         bool    gsaBDSim();
         bool    bdsaBDSim();
         bool    bdSimpleSim();
         bool    pairedBDPSim();
-        bool    pairedBDPSimAna();
         bool    coalescentSim();
+        void    prepareCoalescentSim();
+        void    prepareBoundedCoalescentSim();
+        std::shared_ptr<GeneTree>   coalescentGeneTree(std::shared_ptr<Rng> rng) const;
+        std::shared_ptr<GeneTree>   boundedCoalescentGeneTree(std::shared_ptr<Rng> rng) const;
         bool    simSpeciesTree();
         bool    simSpeciesTreeTime();
         bool    simLocusTree();
         bool    simGeneTree(int j);
+        bool    simGeneTrees(int numThreads);
         bool    simHostSymbSpeciesTreePair();
         bool    simHostSymbSpeciesTreePairWithAnagenesis();
         void    initializeSim();
@@ -144,15 +219,17 @@ class Simulator
         std::shared_ptr<GeneTree>       getGeneTree() {return geneTree; }
         double          getTimeToSim() {return timeToSim; }
         void            setTimeToSim(double tts) {timeToSim = tts; }
-        NumericMatrix   getSymbiontEdges() { return symbiontTree->getEdges(); }
-        NumericMatrix   getSpeciesEdges() { return spTree->getEdges(); }
-        NumericMatrix   getLocusEdges() { return lociTree->getEdges(); }
-        NumericMatrix   getGeneEdges(int j) { return geneTrees[j]->getGeneEdges(); }
+        EdgeMatrix      getSymbiontEdges() { return symbiontTree->getEdges(); }
+        EdgeMatrix      getSpeciesEdges() { return spTree->getEdges(); }
+        EdgeMatrix      getLocusEdges() { return lociTree->getEdges(); }
+        EdgeMatrix      getGeneEdges(int j) { return geneTrees[j]->getGeneEdges(); }
 
         std::vector<double>    getSymbiontEdgeLengths() { return symbiontTree->getEdgeLengths(); }
         std::vector<double>    getSpeciesEdgeLengths() { return spTree->getEdgeLengths(); }
         std::vector<double>    getLocusEdgeLengths() { return lociTree->getEdgeLengths(); }
         std::vector<double>    getGeneEdgeLengths(int j) { return geneTrees[j]->getEdgeLengths(); }
+        std::vector<double>    getSpeciesTipDistances() { return spTree->getTipDistances(); }
+        std::vector<double>    getSymbiontTipDistances() { return symbiontTree->getTipDistances(); }
 
         int    getSymbiontNnodes() { return symbiontTree->getNnodes(); }
         int    getSpeciesNnodes() { return spTree->getNnodes(); }
@@ -170,81 +247,33 @@ class Simulator
         double    getLocusTreeRootEdge();
         double    getSymbiontTreeRootEdge();
         double    getGeneTreeRootEdge(int j);
-        arma::umat    hostLimitCheck(arma::umat assocMat, int hostLimit);
-        arma::umat    getAssociationMatrix() { return assocMat; }
-        arma::umat    cophyloEvent(double eventTime, arma::umat assocMat);
-        arma::umat    cophyloERMEvent(double eventTime, arma::umat assocMat);
-        arma::umat    cospeciationEvent(double eventTime, arma::umat assocMat);
-        arma::umat    symbiontTreeEvent(double eventTime, arma::umat assocMat);
-        Rcpp::DataFrame createEventDF();
-        void      updateEventIndices();
-        void      updateEventVector(int h, int s, int e, double time);
+        // the events below update assocMat in place
+        void          hostLimitCheck(int hostLimit);
+        // hosts x symbionts, see AssociationMatrix::getMatrix
+        std::vector<int>    getAssociationMatrix() { return assocMat.getMatrix(); }
+        // current total rate of each scheduler channel (host, symbiont,
+        // cospeciation, dispersal, extirpation)
+        std::vector<double> getEventRates() const { return scheduler.getChannelRates(); }
+        void          initializeScheduler();
+        void          cophyloEvent(EventScheduler::Channel channel, double eventTime);
+        void          cophyloERMEvent(double eventTime);
+        void          cospeciationEvent(double eventTime);
+        void          symbiontTreeEvent(double eventTime);
+        const EventLog& getEventLog() const { return eventLog; }
+        const std::vector<double>&  getEventRateLog() const { return eventRateLog; }
+        void      recordNewLineages();
+        void      recordAssociationCheckpoint();
+        AssociationHistory  getAssociationHistory();
+        void      updateEventVector(int h, int s, EventLog::Type e, double time);
         void    clearEventDFVecs();
         void    initializeEventVector();
-        Rcpp::CharacterVector  getExtantHostNames(std::vector<std::string> hostNames);
-        Rcpp::CharacterVector  getExtantSymbNames(std::vector<std::string> symbNames);
+        std::vector<std::string>  getExtantHostNames(std::vector<std::string> hostNames);
+        std::vector<std::string>  getExtantSymbNames(std::vector<std::string> symbNames);
         // anagenetic functions
-        double    getTimeToAnaEvent(double dispRate, double extRate, arma::umat assocMat);
-        arma::umat symbiontDispersalEvent(int symbInd, arma::umat assocMat);
-        arma::umat symbiontExtirpationEvent(int symbInd, arma::umat assocMat);
-        arma::umat anageneticEvent(double dispersalRate, double extirpationRate, double currTime, arma::umat assocMat);
+        void      symbiontDispersalEvent(int symbInd);
+        void      symbiontExtirpationEvent(int symbInd);
+        void      anageneticEvent(bool isDispersal, double currTime);
 
 };
 
-extern Rcpp::List bdsim_species_tree(double sbr,
-                                     double sdr,
-                                     int numbsim,
-                                     int n_tips,
-                                     int gsa_stop);
-
-extern Rcpp::List sim_bdsimple_species_tree(double sbr,
-                                            double sdr,
-                                            int numbsim,
-                                            double timeToSimTo);
-
-extern Rcpp::List sim_locus_tree(std::shared_ptr<SpeciesTree> species_tree,
-                                 double gbr,
-                                 double gdr,
-                                 double lgtr,
-                                 int numLoci,
-                                 std::string trans_type);
-
-extern Rcpp::List sim_host_symb_treepair(double hostbr,
-                                         double hostdr,
-                                         double symbbr,
-                                         double symbdr,
-                                         double switchrate,
-                                         double cosprate,
-                                         double timeToSimTo,
-                                         int host_limit,
-                                         int numbsim,
-                                         bool hsMode);
-
-extern Rcpp::List sim_host_symb_treepair_ana(double hostbr,
-                                            double hostdr,
-                                            double symbbr,
-                                            double symbdr,
-                                            double symbdispersal,
-                                            double symbextirpation,
-                                            double switchrate,
-                                            double cosprate,
-                                            double timeToSimTo,
-                                            int host_limit,
-                                            int numbsim,
-                                            bool hsMode);
-
-extern Rcpp::List sim_locus_tree_gene_tree(std::shared_ptr<SpeciesTree> species_tree,
-                                           double gbr,
-                                           double gdr,
-                                           double lgtr,
-                                           int numLoci,
-                                           double popsize,
-                                           int samples_per_lineage,
-                                           int numGenesPerLocus);
-
-extern Rcpp::List sim_genetree_msc(std::shared_ptr<SpeciesTree> species_tree,
-                                   double popsize,
-                                   int samples_per_lineage,
-                                   int numbsim);
-
 #endif /* Simulator_h */
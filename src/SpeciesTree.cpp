@@ -2,8 +2,8 @@
 #include <iostream>
 
 #include "math.h"
-
-using namespace Rcpp;
+#include <algorithm>
+#include <stdexcept>
 
 
 SpeciesTree::SpeciesTree(unsigned numTaxa, double ct, double br, double dr) : Tree(numTaxa, 0.0){
@@ -13,15 +13,33 @@ SpeciesTree::SpeciesTree(unsigned numTaxa, double ct, double br, double dr) : Tr
 
 }
 
+void SpeciesTree::reset(unsigned numTaxa, double ct, double br, double dr){
+    resetToRoot(numTaxa, 0.0);
+    extantStop = numTaxa;
+    speciationRate = br;
+    extinctionRate = dr;
+}
+
 SpeciesTree::SpeciesTree(unsigned numTaxa) : Tree(numTaxa){
     extantStop = numTaxa;
 }
 
-SpeciesTree::SpeciesTree(SEXP rtree) : Tree(rtree){
+SpeciesTree::SpeciesTree(const EdgeMatrix &edges,
+                         const std::vector<double> &edgeLengths,
+                         const std::vector<std::string> &tipNames,
+                         int numInternal,
+                         double rootEdge) : Tree(edges, edgeLengths, tipNames, numInternal, rootEdge){
   speciationRate = 0.0;
   extinctionRate = 0.0;
 }
 
+SpeciesTree::SpeciesTree(const PhyloTree &tree) : SpeciesTree(tree.edges,
+                                                              tree.edgeLengths,
+                                                              tree.tipNames,
+                                                              tree.numInternal,
+                                                              tree.rootEdge){
+}
+
 SpeciesTree::SpeciesTree(const SpeciesTree& speciestree, unsigned numTaxa) : Tree(numTaxa) {
   extantStop = numTaxa;
   nodes = speciestree.nodes;
@@ -46,17 +64,15 @@ SpeciesTree::~SpeciesTree(){
 double SpeciesTree::getTimeToNextEvent(){
     double sumrt = speciationRate + extinctionRate;
     double returnTime = 0.0;
-    NumericVector randNum = Rcpp::runif(1);
-
-    returnTime = -log(randNum[0]) / (double(numExtant) * sumrt);
+    returnTime = -log(rng->uniform()) / (double(numExtant) * sumrt);
     return returnTime;
 }
 
 void SpeciesTree::lineageBirthEvent(unsigned indx){
     std::shared_ptr<Node> sis;
     std::shared_ptr<Node> right;
-    right = std::shared_ptr<Node>(new Node());
-    sis = std::shared_ptr<Node>(new Node());
+    right = getNewNode();
+    sis = getNewNode();
     setNewLineageInfo(indx, right, sis);
 }
 
@@ -72,11 +88,9 @@ void SpeciesTree::lineageDeathEvent(unsigned int indx){
 
 void SpeciesTree::ermEvent(double cTime){
     currentTime = cTime;
-    RNGScope scope;
-    NumericVector randNum = Rcpp::runif(2);
-    int nodeInd = randNum[0]*(numExtant - 1);
+    int nodeInd = rng->uniform()*(numExtant - 1);
     double relBr = speciationRate / (speciationRate + extinctionRate);
-    bool isBirth = (randNum[1] < relBr ? true : false);
+    bool isBirth = (rng->uniform() < relBr ? true : false);
     if(isBirth)
         lineageBirthEvent(nodeInd);
     else
@@ -124,6 +138,7 @@ void SpeciesTree::setNewLineageInfo(unsigned int indx,
 
 void SpeciesTree::setBranchLengths(){
     double bl = NAN;
+    branchLengths.clear();
     for(auto node : nodes){
       bl = node->getDeathTime() - node->getBirthTime();
       branchLengths.push_back(bl);
@@ -326,7 +341,7 @@ void SpeciesTree::reconstructLineageFromGSASim(std::shared_ptr<Node> currN,
         else if(currN->getRdes() == NULL)
             currN->setRdes(p);
         else{
-            stop("ERROR: Problem adding a tip to the tree!");
+            throw std::runtime_error("ERROR: Problem adding a tip to the tree!");
         }
 
     }
@@ -364,7 +379,7 @@ void SpeciesTree::reconstructLineageFromGSASim(std::shared_ptr<Node> currN,
                     else if(currN->getRdes() == NULL)
                         currN->setRdes(s1);
                     else{
-                        stop("ERROR: Probem adding an internal node to the tree");
+                        throw std::runtime_error("ERROR: Probem adding an internal node to the tree");
                     }
                 }
                 else{
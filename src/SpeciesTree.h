@@ -5,9 +5,6 @@
 #include <sstream>
 #include <map>
 #include <set>
-#include <RcppArmadillo.h>
-
-using namespace Rcpp;
 
 class SpeciesTree : public Tree
 {
@@ -19,9 +16,16 @@ class SpeciesTree : public Tree
     public:
                       SpeciesTree(unsigned numTaxa, double curTime, double specRate, double extRate);
                       SpeciesTree(unsigned numTaxa);
-                      SpeciesTree(SEXP rtree);
+                      SpeciesTree(const EdgeMatrix &edges,
+                                  const std::vector<double> &edgeLengths,
+                                  const std::vector<std::string> &tipNames,
+                                  int numInternal,
+                                  double rootEdge);
+                      SpeciesTree(const PhyloTree &tree);
                       SpeciesTree(const SpeciesTree& speciestree, unsigned numTaxa);
         virtual       ~SpeciesTree();
+        // back to a new SpeciesTree(numTaxa, curTime, specRate, extRate)
+        void          reset(unsigned numTaxa, double curTime, double specRate, double extRate);
 
         std::shared_ptr<SpeciesTree>  clone() const { return std::shared_ptr<SpeciesTree>(new SpeciesTree(*this)); }
         void          setSpeciationRate(double sr) {speciationRate = sr; }
@@ -24,6 +24,24 @@ SymbiontTree::SymbiontTree(int nt,
     symbHostMap.insert(std::pair<unsigned,std::vector<unsigned>> (0,initialHosts));
 }
 
+void SymbiontTree::reset(int nt,
+                         double ct,
+                         double br,
+                         double dr,
+                         double her,
+                         int K){
+    resetToRoot(nt, 0.0);
+    numTaxa = nt;
+    symbSpecRate = br;
+    symbExtRate = dr;
+    hostExpanRate = her;
+    numExpansions = 0;
+    hostLimit = K;
+    root->addHost(0);
+    symbHostMap.clear();
+    symbHostMap[0].assign(1, 0);
+}
+
 SymbiontTree::SymbiontTree(const SymbiontTree& symbionttree, unsigned numTaxa) : Tree(numTaxa) {
     nodes = symbionttree.nodes;
     extantNodes = symbionttree.extantNodes;
@@ -43,19 +61,6 @@ SymbiontTree::~SymbiontTree(){
 }
 
 
-double SymbiontTree::getTimeToNextJointEvent(double hostSpecRate,
-                                        double hostExtRate,
-                                        double cospeciaRate,
-                                        arma::umat assocMat){
-    int numHosts = assocMat.n_cols;
-// arma::uvec numPairs = find(assocMat);
-    double sumrt_host =  (hostSpecRate + hostExtRate) * numHosts;
-    double sumrt_symb = (symbSpecRate + symbExtRate + hostExpanRate) * numExtant;
-    double sumrt_both = cospeciaRate * numHosts;
-    double returnTime = -log(unif_rand()) / (sumrt_host + sumrt_symb + sumrt_both);
-    return returnTime;
-}
-
 void SymbiontTree::setSymbTreeInfoSpeciation(unsigned int indxToFind, unsigned int indxToReplace){
     for(auto s = extantNodes.begin(); s != extantNodes.end(); ++s){
         std::vector<unsigned int> hostsOfS = (*s)->getHosts();
@@ -93,8 +98,8 @@ std::vector<unsigned int> SymbiontTree::getSymbsOnHost(unsigned int hostIndx){
 }
 
 void SymbiontTree::lineageBirthEvent(unsigned indx){
-    std::shared_ptr<Node> right = std::shared_ptr<Node>(new Node());
-    std::shared_ptr<Node> sis = std::shared_ptr<Node>(new Node());
+    std::shared_ptr<Node> right = getNewNode();
+    std::shared_ptr<Node> sis = getNewNode();
     setNewLineageInfo(indx, right, sis);
 }
 
@@ -147,44 +152,37 @@ void SymbiontTree::setNewLineageInfo(unsigned int indx, std::shared_ptr<Node> r,
     l->setIndx(numNodes - 1);
 }
 
-arma::umat SymbiontTree::ermJointEvent(double ct, arma::umat assocMat){
+void SymbiontTree::ermJointEvent(double ct, AssociationMatrix &assocMat){
     currentTime = ct;
     this->setCurrentTime(ct);
 
     // pick a row at random
-    int nodeInd = unif_rand()*(numExtant);
-
-    arma::urowvec rvec = assocMat.row(nodeInd);
-    assocMat.shed_row(nodeInd);
+    int nodeInd = rng->uniform()*(numExtant);
 
     // which event
     double relBr = symbSpecRate / (symbExtRate + symbSpecRate + hostExpanRate);
     double relDr = relBr + (symbExtRate / (symbExtRate + symbSpecRate + hostExpanRate));
-    double dec = unif_rand();
+    double dec = rng->uniform();
     if(dec < relBr){
         // its a birth
         this->lineageBirthEvent(nodeInd);
-        assocMat.resize(numExtant, assocMat.n_cols);
-        assocMat(numExtant - 2, arma::span::all) = rvec;
-        assocMat(numExtant - 1, arma::span::all) = rvec;
+        assocMat.splitSymbiont(nodeInd);
     }
-    else if(dec < relDr)
+    else if(dec < relDr){
         this->lineageDeathEvent(nodeInd);
-
+        assocMat.removeSymbiont(nodeInd);
+    }
     else{
-        int hostInd = unif_rand() * assocMat.n_cols;
+        int hostInd = rng->uniform() * assocMat.getNumHosts();
         this->hostExpansionEvent(nodeInd, hostInd);
-        assocMat.resize(numExtant, assocMat.n_cols);
-        assocMat(numExtant - 2, arma::span::all) = rvec;
-        rvec(hostInd) = 1;
-        assocMat(numExtant - 1, arma::span::all) = rvec;
+        assocMat.splitSymbiont(nodeInd);
+        assocMat.associate(numExtant - 1, hostInd);
     }
-    return assocMat;
 }
 
 void SymbiontTree::hostExpansionEvent(unsigned int indx, unsigned int hostIndx){
-    std::shared_ptr<Node> right = std::shared_ptr<Node>(new Node());
-    std::shared_ptr<Node> sis = std::shared_ptr<Node>(new Node());
+    std::shared_ptr<Node> right = getNewNode();
+    std::shared_ptr<Node> sis = getNewNode();
     this->setNewLineageInfoExpan(indx, right, sis, hostIndx);
 }
 
@@ -286,6 +284,7 @@ void SymbiontTree::recTipNamer(std::shared_ptr<Node> p, unsigned &nodeIndx, unsi
 
 void SymbiontTree::setBranchLengths(){
     double bl = NAN;
+    branchLengths.clear();
     for(auto node : nodes){
         bl = node->getDeathTime() - node->getBirthTime();
         branchLengths.push_back(std::move(bl));
@@ -332,7 +331,7 @@ void SymbiontTree::cospeciationMapUpdate(unsigned int oldHostIndx,
             rightHostSymbiontsValues.push_back(this->getNodesSize() - 2);
         }
         else{
-            double which = unif_rand();
+            double which = rng->uniform();
             if(which < 0.5){
                 leftHostSymbiontsValues.push_back(symbsOnHost[i]);
                 for(unsigned int i=0; i < hostsInSymb.size(); i++){
@@ -11,6 +11,7 @@
 #include <set>
 #include <algorithm>
 #include "SpeciesTree.h"
+#include "AssociationMatrix.h"
 
 class SymbiontTree : public Tree {
 
@@ -34,10 +35,13 @@ class SymbiontTree : public Tree {
                    unsigned numTaxa);
 
       virtual         ~SymbiontTree();
-      double  getTimeToNextJointEvent(double hostSpecRate,
-                                         double hostExtRate,
-                                         double cospeciaRate,
-                                         arma::umat assocMat);
+      // back to a new SymbiontTree with these arguments
+      void            reset(int nt,
+                            double currSimTime,
+                            double symbsr,
+                            double symber,
+                            double hostExpanRate,
+                            int hostLimit);
       void    lineageBirthEvent(unsigned indx) override;
       void    lineageDeathEvent(unsigned indx) override;
       virtual void    setNewLineageInfo(unsigned int indx, std::shared_ptr<Node> r, std::shared_ptr<Node> s);
@@ -46,16 +50,14 @@ class SymbiontTree : public Tree {
                                              std::shared_ptr<Node> s,
                                              unsigned int hostIndx);
       void            hostExpansionEvent(unsigned int indx, unsigned int hostIndx);
-      arma::umat       ermJointEvent(double ct, arma::umat assocMat);
+      void            ermJointEvent(double ct, AssociationMatrix &assocMat);
 
       void            setSymbTreeInfoSpeciation(unsigned int ancIndx, unsigned int desIndx);
       void            setSymbTreeInfoExtinction(unsigned int deadIndx);
 
-      //std::string     printNewickTree();
       void            setTreeTipNames() override;
       void            recTipNamer(std::shared_ptr<Node> p, unsigned &extinctCount, unsigned &tipCount);
 
-//      void            recGetNewickTree(Node *r, std::stringstream &ss);
       void            setBranchLengths() override;
       void            setPresentTime(double currentT);
       void            setStopTime(double st) { stopTime = st; currentTime = 0;}
@@ -1,19 +1,33 @@
 #include "Tree.h"
+#include "TreeDistances.h"
 #include <vector>
 #include <string>
 #include <cmath>
+#include <stdexcept>
 
-using namespace Rcpp;
+thread_local unsigned long *Node::allocationCounter = nullptr;
 
 Node::Node()
 {
+    if(allocationCounter)
+        ++(*allocationCounter);
+    reset();
+}
+
+Node::~Node(){
+
+}
+
+void Node::reset(){
     ldes = nullptr;
     rdes = nullptr;
-    anc = nullptr;
-    sib = nullptr;
+    anc.reset();
+    sib.reset();
     indx = -1;
     Lindx = -1;
     flag = -1;
+    hosts.clear();
+    name.clear();
     isRoot = false;
     isTip = false;
     isExtant = false;
@@ -22,17 +36,20 @@ Node::Node()
     branchLength = 0.0;
     birthTime = 0.0;
     deathTime = 0.0;
-
+    locusID = 0;
 }
 
-Node::~Node(){
-
+Tree::Tree(unsigned numExta, double curTime){
+    resetToRoot(numExta, curTime);
 }
 
-Tree::Tree(unsigned numExta, double curTime){
+void Tree::resetToRoot(unsigned numExta, double curTime){
+    recycleNodes();
     numNodes = 0;
+    branchLengths.clear();
+    extantRoot = nullptr;
     // intialize tree with root
-    root = std::shared_ptr<Node>(new Node());
+    root = getNewNode();
     root->setAsRoot(true);
     root->setBirthTime(0.0);
     root->setIndx(0);
@@ -47,6 +64,39 @@ Tree::Tree(unsigned numExta, double curTime){
     numTotalTips = 0;
 }
 
+// Moves the nodes of the tree to spareNodes. They are only taken when the
+// tree is all that holds them, that is every node is held by nodes and by
+// the node above it. Otherwise something else still uses the tree (or part
+// of it) and the nodes are just let go.
+void Tree::recycleNodes(){
+    root = nullptr;
+    extantRoot = nullptr;
+    extantNodes.clear();
+    bool onlyHeldHere = true;
+    for(auto &node : nodes){
+        long owners = node->getAnc() ? 2 : 1;
+        if(node.use_count() != owners){
+            onlyHeldHere = false;
+            break;
+        }
+    }
+    if(onlyHeldHere){
+        for(auto &node : nodes){
+            node->reset();
+            spareNodes.push_back(std::move(node));
+        }
+    }
+    nodes.clear();
+}
+
+std::shared_ptr<Node> Tree::getNewNode(){
+    if(spareNodes.empty())
+        return std::make_shared<Node>();
+    std::shared_ptr<Node> p = std::move(spareNodes.back());
+    spareNodes.pop_back();
+    return p;
+}
+
 Tree::Tree(unsigned numTax){
     numTaxa = numTax; 
     numNodes = 2 * numTax - 1;
@@ -62,14 +112,13 @@ Tree::Tree(unsigned numTax){
     //numExtant = 1;
     //currentTime = 0.0;
 }
-// Implicit converter from R tree object (ala APE) into C++ tree class
-Tree::Tree(SEXP rtree){
-    Rcpp::List tr(rtree);
-    Rcpp::NumericMatrix edge_mat = tr["edge"];
-    std::vector<double> edge_lengths = tr["edge.length"];
-    std::vector<std::string> tip_names = tr["tip.label"];
-    double root_edge = tr["root.edge"];
-    numNodes = tr["Nnode"];
+// Converter from a tree in APE's format into C++ tree class
+Tree::Tree(const EdgeMatrix &edges,
+           const std::vector<double> &edge_lengths,
+           const std::vector<std::string> &tip_names,
+           int numInternal,
+           double root_edge){
+    numNodes = numInternal;
 
     std::map<int,int> indMap;
     numTaxa = (int) tip_names.size();
@@ -91,9 +140,8 @@ Tree::Tree(SEXP rtree){
     int i = 0;
     std::vector<int> nodeIndices;
     while(i < numTaxa + numNodes - 1){
-        NumericMatrix::Row edgeMatRow = edge_mat(i,_);
-        int indx1 = edgeMatRow[0] - 1;
-        int indx2 = edgeMatRow[1] - 1;
+        int indx1 = edges.anc[i] - 1;
+        int indx2 = edges.des[i] - 1;
         std::shared_ptr<Node> p = std::shared_ptr<Node>(new Node());
         p->setBranchLength(edge_lengths[i]);
         branchLengths[i + 1] = edge_lengths[i];
@@ -308,7 +356,7 @@ void Tree::reconstructLineageFromSim(std::shared_ptr<Node> currN,
         else if(currN->getRdes() == NULL)
             currN->setRdes(p);
         else{
-            stop("ERROR: Problem adding a tip to the tree!");
+            throw std::runtime_error("ERROR: Problem adding a tip to the tree!");
         }
 
     }
@@ -346,7 +394,7 @@ void Tree::reconstructLineageFromSim(std::shared_ptr<Node> currN,
                     else if(currN->getRdes() == NULL)
                         currN->setRdes(s1);
                     else{
-                        stop("ERROR: Problem adding a tip to the tree!");
+                        throw std::runtime_error("ERROR: Problem adding a tip to the tree!");
                     }
                 }
                 else{
@@ -523,16 +571,15 @@ void Tree::reindexForR(){
 // remember if something breaks you edited the notoriously
 //  sketchy reconstruct lineages WTD
 
-NumericMatrix Tree::getEdges(){
+EdgeMatrix Tree::getEdges(){
     int numRows = (int) nodes.size() - 1;
-    NumericMatrix edgeMat(numRows, 2);
+    EdgeMatrix edgeMat;
+    edgeMat.anc.assign(numRows, 0);
+    edgeMat.des.assign(numRows, 0);
     for(unsigned int i=1; i < nodes.size(); i++){
         if(!(nodes[i]->getIsRoot())){
-
-            NumericMatrix::Row row = edgeMat(i - 1, _);
-
-            row[0] = nodes[i]->getAnc()->getIndex();
-            row[1] = nodes[i]->getIndex();
+            edgeMat.anc[i - 1] = nodes[i]->getAnc()->getIndex();
+            edgeMat.des[i - 1] = nodes[i]->getIndex();
         }
     }
     return edgeMat;
@@ -540,6 +587,10 @@ NumericMatrix Tree::getEdges(){
 
 
 
+double Tree::getRootEdge(){
+    return root->getDeathTime() - root->getBirthTime();
+}
+
 std::vector<double> Tree::getEdgeLengths(){
     std::vector<double> edgeLengths;
     edgeLengths = branchLengths;
@@ -547,6 +598,18 @@ std::vector<double> Tree::getEdgeLengths(){
     return edgeLengths;
 }
 
+// tip by tip distances in the order of the tip indices, only after reindexForR.
+// The branch lengths are set from the node times first so they match the
+// edges whether or not the tree has been finished.
+std::vector<double> Tree::getTipDistances(){
+    int numTips = numExtant + numExtinct;
+    setBranchLengths();
+    EdgeMatrix edges = getEdges();
+    std::vector<double> dist((size_t) numTips * numTips);
+    copheneticDistances(edges.anc, edges.des, getEdgeLengths(), numTips, dist.data());
+    return dist;
+}
+
 void Tree::switchIndicesFirstToSecond(std::map<int,int> mappy){
     for(unsigned int i = 0; i < nodes.size(); i++){
         int newIndx = mappy[nodes[i]->getIndex()];
@@ -12,17 +12,38 @@
 #include <string>
 #include <vector>
 #include <iostream>
-#include <RcppArmadillo.h>
+#include <map>
 #include <memory>
-using namespace Rcpp;
+#include "Rng.h"
+
+// edges of a tree numbered as in ape (tips 1..n and then the internal nodes),
+// edge i goes from anc[i] to des[i]
+struct EdgeMatrix
+{
+    std::vector<int>    anc;
+    std::vector<int>    des;
+};
+
+// a tree as ape stores it, the internal nodes are numTips + 1, ... with the
+// root first, nodeLabels is empty or has one label per internal node
+struct PhyloTree
+{
+    EdgeMatrix                  edges;
+    std::vector<double>         edgeLengths;
+    std::vector<std::string>    tipNames;
+    std::vector<std::string>    nodeLabels;
+    int                         numInternal;
+    double                      rootEdge;
+};
 
 class Node
 {
     private:
         std::shared_ptr<Node>    ldes;
         std::shared_ptr<Node>    rdes;
-        std::shared_ptr<Node>    anc;
-        std::shared_ptr<Node>    sib;
+        // links up and across are weak so a tree is freed with its root
+        std::weak_ptr<Node>      anc;
+        std::weak_ptr<Node>      sib;
         int     indx, Lindx;
         std::vector<unsigned int> hosts;
         int     flag;
@@ -38,6 +59,11 @@ class Node
     public:
                 Node();
                 ~Node();
+        // back to the state of a new node, for reusing it in another tree
+        void    reset();
+        // nodes constructed on this thread are counted here when it is set,
+        // see PhaseTimer
+        static thread_local unsigned long *allocationCounter;
         void    setAsRoot(bool t) {isRoot = t; }
         void    setBirthTime(double bt) {birthTime = bt; }
         void    setIsTip(bool t) {isTip = t; }
@@ -59,8 +85,8 @@ class Node
         int     getFlag() {return flag; }
         std::shared_ptr<Node>   getLdes() {return ldes; }
         std::shared_ptr<Node>   getRdes() {return rdes; }
-        std::shared_ptr<Node>   getAnc() {return anc; }
-        std::shared_ptr<Node>   getSib() {return sib; }
+        std::shared_ptr<Node>   getAnc() {return anc.lock(); }
+        std::shared_ptr<Node>   getSib() {return sib.lock(); }
         bool    getIsRoot() {return isRoot; }
         bool    getIsTip() {return isTip; }
         bool    getIsExtinct() {return isExtinct; }
@@ -92,16 +118,31 @@ class Tree
         int numExtant, numExtinct;
         double  currentTime;
         std::vector<double> branchLengths;
+        // every random draw of the simulation comes from this stream
+        std::shared_ptr<Rng> rng;
+        // nodes of an earlier simulation of this tree, handed out again by
+        // getNewNode before any new ones are allocated
+        std::vector<std::shared_ptr<Node>> spareNodes;
+        std::shared_ptr<Node>   getNewNode();
+        void        recycleNodes();
+        // starts the tree again from a single root lineage as Tree(numTaxa,
+        // cTime) does, keeping the node storage of the last simulation
+        void        resetToRoot(unsigned numTaxa, double cTime);
 
     public:
                     Tree(unsigned numExtant, double cTime);
                     Tree(unsigned numTaxa);
-                    Tree(SEXP rtree);
+                    Tree(const EdgeMatrix &edges,
+                         const std::vector<double> &edgeLengths,
+                         const std::vector<std::string> &tipNames,
+                         int numInternal,
+                         double rootEdge);
         virtual      ~Tree();
         std::shared_ptr<Node>    getRoot() {return root; }
         std::shared_ptr<Node>    getExtantRoot() { return extantRoot; }
         void        setExtantRoot(std::shared_ptr<Node> r) { extantRoot = r; }
         void        setRoot(std::shared_ptr<Node> r) { root = r; }
+        void        setRng(std::shared_ptr<Rng> r) { rng = r; }
         unsigned int         getNumExtant() {return numExtant; }
         int         getNumTips() { return extantNodes.size(); }
         int         getNumExtinct() {return numExtinct; }
@@ -135,9 +176,11 @@ class Tree
         void        reindexForR();
         std::vector<std::string>    getTipNames();
         std::vector<std::string>    getNodeLabels();
-        NumericMatrix getEdges();
+        EdgeMatrix  getEdges();
         std::vector<double> getEdgeLengths();
+        std::vector<double> getTipDistances();
         int         getNnodes() { return nodes.size() - (numExtant + numExtinct);}
+        virtual double  getRootEdge();
         void        setTipsFromRtree();
         double      findMaxNodeHeight();
         int         getIndexFromNodes(int indx) {return nodes[indx]->getIndex(); }
@@ -0,0 +1,514 @@
+//
+//  TreeArchive.cpp
+//  treeducken
+//
+
+#include "TreeArchive.h"
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char archiveMagic[8] = {'T', 'D', 'K', 'T', 'R', 'E', 'E', 'S'};
+static const uint32_t byteOrderMark = 0x01020304;
+static const uint32_t archiveVersion = 1;
+static const size_t headerSize = 64;
+
+enum RecordKind : uint32_t
+{
+    TreeRecord = 1,
+    AssociationRecord = 2,
+    EventRecord = 3
+};
+
+enum TreeFlags : uint32_t
+{
+    HasNodeLabels = 1,
+    SinglePrecision = 2
+};
+
+template <typename T>
+static void put(std::string &data, T x){
+    data.append(reinterpret_cast<const char*>(&x), sizeof(T));
+}
+
+template <typename T>
+static void putArray(std::string &data, const std::vector<T> &x){
+    if(!(x.empty()))
+        data.append(reinterpret_cast<const char*>(x.data()), x.size() * sizeof(T));
+}
+
+static void padTo8(std::string &data){
+    data.append((8 - data.size() % 8) % 8, '\0');
+}
+
+template <typename T>
+static T get(const char *p){
+    T x;
+    std::memcpy(&x, p, sizeof(T));
+    return x;
+}
+
+template <typename T>
+static std::vector<T> getArray(const char *p, size_t n){
+    std::vector<T> x(n);
+    if(n > 0)
+        std::memcpy(x.data(), p, n * sizeof(T));
+    return x;
+}
+
+ArchiveRecord treeRecord(Tree &tree, bool singlePrecision, std::vector<int> *nodeNumbers){
+    std::vector<Node*> order;
+    std::vector<int32_t> parents;
+    std::vector<std::pair<Node*, int> > stack;
+    stack.push_back(std::make_pair(tree.getRoot().get(), -1));
+    while(!(stack.empty())){
+        Node *p = stack.back().first;
+        int parent = stack.back().second;
+        stack.pop_back();
+        int pos = (int) order.size();
+        order.push_back(p);
+        parents.push_back(parent);
+        // right first so the left subtree comes out first
+        if(p->getRdes())
+            stack.push_back(std::make_pair(p->getRdes().get(), pos));
+        if(p->getLdes())
+            stack.push_back(std::make_pair(p->getLdes().get(), pos));
+    }
+    uint32_t numNodes = order.size();
+    std::vector<std::string> tipLabels, nodeLabels;
+    bool hasNodeLabels = false;
+    for(Node *p : order){
+        if(!(p->getLdes()) && !(p->getRdes()))
+            tipLabels.push_back(p->getName());
+        else{
+            nodeLabels.push_back(p->getIsDuplication() ? p->getName() : "");
+            hasNodeLabels = hasNodeLabels || p->getIsDuplication();
+        }
+    }
+    uint32_t numTips = tipLabels.size();
+
+    ArchiveRecord record;
+    record.kind = TreeRecord;
+    put<uint32_t>(record.data, numNodes);
+    put<uint32_t>(record.data, numTips);
+    uint32_t flags = 0;
+    if(hasNodeLabels)
+        flags |= HasNodeLabels;
+    if(singlePrecision)
+        flags |= SinglePrecision;
+    put<uint32_t>(record.data, flags);
+    put<uint32_t>(record.data, 0);
+    for(uint32_t i = 0; i < numNodes; i++){
+        double length = i == 0 ? tree.getRootEdge() : order[i]->getBranchLength();
+        if(singlePrecision)
+            put<float>(record.data, (float) length);
+        else
+            put<double>(record.data, length);
+    }
+    putArray(record.data, parents);
+    record.labelOffset = record.data.size();
+    record.labels.swap(tipLabels);
+    if(hasNodeLabels)
+        record.labels.insert(record.labels.end(), nodeLabels.begin(), nodeLabels.end());
+    record.data.append(record.labels.size() * sizeof(uint32_t), '\0');
+    padTo8(record.data);
+
+    if(nodeNumbers != nullptr){
+        std::unordered_map<Node*, int> numberOf;
+        int nextTip = 1;
+        int nextInternal = numTips + 1;
+        for(Node *p : order){
+            bool isTip = !(p->getLdes()) && !(p->getRdes());
+            numberOf[p] = isTip ? nextTip++ : nextInternal++;
+        }
+        std::vector<std::shared_ptr<Node>> nodes = tree.getNodes();
+        nodeNumbers->assign(nodes.size(), 0);
+        for(size_t k = 0; k < nodes.size(); k++){
+            auto it = numberOf.find(nodes[k].get());
+            if(it != numberOf.end())
+                (*nodeNumbers)[k] = it->second;
+        }
+    }
+    return record;
+}
+
+ArchiveRecord associationRecord(const std::vector<std::string> &hostNames,
+                                const std::vector<std::string> &symbNames,
+                                const std::vector<int> &assoc){
+    size_t numHosts = hostNames.size();
+    size_t numSymbs = symbNames.size();
+    ArchiveRecord record;
+    record.kind = AssociationRecord;
+    put<uint32_t>(record.data, numHosts);
+    put<uint32_t>(record.data, numSymbs);
+    record.labelOffset = record.data.size();
+    record.labels = hostNames;
+    record.labels.insert(record.labels.end(), symbNames.begin(), symbNames.end());
+    record.data.append(record.labels.size() * sizeof(uint32_t), '\0');
+    std::vector<uint8_t> bits((numHosts * numSymbs + 7) / 8, 0);
+    for(size_t k = 0; k < numHosts * numSymbs; k++)
+        if(assoc[k])
+            bits[k / 8] |= (uint8_t) (1 << (k % 8));
+    putArray(record.data, bits);
+    padTo8(record.data);
+    return record;
+}
+
+ArchiveRecord eventRecord(const EventLog &events,
+                          const std::vector<int> &hostNumbers,
+                          const std::vector<int> &symbNumbers){
+    unsigned numEvents = events.size();
+    std::vector<double> times(numEvents);
+    std::vector<int32_t> hosts(numEvents), symbs(numEvents);
+    std::vector<uint8_t> types(numEvents);
+    for(unsigned i = 0; i < numEvents; i++){
+        int h = events.getHostIndex(i);
+        int s = events.getSymbiontIndex(i);
+        times[i] = events.getTime(i);
+        hosts[i] = h >= 0 && h < (int) hostNumbers.size() ? hostNumbers[h] : 0;
+        symbs[i] = s >= 0 && s < (int) symbNumbers.size() ? symbNumbers[s] : 0;
+        types[i] = events.getType(i);
+    }
+    ArchiveRecord record;
+    record.kind = EventRecord;
+    put<uint32_t>(record.data, numEvents);
+    put<uint32_t>(record.data, 0);
+    putArray(record.data, times);
+    putArray(record.data, hosts);
+    putArray(record.data, symbs);
+    putArray(record.data, types);
+    padTo8(record.data);
+    record.labelOffset = record.data.size();
+    return record;
+}
+
+TreeArchiveWriter::TreeArchiveWriter(const std::string &p, ArchiveContent c){
+    path = p;
+    content = c;
+    file = std::fopen(path.c_str(), "wb");
+    if(file == nullptr)
+        throw std::runtime_error("could not open '" + path + "' for writing");
+    // the header is written again with the counts and offsets on close, a
+    // file that was not closed has no records
+    buffer.append(archiveMagic, sizeof(archiveMagic));
+    put<uint32_t>(buffer, byteOrderMark);
+    put<uint32_t>(buffer, archiveVersion);
+    put<uint32_t>(buffer, content);
+    buffer.append(headerSize - buffer.size(), '\0');
+    offset = headerSize;
+    labels.push_back("");
+    labelIndices[""] = 0;
+}
+
+TreeArchiveWriter::~TreeArchiveWriter(){
+    if(file != nullptr)
+        std::fclose(file);
+}
+
+void TreeArchiveWriter::writeBuffer(){
+    if(buffer.empty())
+        return;
+    bool ok = std::fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+    buffer.clear();
+    if(!ok)
+        throw std::runtime_error("could not write to '" + path + "'");
+}
+
+void TreeArchiveWriter::append(const void *bytes, size_t n){
+    buffer.append(static_cast<const char*>(bytes), n);
+    offset += n;
+    if(buffer.size() >= (1 << 20))
+        writeBuffer();
+}
+
+void TreeArchiveWriter::add(const ArchiveRecord &record, long replicate){
+    recordOffsets.push_back(offset);
+    recordKinds.push_back(record.kind);
+    recordReplicates.push_back((uint32_t) replicate);
+    if(record.labels.empty()){
+        append(record.data.data(), record.data.size());
+        return;
+    }
+    std::vector<uint32_t> indices(record.labels.size());
+    for(size_t i = 0; i < indices.size(); i++){
+        auto it = labelIndices.find(record.labels[i]);
+        if(it == labelIndices.end()){
+            it = labelIndices.emplace(record.labels[i], (uint32_t) labels.size()).first;
+            labels.push_back(record.labels[i]);
+        }
+        indices[i] = it->second;
+    }
+    append(record.data.data(), record.labelOffset);
+    append(indices.data(), indices.size() * sizeof(uint32_t));
+    size_t rest = record.labelOffset + indices.size() * sizeof(uint32_t);
+    append(record.data.data() + rest, record.data.size() - rest);
+}
+
+void TreeArchiveWriter::close(){
+    uint64_t numRecords = recordOffsets.size();
+    uint64_t indexOffset = offset;
+    for(uint64_t i = 0; i < numRecords; i++){
+        append(&recordOffsets[i], sizeof(uint64_t));
+        append(&recordKinds[i], sizeof(uint32_t));
+        append(&recordReplicates[i], sizeof(uint32_t));
+    }
+    uint64_t labelsOffset = offset;
+    uint64_t numLabels = labels.size();
+    uint64_t end = 0;
+    for(auto &label : labels){
+        end += label.size();
+        append(&end, sizeof(uint64_t));
+    }
+    for(auto &label : labels)
+        append(label.data(), label.size());
+    writeBuffer();
+
+    std::string header(archiveMagic, sizeof(archiveMagic));
+    put<uint32_t>(header, byteOrderMark);
+    put<uint32_t>(header, archiveVersion);
+    put<uint32_t>(header, content);
+    put<uint32_t>(header, 0);
+    put<uint64_t>(header, numRecords);
+    put<uint64_t>(header, indexOffset);
+    put<uint64_t>(header, labelsOffset);
+    put<uint64_t>(header, numLabels);
+    header.append(headerSize - header.size(), '\0');
+    bool ok = std::fseek(file, 0, SEEK_SET) == 0
+        && std::fwrite(header.data(), 1, header.size(), file) == header.size();
+    ok = (std::fclose(file) == 0) && ok;
+    file = nullptr;
+    if(!ok)
+        throw std::runtime_error("could not write to '" + path + "'");
+}
+
+static void unmapFile(const char *data, uint64_t size){
+    if(data == nullptr)
+        return;
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+#else
+    munmap(const_cast<char*>(data), size);
+#endif
+}
+
+TreeArchive::TreeArchive(const std::string &p){
+    path = p;
+    data = nullptr;
+    size = 0;
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(handle == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("could not open '" + path + "'");
+    LARGE_INTEGER fileSize;
+    if(GetFileSizeEx(handle, &fileSize) && fileSize.QuadPart >= (LONGLONG) headerSize){
+        HANDLE mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if(mapping != NULL){
+            data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            CloseHandle(mapping);
+        }
+        size = fileSize.QuadPart;
+    }
+    CloseHandle(handle);
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+        throw std::runtime_error("could not open '" + path + "'");
+    struct stat info;
+    if(fstat(fd, &info) == 0 && info.st_size >= (off_t) headerSize){
+        void *mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(mapped != MAP_FAILED)
+            data = static_cast<const char*>(mapped);
+        size = info.st_size;
+    }
+    ::close(fd);
+#endif
+    if(size < headerSize)
+        throw std::runtime_error("'" + path + "' is not a treeducken tree archive");
+    if(data == nullptr)
+        throw std::runtime_error("could not map '" + path + "' into memory");
+    try{
+        if(std::memcmp(data, archiveMagic, sizeof(archiveMagic)) != 0)
+            fail("is not a treeducken tree archive");
+        if(get<uint32_t>(data + 8) != byteOrderMark)
+            fail("was written on a machine with a different byte order");
+        if(get<uint32_t>(data + 12) != archiveVersion)
+            fail("was written by a different version of treeducken");
+        content = static_cast<ArchiveContent>(get<uint32_t>(data + 16));
+        numRecords = get<uint64_t>(data + 24);
+        indexOffset = get<uint64_t>(data + 32);
+        labelsOffset = get<uint64_t>(data + 40);
+        numLabels = get<uint64_t>(data + 48);
+        if(indexOffset == 0)
+            fail("was not closed after writing");
+        if(content != ArchiveTrees && content != ArchiveCophylo)
+            fail("has an unknown content");
+        if(indexOffset < headerSize || indexOffset > size
+           || numRecords > (size - indexOffset) / 16
+           || labelsOffset != indexOffset + numRecords * 16
+           || numLabels > (size - labelsOffset) / 8
+           || numLabels < 1)
+            fail("is damaged");
+        uint64_t labelBytes = numLabels == 0 ? 0 : get<uint64_t>(data + labelsOffset + (numLabels - 1) * 8);
+        if(labelBytes > size - labelsOffset - numLabels * 8)
+            fail("is damaged");
+    }
+    catch(...){
+        unmapFile(data, size);
+        throw;
+    }
+}
+
+TreeArchive::~TreeArchive(){
+    unmapFile(data, size);
+}
+
+void TreeArchive::fail(const std::string &what) const{
+    throw std::runtime_error("'" + path + "' " + what);
+}
+
+long TreeArchive::getNumReplicates() const{
+    return content == ArchiveCophylo ? numRecords / 4 : numRecords;
+}
+
+// start of a record and the bytes to the next one (or the index)
+const char* TreeArchive::getRecord(long replicate, int which, uint32_t kind, uint64_t &length) const{
+    if(replicate < 0 || replicate >= getNumReplicates())
+        throw std::out_of_range("replicate " + std::to_string(replicate + 1) + " is not in the archive");
+    uint64_t r = content == ArchiveCophylo ? 4 * (uint64_t) replicate + which : replicate;
+    const char *entry = data + indexOffset + 16 * r;
+    uint64_t start = get<uint64_t>(entry);
+    uint64_t end = r + 1 < numRecords ? get<uint64_t>(entry + 16) : indexOffset;
+    if(get<uint32_t>(entry + 8) != kind || get<uint32_t>(entry + 12) != (uint32_t) replicate
+       || start < headerSize || start > end || end > indexOffset)
+        fail("is damaged");
+    length = end - start;
+    return data + start;
+}
+
+std::string TreeArchive::getLabel(uint32_t i) const{
+    if(i >= numLabels)
+        fail("is damaged");
+    const char *ends = data + labelsOffset;
+    const char *bytes = ends + numLabels * 8;
+    uint64_t start = i == 0 ? 0 : get<uint64_t>(ends + 8 * (i - 1));
+    uint64_t end = get<uint64_t>(ends + 8 * i);
+    if(start > end)
+        fail("is damaged");
+    return std::string(bytes + start, end - start);
+}
+
+PhyloTree TreeArchive::getTree(long replicate, int which) const{
+    uint64_t length;
+    const char *record = getRecord(replicate, which, TreeRecord, length);
+    if(length < 16)
+        fail("is damaged");
+    uint64_t numNodes = get<uint32_t>(record);
+    uint64_t numTips = get<uint32_t>(record + 4);
+    uint32_t flags = get<uint32_t>(record + 8);
+    size_t lengthSize = (flags & SinglePrecision) ? sizeof(float) : sizeof(double);
+    uint64_t numLabels = (flags & HasNodeLabels) ? numNodes : numTips;
+    if(numNodes < 1 || numTips > numNodes || 16 + numNodes * (lengthSize + 4) + numLabels * 4 > length)
+        fail("is damaged");
+    const char *lengths = record + 16;
+    std::vector<int32_t> parents = getArray<int32_t>(lengths + numNodes * lengthSize, numNodes);
+    std::vector<uint32_t> labels = getArray<uint32_t>(lengths + numNodes * (lengthSize + 4), numLabels);
+
+    // ape numbers from the preorder, tips are the nodes that are no parent
+    std::vector<bool> isTip(numNodes, true);
+    for(uint64_t i = 1; i < numNodes; i++){
+        if(parents[i] < 0 || (uint64_t) parents[i] >= i)
+            fail("is damaged");
+        isTip[parents[i]] = false;
+    }
+    if(parents[0] != -1)
+        fail("is damaged");
+    std::vector<int> numbers(numNodes);
+    int nextTip = 1;
+    int nextInternal = numTips + 1;
+    for(uint64_t i = 0; i < numNodes; i++)
+        numbers[i] = isTip[i] ? nextTip++ : nextInternal++;
+    if((uint64_t) (nextTip - 1) != numTips)
+        fail("is damaged");
+
+    PhyloTree tree;
+    tree.numInternal = numNodes - numTips;
+    tree.rootEdge = lengthSize == sizeof(float) ? get<float>(lengths) : get<double>(lengths);
+    tree.edges.anc.resize(numNodes - 1);
+    tree.edges.des.resize(numNodes - 1);
+    tree.edgeLengths.resize(numNodes - 1);
+    for(uint64_t i = 1; i < numNodes; i++){
+        tree.edges.anc[i - 1] = numbers[parents[i]];
+        tree.edges.des[i - 1] = numbers[i];
+        const char *p = lengths + i * lengthSize;
+        tree.edgeLengths[i - 1] = lengthSize == sizeof(float) ? get<float>(p) : get<double>(p);
+    }
+    tree.tipNames.reserve(numTips);
+    for(uint64_t i = 0; i < numTips; i++)
+        tree.tipNames.push_back(getLabel(labels[i]));
+    if(flags & HasNodeLabels)
+        for(uint64_t i = numTips; i < numNodes; i++)
+            tree.nodeLabels.push_back(getLabel(labels[i]));
+    return tree;
+}
+
+ArchivedAssociations TreeArchive::getAssociations(long replicate) const{
+    if(content != ArchiveCophylo)
+        fail("has no associations");
+    uint64_t length;
+    const char *record = getRecord(replicate, 2, AssociationRecord, length);
+    if(length < 8)
+        fail("is damaged");
+    uint64_t numHosts = get<uint32_t>(record);
+    uint64_t numSymbs = get<uint32_t>(record + 4);
+    uint64_t numCells = numHosts * numSymbs;
+    if(8 + (numHosts + numSymbs) * 4 + (numCells + 7) / 8 > length)
+        fail("is damaged");
+    std::vector<uint32_t> labels = getArray<uint32_t>(record + 8, numHosts + numSymbs);
+    const char *bits = record + 8 + (numHosts + numSymbs) * 4;
+    ArchivedAssociations associations;
+    for(uint64_t h = 0; h < numHosts; h++)
+        associations.hostNames.push_back(getLabel(labels[h]));
+    for(uint64_t s = 0; s < numSymbs; s++)
+        associations.symbNames.push_back(getLabel(labels[numHosts + s]));
+    associations.assoc.resize(numCells);
+    for(uint64_t k = 0; k < numCells; k++)
+        associations.assoc[k] = (bits[k / 8] >> (k % 8)) & 1;
+    return associations;
+}
+
+EventLog TreeArchive::getEvents(long replicate) const{
+    if(content != ArchiveCophylo)
+        fail("has no event histories");
+    uint64_t length;
+    const char *record = getRecord(replicate, 3, EventRecord, length);
+    if(length < 8)
+        fail("is damaged");
+    uint64_t numEvents = get<uint32_t>(record);
+    if(8 + numEvents * 17 > length)
+        fail("is damaged");
+    const char *times = record + 8;
+    const char *hosts = times + numEvents * 8;
+    const char *symbs = hosts + numEvents * 4;
+    const char *types = symbs + numEvents * 4;
+    EventLog events;
+    events.reserve(numEvents);
+    for(uint64_t i = 0; i < numEvents; i++){
+        uint8_t type = get<uint8_t>(types + i);
+        if(type >= EventLog::NumTypes)
+            fail("is damaged");
+        events.addEvent(get<int32_t>(hosts + 4 * i),
+                        get<int32_t>(symbs + 4 * i),
+                        static_cast<EventLog::Type>(type),
+                        get<double>(times + 8 * i));
+    }
+    return events;
+}
@@ -0,0 +1,160 @@
+//
+//  TreeArchive.h
+//  treeducken
+//
+//  Binary archives of simulated trees. Each replicate is stored as one record
+//  per tree (a parent array in preorder with its branch lengths) followed,
+//  for cophylogenies, by its associations and event history. Labels are
+//  stored once in a dictionary at the end of the file. Archives are read by
+//  mapping the file into memory so single replicates can be taken out of
+//  very large files without reading the rest.
+//
+//  Layout, in the byte order of the machine that wrote the file:
+//
+//    header (64 bytes)
+//      char[8]   "TDKTREES"
+//      uint32    0x01020304, to tell the byte order
+//      uint32    version (1)
+//      uint32    content (ArchiveContent)
+//      uint32    reserved
+//      uint64    number of records
+//      uint64    offset of the record index
+//      uint64    offset of the label dictionary
+//      uint64    number of labels
+//      uint64    reserved
+//    records, each starting at a multiple of 8 bytes
+//      tree:         uint32 numNodes, numTips, flags, reserved
+//                    branch lengths of the nodes in preorder, float64 or
+//                    float32 (flag 2), the root edge first
+//                    int32 parent of every node, -1 for the root
+//                    uint32 labels of the tips, then of the internal nodes
+//                    when flag 1 is set
+//      associations: uint32 numHosts, numSymbionts
+//                    uint32 labels of the hosts, then of the symbionts
+//                    a bit per symbiont and host, symbiont major
+//      events:       uint32 numEvents, reserved
+//                    float64 times, int32 host nodes, int32 symbiont nodes,
+//                    uint8 types (EventLog::Type)
+//    record index: uint64 offset, uint32 kind, uint32 replicate per record
+//    label dictionary: uint64 end of every label, then the label bytes,
+//      label 0 is ""
+//
+//  Nodes are numbered as in ape in the order they are stored: tips 1..n left
+//  to right and internal nodes from n + 1 at the root, which is also how the
+//  nodes of the event records are given.
+//
+
+#ifndef TreeArchive_h
+#define TreeArchive_h
+
+#include "Tree.h"
+#include "EventLog.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// what a replicate of an archive holds
+enum ArchiveContent : uint32_t
+{
+    ArchiveTrees = 0,       // a tree
+    ArchiveCophylo = 1      // host tree, symbiont tree, associations, events
+};
+
+// one record ready to be added to an archive, these can be made on any
+// thread and are added in order by the writer
+struct ArchiveRecord
+{
+    uint32_t                    kind;
+    std::string                 data;
+    // the uint32 at labelOffset and after in data are the labels, they are
+    // set to the indices of the labels in the dictionary when the record is
+    // added
+    size_t                      labelOffset;
+    std::vector<std::string>    labels;
+};
+
+// nodeNumbers, if given, gets the number of every node of tree.getNodes() in
+// the archive (0 for nodes below the root that are not in the tree)
+ArchiveRecord treeRecord(Tree &tree,
+                         bool singlePrecision,
+                         std::vector<int> *nodeNumbers = nullptr);
+
+// associations as from Simulator::getAssociationMatrix
+ArchiveRecord associationRecord(const std::vector<std::string> &hostNames,
+                                const std::vector<std::string> &symbNames,
+                                const std::vector<int> &assoc);
+
+// events with their node indices replaced by the numbers from treeRecord
+ArchiveRecord eventRecord(const EventLog &events,
+                          const std::vector<int> &hostNumbers,
+                          const std::vector<int> &symbNumbers);
+
+class TreeArchiveWriter
+{
+    private:
+        std::string     path;
+        ArchiveContent  content;
+        FILE            *file;
+        std::string     buffer;
+        uint64_t        offset;
+        std::vector<uint64_t>   recordOffsets;
+        std::vector<uint32_t>   recordKinds;
+        std::vector<uint32_t>   recordReplicates;
+        std::vector<std::string>    labels;
+        std::unordered_map<std::string, uint32_t>   labelIndices;
+
+        void        append(const void *bytes, size_t n);
+        void        writeBuffer();
+
+    public:
+                    TreeArchiveWriter(const std::string &path, ArchiveContent content);
+                    TreeArchiveWriter(const TreeArchiveWriter&) = delete;
+                    ~TreeArchiveWriter();
+        // records of a replicate have to be added together and in the order
+        // given by its content
+        void        add(const ArchiveRecord &record, long replicate);
+        // writes the index and labels, the archive can not be read before
+        void        close();
+};
+
+// host by symbiont associations of a replicate
+struct ArchivedAssociations
+{
+    std::vector<std::string>    hostNames;
+    std::vector<std::string>    symbNames;
+    // as from Simulator::getAssociationMatrix
+    std::vector<int>            assoc;
+};
+
+class TreeArchive
+{
+    private:
+        std::string     path;
+        const char      *data;
+        uint64_t        size;
+        ArchiveContent  content;
+        uint64_t        numRecords;
+        uint64_t        indexOffset;
+        uint64_t        labelsOffset;
+        uint64_t        numLabels;
+
+        void        fail(const std::string &what) const;
+        const char* getRecord(long replicate, int which, uint32_t kind, uint64_t &length) const;
+        std::string getLabel(uint32_t i) const;
+
+    public:
+                    TreeArchive(const std::string &path);
+                    TreeArchive(const TreeArchive&) = delete;
+                    ~TreeArchive();
+        ArchiveContent  getContent() const { return content; }
+        long        getNumReplicates() const;
+        // which is 0 for the host tree and 1 for the symbiont tree of
+        // cophylogenies
+        PhyloTree   getTree(long replicate, int which = 0) const;
+        ArchivedAssociations    getAssociations(long replicate) const;
+        EventLog    getEvents(long replicate) const;
+};
+
+#endif /* TreeArchive_h */
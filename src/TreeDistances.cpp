@@ -0,0 +1,134 @@
+//
+//  TreeDistances.cpp
+//  treeducken
+//
+
+#include "TreeDistances.h"
+#include <algorithm>
+#include <cstring>
+#include <cstddef>
+
+// distances between the tips in positions r0..r1 and c0..c1 of the depth first
+// order whose last common ancestor is at depth ancDepth
+static void fillBlock(double *dist, size_t n, const std::vector<double> &tipDepths,
+                      size_t r0, size_t r1, size_t c0, size_t c1, double ancDepth){
+    const double *cDepths = tipDepths.data();
+    for(size_t i = r0; i < r1; i++){
+        double *row = dist + i * n;
+        double rowBase = tipDepths[i] - 2.0 * ancDepth;
+        for(size_t j = c0; j < c1; j++)
+            row[j] = rowBase + cDepths[j];
+    }
+}
+
+void copheneticDistances(const std::vector<int> &anc,
+                         const std::vector<int> &des,
+                         const std::vector<double> &brlens,
+                         int numTips,
+                         double *dist){
+    if(numTips <= 0)
+        return;
+    size_t n = numTips;
+    int numEdges = anc.size();
+    int maxNode = numTips;
+    for(int e = 0; e < numEdges; e++)
+        maxNode = std::max(maxNode, std::max(anc[e], des[e]));
+    // children of each node in compressed rows and the branch above each node
+    std::vector<int> firstChild(maxNode + 2, 0), children(numEdges);
+    std::vector<double> branchAbove(maxNode + 1, 0.0);
+    std::vector<char> hasParent(maxNode + 1, 0);
+    for(int e = 0; e < numEdges; e++){
+        firstChild[anc[e] + 1]++;
+        branchAbove[des[e]] = brlens[e];
+        hasParent[des[e]] = 1;
+    }
+    for(int v = 0; v <= maxNode; v++)
+        firstChild[v + 1] += firstChild[v];
+    std::vector<int> fillAt(firstChild.begin(), firstChild.end() - 1);
+    for(int e = 0; e < numEdges; e++)
+        children[fillAt[anc[e]]++] = des[e];
+    int root = 1;
+    for(int v = 1; v <= maxNode; v++){
+        if(!(hasParent[v]) && (firstChild[v + 1] > firstChild[v] || numTips == 1)){
+            root = v;
+            break;
+        }
+    }
+
+    // depth first order of the tips and the range of it under every node
+    std::vector<double> depth(maxNode + 1, 0.0);
+    std::vector<size_t> start(maxNode + 1, 0), end(maxNode + 1, 0);
+    std::vector<int> order;
+    order.reserve(n);
+    std::vector<int> stack(1, root), cursor(maxNode + 1, 0);
+    while(!(stack.empty())){
+        int v = stack.back();
+        if(cursor[v] == 0)
+            start[v] = order.size();
+        if(v <= numTips){
+            order.push_back(v);
+            end[v] = order.size();
+            stack.pop_back();
+        }
+        else if(firstChild[v] + cursor[v] < firstChild[v + 1]){
+            int c = children[firstChild[v] + cursor[v]];
+            cursor[v]++;
+            depth[c] = depth[v] + branchAbove[c];
+            stack.push_back(c);
+        }
+        else{
+            end[v] = order.size();
+            stack.pop_back();
+        }
+    }
+    std::vector<double> tipDepths(n);
+    for(size_t k = 0; k < n; k++)
+        tipDepths[k] = depth[order[k]];
+
+    for(size_t k = 0; k < n; k++)
+        dist[k * n + k] = 0.0;
+    for(int v = numTips + 1; v <= maxNode; v++){
+        for(int a = firstChild[v]; a < firstChild[v + 1]; a++){
+            for(int b = a + 1; b < firstChild[v + 1]; b++){
+                int ca = children[a];
+                int cb = children[b];
+                fillBlock(dist, n, tipDepths, start[ca], end[ca], start[cb], end[cb], depth[v]);
+                fillBlock(dist, n, tipDepths, start[cb], end[cb], start[ca], end[ca], depth[v]);
+            }
+        }
+    }
+
+    // back to tip order, row a of the result is row start[a + 1] of dist
+    std::vector<size_t> pos(n);
+    bool inOrder = true;
+    for(size_t a = 0; a < n; a++){
+        pos[a] = start[a + 1];
+        inOrder = inOrder && (pos[a] == a);
+    }
+    if(inOrder)
+        return;
+    std::vector<double> buffer(n);
+    for(size_t i = 0; i < n; i++){
+        double *row = dist + i * n;
+        for(size_t b = 0; b < n; b++)
+            buffer[b] = row[pos[b]];
+        std::memcpy(row, buffer.data(), n * sizeof(double));
+    }
+    std::vector<char> placed(n, 0);
+    for(size_t a = 0; a < n; a++){
+        if(placed[a])
+            continue;
+        std::memcpy(buffer.data(), dist + a * n, n * sizeof(double));
+        size_t cur = a;
+        while(true){
+            placed[cur] = 1;
+            size_t next = pos[cur];
+            if(next == a){
+                std::memcpy(dist + cur * n, buffer.data(), n * sizeof(double));
+                break;
+            }
+            std::memcpy(dist + cur * n, dist + next * n, n * sizeof(double));
+            cur = next;
+        }
+    }
+}
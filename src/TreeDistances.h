@@ -0,0 +1,29 @@
+//
+//  TreeDistances.h
+//  treeducken
+//
+//  All pairs of tip to tip (cophenetic) distances of a rooted tree given as an
+//  ape style edge list (tips 1..numTips, internal nodes after them).
+//
+//  Tips are first put in depth first order so that the tips under every node
+//  are contiguous. The distances between the tips of two children of a node
+//  then fill a rectangular block of the matrix, written row by row from the
+//  root to tip depths, so every entry is written once with unit stride. The
+//  rows and columns are put back in tip order at the end in place, which
+//  only needs one extra row.
+//
+
+#ifndef TreeDistances_h
+#define TreeDistances_h
+
+#include <vector>
+
+// dist must hold numTips * numTips values and is symmetric, so it is the same
+// in row or column major order
+void copheneticDistances(const std::vector<int> &anc,
+                         const std::vector<int> &des,
+                         const std::vector<double> &brlens,
+                         int numTips,
+                         double *dist);
+
+#endif /* TreeDistances_h */
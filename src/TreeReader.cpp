@@ -0,0 +1,332 @@
+//
+//  TreeReader.cpp
+//  treeducken
+//
+
+#include "TreeReader.h"
+#include <zlib.h>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <cctype>
+
+// reads a label at pos, single quoted or up to the next delimiter
+static std::string readLabel(const std::string &text, size_t &pos){
+    std::string label;
+    if(pos < text.size() && text[pos] == '\''){
+        pos++;
+        while(pos < text.size()){
+            if(text[pos] == '\''){
+                if(pos + 1 < text.size() && text[pos + 1] == '\''){
+                    label.push_back('\'');
+                    pos += 2;
+                    continue;
+                }
+                pos++;
+                break;
+            }
+            label.push_back(text[pos++]);
+        }
+        return label;
+    }
+    while(pos < text.size() && std::strchr("(),:;[", text[pos]) == nullptr){
+        if(!(std::isspace((unsigned char) text[pos])))
+            label.push_back(text[pos]);
+        pos++;
+    }
+    return label;
+}
+
+static void skipSpace(const std::string &text, size_t &pos){
+    while(pos < text.size()){
+        if(std::isspace((unsigned char) text[pos]))
+            pos++;
+        else if(text[pos] == '['){
+            size_t close = text.find(']', pos);
+            if(close == std::string::npos)
+                throw std::runtime_error("unterminated comment in Newick tree");
+            pos = close + 1;
+        }
+        else
+            break;
+    }
+}
+
+// branch length after a node, NaN when there is none
+static double readLength(const std::string &text, size_t &pos){
+    skipSpace(text, pos);
+    if(pos >= text.size() || text[pos] != ':')
+        return NAN;
+    pos++;
+    skipSpace(text, pos);
+    const char *start = text.c_str() + pos;
+    char *end = nullptr;
+    double len = std::strtod(start, &end);
+    if(end == start)
+        throw std::runtime_error("bad branch length in Newick tree");
+    pos += end - start;
+    return len;
+}
+
+PhyloTree parseNewick(const std::string &text, size_t pos){
+    // the k-th internal node is stored as -k until the number of tips is known
+    std::vector<int> anc, des;
+    std::vector<double> lengths;
+    std::vector<std::string> tipNames;
+    std::vector<std::string> nodeLabels;
+    bool hasNodeLabels = false;
+    int numInternal = 0;
+    std::vector<int> open; // internal nodes that are not closed yet
+    std::vector<int> openEdge; // edge above each of them
+    double rootEdge = 0.0;
+    skipSpace(text, pos);
+    bool done = false;
+    while(!done){
+        skipSpace(text, pos);
+        if(pos >= text.size())
+            throw std::runtime_error("Newick tree is missing ';'");
+        char c = text[pos];
+        if(c == '('){
+            pos++;
+            int node = -(++numInternal);
+            openEdge.push_back(anc.size());
+            if(!(open.empty())){
+                anc.push_back(open.back());
+                des.push_back(node);
+                lengths.push_back(NAN);
+            }
+            open.push_back(node);
+            nodeLabels.push_back("");
+        }
+        else if(c == ','){
+            pos++;
+        }
+        else if(c == ')'){
+            pos++;
+            if(open.empty())
+                throw std::runtime_error("unbalanced parentheses in Newick tree");
+            std::string label = readLabel(text, pos);
+            if(!(label.empty())){
+                nodeLabels[-open.back() - 1] = label;
+                hasNodeLabels = true;
+            }
+            double len = readLength(text, pos);
+            size_t e = openEdge.back();
+            open.pop_back();
+            openEdge.pop_back();
+            if(open.empty())
+                rootEdge = std::isnan(len) ? 0.0 : len;
+            else
+                lengths[e] = len;
+        }
+        else if(c == ';'){
+            if(!(open.empty()))
+                throw std::runtime_error("unbalanced parentheses in Newick tree");
+            done = true;
+        }
+        else{
+            if(open.empty())
+                throw std::runtime_error("Newick tree must start with '('");
+            tipNames.push_back(readLabel(text, pos));
+            anc.push_back(open.back());
+            des.push_back(tipNames.size() - 1);
+            lengths.push_back(readLength(text, pos));
+        }
+    }
+    int numTips = tipNames.size();
+    PhyloTree tree;
+    tree.edges.anc.resize(anc.size());
+    tree.edges.des.resize(des.size());
+    for(size_t e = 0; e < anc.size(); e++){
+        if(std::isnan(lengths[e]))
+            throw std::runtime_error("every branch of the species tree needs a length");
+        tree.edges.anc[e] = numTips - anc[e];
+        tree.edges.des[e] = des[e] < 0 ? numTips - des[e] : des[e] + 1;
+    }
+    tree.edgeLengths.swap(lengths);
+    tree.tipNames.swap(tipNames);
+    if(hasNodeLabels)
+        tree.nodeLabels.swap(nodeLabels);
+    tree.numInternal = numInternal;
+    tree.rootEdge = rootEdge;
+    return tree;
+}
+
+// NEXUS command or block name at pos in lower case
+static std::string readWord(const std::string &text, size_t &pos){
+    skipSpace(text, pos);
+    std::string word;
+    while(pos < text.size() && std::isalpha((unsigned char) text[pos]))
+        word.push_back(std::tolower((unsigned char) text[pos++]));
+    return word;
+}
+
+// a name of a TRANSLATE command, single quoted or up to a space, ',' or ';'
+static std::string readToken(const std::string &text, size_t &pos){
+    skipSpace(text, pos);
+    if(pos < text.size() && text[pos] == '\'')
+        return readLabel(text, pos);
+    size_t start = pos;
+    while(pos < text.size() && std::strchr(",;", text[pos]) == nullptr
+          && !(std::isspace((unsigned char) text[pos])))
+        pos++;
+    return text.substr(start, pos - start);
+}
+
+TreeReader::TreeReader(const std::string &p) : path(p), buffer(1 << 20){
+    bufferPos = 0;
+    bufferEnd = 0;
+    inTrees = false;
+    numTrees = 0;
+    // gzread passes files that are not compressed through unchanged
+    gz = gzopen(path.c_str(), "rb");
+    if(gz == nullptr)
+        throw std::runtime_error("could not open tree file '" + path + "'");
+    fillBuffer();
+    while(bufferPos < bufferEnd && std::isspace((unsigned char) buffer[bufferPos]))
+        bufferPos++;
+    const char *magic = "#nexus";
+    nexus = bufferEnd - bufferPos >= 6;
+    for(size_t i = 0; nexus && i < 6; i++)
+        nexus = std::tolower((unsigned char) buffer[bufferPos + i]) == magic[i];
+    if(nexus)
+        bufferPos += 6;
+}
+
+TreeReader::~TreeReader(){
+    gzclose(gz);
+}
+
+bool TreeReader::fillBuffer(){
+    int numRead = gzread(gz, buffer.data(), buffer.size());
+    if(numRead < 0)
+        throw std::runtime_error("could not read tree file '" + path + "'");
+    bufferPos = 0;
+    bufferEnd = numRead;
+    return numRead > 0;
+}
+
+// copies runs of ordinary characters in one go and only looks at quotes,
+// comments and the final ';' one by one
+bool TreeReader::readStatement(){
+    statement.clear();
+    bool quoted = false;
+    int commentDepth = 0;
+    bool blank = true;
+    while(bufferPos < bufferEnd || fillBuffer()){
+        if(!quoted && commentDepth == 0){
+            size_t start = bufferPos;
+            while(bufferPos < bufferEnd && buffer[bufferPos] != '\''
+                  && buffer[bufferPos] != '[' && buffer[bufferPos] != ';')
+                bufferPos++;
+            for(size_t i = start; blank && i < bufferPos; i++)
+                blank = std::isspace((unsigned char) buffer[i]);
+            statement.append(buffer.data() + start, bufferPos - start);
+            if(bufferPos == bufferEnd)
+                continue;
+        }
+        char c = buffer[bufferPos++];
+        if(commentDepth > 0){
+            if(c == '[')
+                commentDepth++;
+            else if(c == ']')
+                commentDepth--;
+            continue;
+        }
+        if(quoted){
+            quoted = c != '\'';
+        }
+        else if(c == '\''){
+            quoted = true;
+            blank = false;
+        }
+        else if(c == '['){
+            commentDepth = 1;
+            continue;
+        }
+        else if(c == ';'){
+            if(blank){
+                statement.clear();
+                continue;
+            }
+            statement.push_back(c);
+            return true;
+        }
+        statement.push_back(c);
+    }
+    // a last tree without its ';' is reported by parseNewick
+    return !blank;
+}
+
+void TreeReader::readTranslation(size_t pos){
+    translation.clear();
+    while(true){
+        std::string key = readToken(statement, pos);
+        if(key.empty())
+            break;
+        std::string name = readToken(statement, pos);
+        translation[key] = name;
+        skipSpace(statement, pos);
+        if(pos < statement.size() && statement[pos] == ',')
+            pos++;
+    }
+}
+
+bool TreeReader::next(PhyloTree &tree){
+    try{
+        while(readStatement()){
+            if(!nexus){
+                tree = parseNewick(statement);
+                numTrees++;
+                return true;
+            }
+            size_t pos = 0;
+            std::string command = readWord(statement, pos);
+            if(command == "begin"){
+                inTrees = readWord(statement, pos) == "trees";
+                translation.clear();
+            }
+            else if(command == "end" || command == "endblock")
+                inTrees = false;
+            else if(inTrees && command == "translate")
+                readTranslation(pos);
+            else if(inTrees && (command == "tree" || command == "utree")){
+                readToken(statement, pos);
+                skipSpace(statement, pos);
+                if(pos >= statement.size() || statement[pos] != '=')
+                    throw std::runtime_error("TREE command is missing '='");
+                tree = parseNewick(statement, pos + 1);
+                if(!(translation.empty())){
+                    for(auto &name : tree.tipNames){
+                        auto it = translation.find(name);
+                        if(it != translation.end())
+                            name = it->second;
+                    }
+                }
+                numTrees++;
+                return true;
+            }
+        }
+    }
+    catch(const std::runtime_error &e){
+        throw std::runtime_error("tree " + std::to_string(numTrees + 1) + " of '"
+                                 + path + "': " + e.what());
+    }
+    return false;
+}
+
+std::shared_ptr<SpeciesTree> TreeReader::nextSpeciesTree(){
+    PhyloTree tree;
+    if(!(next(tree)))
+        return nullptr;
+    return std::make_shared<SpeciesTree>(tree);
+}
+
+PhyloTree readTreeFile(const std::string &path){
+    TreeReader reader(path);
+    PhyloTree tree;
+    if(!(reader.next(tree)))
+        throw std::runtime_error("no tree in '" + path + "'");
+    return tree;
+}
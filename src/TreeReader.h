@@ -0,0 +1,60 @@
+//
+//  TreeReader.h
+//  treeducken
+//
+//  Newick and NEXUS tree files read one tree at a time, so files of many
+//  species trees (a posterior sample, say) never have to be held in memory.
+//  Files may be gzip compressed.
+//
+
+#ifndef TreeReader_h
+#define TreeReader_h
+
+#include "SpeciesTree.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+struct gzFile_s;
+
+// one Newick tree starting at pos of text and ending in ';', tips are
+// numbered in the order they appear and internal nodes in preorder so the
+// edges are in the cladewise order of ape::read.tree
+PhyloTree parseNewick(const std::string &text, size_t pos = 0);
+
+class TreeReader
+{
+    private:
+        std::string path;
+        gzFile_s    *gz;
+        std::vector<char>   buffer;
+        size_t      bufferPos;
+        size_t      bufferEnd;
+        bool        nexus;
+        bool        inTrees;
+        // tip names of the TRANSLATE command of the current trees block
+        std::unordered_map<std::string, std::string> translation;
+        long        numTrees;
+        // text up to and including the next ';' without comments
+        std::string statement;
+
+        bool        fillBuffer();
+        bool        readStatement();
+        void        readTranslation(size_t pos);
+
+    public:
+                    TreeReader(const std::string &path);
+                    TreeReader(const TreeReader&) = delete;
+                    ~TreeReader();
+        // reads the next tree of the file into tree, false when there are
+        // no more, malformed trees throw with their number in the file
+        bool        next(PhyloTree &tree);
+        // the next tree as a species tree to simulate on, nullptr at the end
+        std::shared_ptr<SpeciesTree>    nextSpeciesTree();
+        long        getNumTrees() const { return numTrees; }
+};
+
+// first tree of a Newick or NEXUS file
+PhyloTree readTreeFile(const std::string &path);
+
+#endif /* TreeReader_h */
@@ -0,0 +1,188 @@
+//
+//  TreeStats.cpp
+//  treeducken
+//
+
+#include "TreeStats.h"
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+// log likelihood of Aldous' beta-splitting model for clades of size n = cladeSizes[k]
+// splitting into i = splitSizes[k] and n - i tips (only clades with 3 or more tips
+// carry information)
+double betaSplitLogLik(const std::vector<int> &splitSizes,
+                       const std::vector<int> &cladeSizes,
+                       double beta){
+    int maxSize = 0;
+    for(auto n : cladeSizes)
+        maxSize = std::max(maxSize, n);
+    // log of the normalising constant for every clade size that is needed
+    std::vector<double> logNorm(maxSize + 1, 0.0);
+    std::vector<char> needNorm(maxSize + 1, 0);
+    for(auto n : cladeSizes)
+        needNorm[n] = 1;
+    std::vector<double> logTerms;
+    for(int n = 2; n <= maxSize; n++){
+        if(!(needNorm[n]))
+            continue;
+        logTerms.resize(n - 1);
+        double maxTerm = -std::numeric_limits<double>::infinity();
+        for(int i = 1; i < n; i++){
+            logTerms[i - 1] = std::lgamma(beta + i + 1) + std::lgamma(beta + n - i + 1)
+                              - std::lgamma(i + 1.0) - std::lgamma(n - i + 1.0);
+            maxTerm = std::max(maxTerm, logTerms[i - 1]);
+        }
+        double sumExp = 0.0;
+        for(auto lt : logTerms)
+            sumExp += std::exp(lt - maxTerm);
+        logNorm[n] = maxTerm + std::log(sumExp);
+    }
+    double logLik = 0.0;
+    for(unsigned k = 0; k < cladeSizes.size(); k++){
+        int n = cladeSizes[k];
+        int i = splitSizes[k];
+        logLik += std::lgamma(beta + i + 1) + std::lgamma(beta + n - i + 1)
+                  - std::lgamma(i + 1.0) - std::lgamma(n - i + 1.0) - logNorm[n];
+    }
+    return logLik;
+}
+
+// golden section search for the maximum likelihood beta on (-2, 10)
+// like apTreeshape::maxlik.betasplit
+double betaSplitMLE(const std::vector<int> &splitSizes,
+                    const std::vector<int> &cladeSizes){
+    if(cladeSizes.empty())
+        return NAN;
+    const double invPhi = (std::sqrt(5.0) - 1.0) / 2.0;
+    double lower = -2.0, upper = 10.0;
+    double x1 = upper - invPhi * (upper - lower);
+    double x2 = lower + invPhi * (upper - lower);
+    double f1 = betaSplitLogLik(splitSizes, cladeSizes, x1);
+    double f2 = betaSplitLogLik(splitSizes, cladeSizes, x2);
+    while(upper - lower > 1e-6){
+        if(f1 > f2){
+            upper = x2;
+            x2 = x1;
+            f2 = f1;
+            x1 = upper - invPhi * (upper - lower);
+            f1 = betaSplitLogLik(splitSizes, cladeSizes, x1);
+        }
+        else{
+            lower = x1;
+            x1 = x2;
+            f1 = f2;
+            x2 = lower + invPhi * (upper - lower);
+            f2 = betaSplitLogLik(splitSizes, cladeSizes, x2);
+        }
+    }
+    return (lower + upper) / 2.0;
+}
+
+TreeShapeStats calculateTreeShapeStats(const std::vector<int> &anc,
+                                       const std::vector<int> &des,
+                                       const std::vector<double> &brlens,
+                                       int numTips){
+    TreeShapeStats stats;
+    if(anc.empty()){
+        stats.colless = stats.sackin = stats.cherries = stats.b1 = 0.0;
+        stats.beta = stats.gamma = NAN;
+        stats.treeDepth = 0.0;
+        stats.meanBranchLength = stats.varBranchLength = NAN;
+        return stats;
+    }
+    int numNodes = 0;
+    for(unsigned e = 0; e < anc.size(); e++)
+        numNodes = std::max(numNodes, std::max(anc[e], des[e]));
+    int rootNode = numTips + 1;
+    std::vector<int> ldes(numNodes + 1, 0), rdes(numNodes + 1, 0);
+    std::vector<double> edgeLength(numNodes + 1, 0.0);
+    for(unsigned e = 0; e < anc.size(); e++){
+        if(ldes[anc[e]] == 0)
+            ldes[anc[e]] = des[e];
+        else
+            rdes[anc[e]] = des[e];
+        edgeLength[des[e]] = brlens[e];
+    }
+    // nodes from the root down, read backwards this is a postorder
+    std::vector<int> preorder(1, rootNode);
+    preorder.reserve(numNodes);
+    for(unsigned k = 0; k < preorder.size(); k++){
+        int n = preorder[k];
+        if(ldes[n] != 0){
+            preorder.push_back(ldes[n]);
+            preorder.push_back(rdes[n]);
+        }
+    }
+
+    std::vector<int> numTipsBelow(numNodes + 1, 1), edgesToTip(numNodes + 1, 0);
+    std::vector<double> rootDist(numNodes + 1, 0.0);
+    std::vector<int> splitSizes, cladeSizes;
+    stats.colless = 0.0;
+    stats.sackin = 0.0;
+    stats.cherries = 0.0;
+    stats.b1 = 0.0;
+    for(auto it = preorder.rbegin(); it != preorder.rend(); ++it){
+        int n = *it;
+        if(ldes[n] == 0)
+            continue;
+        int l = ldes[n], r = rdes[n];
+        numTipsBelow[n] = numTipsBelow[l] + numTipsBelow[r];
+        edgesToTip[n] = 1 + std::max(edgesToTip[l], edgesToTip[r]);
+        stats.colless += std::abs(numTipsBelow[l] - numTipsBelow[r]);
+        stats.sackin += numTipsBelow[n];
+        if(ldes[l] == 0 && ldes[r] == 0)
+            stats.cherries += 1.0;
+        if(n != rootNode)
+            stats.b1 += 1.0 / edgesToTip[n];
+        if(numTipsBelow[n] > 2){
+            cladeSizes.push_back(numTipsBelow[n]);
+            splitSizes.push_back(numTipsBelow[l]);
+        }
+    }
+    for(auto n : preorder){
+        if(ldes[n] != 0){
+            rootDist[ldes[n]] = rootDist[n] + edgeLength[ldes[n]];
+            rootDist[rdes[n]] = rootDist[n] + edgeLength[rdes[n]];
+        }
+    }
+    stats.treeDepth = 0.0;
+    for(auto n : preorder)
+        stats.treeDepth = std::max(stats.treeDepth, rootDist[n]);
+    stats.beta = betaSplitMLE(splitSizes, cladeSizes);
+
+    // gamma statistic of Pybus and Harvey (2000) computed as in ape::gammaStat
+    stats.gamma = NAN;
+    if(numTips > 2){
+        std::vector<double> branchingTimes;
+        for(auto n : preorder)
+            if(ldes[n] != 0)
+                branchingTimes.push_back(stats.treeDepth - rootDist[n]);
+        std::sort(branchingTimes.begin(), branchingTimes.end());
+        int N = numTips;
+        // internode intervals from the root down, g[k] has k + 2 lineages
+        std::vector<double> g(branchingTimes.size());
+        for(unsigned k = 0; k < g.size(); k++){
+            unsigned j = g.size() - 1 - k;
+            g[k] = (j == 0) ? branchingTimes[0] : branchingTimes[j] - branchingTimes[j - 1];
+        }
+        double ST = 0.0;
+        for(int k = 0; k < N - 1; k++)
+            ST += (k + 2) * g[k];
+        double cumT = 0.0, sumT = 0.0;
+        for(int k = 0; k < N - 2; k++){
+            cumT += (k + 2) * g[k];
+            sumT += cumT;
+        }
+        stats.gamma = (sumT / (N - 2.0) - ST / 2.0) / (ST * std::sqrt(1.0 / (12.0 * (N - 2.0))));
+    }
+
+    double sum = 0.0, sumSq = 0.0;
+    for(auto bl : brlens)
+        sum += bl;
+    stats.meanBranchLength = brlens.empty() ? NAN : sum / brlens.size();
+    for(auto bl : brlens)
+        sumSq += (bl - stats.meanBranchLength) * (bl - stats.meanBranchLength);
+    stats.varBranchLength = brlens.size() < 2 ? NAN : sumSq / (brlens.size() - 1.0);
+    return stats;
+}
@@ -0,0 +1,37 @@
+//
+//  TreeStats.h
+//  treeducken
+//
+//  Tree shape and branch length summaries of a rooted binary tree given as an
+//  ape style edge list (tips 1..numTips, root numTips + 1).
+//
+
+#ifndef TreeStats_h
+#define TreeStats_h
+
+#include <vector>
+
+struct TreeShapeStats
+{
+    double colless;
+    double sackin;
+    double cherries;
+    double b1;
+    double beta;
+    double gamma;
+    double treeDepth;
+    double meanBranchLength;
+    double varBranchLength;
+};
+
+TreeShapeStats calculateTreeShapeStats(const std::vector<int> &anc,
+                                       const std::vector<int> &des,
+                                       const std::vector<double> &brlens,
+                                       int numTips);
+double betaSplitLogLik(const std::vector<int> &splitSizes,
+                       const std::vector<int> &cladeSizes,
+                       double beta);
+double betaSplitMLE(const std::vector<int> &splitSizes,
+                    const std::vector<int> &cladeSizes);
+
+#endif /* TreeStats_h */
@@ -0,0 +1,201 @@
+//
+//  TreeWriter.cpp
+//  treeducken
+//
+
+#include "TreeWriter.h"
+#include <zlib.h>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+static const double powersOfTen[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+    1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18};
+
+// Scales x to an integer of precision digits and writes that instead of going
+// through printf. Exponents that %g would print in scientific notation and
+// values too close to a rounding tie to round reliably in doubles are left to
+// snprintf.
+void appendDouble(double x, int precision, std::string &out){
+    double ax = std::fabs(x);
+    if(precision >= 1 && precision <= 15 && ax >= 1e-4 && ax < 1e15){
+        int e = (int) std::floor(std::log10(ax));
+        double scaled = 0.0;
+        // log10 may be one off next to powers of ten
+        for(int tries = 0; tries < 2; tries++){
+            int k = precision - 1 - e;
+            scaled = k >= 0 ? ax * powersOfTen[k] : ax / powersOfTen[-k];
+            if(scaled >= powersOfTen[precision])
+                e++;
+            else if(scaled < powersOfTen[precision - 1])
+                e--;
+            else
+                break;
+        }
+        double whole = std::floor(scaled);
+        double frac = scaled - whole;
+        if(whole >= powersOfTen[precision - 1] && whole < powersOfTen[precision]
+           && std::fabs(frac - 0.5) > scaled * 4.5e-16){
+            uint64_t digits = (uint64_t) whole + (frac > 0.5 ? 1 : 0);
+            if(digits == (uint64_t) powersOfTen[precision]){
+                digits /= 10;
+                e++;
+            }
+            if(e < precision){
+                char buf[24];
+                for(int i = precision - 1; i >= 0; i--){
+                    buf[i] = (char) ('0' + digits % 10);
+                    digits /= 10;
+                }
+                int numDigits = precision;
+                while(numDigits > 1 && numDigits > e + 1 && buf[numDigits - 1] == '0')
+                    numDigits--;
+                if(x < 0)
+                    out.push_back('-');
+                if(e >= 0){
+                    out.append(buf, e + 1);
+                    if(numDigits > e + 1){
+                        out.push_back('.');
+                        out.append(buf + e + 1, numDigits - e - 1);
+                    }
+                }
+                else{
+                    out.append("0.");
+                    out.append(-e - 1, '0');
+                    out.append(buf, numDigits);
+                }
+                return;
+            }
+        }
+    }
+    char buf[32];
+    int len = std::snprintf(buf, sizeof(buf), "%.*g", precision, x);
+    out.append(buf, len);
+}
+
+NewickWriter::NewickWriter(int p){
+    precision = p;
+}
+
+// labels with Newick punctuation are single quoted
+void NewickWriter::appendLabel(const std::string &label, std::string &out){
+    if(label.find_first_of(" \t()[]':;,") == std::string::npos){
+        out.append(label);
+        return;
+    }
+    out.push_back('\'');
+    for(char c : label){
+        if(c == '\'')
+            out.push_back('\'');
+        out.push_back(c);
+    }
+    out.push_back('\'');
+}
+
+void NewickWriter::append(Tree &tree, std::string &out){
+    stack.clear();
+    stack.push_back(std::make_pair(tree.getRoot().get(), 0));
+    while(!(stack.empty())){
+        Node *p = stack.back().first;
+        Node *children[2];
+        int numChildren = 0;
+        if(p->getLdes())
+            children[numChildren++] = p->getLdes().get();
+        if(p->getRdes())
+            children[numChildren++] = p->getRdes().get();
+        int next = stack.back().second;
+        if(next < numChildren){
+            out.push_back(next == 0 ? '(' : ',');
+            stack.back().second++;
+            stack.push_back(std::make_pair(children[next], 0));
+            continue;
+        }
+        if(numChildren == 0)
+            appendLabel(p->getName(), out);
+        else{
+            out.push_back(')');
+            if(p->getIsDuplication())
+                appendLabel(p->getName(), out);
+        }
+        if(stack.size() > 1){
+            out.push_back(':');
+            appendDouble(p->getBranchLength(), precision, out);
+        }
+        else{
+            double rootEdge = tree.getRootEdge();
+            if(rootEdge != 0.0){
+                out.push_back(':');
+                appendDouble(rootEdge, precision, out);
+            }
+        }
+        stack.pop_back();
+    }
+    out.append(";\n");
+}
+
+void NewickWriter::appendNexus(Tree &tree, const std::string &name, std::string &out){
+    out.append("\tTREE ");
+    appendLabel(name, out);
+    out.append(" = [&R] ");
+    append(tree, out);
+}
+
+TreeFile::TreeFile(const std::string &p, bool n){
+    path = p;
+    nexus = n;
+    file = nullptr;
+    gz = nullptr;
+    gzipped = path.size() > 3 && path.compare(path.size() - 3, 3, ".gz") == 0;
+    if(gzipped)
+        gz = gzopen(path.c_str(), "wb");
+    else
+        file = std::fopen(path.c_str(), "wb");
+    if(file == nullptr && gz == nullptr)
+        throw std::runtime_error("could not open '" + path + "' for writing");
+    if(nexus)
+        buffer.append("#NEXUS\nBEGIN TREES;\n");
+}
+
+TreeFile::~TreeFile(){
+    // close() reports errors, here they can only be dropped
+    if(file != nullptr)
+        std::fclose(file);
+    if(gz != nullptr)
+        gzclose(gz);
+}
+
+void TreeFile::writeBuffer(){
+    if(buffer.empty())
+        return;
+    bool ok;
+    if(gzipped)
+        ok = gzwrite(gz, buffer.data(), (unsigned) buffer.size()) == (int) buffer.size();
+    else
+        ok = std::fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+    buffer.clear();
+    if(!ok)
+        throw std::runtime_error("could not write to '" + path + "'");
+}
+
+void TreeFile::write(const std::string &text){
+    buffer.append(text);
+    if(buffer.size() >= (1 << 20))
+        writeBuffer();
+}
+
+void TreeFile::close(){
+    if(nexus)
+        buffer.append("END;\n");
+    writeBuffer();
+    bool ok;
+    if(gzipped){
+        ok = gzclose(gz) == Z_OK;
+        gz = nullptr;
+    }
+    else{
+        ok = std::fclose(file) == 0;
+        file = nullptr;
+    }
+    if(!ok)
+        throw std::runtime_error("could not write to '" + path + "'");
+}
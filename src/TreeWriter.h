@@ -0,0 +1,65 @@
+//
+//  TreeWriter.h
+//  treeducken
+//
+//  Newick and NEXUS text of any Tree (species, locus, gene or symbiont trees)
+//  and tree files that are written in large blocks, gzip compressed when the
+//  file name ends in ".gz".
+//
+
+#ifndef TreeWriter_h
+#define TreeWriter_h
+
+#include "Tree.h"
+#include <string>
+#include <vector>
+#include <cstdio>
+
+struct gzFile_s;
+
+// appends x with precision significant digits, the same text as printf's %.*g
+void appendDouble(double x, int precision, std::string &out);
+
+class NewickWriter
+{
+    private:
+        int     precision;
+        // (node, children written so far), kept between trees
+        std::vector<std::pair<Node*, int> > stack;
+
+        void    appendLabel(const std::string &label, std::string &out);
+
+    public:
+                NewickWriter(int precision = 10);
+        // appends the Newick text of the tree below its root with the
+        // terminating ';' and a newline, internal nodes that are duplications
+        // are labelled with their names
+        void    append(Tree &tree, std::string &out);
+        // a TREE line of a NEXUS trees block
+        void    appendNexus(Tree &tree, const std::string &name, std::string &out);
+};
+
+class TreeFile
+{
+    private:
+        std::string path;
+        bool        nexus;
+        bool        gzipped;
+        FILE        *file;
+        gzFile_s    *gz;
+        std::string buffer;
+
+        void        writeBuffer();
+
+    public:
+                    TreeFile(const std::string &path, bool nexus = false);
+                    TreeFile(const TreeFile&) = delete;
+                    ~TreeFile();
+        // text of one tree from NewickWriter::append or appendNexus
+        void        write(const std::string &text);
+        // finishes the NEXUS block and closes the file, throws if anything
+        // could not be written
+        void        close();
+};
+
+#endif /* TreeWriter_h */
@@ -1,29 +1,214 @@
 #include <iostream>
 #include <string>
-#include "SpeciesTree.h"
-#include "Simulator.h"
+#include "Treeducken.h"
 #include <sstream> 
-#include <RcppArmadillo.h>
 
 using namespace Rcpp;
 
+uint64_t drawSeedFromR(){
+    uint64_t hi = (uint64_t) (unif_rand() * 4294967296.0);
+    uint64_t lo = (uint64_t) (unif_rand() * 4294967296.0);
+    return (hi << 32) | lo;
+}
+
+std::shared_ptr<Rng> rngFromR(){
+    return std::make_shared<Rng>(drawSeedFromR());
+}
+
+// R_CheckUserInterrupt jumps out of R_ToplevelExec rather than out of the
+// simulation, which then stops on its own and frees what it made
+static void checkInterrupt(void *){
+    R_CheckUserInterrupt();
+}
+
+std::shared_ptr<Cancellation> cancellationFromR(){
+    return std::make_shared<Cancellation>([](){
+        return !R_ToplevelExec(checkInterrupt, nullptr);
+    });
+}
+
+Rcpp::NumericMatrix edgesToR(const EdgeMatrix &edges){
+    int numRows = edges.anc.size();
+    NumericMatrix edgeMat(numRows, 2);
+    for(int i = 0; i < numRows; i++){
+        edgeMat(i, 0) = edges.anc[i];
+        edgeMat(i, 1) = edges.des[i];
+    }
+    return edgeMat;
+}
+
+EdgeMatrix edgesFromR(Rcpp::NumericMatrix edgeMat){
+    EdgeMatrix edges;
+    int numRows = edgeMat.nrow();
+    edges.anc.resize(numRows);
+    edges.des.resize(numRows);
+    for(int i = 0; i < numRows; i++){
+        edges.anc[i] = edgeMat(i, 0);
+        edges.des[i] = edgeMat(i, 1);
+    }
+    return edges;
+}
+
+// Implicit converter from R tree object (ala APE) into C++ tree class
+std::shared_ptr<SpeciesTree> speciesTreeFromR(Rcpp::List tree){
+    Rcpp::NumericMatrix edge_mat = tree["edge"];
+    std::vector<double> edge_lengths = tree["edge.length"];
+    std::vector<std::string> tip_names = tree["tip.label"];
+    double root_edge = tree["root.edge"];
+    int nnode = tree["Nnode"];
+    return std::shared_ptr<SpeciesTree>(new SpeciesTree(edgesFromR(edge_mat),
+                                                        edge_lengths,
+                                                        tip_names,
+                                                        nnode,
+                                                        root_edge));
+}
+
+Rcpp::List phyloToR(const PhyloTree &tree){
+    List phy = List::create(Named("edge") = edgesToR(tree.edges),
+                            Named("edge.length") = tree.edgeLengths,
+                            Named("Nnode") = tree.numInternal,
+                            Named("tip.label") = tree.tipNames,
+                            Named("root.edge") = tree.rootEdge);
+    if(!(tree.nodeLabels.empty()))
+        phy["node.label"] = tree.nodeLabels;
+    phy.attr("class") = "phylo";
+    return phy;
+}
+
+std::string filePathFromR(SEXP file){
+    if(Rf_isNull(file))
+        return "";
+    if(TYPEOF(file) != STRSXP || Rf_length(file) != 1)
+        stop("'file' must be NULL or a single file path");
+    return R_ExpandFileName(CHAR(STRING_ELT(file, 0)));
+}
+
+TreeOutput treeOutputFromR(SEXP file, std::string format, int precision){
+    TreeOutput output;
+    if(format == "newick")
+        output.format = NewickFormat;
+    else if(format == "nexus")
+        output.format = NexusFormat;
+    else if(format == "binary")
+        output.format = BinaryFormat;
+    else
+        stop("'format' must be \"newick\", \"nexus\" or \"binary\"");
+    if(precision < 1 || precision > 17)
+        stop("'precision' must be between 1 and 17");
+    output.precision = precision;
+    output.path = filePathFromR(file);
+    if(output.format == BinaryFormat && output.path.size() > 3
+       && output.path.compare(output.path.size() - 3, 3, ".gz") == 0)
+        stop("binary tree archives can not be gzip compressed");
+    return output;
+}
+
+Rcpp::List simulationStatsToR(const SimulationStats &stats){
+    NumericVector events(SimulationStats::NumEvents);
+    CharacterVector eventNames(SimulationStats::NumEvents);
+    for(int e = 0; e < SimulationStats::NumEvents; e++){
+        events[e] = stats.getEventCount(static_cast<SimulationStats::Event>(e));
+        eventNames[e] = SimulationStats::getEventName(static_cast<SimulationStats::Event>(e));
+    }
+    events.attr("names") = eventNames;
+    NumericVector seconds(SimulationStats::NumPhases);
+    CharacterVector phaseNames(SimulationStats::NumPhases);
+    for(int p = 0; p < SimulationStats::NumPhases; p++){
+        seconds[p] = stats.getPhaseSeconds(static_cast<SimulationStats::Phase>(p));
+        phaseNames[p] = SimulationStats::getPhaseName(static_cast<SimulationStats::Phase>(p));
+    }
+    seconds.attr("names") = phaseNames;
+    return List::create(Named("events") = events,
+                        Named("attempts") = (double) stats.getAttempts(),
+                        Named("rejections") = (double) stats.getRejections(),
+                        Named("nodes_allocated") = (double) stats.getNodesAllocated(),
+                        Named("phase_seconds") = seconds);
+}
+
+SEXP withSimulationStats(SEXP result, std::shared_ptr<SimulationStats> stats){
+    if(!stats)
+        return result;
+    RObject res(result);
+    res.attr("sim_stats") = simulationStatsToR(*stats);
+    return res;
+}
 
-Rcpp::List bdsim_species_tree(double sbr,
+// The file a simulation writes its trees to, in any of the formats. Binary
+// archives store branch lengths as floats when no more than 7 significant
+// digits are asked for.
+class TreeOutputFile
+{
+    private:
+        TreeOutput  output;
+        std::unique_ptr<TreeFile>           textFile;
+        std::unique_ptr<TreeArchiveWriter>  archive;
+        NewickWriter    writer;
+        std::string     text;
+
+    public:
+        TreeOutputFile(const TreeOutput &o) : output(o), writer(o.precision){
+            if(output.format == BinaryFormat)
+                archive.reset(new TreeArchiveWriter(output.path, ArchiveTrees));
+            else
+                textFile.reset(new TreeFile(output.path, output.format == NexusFormat));
+        }
+
+        // adds the i-th tree of the simulation
+        void write(Tree &tree, int i){
+            if(archive){
+                archive->add(treeRecord(tree, output.precision <= 7), i);
+                return;
+            }
+            text.clear();
+            if(output.format == NexusFormat)
+                writer.appendNexus(tree, "tree_" + std::to_string(i + 1), text);
+            else
+                writer.append(tree, text);
+            textFile->write(text);
+        }
+
+        void close(){
+            if(archive)
+                archive->close();
+            else
+                textFile->close();
+        }
+};
+
+
+SEXP bdsim_species_tree(double sbr,
                         double sdr,
                         int numbsim,
                         int n_tips,
-                        int gsa_stop){
-
-    List multiphy(numbsim);
+                        int gsa_stop,
+                        const TreeOutput &output,
+                        std::shared_ptr<SimulationStats> stats){
+    RNGScope scope;
+    auto cancellation = cancellationFromR();
+
+    // trees go straight to the file without building phylo objects
+    std::unique_ptr<TreeOutputFile> treeFile;
+    if(!(output.path.empty()))
+        treeFile.reset(new TreeOutputFile(output));
+    List multiphy(treeFile ? 0 : numbsim);
+    // one simulator runs every replicate and reuses the trees of the last one
+    std::shared_ptr<Simulator> phySimulator = std::shared_ptr<Simulator>(new Simulator(n_tips,
+                                                                                        sbr,
+                                                                                        sdr,
+                                                                                        1));
+    phySimulator->setGSAStop(gsa_stop);
+    phySimulator->setStats(stats);
+    phySimulator->setCancellation(cancellation);
     for(int i = 0; i < numbsim; i++){
-        std::shared_ptr<Simulator> phySimulator = std::shared_ptr<Simulator>(new Simulator(n_tips,
-                                                                                            sbr,
-                                                                                            sdr,
-                                                                                            1));
-        phySimulator->setGSAStop(gsa_stop);
+        phySimulator->setRng(rngFromR());
         phySimulator->simSpeciesTree();
+        PhaseTimer timer(stats.get(), SimulationStats::Export);
+        if(treeFile){
+            treeFile->write(*(phySimulator->getSpeciesTree()), i);
+            continue;
+        }
 
-        List phy = List::create(Named("edge") = phySimulator->getSpeciesEdges(),
+        List phy = List::create(Named("edge") = edgesToR(phySimulator->getSpeciesEdges()),
                                 Named("edge.length") = phySimulator->getSpeciesEdgeLengths(),
                                 Named("Nnode") = phySimulator->getSpeciesNnodes(),
                                 Named("tip.label") = phySimulator->getSpeciesTipNames(),
@@ -31,7 +216,10 @@ Rcpp::List bdsim_species_tree(double sbr,
         phy.attr("class") = "phylo";
         multiphy[i] = phy;
     }
-
+    if(treeFile){
+        treeFile->close();
+        return wrap(output.path);
+    }
 
     multiphy.attr("class") = "multiPhylo";
 
@@ -39,21 +227,35 @@ Rcpp::List bdsim_species_tree(double sbr,
     return multiphy;
 }
 
-Rcpp::List sim_bdsimple_species_tree(double sbr,
-                                     double sdr,
-                                     int numbsim,
-                                     double timeToSimTo){
-    List multiphy(numbsim);
+SEXP sim_bdsimple_species_tree(double sbr,
+                               double sdr,
+                               int numbsim,
+                               double timeToSimTo,
+                               const TreeOutput &output,
+                               std::shared_ptr<SimulationStats> stats){
+    RNGScope scope;
+    auto cancellation = cancellationFromR();
+    std::unique_ptr<TreeOutputFile> treeFile;
+    if(!(output.path.empty()))
+        treeFile.reset(new TreeOutputFile(output));
+    List multiphy(treeFile ? 0 : numbsim);
+    auto phySimulator = std::shared_ptr<Simulator>(new Simulator(1,
+                                                                  sbr,
+                                                                  sdr,
+                                                                  1));
+    phySimulator->setTimeToSim(timeToSimTo);
+    phySimulator->setStats(stats);
+    phySimulator->setCancellation(cancellation);
     for(int i = 0; i < numbsim; i++){
-
-        auto phySimulator = std::shared_ptr<Simulator>(new Simulator(1,
-                                                                      sbr,
-                                                                      sdr,
-                                                                      1));
-        phySimulator->setTimeToSim(timeToSimTo);
+        phySimulator->setRng(rngFromR());
         phySimulator->simSpeciesTreeTime();
+        PhaseTimer timer(stats.get(), SimulationStats::Export);
+        if(treeFile){
+            treeFile->write(*(phySimulator->getSpeciesTree()), i);
+            continue;
+        }
 
-        List phy = List::create(Named("edge") = phySimulator->getSpeciesEdges(),
+        List phy = List::create(Named("edge") = edgesToR(phySimulator->getSpeciesEdges()),
                                 Named("edge.length") = phySimulator->getSpeciesEdgeLengths(),
                                 Named("Nnode") = phySimulator->getSpeciesNnodes(),
                                 Named("tip.label") = phySimulator->getSpeciesTipNames(),
@@ -61,38 +263,54 @@ Rcpp::List sim_bdsimple_species_tree(double sbr,
         phy.attr("class") = "phylo";
         multiphy[i] = phy;
     }
+    if(treeFile){
+        treeFile->close();
+        return wrap(output.path);
+    }
 
     multiphy.attr("class") = "multiPhylo";
     return multiphy;
 }
 
-Rcpp::List sim_locus_tree(std::shared_ptr<SpeciesTree> species_tree,
-                          double gbr,
-                          double gdr,
-                          double lgtr,
-                          int numbsim,
-                          std::string trans_type){
+// numbsim locus trees along one species tree, they are written to treeFile
+// as trees firstIndex, firstIndex + 1, ... when there is one
+static Rcpp::List simLocusTrees(std::shared_ptr<SpeciesTree> species_tree,
+                                double gbr,
+                                double gdr,
+                                double lgtr,
+                                int numbsim,
+                                const std::string &trans_type,
+                                TreeOutputFile *treeFile,
+                                long firstIndex,
+                                std::shared_ptr<SimulationStats> stats){
     Rcpp::List multiphy;
+    auto cancellation = cancellationFromR();
     int ntax = species_tree->getNumExtant();
     double lambda = 0.0;
     double mu = 0.0;
     double rho = 0.0;
     unsigned numLociToSim = numbsim;
+    auto phySimulator = std::shared_ptr<Simulator>(new Simulator( ntax,
+                                                    lambda,
+                                                    mu,
+                                                    rho,
+                                                    numLociToSim,
+                                                    gbr,
+                                                    gdr,
+                                                    lgtr,
+                                                    trans_type));
+    phySimulator->setSpeciesTree(species_tree);
+    phySimulator->setStats(stats);
+    phySimulator->setCancellation(cancellation);
     for(int i = 0; i < numbsim; i++){
-
-        auto phySimulator = std::shared_ptr<Simulator>(new Simulator( ntax,
-                                                        lambda,
-                                                        mu,
-                                                        rho,
-                                                        numLociToSim,
-                                                        gbr,
-                                                        gdr,
-                                                        lgtr,
-                                                        trans_type));
-        phySimulator->setSpeciesTree(species_tree);
-
+        phySimulator->setRng(rngFromR());
         phySimulator->simLocusTree();
-        List phy = List::create(Named("edge") = phySimulator->getLocusEdges(),
+        PhaseTimer timer(stats.get(), SimulationStats::Export);
+        if(treeFile){
+            treeFile->write(*(phySimulator->getLocusTree()), firstIndex + i);
+            continue;
+        }
+        List phy = List::create(Named("edge") = edgesToR(phySimulator->getLocusEdges()),
                                 Named("edge.length") = phySimulator->getLocusEdgeLengths(),
                                 Named("Nnode") = phySimulator->getLocusNnodes(),
                                 Named("tip.label") = phySimulator->getLocusTipNames(),
@@ -103,12 +321,66 @@ Rcpp::List sim_locus_tree(std::shared_ptr<SpeciesTree> species_tree,
 
         multiphy.push_back(phy);
     }
-    multiphy.attr("class") = "multiPhylo";
-
+    if(!treeFile)
+        multiphy.attr("class") = "multiPhylo";
+    return multiphy;
+}
 
+SEXP sim_locus_tree(std::shared_ptr<SpeciesTree> species_tree,
+                    double gbr,
+                    double gdr,
+                    double lgtr,
+                    int numbsim,
+                    std::string trans_type,
+                    const TreeOutput &output,
+                    std::shared_ptr<SimulationStats> stats){
+    RNGScope scope;
+    std::unique_ptr<TreeOutputFile> treeFile;
+    if(!(output.path.empty()))
+        treeFile.reset(new TreeOutputFile(output));
+    Rcpp::List multiphy = simLocusTrees(species_tree, gbr, gdr, lgtr, numbsim,
+                                        trans_type, treeFile.get(), 0, stats);
+    if(treeFile){
+        treeFile->close();
+        return wrap(output.path);
+    }
     return multiphy;
 }
 
+SEXP sim_locus_tree_file(const std::string &speciesTreeFile,
+                         double gbr,
+                         double gdr,
+                         double lgtr,
+                         int numbsim,
+                         std::string trans_type,
+                         const TreeOutput &output,
+                         std::shared_ptr<SimulationStats> stats){
+    RNGScope scope;
+    TreeReader reader(speciesTreeFile);
+    std::unique_ptr<TreeOutputFile> treeFile;
+    if(!(output.path.empty()))
+        treeFile.reset(new TreeOutputFile(output));
+    std::vector<Rcpp::List> lociPerTree;
+    // only one species tree is held at a time
+    while(auto species_tree = reader.nextSpeciesTree()){
+        long firstIndex = (reader.getNumTrees() - 1) * numbsim;
+        Rcpp::List multiphy = simLocusTrees(species_tree, gbr, gdr, lgtr, numbsim,
+                                            trans_type, treeFile.get(), firstIndex, stats);
+        if(!treeFile)
+            lociPerTree.push_back(multiphy);
+    }
+    if(reader.getNumTrees() == 0)
+        stop("there are no trees in '" + speciesTreeFile + "'");
+    if(treeFile){
+        treeFile->close();
+        return wrap(output.path);
+    }
+    Rcpp::List sets(lociPerTree.size());
+    for(size_t i = 0; i < lociPerTree.size(); i++)
+        sets[i] = lociPerTree[i];
+    return sets;
+}
+
 Rcpp::List sim_locus_tree_gene_tree(std::shared_ptr<SpeciesTree> species_tree,
                                     double gbr,
                                     double gdr,
@@ -116,7 +388,11 @@ Rcpp::List sim_locus_tree_gene_tree(std::shared_ptr<SpeciesTree> species_tree,
                                     int numLoci,
                                     double popsize,
                                     int samples_per_lineage,
-                                    int numGenesPerLocus){
+                                    int numGenesPerLocus,
+                                    int numThreads,
+                                    std::shared_ptr<SimulationStats> stats){
+    RNGScope scope;
+    auto cancellation = cancellationFromR();
     Rcpp::List multiphy;
     int ntax = species_tree->getNumExtant();
     double lambda = 0.0;
@@ -127,26 +403,26 @@ Rcpp::List sim_locus_tree_gene_tree(std::shared_ptr<SpeciesTree> species_tree,
     double ts = 1.0;
     bool sout = false;
     double og = 0.0;
+    auto phySimulator = std::shared_ptr<Simulator>(new Simulator(ntax,
+                                                    lambda,
+                                                    mu,
+                                                    rho,
+                                                    numLociToSim,
+                                                    gbr,
+                                                    gdr,
+                                                    lgtr,
+                                                    samples_per_lineage,
+                                                    popsize,
+                                                    genTime,
+                                                    numGenesPerLocus,
+                                                    og,
+                                                    ts,
+                                                    sout));
+    phySimulator->setSpeciesTree(species_tree);
+    phySimulator->setStats(stats);
+    phySimulator->setCancellation(cancellation);
     for(int i = 0; i < numLoci; i++){
-
-        auto phySimulator = std::shared_ptr<Simulator>(new Simulator(ntax,
-                                                        lambda,
-                                                        mu,
-                                                        rho,
-                                                        numLociToSim,
-                                                        gbr,
-                                                        gdr,
-                                                        lgtr,
-                                                        samples_per_lineage,
-                                                        popsize,
-                                                        genTime,
-                                                        numGenesPerLocus,
-                                                        og,
-                                                        ts,
-                                                        sout));
-
-
-        phySimulator->setSpeciesTree(species_tree);
+        phySimulator->setRng(rngFromR());
         if(gbr + gdr + lgtr > 0.0){
             phySimulator->simLocusTree();
         }
@@ -158,11 +434,12 @@ Rcpp::List sim_locus_tree_gene_tree(std::shared_ptr<SpeciesTree> species_tree,
                                                                                  0.0)));
         }
         List phyGenesPerLoc(numGenesPerLocus);
-
+        // gene trees are simulated together then converted to phylo here on the main thread
+        phySimulator->simGeneTrees(numThreads);
+        PhaseTimer timer(stats.get(), SimulationStats::Export);
         for(int j=0; j<numGenesPerLocus; j++){
-            phySimulator->simGeneTree(j);
 
-            List phyGene = List::create(Named("edge") = phySimulator->getGeneEdges(j),
+            List phyGene = List::create(Named("edge") = edgesToR(phySimulator->getGeneEdges(j)),
                          _("edge.length") = phySimulator->getGeneEdgeLengths(j),
                          _("Nnode") = phySimulator->getGeneNnodes(j),
                          _("tip.label") = phySimulator->getGeneTipNames(j),
@@ -171,7 +448,7 @@ Rcpp::List sim_locus_tree_gene_tree(std::shared_ptr<SpeciesTree> species_tree,
             phyGenesPerLoc[j] = phyGene;
         }
 
-        List phyLoc = List::create(Named("edge") = phySimulator->getLocusEdges(),
+        List phyLoc = List::create(Named("edge") = edgesToR(phySimulator->getLocusEdges()),
                                    Named("edge.length") = phySimulator->getLocusEdgeLengths(),
                                    Named("Nnode") = phySimulator->getLocusNnodes(),
                                    Named("tip.label") = phySimulator->getLocusTipNames(),
@@ -193,7 +470,9 @@ Rcpp::List sim_locus_tree_gene_tree(std::shared_ptr<SpeciesTree> species_tree,
 Rcpp::List sim_genetree_msc(std::shared_ptr<SpeciesTree> species_tree,
                             double popsize,
                             int samples_per_lineage,
-                            int numbsim){
+                            int numbsim,
+                            int numThreads,
+                            std::shared_ptr<SimulationStats> stats){
     return sim_locus_tree_gene_tree(species_tree,
                              0.0,
                              0.0,
@@ -201,6 +480,162 @@ Rcpp::List sim_genetree_msc(std::shared_ptr<SpeciesTree> species_tree,
                              1,
                              popsize,
                              samples_per_lineage,
-                             numbsim);
+                             numbsim,
+                             numThreads,
+                             stats);
     // this one is a wrapper for above function with locus tree parameters set to 0
-}
\ No newline at end of file
+}
+
+Rcpp::List sim_genetree_msc_file(const std::string &speciesTreeFile,
+                                 double popsize,
+                                 bool rescale,
+                                 int samples_per_lineage,
+                                 int numbsim,
+                                 int numThreads,
+                                 std::shared_ptr<SimulationStats> stats){
+    TreeReader reader(speciesTreeFile);
+    std::vector<Rcpp::List> genesPerTree;
+    while(auto species_tree = reader.nextSpeciesTree()){
+        if(rescale)
+            species_tree->scaleTree(popsize);
+        genesPerTree.push_back(sim_genetree_msc(species_tree,
+                                                popsize,
+                                                samples_per_lineage,
+                                                numbsim,
+                                                numThreads,
+                                                stats));
+    }
+    if(reader.getNumTrees() == 0)
+        stop("there are no trees in '" + speciesTreeFile + "'");
+    Rcpp::List sets(genesPerTree.size());
+    for(size_t i = 0; i < genesPerTree.size(); i++)
+        sets[i] = genesPerTree[i];
+    return sets;
+}
+
+static Rcpp::List geneTreeToPhylo(std::shared_ptr<GeneTree> gt){
+    List phyGene = List::create(Named("edge") = edgesToR(gt->getGeneEdges()),
+                                _("edge.length") = gt->getEdgeLengths(),
+                                _("Nnode") = gt->getNnodes(),
+                                _("tip.label") = gt->getTipNames(),
+                                _("root.edge") = gt->getRoot()->getBranchLength());
+    phyGene.attr("class") = "phylo";
+    return phyGene;
+}
+
+// multilocus coalescent on a locus tree (Rasmussen and Kellis 2012)
+// each duplication starts a new locus whose gene tree has to coalesce before
+// the duplication, in every other locus that new locus is a single lineage
+Rcpp::List sim_multilocus_genetrees(std::shared_ptr<LocusTree> locus_tree,
+                                    double popsize,
+                                    int numReps,
+                                    int numThreads){
+    std::vector<std::shared_ptr<Node>> locusNodes = locus_tree->getNodes();
+    std::set<int> coalBounds = locus_tree->getCoalBounds();
+    std::set<std::shared_ptr<Node>> newLoci;
+    std::vector<std::shared_ptr<Node>> childRoots;
+    for(auto dupIndx : coalBounds){
+        std::shared_ptr<Node> newCopy = locus_tree->getNewLocusChild(locusNodes[dupIndx]);
+        newLoci.insert(newCopy);
+        // a new copy that is a single tip has a trivial gene tree
+        if(!(newCopy->getIsTip()))
+            childRoots.push_back(newCopy);
+    }
+    // the parent locus first and then one locus per duplication
+    std::vector<std::shared_ptr<LocusTree>> loci;
+    loci.push_back(locus_tree->getCollapsedSubtree(locus_tree->getRoot(), newLoci));
+    for(auto c : childRoots)
+        loci.push_back(locus_tree->getCollapsedSubtree(c, newLoci));
+
+    int numLociToSim = (int) loci.size();
+    std::vector<std::shared_ptr<Simulator>> simulators(numLociToSim);
+    for(int i = 0; i < numLociToSim; i++){
+        simulators[i] = std::shared_ptr<Simulator>(new Simulator(loci[i]->getNumExtant(),
+                                                                 0.0,
+                                                                 0.0,
+                                                                 1.0,
+                                                                 1,
+                                                                 0.0,
+                                                                 0.0,
+                                                                 0.0,
+                                                                 1,
+                                                                 popsize,
+                                                                 1.0,
+                                                                 numReps,
+                                                                 0.0,
+                                                                 1.0,
+                                                                 false));
+        simulators[i]->setLocusTree(loci[i]);
+        if(i == 0)
+            simulators[i]->prepareCoalescentSim();
+        else
+            simulators[i]->prepareBoundedCoalescentSim();
+    }
+    // seeds are drawn here in order so results do not depend on numThreads
+    RNGScope scope;
+    int numTasks = numLociToSim * numReps;
+    std::vector<uint64_t> seeds(numTasks);
+    for(int k = 0; k < numTasks; k++)
+        seeds[k] = drawSeedFromR();
+    std::vector<std::shared_ptr<GeneTree>> geneTrees(numTasks);
+    auto cancellation = cancellationFromR();
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(numThreads)
+#endif
+    for(int k = 0; k < numTasks; k++){
+        if(cancellation->requested())
+            continue;
+        int i = k / numReps;
+        auto rng = std::make_shared<Rng>(seeds[k]);
+        if(i == 0)
+            geneTrees[k] = simulators[i]->coalescentGeneTree(rng);
+        else
+            geneTrees[k] = simulators[i]->boundedCoalescentGeneTree(rng);
+    }
+    cancellation->check();
+
+    List parentTrees(numReps);
+    for(int j = 0; j < numReps; j++)
+        parentTrees[j] = geneTreeToPhylo(geneTrees[j]);
+    List childTrees(numLociToSim - 1);
+    for(int i = 1; i < numLociToSim; i++){
+        List childGeneTrees(numReps);
+        for(int j = 0; j < numReps; j++)
+            childGeneTrees[j] = geneTreeToPhylo(geneTrees[i * numReps + j]);
+        childTrees[i - 1] = childGeneTrees;
+    }
+    List mlcGeneTrees = List::create(Named("parent_tree") = parentTrees,
+                                     Named("child_trees") = childTrees);
+    if(numLociToSim == 1)
+        mlcGeneTrees["child_trees"] = R_NilValue;
+    mlcGeneTrees.attr("class") = "mlc_genetrees";
+    return mlcGeneTrees;
+}
+
+// replicates of an archive as phylo or cophy objects, replicates are 1-based
+Rcpp::List tree_archive_replicates(const TreeArchive &archive,
+                                   Rcpp::IntegerVector replicates){
+    Rcpp::List out(replicates.size());
+    for(int i = 0; i < replicates.size(); i++){
+        if(replicates[i] == NA_INTEGER || replicates[i] < 1 || replicates[i] > archive.getNumReplicates())
+            stop("subscript out of bounds");
+        long r = replicates[i] - 1;
+        if(archive.getContent() == ArchiveTrees){
+            out[i] = phyloToR(archive.getTree(r));
+            continue;
+        }
+        ArchivedAssociations associations = archive.getAssociations(r);
+        Rcpp::NumericMatrix assocMat(associations.hostNames.size(),
+                                     associations.symbNames.size(),
+                                     associations.assoc.begin());
+        Rcpp::rownames(assocMat) = Rcpp::wrap(associations.hostNames);
+        Rcpp::colnames(assocMat) = Rcpp::wrap(associations.symbNames);
+        Rcpp::List cophy = List::create(Named("host_tree") = phyloToR(archive.getTree(r, 0)),
+                                        Named("symb_tree") = phyloToR(archive.getTree(r, 1)),
+                                        Named("association_mat") = assocMat,
+                                        Named("event_history") = eventLogToR(archive.getEvents(r), {}, {}));
+        cophy.attr("class") = "cophy";
+        out[i] = cophy;
+    }
+    return out;
+}
@@ -0,0 +1,183 @@
+//
+//  Treeducken.h
+//  treeducken
+//
+//  R side of the package. The simulation core (the trees, Simulator and the
+//  classes they use) does not include any R headers so it can be built and
+//  run on its own, everything that turns its results into R objects or
+//  draws from R's generator is declared here and lives in Treeducken.cpp,
+//  Cophylo.cpp and rcpp_treeducken.cpp.
+//
+
+#ifndef Treeducken_h
+#define Treeducken_h
+
+#include <RcppArmadillo.h>
+#include "Simulator.h"
+#include "TreeWriter.h"
+#include "TreeArchive.h"
+#include "TreeReader.h"
+
+enum TreeFormat
+{
+    NewickFormat,
+    NexusFormat,
+    BinaryFormat
+};
+
+// where sim_stBD, sim_stBD_t and sim_ltBD put their trees, they are returned
+// to R as a multiPhylo when path is empty
+struct TreeOutput
+{
+    std::string path;
+    TreeFormat  format;
+    int         precision;
+};
+
+// 64 bit seed for an Rng stream taken from R's generator, this has to be
+// called on the main thread inside an RNGScope
+extern uint64_t drawSeedFromR();
+
+// new stream for a simulation seeded from R's generator
+extern std::shared_ptr<Rng> rngFromR();
+
+// cancelled when the user interrupts R, this has to be made on the main thread
+extern std::shared_ptr<Cancellation> cancellationFromR();
+
+// edge matrix of a phylo object and back
+extern Rcpp::NumericMatrix edgesToR(const EdgeMatrix &edges);
+
+extern EdgeMatrix edgesFromR(Rcpp::NumericMatrix edgeMat);
+
+extern std::shared_ptr<SpeciesTree> speciesTreeFromR(Rcpp::List tree);
+
+// phylo object of a tree read from a file
+extern Rcpp::List phyloToR(const PhyloTree &tree);
+
+// path of a file argument, empty for NULL
+extern std::string filePathFromR(SEXP file);
+
+// checks the file, format and precision arguments of the simulation functions
+extern TreeOutput treeOutputFromR(SEXP file, std::string format, int precision);
+
+// event_history data frame, nodes are turned into ape numbers with
+// hostNumbers and symbNumbers when they are given
+extern Rcpp::DataFrame eventLogToR(const EventLog &eventLog,
+                                   const std::vector<int> &hostNumbers,
+                                   const std::vector<int> &symbNumbers);
+
+extern Rcpp::List associationHistoryToList(const AssociationHistory &hist);
+
+// the sim_stats attribute, a list of the counters and phase times of stats
+extern Rcpp::List simulationStatsToR(const SimulationStats &stats);
+
+// result with stats as its sim_stats attribute, unchanged when stats is null
+extern SEXP withSimulationStats(SEXP result, std::shared_ptr<SimulationStats> stats);
+
+extern Rcpp::List association_history_at(Rcpp::List history, Rcpp::NumericVector times);
+
+extern SEXP bdsim_species_tree(double sbr,
+                               double sdr,
+                               int numbsim,
+                               int n_tips,
+                               int gsa_stop,
+                               const TreeOutput &output,
+                               std::shared_ptr<SimulationStats> stats);
+
+extern SEXP sim_bdsimple_species_tree(double sbr,
+                                      double sdr,
+                                      int numbsim,
+                                      double timeToSimTo,
+                                      const TreeOutput &output,
+                                      std::shared_ptr<SimulationStats> stats);
+
+extern SEXP sim_locus_tree(std::shared_ptr<SpeciesTree> species_tree,
+                           double gbr,
+                           double gdr,
+                           double lgtr,
+                           int numLoci,
+                           std::string trans_type,
+                           const TreeOutput &output,
+                           std::shared_ptr<SimulationStats> stats);
+
+// sim_locus_tree along every tree of a Newick or NEXUS file in turn, the loci
+// of each species tree are one multiPhylo of the list that is returned
+extern SEXP sim_locus_tree_file(const std::string &speciesTreeFile,
+                                double gbr,
+                                double gdr,
+                                double lgtr,
+                                int numLoci,
+                                std::string trans_type,
+                                const TreeOutput &output,
+                                std::shared_ptr<SimulationStats> stats);
+
+extern SEXP sim_host_symb_treepair(double hostbr,
+                                   double hostdr,
+                                   double symbbr,
+                                   double symbdr,
+                                   double switchrate,
+                                   double cosprate,
+                                   double timeToSimTo,
+                                   int host_limit,
+                                   int numbsim,
+                                   bool hsMode,
+                                   bool sparseAssoc,
+                                   int numThreads,
+                                   std::string file,
+                                   std::shared_ptr<SimulationStats> stats,
+                                   bool keepHistory);
+
+extern SEXP sim_host_symb_treepair_ana(double hostbr,
+                                       double hostdr,
+                                       double symbbr,
+                                       double symbdr,
+                                       double symbdispersal,
+                                       double symbextirpation,
+                                       double switchrate,
+                                       double cosprate,
+                                       double timeToSimTo,
+                                       int host_limit,
+                                       int numbsim,
+                                       bool hsMode,
+                                       int numThreads,
+                                       std::string file,
+                                       std::shared_ptr<SimulationStats> stats,
+                                       bool keepHistory);
+
+extern Rcpp::List sim_locus_tree_gene_tree(std::shared_ptr<SpeciesTree> species_tree,
+                                           double gbr,
+                                           double gdr,
+                                           double lgtr,
+                                           int numLoci,
+                                           double popsize,
+                                           int samples_per_lineage,
+                                           int numGenesPerLocus,
+                                           int numThreads,
+                                           std::shared_ptr<SimulationStats> stats);
+
+extern Rcpp::List sim_genetree_msc(std::shared_ptr<SpeciesTree> species_tree,
+                                   double popsize,
+                                   int samples_per_lineage,
+                                   int numbsim,
+                                   int numThreads,
+                                   std::shared_ptr<SimulationStats> stats);
+
+// sim_genetree_msc along every tree of a file, rescaled by popsize if asked
+extern Rcpp::List sim_genetree_msc_file(const std::string &speciesTreeFile,
+                                        double popsize,
+                                        bool rescale,
+                                        int samples_per_lineage,
+                                        int numbsim,
+                                        int numThreads,
+                                        std::shared_ptr<SimulationStats> stats);
+
+extern Rcpp::List sim_multilocus_genetrees(std::shared_ptr<LocusTree> locus_tree,
+                                           double popsize,
+                                           int numReps,
+                                           int numThreads);
+
+// a tree_archive object reads its replicates from this
+extern Rcpp::List tree_archive_replicates(const TreeArchive &archive,
+                                          Rcpp::IntegerVector replicates);
+
+#endif /* Treeducken_h */
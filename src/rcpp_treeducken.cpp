@@ -1,5 +1,39 @@
-#include "Simulator.h"
+#include "Treeducken.h"
 #include <string.h>
+#include <fstream>
+#include "SequenceSimulator.h"
+#include "TreeStats.h"
+#include "ParaFit.h"
+#include "TreeDistances.h"
+#include "Abc.h"
+
+using namespace Rcpp;
+
+// path of a file of species trees given as species_tree
+static std::string speciesTreePathFromR(SEXP species_tree){
+    if(Rf_length(species_tree) != 1)
+        stop("species_tree must be an object of class 'phylo' or a single file path");
+    return R_ExpandFileName(CHAR(STRING_ELT(species_tree, 0)));
+}
+
+// runs one of the simulations, a cancellation after a user interrupt is
+// passed back to R as that interrupt
+template <typename Simulation>
+static SEXP runSimulation(Simulation simulate, std::shared_ptr<SimulationStats> stats){
+    try{
+        return withSimulationStats(simulate(), stats);
+    }
+    catch(SimulationCancelled &){
+        throw Rcpp::internal::InterruptedException();
+    }
+}
+
+// counters for the sim_stats argument, null when they are not asked for
+static std::shared_ptr<SimulationStats> simulationStatsFromR(bool sim_stats){
+    if(!sim_stats)
+        return nullptr;
+    return std::make_shared<SimulationStats>();
+}
 
 //' Simulates species trees using constant rate birth-death process
 //'
@@ -11,7 +45,26 @@
 //' @param numbsim number of species trees to simulate
 //' @param n_tips number of tips to simulate to
 //' @param gsa_stop_mult number of tips to simulate the GSA tip to
-//' @return List of objects of the tree class (as implemented in APE)
+//' @param file `NULL` to return the trees, otherwise the path of a file to
+//'     write them to (gzip compressed if it ends in ".gz")
+//' @param format format of `file`, "newick", "nexus" or "binary" (a tree
+//'     archive to read with `read_tree_archive`)
+//' @param precision significant digits of the branch lengths in `file`, binary
+//'     archives store them as single precision floats at 7 or less
+//' @param sim_stats if `TRUE` the result gets a `sim_stats` attribute that
+//'     describes how the simulation went (see Value)
+//' @return List of objects of the tree class (as implemented in APE). If
+//'     `file` is given the trees are written to it as they are simulated,
+//'     without making R objects, and the path is returned instead.
+//'
+//'     With `sim_stats = TRUE` the result has a `sim_stats` attribute, a list
+//'     of `events` (the number of each type of event, those of rejected
+//'     attempts included), `attempts` and `rejections` (tries at a tree and
+//'     how many of them were thrown away, say because every lineage went
+//'     extinct), `nodes_allocated` and `phase_seconds` (wall time spent
+//'     simulating, reconstructing GSA trees, setting up and running the
+//'     coalescent and exporting the results). The counts are only made when
+//'     asked for.
 //' @references
 //' K. Hartmann, D. Wong, T. Stadler. Sampling trees from evolutionary models.
 //'     Syst. Biol., 59(4): 465-476, 2010.
@@ -31,12 +84,23 @@
 //'                 sdr = mu,
 //'                 numbsim = numb_replicates,
 //'                 n_tips = numb_extant_tips)
+//'
+//' # write the trees straight to a gzip compressed Newick file instead
+//' tree_file <- sim_stBD(sbr = lambda,
+//'                 sdr = mu,
+//'                 numbsim = numb_replicates,
+//'                 n_tips = numb_extant_tips,
+//'                 file = tempfile(fileext = ".tre.gz"))
 // [[Rcpp::export]]
-Rcpp::List sim_stBD(SEXP sbr,
-                          SEXP sdr,
-                          SEXP numbsim,
-                          Rcpp::NumericVector n_tips,
-                          Rcpp::NumericVector gsa_stop_mult = 10){
+SEXP sim_stBD(SEXP sbr,
+              SEXP sdr,
+              SEXP numbsim,
+              Rcpp::NumericVector n_tips,
+              Rcpp::NumericVector gsa_stop_mult = 10,
+              SEXP file = R_NilValue,
+              std::string format = "newick",
+              int precision = 10,
+              bool sim_stats = false){
     double sbr_ = as<double>(sbr);
     double sdr_ = as<double>(sdr);
     unsigned numbsim_ = as<int>(numbsim);
@@ -56,7 +120,11 @@ Rcpp::List sim_stBD(SEXP sbr,
         stop("'n_tips' must be greater than 1.");
     if(gsa_stop_ < 1)
         stop("'gsa_stop_mult' must be greater than 1.");
-    return bdsim_species_tree(sbr_, sdr_, numbsim_, n_tips_, gsa_stop);
+    TreeOutput output = treeOutputFromR(file, format, precision);
+    auto stats = simulationStatsFromR(sim_stats);
+    return runSimulation([&](){ return bdsim_species_tree(sbr_, sdr_, numbsim_, n_tips_,
+                                                          gsa_stop, output, stats); },
+                         stats);
 }
 //' Simulates species tree using constant rate birth-death process to a time
 //'
@@ -65,7 +133,17 @@ Rcpp::List sim_stBD(SEXP sbr,
 //' @param sdr species death rate (i.e. extinction rate)
 //' @param numbsim number of species trees to simulate
 //' @param t time to simulate to
-//' @return List of objects of the tree class (as implemented in APE)
+//' @param file `NULL` to return the trees, otherwise the path of a file to
+//'     write them to (gzip compressed if it ends in ".gz")
+//' @param format format of `file`, "newick", "nexus" or "binary" (a tree
+//'     archive to read with `read_tree_archive`)
+//' @param precision significant digits of the branch lengths in `file`, binary
+//'     archives store them as single precision floats at 7 or less
+//' @param sim_stats if `TRUE` the result gets a `sim_stats` attribute that
+//'     describes how the simulation went, see `sim_stBD`
+//' @return List of objects of the tree class (as implemented in APE). If
+//'     `file` is given the trees are written to it as they are simulated,
+//'     without making R objects, and the path is returned instead.
 //' @references
 //' K. Hartmann, D. Wong, T. Stadler. Sampling trees from evolutionary models.
 //'     Syst. Biol., 59(4): 465-476, 2010.
@@ -83,7 +161,14 @@ Rcpp::List sim_stBD(SEXP sbr,
 //'                 numbsim = numb_replicates,
 //'                 t = time)
 // [[Rcpp::export]]
-Rcpp::List sim_stBD_t(SEXP sbr, SEXP sdr, SEXP numbsim, SEXP t){
+SEXP sim_stBD_t(SEXP sbr,
+                SEXP sdr,
+                SEXP numbsim,
+                SEXP t,
+                SEXP file = R_NilValue,
+                std::string format = "newick",
+                int precision = 10,
+                bool sim_stats = false){
     double sbr_ = as<double>(sbr);
     double sdr_ = as<double>(sdr);
     unsigned numbsim_ = as<int>(numbsim);
@@ -98,20 +183,38 @@ Rcpp::List sim_stBD_t(SEXP sbr, SEXP sdr, SEXP numbsim, SEXP t){
         stop("'sdr' must be 0.0 or greater.");
     if(t_ <= 0.0)
         stop("'t' must be greater than 0.");
-    return sim_bdsimple_species_tree(sbr_, sdr_, numbsim_, t_);
+    TreeOutput output = treeOutputFromR(file, format, precision);
+    auto stats = simulationStatsFromR(sim_stats);
+    return runSimulation([&](){ return sim_bdsimple_species_tree(sbr_, sdr_, numbsim_, t_,
+                                                                 output, stats); },
+                         stats);
 }
 //' Simulates locus tree using constant rate birth-death-transfer process
 //'
 //' @description Given a species tree simulates a locus or gene family tree along
 //'     the species tree. Short for simulates a locus tree under a birth-death-transfer
 //'     process.
-//' @param species_tree species tree to simulate along
+//' @param species_tree species tree to simulate along, an object of class
+//'     "phylo" or the path of a Newick or NEXUS file (gzip compressed or not)
+//'     whose trees are simulated along one after the other
 //' @param gbr gene birth rate
 //' @param gdr gene death rate
 //' @param lgtr gene transfer rate
 //' @param num_loci number of locus trees to simulate
 //' @param transfer_type The type of transfer input. Acceptable options: "cladewise" or "random"
-//' @return List of objects of the tree class (as implemented in APE)
+//' @param file `NULL` to return the trees, otherwise the path of a file to
+//'     write them to (gzip compressed if it ends in ".gz")
+//' @param format format of `file`, "newick", "nexus" or "binary" (a tree
+//'     archive to read with `read_tree_archive`)
+//' @param precision significant digits of the branch lengths in `file`, binary
+//'     archives store them as single precision floats at 7 or less
+//' @param sim_stats if `TRUE` the result gets a `sim_stats` attribute that
+//'     describes how the simulation went, see `sim_stBD`
+//' @return List of objects of the tree class (as implemented in APE). If
+//'     `file` is given the trees are written to it as they are simulated,
+//'     without making R objects, and the path is returned instead. When
+//'     `species_tree` is a file the list has one such list of `num_loci`
+//'     locus trees for each of its trees, or `file` has all of them in order.
 //' @details Given a species tree will perform a birth-death process coupled with transfer.
 //' The simulation runs along the species tree speciating and going extinct in addition to locus tree birth and deaths.
 //' Thus with parameters set to 0.0 a tree identical to the species tree is returned (it is relabel however).
@@ -121,6 +224,10 @@ Rcpp::List sim_stBD_t(SEXP sbr, SEXP sdr, SEXP numbsim, SEXP t){
 //' At present, two types of transfers are implemented: "random" an "cladewise".
 //' The random transfer mode transfers one randomly chooses a contemporaneous lineage.
 //' Cladewise transfers choose lineages based on relatedness with more closely related lineages being more likely.
+//'
+//' Species trees in a file are read one at a time as they are needed, so a
+//' large sample of species trees (say, from a posterior distribution) does not
+//' have to be read into R first. Every branch of these trees needs a length.
 //' @references
 //' Rasmussen MD, Kellis M. Unified modeling of gene duplication, loss, and
 //'     coalescence using a locus tree. Genome Res. 2012;22(4):755–765.
@@ -148,13 +255,25 @@ Rcpp::List sim_stBD_t(SEXP sbr, SEXP sdr, SEXP numbsim, SEXP t){
 //'                   gdr = gene_dr,
 //'                   lgtr = transfer_rate,
 //'                   num_loci = 10)
+//'
+//' # or along every tree of a Newick or NEXUS file
+//' gophers <- system.file("extdata", "gophers_bd.tre", package = "treeducken")
+//' sim_ltBD(species_tree = gophers,
+//'          gbr = gene_br,
+//'          gdr = gene_dr,
+//'          lgtr = transfer_rate,
+//'          num_loci = 2)
 // [[Rcpp::export]]
-Rcpp::List sim_ltBD(Rcpp::List species_tree,
-                             SEXP gbr,
-                             SEXP gdr,
-                             SEXP lgtr,
-                             SEXP num_loci,
-                             Rcpp::String transfer_type = "random"){
+SEXP sim_ltBD(SEXP species_tree,
+              SEXP gbr,
+              SEXP gdr,
+              SEXP lgtr,
+              SEXP num_loci,
+              Rcpp::String transfer_type = "random",
+              SEXP file = R_NilValue,
+              std::string format = "newick",
+              int precision = 10,
+              bool sim_stats = false){
     RNGScope scope;
     double gbr_ = as<double>(gbr);
     double gdr_ = as<double>(gdr);
@@ -175,14 +294,23 @@ Rcpp::List sim_ltBD(Rcpp::List species_tree,
         stop("'lgtr' must be a positive number or 0.0");
     if(gdr_ < 0.0)
         stop("'gdr' must be greater than or equal to 0.0");
-    if(strcmp(species_tree.attr("class"), "phylo") != 0)
-        stop("species_tree must be an object of class phylo'.");
-
     if(trans_type !=  "cladewise" && trans_type != "random")
         stop("the transfer_type must be set to 'cladewise' or 'random'");
 
-    std::shared_ptr<SpeciesTree> specTree = std::shared_ptr<SpeciesTree>(new SpeciesTree(species_tree));
-    return sim_locus_tree(specTree, gbr_, gdr_, lgtr_, numLoci, trans_type);
+    TreeOutput output = treeOutputFromR(file, format, precision);
+    auto stats = simulationStatsFromR(sim_stats);
+    if(TYPEOF(species_tree) == STRSXP)
+        return runSimulation([&](){ return sim_locus_tree_file(speciesTreePathFromR(species_tree),
+                                                               gbr_, gdr_, lgtr_, numLoci,
+                                                               trans_type, output, stats); },
+                             stats);
+    Rcpp::List species_tree_ = as<Rcpp::List>(species_tree);
+    if(strcmp(species_tree_.attr("class"), "phylo") != 0)
+        stop("species_tree must be an object of class phylo'.");
+    std::shared_ptr<SpeciesTree> specTree = speciesTreeFromR(species_tree_);
+    return runSimulation([&](){ return sim_locus_tree(specTree, gbr_, gdr_, lgtr_, numLoci,
+                                                      trans_type, output, stats); },
+                         stats);
 }
 //' Simulates a host-symbiont system using a cophylogenetic birth-death process
 //'
@@ -207,6 +335,10 @@ Rcpp::List sim_ltBD(Rcpp::List species_tree,
 //'     host. When the option `host_switch_mode = TRUE`, the behavior of this changes to a
 //'     more traditional host switching where one descendant retains the ancestral range and
 //'     the other gains a novel host association.
+//'
+//'     Replicates are simulated in parallel when `num_threads` is greater than 1 and
+//'     treeducken was built with OpenMP. Every replicate gets its own random number stream
+//'     seeded from R's generator so results under `set.seed` do not depend on `num_threads`.
 //' @param hbr host tree birth rate
 //' @param hdr host tree death rate
 //' @param sbr symbiont tree birth rate
@@ -219,9 +351,21 @@ Rcpp::List sim_ltBD(Rcpp::List species_tree,
 //' @param numbsim number of replicates
 //' @param host_limit Maximum number of hosts for symbionts (0 implies no limit)
 //' @param hs_mode Boolean turning host expansion into host switching (explained above) (default = FALSE)
+//' @param num_threads Number of threads to simulate the replicates on (default 1)
+//' @param file `NULL` to return the replicates, otherwise the path of a binary
+//'     tree archive to write them to (see `read_tree_archive`)
+//' @param sim_stats if `TRUE` the result gets a `sim_stats` attribute that
+//'     describes how the simulation went, see `sim_stBD`. Every replicate then
+//'     also has an `event_rates` attribute, a data frame with the time of each
+//'     event and the total rate of each kind of event (`Host`, `Symbiont`,
+//'     `Cospeciation`, `Dispersal` and `Extirpation`) just before it
+//' @param keep_history if `TRUE` every change to the associations is recorded
+//'     in an `association_history` attribute of each replicate so `get_assoc`
+//'     can rebuild the associations at any time (default = FALSE)
 //' @return A list containing the `host_tree`, the `symbiont_tree`, the
 //'     association matrix in the present, with hosts as rows and symbionts as columns, and the history of events that have
-//'     occurred.
+//'     occurred. If `file` is given the replicates are written to it instead
+//'     and the path is returned.
 //' @examples
 //'
 //' host_mu <- 0.5 # death rate
@@ -245,7 +389,7 @@ Rcpp::List sim_ltBD(Rcpp::List species_tree,
 //'                            time_to_sim = time)
 //'
 // [[Rcpp::export]]
-Rcpp::List sim_cophyBD_ana(SEXP hbr,
+SEXP sim_cophyBD_ana(SEXP hbr,
                         SEXP hdr,
                         SEXP sbr,
                         SEXP sdr,
@@ -256,7 +400,11 @@ Rcpp::List sim_cophyBD_ana(SEXP hbr,
                         SEXP time_to_sim,
                         SEXP numbsim,
                         Rcpp::NumericVector host_limit = 0,
-                        Rcpp::LogicalVector hs_mode = false){
+                        Rcpp::LogicalVector hs_mode = false,
+                        Rcpp::IntegerVector num_threads = 1,
+                        SEXP file = R_NilValue,
+                        bool sim_stats = false,
+                        bool keep_history = false){
 
     double hbr_ = as<double>(hbr);
     double hdr_ = as<double>(hdr);
@@ -270,6 +418,7 @@ Rcpp::List sim_cophyBD_ana(SEXP hbr,
     int hl_ = as<int>(host_limit);
     int numbsim_ = as<int>(numbsim);
     bool host_switch_mode_ = as<bool>(hs_mode);
+    int num_threads_ = as<int>(num_threads);
 
     RNGScope scope;
     if(hbr_ < 0.0){
@@ -297,18 +446,26 @@ Rcpp::List sim_cophyBD_ana(SEXP hbr,
         stop("symbiont dispersal cannot be negative");
     if(symb_ext_ < 0.0)
         stop("symbiont extirpation cannot be negative");
-    return sim_host_symb_treepair_ana(hbr_,
-                                  hdr_,
-                                  sbr_,
-                                  sdr_,
-                                  symb_disp_,
-                                  symb_ext_,
-                                  host_exp_rate_,
-                                  cosp_rate_,
-                                  timeToSimTo_,
-                                  hl_,
-                                  numbsim_,
-                                  host_switch_mode_);
+    if(num_threads_ < 1)
+        stop("'num_threads' must be greater than or equal to 1");
+    auto stats = simulationStatsFromR(sim_stats);
+    return runSimulation([&](){ return sim_host_symb_treepair_ana(hbr_,
+                                                                  hdr_,
+                                                                  sbr_,
+                                                                  sdr_,
+                                                                  symb_disp_,
+                                                                  symb_ext_,
+                                                                  host_exp_rate_,
+                                                                  cosp_rate_,
+                                                                  timeToSimTo_,
+                                                                  hl_,
+                                                                  numbsim_,
+                                                                  host_switch_mode_,
+                                                                  num_threads_,
+                                                                  filePathFromR(file),
+                                                                  stats,
+                                                                  keep_history); },
+                         stats);
 }
 //' Simulates a host-symbiont system using a cophylogenetic birth-death process
 //'
@@ -330,6 +487,10 @@ Rcpp::List sim_cophyBD_ana(SEXP hbr,
 //'     host. When the option `host_switch_mode = TRUE`, the behavior of this changes to a
 //'     more traditional host switching where one descendant retains the ancestral range and
 //'     the other gains a novel host association.
+//'
+//'     Replicates are simulated in parallel when `num_threads` is greater than 1 and
+//'     treeducken was built with OpenMP. Every replicate gets its own random number stream
+//'     seeded from R's generator so results under `set.seed` do not depend on `num_threads`.
 //' @param hbr host tree birth rate
 //' @param hdr host tree death rate
 //' @param sbr symbiont tree birth rate
@@ -340,9 +501,23 @@ Rcpp::List sim_cophyBD_ana(SEXP hbr,
 //' @param numbsim number of replicates
 //' @param host_limit Maximum number of hosts for symbionts (0 implies no limit)
 //' @param hs_mode Boolean turning host expansion into host switching (explained above) (default = FALSE)
+//' @param sparse_assoc Boolean storing the associations as adjacency lists instead of bit sets (default = FALSE),
+//'     faster for large systems where each symbiont only has a few hosts
+//' @param num_threads Number of threads to simulate the replicates on (default 1)
+//' @param file `NULL` to return the replicates, otherwise the path of a binary
+//'     tree archive to write them to (see `read_tree_archive`)
+//' @param sim_stats if `TRUE` the result gets a `sim_stats` attribute that
+//'     describes how the simulation went, see `sim_stBD`. Every replicate then
+//'     also has an `event_rates` attribute, a data frame with the time of each
+//'     event and the total rate of each kind of event (`Host`, `Symbiont`,
+//'     `Cospeciation`, `Dispersal` and `Extirpation`) just before it
+//' @param keep_history if `TRUE` every change to the associations is recorded
+//'     in an `association_history` attribute of each replicate so `get_assoc`
+//'     can rebuild the associations at any time (default = FALSE)
 //' @return A list containing the `host_tree`, the `symbiont_tree`, the
 //'     association matrix in the present, with hosts as rows and symbionts as columns, and the history of events that have
-//'     occurred.
+//'     occurred. If `file` is given the replicates are written to it instead
+//'     and the path is returned.
 //' @examples
 //'
 //' host_mu <- 0.5 # death rate
@@ -364,7 +539,7 @@ Rcpp::List sim_cophyBD_ana(SEXP hbr,
 //'                            time_to_sim = time)
 //'
 // [[Rcpp::export]]
-Rcpp::List sim_cophyBD(SEXP hbr,
+SEXP sim_cophyBD(SEXP hbr,
                     SEXP hdr,
                     SEXP sbr,
                     SEXP sdr,
@@ -373,7 +548,12 @@ Rcpp::List sim_cophyBD(SEXP hbr,
                     SEXP time_to_sim,
                     SEXP numbsim,
                     Rcpp::NumericVector host_limit = 0,
-                    Rcpp::LogicalVector hs_mode = false){
+                    Rcpp::LogicalVector hs_mode = false,
+                    Rcpp::LogicalVector sparse_assoc = false,
+                    Rcpp::IntegerVector num_threads = 1,
+                    SEXP file = R_NilValue,
+                    bool sim_stats = false,
+                    bool keep_history = false){
     double hbr_ = as<double>(hbr);
     double hdr_ = as<double>(hdr);
     double sbr_ = as<double>(sbr);
@@ -384,6 +564,8 @@ Rcpp::List sim_cophyBD(SEXP hbr,
     double timeToSimTo_ = as<double>(time_to_sim);
     int numbsim_ = as<int>(numbsim);
     bool host_switch_mode_ = as<bool>(hs_mode);
+    bool sparse_assoc_ = as<bool>(sparse_assoc);
+    int num_threads_ = as<int>(num_threads);
     RNGScope scope;
     if(hbr_ < 0.0){
          stop("'hbr' must be positive or 0.0.");
@@ -406,27 +588,40 @@ Rcpp::List sim_cophyBD(SEXP hbr,
         stop("'time_to_sim' must be a positive value or 0.0.");
     if(hl_ < 0)
         stop("'host_limit' must be a positive number or 0 (0 turns off the host limit).");
-    return sim_host_symb_treepair(hbr_,
-                                  hdr_,
-                                  sbr_,
-                                  sdr_,
-                                  host_exp_rate_,
-                                  cosp_rate_,
-                                  timeToSimTo_,
-                                  hl_,
-                                  numbsim_,
-                                  host_switch_mode_);
+    if(num_threads_ < 1)
+        stop("'num_threads' must be greater than or equal to 1");
+    auto stats = simulationStatsFromR(sim_stats);
+    return runSimulation([&](){ return sim_host_symb_treepair(hbr_,
+                                                              hdr_,
+                                                              sbr_,
+                                                              sdr_,
+                                                              host_exp_rate_,
+                                                              cosp_rate_,
+                                                              timeToSimTo_,
+                                                              hl_,
+                                                              numbsim_,
+                                                              host_switch_mode_,
+                                                              sparse_assoc_,
+                                                              num_threads_,
+                                                              filePathFromR(file),
+                                                              stats,
+                                                              keep_history); },
+                         stats);
 }
 //' Simulate multispecies coalescent on a species tree
 //'
 //' @description Simulates the multispecies coalescent on a species tree.
-//' @param species_tree input species tree of class "phylo"
+//' @param species_tree input species tree of class "phylo", or the path of a
+//'     Newick or NEXUS file (gzip compressed or not) of species trees
 //' @param ne Effective population size
 //' @param generation_time The number of time units per generation
 //' @param num_sampled_individuals number of individuals sampled within each lineage
 //' @param num_genes number of genes to simulate within each locus
 //' @param mutation_rate The rate of mutation per generation
 //' @param rescale Rescale the tree into coalescent units (otherwise assumes it is in those units)
+//' @param num_threads Number of threads to simulate the gene trees on (default 1)
+//' @param sim_stats if `TRUE` the result gets a `sim_stats` attribute that
+//'     describes how the simulation went, see `sim_stBD`
 //' @details
 //' This a multispecies coalescent simulator with two usage options.
 //' The function can rescale the given tree into coalescent units given the `mutation_rate`, `ne`, and the `generation_time`.
@@ -437,7 +632,15 @@ Rcpp::List sim_cophyBD(SEXP hbr,
 //'
 //' If rescale is set to false the tree is assumed to be in coalescent units and `ne` is used as the population
 //' genetic parameter theta.
-//' @return A list of coalescent trees
+//'
+//' The gene trees are simulated in parallel when `num_threads` is greater than 1 and
+//' treeducken was built with OpenMP. Every gene tree gets its own random number stream
+//' seeded from R's generator so results under `set.seed` do not depend on `num_threads`.
+//'
+//' The trees of a file given as `species_tree` are read one at a time and
+//' each is rescaled and simulated along as above.
+//' @return A list of coalescent trees, or with a file of species trees a
+//'     list with one such list for each of them
 //' @seealso sim_ltBD, sim_stBD, sim_stBD_t
 //'
 //' @examples
@@ -464,12 +667,9 @@ Rcpp::List sim_msc(SEXP species_tree,
                                  SEXP num_genes,
                                  Rcpp::LogicalVector rescale = true,
                                  Rcpp::NumericVector mutation_rate = 1,
-                                 Rcpp::NumericVector generation_time = 1){
-    Rcpp::List species_tree_ = as<Rcpp::List>(species_tree);
-    if(strcmp(species_tree_.attr("class"), "phylo") != 0)
-        stop("species_tree must be an object of class phylo'.");
-    auto specTree = std::shared_ptr<SpeciesTree>(new SpeciesTree(species_tree_));
-
+                                 Rcpp::NumericVector generation_time = 1,
+                                 Rcpp::IntegerVector num_threads = 1,
+                                 bool sim_stats = false){
     RNGScope scope;
     int num_sampled_individuals_ = as<int>(num_sampled_individuals);
     double ne_ = as<double>(ne);
@@ -477,12 +677,11 @@ Rcpp::List sim_msc(SEXP species_tree,
     double mutation_rate_ = as<double>(mutation_rate);
     double generation_time_ = as<double>(generation_time);
     bool rescale_ = as<bool>(rescale);
+    int num_threads_ = as<int>(num_threads);
     double u = std::exp(std::log(1) - std::log(generation_time_) + std::log(mutation_rate_)); //mut per site per gen x unit time per gen
     double theta = ne_;
-    if(rescale_){
+    if(rescale_)
         theta = 4 * ne_ * u;
-        specTree->scaleTree(theta);
-    }
     if(mutation_rate_ <= 0.0)
         stop("'mutation_rate' must be greater than 0.0.");
     if(generation_time_ <= 0.0)
@@ -493,10 +692,486 @@ Rcpp::List sim_msc(SEXP species_tree,
         stop("'num_genes' must be greater than or equal to 1");
     if(num_sampled_individuals_ < 1)
         stop("'num_sampled_individuals' must be greater than or equal to 1");
+    if(num_threads_ < 1)
+        stop("'num_threads' must be greater than or equal to 1");
+
+    auto stats = simulationStatsFromR(sim_stats);
+    if(TYPEOF(species_tree) == STRSXP)
+        return runSimulation([&](){ return sim_genetree_msc_file(speciesTreePathFromR(species_tree),
+                                                                 theta,
+                                                                 rescale_,
+                                                                 num_sampled_individuals_,
+                                                                 num_genes_,
+                                                                 num_threads_,
+                                                                 stats); },
+                             stats);
+    Rcpp::List species_tree_ = as<Rcpp::List>(species_tree);
+    if(strcmp(species_tree_.attr("class"), "phylo") != 0)
+        stop("species_tree must be an object of class phylo'.");
+    auto specTree = speciesTreeFromR(species_tree_);
+    if(rescale_)
+        specTree->scaleTree(theta);
+    return runSimulation([&](){ return sim_genetree_msc(specTree,
+                                                        theta,
+                                                        num_sampled_individuals_,
+                                                        num_genes_,
+                                                        num_threads_,
+                                                        stats); },
+                         stats);
+}
+
+
+// native multilocus coalescent behind sim_mlc (see R/sim_multilocus.R)
+// duplications are the internal nodes of locus_tree with a node label and
+// the tips are named <species>_<locus> as by sim_ltBD
+// [[Rcpp::export(.sim_mlc)]]
+Rcpp::List sim_mlc_native(SEXP locus_tree,
+                          double ne,
+                          double generation_time,
+                          double mutation_rate,
+                          int num_reps,
+                          int num_threads){
+    Rcpp::List locus_tree_ = as<Rcpp::List>(locus_tree);
+    if(strcmp(locus_tree_.attr("class"), "phylo") != 0)
+        stop("locus_tree must be an object of class phylo'.");
+    if(num_threads < 1)
+        stop("'num_threads' must be greater than or equal to 1");
+    int numTips = Rf_length(locus_tree_["tip.label"]);
+    auto specTree = speciesTreeFromR(locus_tree_);
+    double u = std::exp(std::log(1) - std::log(generation_time) + std::log(mutation_rate));
+    double theta = 4 * ne * u;
+    specTree->scaleTree(theta);
+    auto locTree = std::shared_ptr<LocusTree>(new LocusTree(*specTree,
+                                                            specTree->getNumExtant(),
+                                                            0.0,
+                                                            0.0,
+                                                            0.0));
+    bool hasDuplications = false;
+    if(locus_tree_.containsElementNamed("node.label")){
+        std::vector<std::string> nodeLabels = locus_tree_["node.label"];
+        for(auto node : locTree->getNodes()){
+            int labelIndx = node->getIndex() - numTips - 1;
+            if(!(node->getIsTip()) && labelIndx < (int) nodeLabels.size()){
+                node->setIsDuplication(!(nodeLabels[labelIndx].empty()));
+                hasDuplications = hasDuplications || node->getIsDuplication();
+            }
+        }
+    }
+    // the new copy of a duplication is told apart by the loci of its tips
+    if(hasDuplications)
+        locTree->setLocusIDsFromTipNames();
+    RNGScope scope;
+    return runSimulation([&](){ return sim_multilocus_genetrees(locTree, theta,
+                                                                num_reps,
+                                                                num_threads); },
+                         nullptr);
+}
+
+// sequence simulation behind sim_seqs (see R/sim_seqs.R), the rate categories
+// and model parameters are checked and set up on the R side
+// [[Rcpp::export(.sim_seqs)]]
+Rcpp::List sim_seqs_native(Rcpp::List trees,
+                           int num_sites,
+                           std::vector<double> exchangeabilities,
+                           std::vector<double> base_freqs,
+                           std::vector<double> category_rates,
+                           std::vector<std::string> files,
+                           std::string format,
+                           int num_threads){
+    int numTrees = trees.size();
+    bool toFile = !(files.empty());
+    std::vector< std::vector<int> > ancs(numTrees), dess(numTrees);
+    std::vector< std::vector<double> > brlens(numTrees);
+    std::vector< std::vector<std::string> > tipNames(numTrees);
+    for(int i = 0; i < numTrees; i++){
+        Rcpp::List tr = trees[i];
+        Rcpp::IntegerMatrix edge = tr["edge"];
+        ancs[i].resize(edge.nrow());
+        dess[i].resize(edge.nrow());
+        for(int e = 0; e < edge.nrow(); e++){
+            ancs[i][e] = edge(e, 0);
+            dess[i][e] = edge(e, 1);
+        }
+        brlens[i] = as<std::vector<double> >(tr["edge.length"]);
+        tipNames[i] = as<std::vector<std::string> >(tr["tip.label"]);
+    }
+    SequenceSimulator seqSim(exchangeabilities, base_freqs, category_rates, num_sites);
+    RNGScope scope;
+    std::vector<uint64_t> seeds(numTrees);
+    for(int i = 0; i < numTrees; i++)
+        seeds[i] = drawSeedFromR();
+    std::vector<PackedAlignment> alignments(numTrees);
+    std::vector<char> writeFailed(numTrees, 0);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(num_threads)
+#endif
+    for(int i = 0; i < numTrees; i++){
+        Rng rng(seeds[i]);
+        PackedAlignment aln = seqSim.simulate(ancs[i], dess[i], brlens[i], tipNames[i], rng);
+        if(toFile){
+            // stream straight to disk so only one alignment per thread is in memory
+            std::ofstream out(files[i].c_str());
+            if(format == "phylip")
+                writePhylip(out, aln);
+            else
+                writeFasta(out, aln);
+            writeFailed[i] = !(out.good());
+        }
+        else{
+            alignments[i] = std::move(aln);
+        }
+    }
+    List seqs(numTrees);
+    for(int i = 0; i < numTrees; i++){
+        if(writeFailed[i])
+            stop("could not write to '%s'.", files[i]);
+        if(toFile)
+            continue;
+        Rcpp::CharacterVector seqVec(tipNames[i].size());
+        for(unsigned j = 0; j < tipNames[i].size(); j++)
+            seqVec[j] = alignments[i].getSequence(j);
+        seqVec.attr("names") = tipNames[i];
+        seqs[i] = seqVec;
+    }
+    return seqs;
+}
+
+// tree shape and branch length summaries of a list of trees in one pass over
+// each edge matrix, used by summarize_gt and summarize_trees
+// [[Rcpp::export(.tree_shape_stats)]]
+Rcpp::List tree_shape_stats_native(Rcpp::List trees, int num_threads){
+    int numTrees = trees.size();
+    std::vector< std::vector<int> > ancs(numTrees), dess(numTrees);
+    std::vector< std::vector<double> > brlens(numTrees);
+    std::vector<int> numTips(numTrees);
+    for(int i = 0; i < numTrees; i++){
+        Rcpp::List tr = trees[i];
+        Rcpp::IntegerMatrix edge = tr["edge"];
+        ancs[i].resize(edge.nrow());
+        dess[i].resize(edge.nrow());
+        for(int e = 0; e < edge.nrow(); e++){
+            ancs[i][e] = edge(e, 0);
+            dess[i][e] = edge(e, 1);
+        }
+        if(tr.containsElementNamed("edge.length"))
+            brlens[i] = as<std::vector<double> >(tr["edge.length"]);
+        else
+            brlens[i].assign(edge.nrow(), 0.0);
+        numTips[i] = Rf_length(tr["tip.label"]);
+    }
+    std::vector<TreeShapeStats> stats(numTrees);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(num_threads)
+#endif
+    for(int i = 0; i < numTrees; i++)
+        stats[i] = calculateTreeShapeStats(ancs[i], dess[i], brlens[i], numTips[i]);
+    Rcpp::NumericVector colless(numTrees), sackin(numTrees), cherries(numTrees);
+    Rcpp::NumericVector b1(numTrees), beta(numTrees), gamma(numTrees);
+    Rcpp::NumericVector treeDepth(numTrees), meanBrlen(numTrees), varBrlen(numTrees);
+    for(int i = 0; i < numTrees; i++){
+        colless[i] = stats[i].colless;
+        sackin[i] = stats[i].sackin;
+        cherries[i] = stats[i].cherries;
+        b1[i] = stats[i].b1;
+        beta[i] = stats[i].beta;
+        gamma[i] = stats[i].gamma;
+        treeDepth[i] = stats[i].treeDepth;
+        meanBrlen[i] = stats[i].meanBranchLength;
+        varBrlen[i] = stats[i].varBranchLength;
+    }
+    return Rcpp::List::create(Named("colless") = colless,
+                              Named("sackin") = sackin,
+                              Named("cherries") = cherries,
+                              Named("b1") = b1,
+                              Named("beta") = beta,
+                              Named("gamma") = gamma,
+                              Named("tree_depth") = treeDepth,
+                              Named("mean_brlen") = meanBrlen,
+                              Named("var_brlen") = varBrlen);
+}
+
+// associations at each of the times from the association_history attribute
+// of a cophy object, used by get_assoc
+// [[Rcpp::export(.assoc_at)]]
+Rcpp::List assoc_at_native(Rcpp::List history, Rcpp::NumericVector times){
+    return association_history_at(history, times);
+}
+
+// applies a sequence of operations to an empty association matrix and
+// returns it (hosts as rows) with the number of slots used, so the tests can
+// check the bit sets and slot reuse against a dense matrix built in R.
+// Indices are 1-based extant indices and NA where an operation has none.
+// [[Rcpp::export(.assoc_matrix_ops)]]
+Rcpp::List assoc_matrix_ops_native(Rcpp::CharacterVector ops,
+                                   Rcpp::IntegerVector symbionts,
+                                   Rcpp::IntegerVector hosts,
+                                   bool sparse){
+    AssociationMatrix assoc;
+    assoc.setSparse(sparse);
+    assoc.reset(0, 0);
+    for(int i = 0; i < ops.size(); i++){
+        std::string op = Rcpp::as<std::string>(ops[i]);
+        bool needsSymbiont = (op == "remove_symbiont" || op == "split_symbiont" ||
+                              op == "associate" || op == "dissociate");
+        bool needsHost = (op == "remove_host" || op == "split_host" ||
+                          op == "associate" || op == "dissociate");
+        int s = symbionts[i] - 1;
+        int h = hosts[i] - 1;
+        if(needsSymbiont && (symbionts[i] == NA_INTEGER || s < 0 ||
+                             s >= (int) assoc.getNumSymbionts()))
+            stop("operation %i has no extant symbiont %i", i + 1, symbionts[i]);
+        if(needsHost && (hosts[i] == NA_INTEGER || h < 0 ||
+                         h >= (int) assoc.getNumHosts()))
+            stop("operation %i has no extant host %i", i + 1, hosts[i]);
+        if(op == "add_symbiont")
+            assoc.addSymbiont();
+        else if(op == "add_host")
+            assoc.addHost();
+        else if(op == "remove_symbiont")
+            assoc.removeSymbiont(s);
+        else if(op == "remove_host")
+            assoc.removeHost(h);
+        else if(op == "split_symbiont")
+            assoc.splitSymbiont(s);
+        else if(op == "split_host")
+            assoc.splitHost(h);
+        else if(op == "associate")
+            assoc.associate(s, h);
+        else if(op == "dissociate")
+            assoc.dissociate(s, h);
+        else
+            stop("unknown operation '%s'", op);
+    }
+    Rcpp::IntegerMatrix assocMat(assoc.getNumHosts(), assoc.getNumSymbionts());
+    std::vector<int> dense = assoc.getMatrix();
+    std::copy(dense.begin(), dense.end(), assocMat.begin());
+    return Rcpp::List::create(Named("association_mat") = assocMat,
+                              Named("num_associations") = (int) assoc.getNumAssociations(),
+                              Named("symbiont_slots") = (int) assoc.getNumSymbiontSlots(),
+                              Named("host_slots") = (int) assoc.getNumHostSlots());
+}
+
+// ParaFitGlobal statistic of an association matrix (hosts as rows) and the
+// statistics of reps row permutations of it, used by parafit_stat and
+// parafit_test. The principal coordinates are found once for all of them.
+// [[Rcpp::export(.parafit)]]
+Rcpp::List parafit_native(arma::mat host_dist, arma::mat symb_dist, arma::mat assoc_mat,
+                          int reps, int num_threads){
+    if(assoc_mat.n_rows != host_dist.n_rows || assoc_mat.n_cols != symb_dist.n_rows)
+        stop("'assoc_mat' must have a row for each host and a column for each symbiont.");
+    ParaFit pf(host_dist, symb_dist);
+    RNGScope scope;
+    std::vector<uint64_t> seeds(std::max(reps, 0));
+    for(unsigned i = 0; i < seeds.size(); i++)
+        seeds[i] = drawSeedFromR();
+    std::vector<double> nullDist = pf.permutationStatistics(assoc_mat, seeds, num_threads);
+    return Rcpp::List::create(Named("statistic") = pf.statistic(assoc_mat),
+                              Named("null_distribution") = Rcpp::wrap(nullDist));
+}
+
+// cophenetic distance matrix of a phylo in the order of its tip labels, the
+// same as ape::cophenetic.phylo
+// [[Rcpp::export(.cophenetic)]]
+Rcpp::NumericMatrix cophenetic_native(Rcpp::List tree){
+    Rcpp::IntegerMatrix edge = tree["edge"];
+    std::vector<int> anc(edge.nrow()), des(edge.nrow());
+    for(int e = 0; e < edge.nrow(); e++){
+        anc[e] = edge(e, 0);
+        des[e] = edge(e, 1);
+    }
+    if(!(tree.containsElementNamed("edge.length")))
+        stop("the tree has no branch lengths.");
+    std::vector<double> brlens = as<std::vector<double> >(tree["edge.length"]);
+    Rcpp::CharacterVector tipNames = tree["tip.label"];
+    int numTips = tipNames.size();
+    Rcpp::NumericMatrix dist(numTips, numTips);
+    copheneticDistances(anc, des, brlens, numTips, dist.begin());
+    Rcpp::rownames(dist) = tipNames;
+    Rcpp::colnames(dist) = tipNames;
+    return dist;
+}
+
+// simulates one species tree and returns it with its tip distances from
+// Tree::getTipDistances, so the tests can check them against
+// cophenetic_distances on the exported tree
+// [[Rcpp::export(.sim_tip_distances)]]
+Rcpp::List sim_tip_distances_native(double sbr, double sdr, int n_tips){
+    RNGScope scope;
+    Simulator phySimulator(n_tips, sbr, sdr, 1);
+    phySimulator.setGSAStop(10 * n_tips);
+    phySimulator.setRng(rngFromR());
+    phySimulator.simSpeciesTree();
+    List phy = List::create(Named("edge") = edgesToR(phySimulator.getSpeciesEdges()),
+                            Named("edge.length") = phySimulator.getSpeciesEdgeLengths(),
+                            Named("Nnode") = phySimulator.getSpeciesNnodes(),
+                            Named("tip.label") = phySimulator.getSpeciesTipNames(),
+                            Named("root.edge") = phySimulator.getSpeciesTreeRootEdge());
+    phy.attr("class") = "phylo";
+    std::vector<double> dist = phySimulator.getSpeciesTipDistances();
+    int numTips = Rf_length(phy["tip.label"]);
+    Rcpp::NumericMatrix distMat(numTips, numTips);
+    std::copy(dist.begin(), dist.end(), distMat.begin());
+    return Rcpp::List::create(Named("tree") = phy,
+                              Named("tip_distances") = distMat);
+}
+
+static TreeArchive& archiveFromR(SEXP archive){
+    Rcpp::XPtr<TreeArchive> ptr(archive);
+    if(ptr.get() == nullptr)
+        stop("the archive is no longer open, open it again with read_tree_archive()");
+    return *ptr;
+}
+
+// tree archives are mapped into memory once and read a replicate at a time
+// by read_tree_archive and the methods of tree_archive
+// [[Rcpp::export(.tree_archive_open)]]
+SEXP tree_archive_open(SEXP file){
+    std::string path = filePathFromR(file);
+    if(path.empty())
+        stop("'file' must be a single file path");
+    Rcpp::XPtr<TreeArchive> archive(new TreeArchive(path), true);
+    return archive;
+}
 
-    return sim_genetree_msc(specTree,
-                            theta,
-                            num_sampled_individuals_,
-                            num_genes_);
+// [[Rcpp::export(.tree_archive_info)]]
+Rcpp::List tree_archive_info(SEXP archive){
+    TreeArchive &a = archiveFromR(archive);
+    return Rcpp::List::create(Named("content") = a.getContent() == ArchiveCophylo ? "cophy" : "phylo",
+                              Named("length") = (double) a.getNumReplicates());
 }
 
+// [[Rcpp::export(.tree_archive_get)]]
+Rcpp::List tree_archive_get(SEXP archive, Rcpp::IntegerVector replicates){
+    return tree_archive_replicates(archiveFromR(archive), replicates);
+}
+
+// a phylo as ape stores it, root.edge may be missing
+static PhyloTree phyloTreeFromR(Rcpp::List tree){
+    if(!(tree.containsElementNamed("edge.length")))
+        stop("the tree has no branch lengths.");
+    Rcpp::NumericMatrix edge = tree["edge"];
+    PhyloTree phy;
+    phy.edges = edgesFromR(edge);
+    phy.edgeLengths = as<std::vector<double> >(tree["edge.length"]);
+    phy.tipNames = as<std::vector<std::string> >(tree["tip.label"]);
+    phy.numInternal = as<int>(tree["Nnode"]);
+    phy.rootEdge = tree.containsElementNamed("root.edge") ? as<double>(tree["root.edge"]) : 0.0;
+    return phy;
+}
+
+// runs the sampler of abc_cophyBD and abc_msc (see R/abc.R). priors has the
+// 0 based index of each parameter that has a prior, the others are fixed at
+// their value in parameters. Parameters and statistics of the accepted
+// proposals are the rows of the param and stats matrices.
+static Rcpp::List runAbc(const AbcModel &model,
+                         Rcpp::NumericVector parameters,
+                         Rcpp::List priors,
+                         Rcpp::NumericVector observed,
+                         Rcpp::List settings,
+                         int numThreads){
+    Rcpp::IntegerVector index = priors["parameter"];
+    Rcpp::NumericVector lower = priors["lower"];
+    Rcpp::NumericVector upper = priors["upper"];
+    Rcpp::LogicalVector logScale = priors["log"];
+    std::vector<AbcPrior> abcPriors(index.size());
+    for(int k = 0; k < index.size(); k++)
+        abcPriors[k] = AbcPrior{index[k], lower[k], upper[k], (bool) logScale[k]};
+    RNGScope scope;
+    Rng rng(drawSeedFromR());
+    AbcSampler sampler(model,
+                       as<std::vector<double> >(parameters),
+                       abcPriors,
+                       as<std::vector<double> >(observed),
+                       numThreads,
+                       cancellationFromR());
+    AbcResult result;
+    if(as<std::string>(settings["method"]) == "smc")
+        result = sampler.smc(as<int>(settings["num_particles"]),
+                             as<int>(settings["num_generations"]),
+                             as<double>(settings["alpha"]),
+                             (long) as<double>(settings["max_sims"]),
+                             rng);
+    else
+        result = sampler.rejection((long) as<double>(settings["num_sims"]),
+                                   (long) as<double>(settings["num_accept"]),
+                                   rng);
+    int numAccepted = result.parameters.size();
+    Rcpp::NumericMatrix params(numAccepted, abcPriors.size());
+    Rcpp::NumericMatrix stats(numAccepted, result.scale.size());
+    for(int i = 0; i < numAccepted; i++){
+        for(int k = 0; k < params.ncol(); k++)
+            params(i, k) = result.parameters[i][k];
+        for(int j = 0; j < stats.ncol(); j++)
+            stats(i, j) = result.statistics[i][j];
+    }
+    Rcpp::colnames(stats) = Rcpp::wrap(model.getStatisticNames());
+    Rcpp::NumericVector scale = Rcpp::wrap(result.scale);
+    scale.attr("names") = model.getStatisticNames();
+    return Rcpp::List::create(Named("param") = params,
+                              Named("stats") = stats,
+                              Named("distance") = result.distances,
+                              Named("weights") = result.weights,
+                              Named("tolerance") = result.tolerances,
+                              Named("num_simulations") = std::vector<double>(result.numSimulations.begin(),
+                                                                             result.numSimulations.end()),
+                              Named("scale") = scale,
+                              Named("completed") = result.completed);
+}
+
+// [[Rcpp::export(.abc_cophy)]]
+SEXP abc_cophy_native(Rcpp::NumericVector parameters,
+                      Rcpp::List priors,
+                      Rcpp::NumericVector observed,
+                      Rcpp::List settings,
+                      bool anagenesis,
+                      double time_to_sim,
+                      int host_limit,
+                      bool hs_mode,
+                      int num_threads){
+    CophyloAbcModel model(anagenesis, time_to_sim, host_limit, hs_mode);
+    return runSimulation([&](){ return runAbc(model, parameters, priors, observed,
+                                              settings, num_threads); },
+                         nullptr);
+}
+
+// [[Rcpp::export(.abc_msc)]]
+SEXP abc_msc_native(Rcpp::NumericVector parameters,
+                    Rcpp::List priors,
+                    Rcpp::NumericVector observed,
+                    Rcpp::List settings,
+                    Rcpp::List species_tree,
+                    bool rescale,
+                    double mutation_rate,
+                    double generation_time,
+                    int num_sampled_individuals,
+                    int num_genes,
+                    int num_threads){
+    double u = std::exp(std::log(1) - std::log(generation_time) + std::log(mutation_rate));
+    MscAbcModel model(phyloTreeFromR(species_tree), rescale, u, num_sampled_individuals, num_genes);
+    return runSimulation([&](){ return runAbc(model, parameters, priors, observed,
+                                              settings, num_threads); },
+                         nullptr);
+}
+
+// the statistics of abc_cophyBD and abc_msc for observed trees, used by
+// abc_summary
+// [[Rcpp::export(.abc_summary_cophy)]]
+Rcpp::NumericVector abc_summary_cophy(Rcpp::List host_tree,
+                                      Rcpp::List symb_tree,
+                                      Rcpp::NumericMatrix assoc_mat){
+    Rcpp::NumericVector stats = Rcpp::wrap(cophyloSummary(phyloTreeFromR(host_tree),
+                                                          phyloTreeFromR(symb_tree),
+                                                          as<std::vector<double> >(assoc_mat)));
+    stats.attr("names") = cophyloSummaryNames();
+    return stats;
+}
+
+// [[Rcpp::export(.abc_summary_gt)]]
+Rcpp::NumericVector abc_summary_gt(Rcpp::List trees){
+    std::vector<PhyloTree> geneTrees(trees.size());
+    for(int i = 0; i < trees.size(); i++)
+        geneTrees[i] = phyloTreeFromR(trees[i]);
+    Rcpp::NumericVector stats = Rcpp::wrap(geneTreeSummary(geneTrees));
+    stats.attr("names") = geneTreeSummaryNames();
+    return stats;
+}
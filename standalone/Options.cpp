@@ -0,0 +1,127 @@
+//
+//  Options.cpp
+//  treeducken standalone
+//
+
+#include "Options.h"
+#include <fstream>
+#include <stdexcept>
+#include <cstdlib>
+#include <cerrno>
+
+static std::string trim(const std::string &s){
+    size_t b = s.find_first_not_of(" \t\r");
+    if(b == std::string::npos)
+        return "";
+    size_t e = s.find_last_not_of(" \t\r");
+    return s.substr(b, e - b + 1);
+}
+
+void Options::parseArgs(int argc, char **argv, int first){
+    for(int i = first; i < argc; i++){
+        std::string arg = argv[i];
+        if(arg.compare(0, 2, "--") != 0)
+            throw std::runtime_error("expected an option starting with '--' but got '" + arg + "'");
+        arg = arg.substr(2);
+        size_t eq = arg.find('=');
+        if(eq != std::string::npos){
+            values[arg.substr(0, eq)] = arg.substr(eq + 1);
+        }
+        else{
+            if(i + 1 >= argc)
+                throw std::runtime_error("option '--" + arg + "' needs a value");
+            values[arg] = argv[++i];
+        }
+    }
+    if(has("config"))
+        readConfig(getString("config"));
+}
+
+void Options::readConfig(const std::string &path){
+    std::ifstream in(path.c_str());
+    if(!in)
+        throw std::runtime_error("could not open config file '" + path + "'");
+    std::string line;
+    int lineNumber = 0;
+    while(std::getline(in, line)){
+        lineNumber++;
+        size_t hash = line.find('#');
+        if(hash != std::string::npos)
+            line.erase(hash);
+        line = trim(line);
+        if(line.empty())
+            continue;
+        size_t eq = line.find('=');
+        if(eq == std::string::npos)
+            throw std::runtime_error(path + ":" + std::to_string(lineNumber) + ": expected 'name = value'");
+        std::string name = trim(line.substr(0, eq));
+        if(!has(name))
+            values[name] = trim(line.substr(eq + 1));
+    }
+}
+
+const std::string* Options::find(const std::string &name){
+    auto it = values.find(name);
+    if(it == values.end())
+        return nullptr;
+    used.insert(name);
+    return &(it->second);
+}
+
+std::string Options::getString(const std::string &name){
+    const std::string *v = find(name);
+    if(v == nullptr)
+        throw std::runtime_error("'" + name + "' must be given");
+    return *v;
+}
+
+std::string Options::getString(const std::string &name, const std::string &def){
+    const std::string *v = find(name);
+    return v == nullptr ? def : *v;
+}
+
+double Options::getDouble(const std::string &name){
+    std::string v = getString(name);
+    char *end = nullptr;
+    errno = 0;
+    double d = std::strtod(v.c_str(), &end);
+    if(end == v.c_str() || *end != '\0' || errno == ERANGE)
+        throw std::runtime_error("'" + name + "' must be a number");
+    return d;
+}
+
+double Options::getDouble(const std::string &name, double def){
+    return has(name) ? getDouble(name) : def;
+}
+
+long Options::getInt(const std::string &name){
+    std::string v = getString(name);
+    char *end = nullptr;
+    errno = 0;
+    long l = std::strtol(v.c_str(), &end, 10);
+    if(end == v.c_str() || *end != '\0' || errno == ERANGE)
+        throw std::runtime_error("'" + name + "' must be an integer");
+    return l;
+}
+
+long Options::getInt(const std::string &name, long def){
+    return has(name) ? getInt(name) : def;
+}
+
+bool Options::getBool(const std::string &name, bool def){
+    if(!has(name))
+        return def;
+    std::string v = getString(name);
+    if(v == "true" || v == "TRUE" || v == "T" || v == "1")
+        return true;
+    if(v == "false" || v == "FALSE" || v == "F" || v == "0")
+        return false;
+    throw std::runtime_error("'" + name + "' must be true or false");
+}
+
+void Options::checkAllUsed() const {
+    for(auto &v : values){
+        if(v.first != "config" && used.count(v.first) == 0)
+            throw std::runtime_error("unknown option '" + v.first + "'");
+    }
+}
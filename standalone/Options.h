@@ -0,0 +1,43 @@
+//
+//  Options.h
+//  treeducken standalone
+//
+//  Settings of a run as name/value pairs. They come from a config file of
+//  "name = value" lines and from "--name value" flags, where flags override
+//  the config file. Names are the argument names of the R functions
+//  (e.g. sbr, n_tips, num_threads).
+//
+
+#ifndef Options_h
+#define Options_h
+
+#include <map>
+#include <set>
+#include <string>
+
+class Options
+{
+    private:
+        std::map<std::string, std::string>  values;
+        std::set<std::string>               used;
+
+        const std::string*  find(const std::string &name);
+
+    public:
+        // arguments after the model name, --config is read after all flags
+        void        parseArgs(int argc, char **argv, int first);
+        // settings already given are kept
+        void        readConfig(const std::string &path);
+        bool        has(const std::string &name) const { return values.count(name) > 0; }
+        std::string getString(const std::string &name);
+        std::string getString(const std::string &name, const std::string &def);
+        double      getDouble(const std::string &name);
+        double      getDouble(const std::string &name, double def);
+        long        getInt(const std::string &name);
+        long        getInt(const std::string &name, long def);
+        bool        getBool(const std::string &name, bool def);
+        // throws if a setting was never asked for (likely a typo)
+        void        checkAllUsed() const;
+};
+
+#endif /* Options_h */
@@ -0,0 +1,379 @@
+//
+//  bench.cpp
+//  treeducken standalone
+//
+//  Times the simulation engines of the core on a grid of settings and writes
+//  one CSV line per setting: replicates per second, tree nodes simulated per
+//  second, the peak resident set size and the number and size of the
+//  allocations made per replicate. Lines carry a --label (e.g. the git
+//  revision) so files from different commits can be put side by side, see
+//  bench/bench_engines.R.
+//
+//  Every setting runs in a child process of its own so its peak RSS is not
+//  that of the settings before it (not on Windows, where it is left NA).
+//  Allocations are counted by replacing the global operator new, which sees
+//  everything the core allocates through the standard containers and
+//  shared_ptrs.
+//
+
+#include "Simulator.h"
+#include "Options.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+static std::atomic<uint64_t> numAllocations(0);
+static std::atomic<uint64_t> allocatedBytes(0);
+
+void* operator new(std::size_t size){
+    numAllocations.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    void *p = std::malloc(size == 0 ? 1 : size);
+    if(p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size){
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept{
+    try{
+        return operator new(size);
+    }
+    catch(...){
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept{
+    return operator new(size, std::nothrow);
+}
+
+void operator delete(void *p) noexcept{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept{
+    std::free(p);
+}
+
+static const char *usage =
+    "usage: treeducken_bench [--name value ...]\n"
+    "\n"
+    "  engines   comma separated engines to time (all of them):\n"
+    "            gsaBDSim, bdSimpleSim, bdsaBDSim, coalescentSim,\n"
+    "            pairedBDPSim, pairedBDPSimAna\n"
+    "  min_time  seconds each setting is repeated for (1)\n"
+    "  min_reps  replicates each setting runs at least (3)\n"
+    "  seed      seed of the random number streams (1)\n"
+    "  label     first column of every line, e.g. the git revision\n"
+    "  out       CSV file the lines are appended to (standard output)\n";
+
+// one point of the grid, settings that do not apply to an engine are -1
+struct BenchCase
+{
+    std::string engine;
+    long        numTips;
+    double      timeToSim;
+    double      birthRate;
+    double      deathRate;
+    // lgtr of bdsaBDSim and host_exp_rate of the cophylogenetic engines
+    double      transferRate;
+    long        indPerPop;
+    long        hostLimit;
+};
+
+// what a child process sends back, fixed size so it can go through a pipe
+struct BenchResult
+{
+    long        replicates;
+    double      seconds;
+    double      nodes;
+    double      peakRssKb;
+    double      allocations;
+    double      bytes;
+    char        error[256];
+};
+
+// simulates one replicate and returns the number of nodes of its trees
+typedef std::function<long(std::shared_ptr<Rng>)> ReplicateFunction;
+
+static std::vector<BenchCase> benchGrid(){
+    std::vector<BenchCase> grid;
+    const double rates[2][2] = {{1.0, 0.0}, {1.0, 0.5}};
+    for(long n : {10, 100, 1000})
+        for(auto &r : rates)
+            grid.push_back({"gsaBDSim", n, -1, r[0], r[1], -1, -1, -1});
+    for(double t : {2.0, 4.0, 6.0})
+        for(auto &r : rates)
+            grid.push_back({"bdSimpleSim", -1, t, r[0], r[1], -1, -1, -1});
+    for(long n : {10, 100, 500})
+        for(double lgtr : {0.0, 0.2})
+            grid.push_back({"bdsaBDSim", n, -1, 0.5, 0.2, lgtr, -1, -1});
+    for(long n : {10, 100})
+        for(long ipp : {1, 10, 100})
+            grid.push_back({"coalescentSim", n, -1, -1, -1, -1, ipp, -1});
+    for(const char *engine : {"pairedBDPSim", "pairedBDPSimAna"})
+        for(double t : {2.0, 4.0})
+            for(long hl : {0, 1, 3})
+                grid.push_back({engine, -1, t, 1.0, 0.3, 0.2, -1, hl});
+    return grid;
+}
+
+// pure birth species tree with n tips for the engines that need one
+static std::shared_ptr<SpeciesTree> speciesTree(long n, uint64_t seed){
+    Simulator sim(n, 1.0, 0.0, 1.0);
+    sim.setRng(std::make_shared<Rng>(seed));
+    sim.setGSAStop(10 * n);
+    sim.simSpeciesTree();
+    return sim.getSpeciesTree();
+}
+
+// Sets up whatever the engine needs outside of the timed loop. The retrying
+// wrappers are timed rather than the single attempts since a failed attempt
+// (a tree that died out) is part of what a simulation costs. As in the R
+// functions one simulator runs all of the replicates of a setting.
+static ReplicateFunction replicateFunction(const BenchCase &c, uint64_t seed){
+    if(c.engine == "gsaBDSim"){
+        auto sim = std::make_shared<Simulator>(c.numTips, c.birthRate, c.deathRate, 1.0);
+        sim->setGSAStop(10 * c.numTips);
+        return [sim](std::shared_ptr<Rng> rng){
+            sim->setRng(rng);
+            sim->simSpeciesTree();
+            return (long) sim->getSpeciesTree()->getNodesSize();
+        };
+    }
+    if(c.engine == "bdSimpleSim"){
+        auto sim = std::make_shared<Simulator>(1, c.birthRate, c.deathRate, 1.0);
+        sim->setTimeToSim(c.timeToSim);
+        return [sim](std::shared_ptr<Rng> rng){
+            sim->setRng(rng);
+            sim->simSpeciesTreeTime();
+            return (long) sim->getSpeciesTree()->getNodesSize();
+        };
+    }
+    if(c.engine == "bdsaBDSim"){
+        // every replicate runs along the same species tree as in sim_ltBD
+        auto spTree = speciesTree(c.numTips, seed);
+        auto sim = std::make_shared<Simulator>(spTree->getNumExtant(), 0.0, 0.0, 0.0, 1,
+                                               c.birthRate, c.deathRate, c.transferRate,
+                                               std::string("random"));
+        sim->setSpeciesTree(spTree);
+        return [sim](std::shared_ptr<Rng> rng){
+            sim->setRng(rng);
+            sim->simLocusTree();
+            return (long) sim->getLocusTree()->getNodesSize();
+        };
+    }
+    if(c.engine == "coalescentSim"){
+        auto spTree = speciesTree(c.numTips, seed);
+        int ntax = spTree->getNumExtant();
+        auto sim = std::make_shared<Simulator>(ntax, 0.0, 0.0, 1.0, 1, 0.0, 0.0, 0.0,
+                                               c.indPerPop, 1.0, 1.0, 1, 0.0, 1.0, false);
+        sim->setSpeciesTree(spTree);
+        sim->setLocusTree(std::make_shared<LocusTree>(*spTree, ntax, 0.0, 0.0, 0.0));
+        return [sim](std::shared_ptr<Rng> rng){
+            sim->setRng(rng);
+            if(!(sim->coalescentSim()))
+                throw std::runtime_error("the species tree has no epochs to coalesce in");
+            return (long) sim->getGeneTree()->getNodesSize();
+        };
+    }
+    if(c.engine == "pairedBDPSim" || c.engine == "pairedBDPSimAna"){
+        bool anagenesis = c.engine == "pairedBDPSimAna";
+        std::shared_ptr<Simulator> sim;
+        if(anagenesis)
+            sim.reset(new Simulator(c.timeToSim, c.birthRate, c.deathRate,
+                                    c.birthRate, c.deathRate, 0.5, 0.2,
+                                    c.transferRate, 0.5, 1.0, c.hostLimit, false));
+        else
+            sim.reset(new Simulator(c.timeToSim, c.birthRate, c.deathRate,
+                                    c.birthRate, c.deathRate, c.transferRate,
+                                    0.5, 1.0, c.hostLimit, false));
+        return [sim, anagenesis](std::shared_ptr<Rng> rng){
+            sim->setRng(rng);
+            if(anagenesis)
+                sim->simHostSymbSpeciesTreePairWithAnagenesis();
+            else
+                sim->simHostSymbSpeciesTreePair();
+            return (long) (sim->getSpeciesTree()->getNodesSize()
+                           + sim->getSymbiontTree()->getNodesSize());
+        };
+    }
+    throw std::runtime_error("unknown engine '" + c.engine + "'");
+}
+
+static double peakRssKb(){
+#ifdef _WIN32
+    return -1;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024.0;
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
+
+static BenchResult measure(const BenchCase &c, double minTime, long minReps, uint64_t seed){
+    BenchResult result;
+    std::memset(&result, 0, sizeof(result));
+    try{
+        ReplicateFunction replicate = replicateFunction(c, seed);
+        Rng streams(seed);
+        numAllocations = 0;
+        allocatedBytes = 0;
+        auto start = std::chrono::steady_clock::now();
+        do{
+            result.nodes += replicate(std::make_shared<Rng>(streams.nextSeed()));
+            result.replicates++;
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            result.seconds = elapsed.count();
+        }while(result.seconds < minTime || result.replicates < minReps);
+        result.allocations = numAllocations;
+        result.bytes = allocatedBytes;
+        result.peakRssKb = peakRssKb();
+    }
+    catch(std::exception &e){
+        std::strncpy(result.error, e.what(), sizeof(result.error) - 1);
+    }
+    return result;
+}
+
+// measures c in a child process so the peak RSS is its own
+static BenchResult measureInChild(const BenchCase &c, double minTime, long minReps, uint64_t seed){
+#ifdef _WIN32
+    BenchResult result = measure(c, minTime, minReps, seed);
+    result.peakRssKb = -1;
+    return result;
+#else
+    int fds[2];
+    if(pipe(fds) != 0)
+        throw std::runtime_error("could not create a pipe");
+    std::cout.flush();
+    pid_t pid = fork();
+    if(pid < 0)
+        throw std::runtime_error("could not fork");
+    if(pid == 0){
+        close(fds[0]);
+        BenchResult result = measure(c, minTime, minReps, seed);
+        ssize_t written = write(fds[1], &result, sizeof(result));
+        _exit(written == (ssize_t) sizeof(result) ? 0 : 1);
+    }
+    close(fds[1]);
+    BenchResult result;
+    size_t numRead = 0;
+    while(numRead < sizeof(result)){
+        ssize_t r = read(fds[0], (char*) &result + numRead, sizeof(result) - numRead);
+        if(r <= 0)
+            break;
+        numRead += r;
+    }
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if(numRead < sizeof(result))
+        throw std::runtime_error(c.engine + " crashed");
+    return result;
+#endif
+}
+
+static std::string field(double x){
+    if(x < 0)
+        return "NA";
+    std::ostringstream out;
+    out.precision(6);
+    out << x;
+    return out.str();
+}
+
+static std::string csvLine(const std::string &label, const BenchCase &c, const BenchResult &r){
+    std::ostringstream line;
+    line << label << "," << c.engine << "," << field(c.numTips) << ","
+         << field(c.timeToSim) << "," << field(c.birthRate) << ","
+         << field(c.deathRate) << "," << field(c.transferRate) << ","
+         << field(c.indPerPop) << "," << field(c.hostLimit) << ","
+         << r.replicates << "," << field(r.seconds) << ","
+         << field(r.replicates / r.seconds) << "," << field(r.nodes / r.seconds) << ","
+         << field(r.peakRssKb) << "," << field(r.allocations / r.replicates) << ","
+         << field(r.bytes / r.replicates) << "\n";
+    return line.str();
+}
+
+static const char *csvHeader =
+    "label,engine,num_tips,time_to_sim,birth_rate,death_rate,transfer_rate,"
+    "ind_per_pop,host_limit,replicates,seconds,reps_per_second,"
+    "nodes_per_second,peak_rss_kb,allocations_per_rep,bytes_per_rep\n";
+
+int main(int argc, char **argv){
+    if(argc > 1 && (std::string(argv[1]) == "--help" || std::string(argv[1]) == "-h")){
+        std::cout << usage;
+        return 0;
+    }
+    try{
+        Options opts;
+        opts.parseArgs(argc, argv, 1);
+        std::string engines = "," + opts.getString("engines", "gsaBDSim,bdSimpleSim,bdsaBDSim,"
+                                                   "coalescentSim,pairedBDPSim,pairedBDPSimAna") + ",";
+        double minTime = opts.getDouble("min_time", 1.0);
+        long minReps = opts.getInt("min_reps", 3);
+        uint64_t seed = opts.getInt("seed", 1);
+        std::string label = opts.getString("label", "");
+        std::string outPath = opts.getString("out", "");
+        opts.checkAllUsed();
+        if(minTime < 0.0 || minReps < 1)
+            throw std::runtime_error("'min_time' must be 0 or more and 'min_reps' at least 1");
+
+        std::ofstream outFile;
+        bool newFile = true;
+        if(!(outPath.empty())){
+            newFile = !(std::ifstream(outPath.c_str()).good());
+            outFile.open(outPath.c_str(), std::ios::app);
+            if(!outFile)
+                throw std::runtime_error("could not open '" + outPath + "'");
+        }
+        std::ostream &out = outPath.empty() ? std::cout : outFile;
+        if(newFile)
+            out << csvHeader;
+        long numRun = 0;
+        for(const BenchCase &c : benchGrid()){
+            if(engines.find("," + c.engine + ",") == std::string::npos)
+                continue;
+            BenchResult r = measureInChild(c, minTime, minReps, seed);
+            if(r.error[0] != '\0')
+                throw std::runtime_error(c.engine + ": " + r.error);
+            out << csvLine(label, c, r);
+            out.flush();
+            if(!(outPath.empty()))
+                std::cerr << c.engine << ": " << field(r.replicates / r.seconds)
+                          << " replicates per second" << std::endl;
+            numRun++;
+        }
+        if(numRun == 0)
+            throw std::runtime_error("no engine in '--engines' is known");
+    }
+    catch(std::exception &e){
+        std::cerr << "treeducken_bench: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,422 @@
+//
+//  main.cpp
+//  treeducken standalone
+//
+//  Command line front end to the simulation core in ../src, for running
+//  simulations without R. Replicates are simulated in batches on a number of
+//  threads and every batch is written out in replicate order before the next
+//  one starts, so memory does not grow with the number of replicates. Each
+//  replicate has its own random number stream whose seed is a hash of --seed
+//  and the replicate number, so the output for a seed does not depend on
+//  --num_threads.
+//
+
+#include "Simulator.h"
+#include "Options.h"
+#include "TreeReader.h"
+#include "TreeWriter.h"
+#include "TreeArchive.h"
+#include <cstdint>
+#include <algorithm>
+#include <memory>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+static const char *usage =
+    "usage: treeducken <model> --out <prefix> [--name value ...] [--config file]\n"
+    "\n"
+    "models and their settings (the arguments of the R functions):\n"
+    "  stBD     sbr, sdr, n_tips, numbsim, gsa_stop_mult = 10\n"
+    "           writes <prefix>.trees (or <prefix>.nex, <prefix>.tdk)\n"
+    "  ltBD     species_tree (first tree of a Newick or NEXUS file), gbr,\n"
+    "           gdr, lgtr, num_loci, transfer_type = random\n"
+    "           writes <prefix>.trees (or <prefix>.nex, <prefix>.tdk)\n"
+    "  msc      species_tree (first tree of a Newick or NEXUS file), ne,\n"
+    "           num_sampled_individuals, num_genes, rescale = true,\n"
+    "           mutation_rate = 1, generation_time = 1\n"
+    "           writes <prefix>.trees (or <prefix>.nex, <prefix>.tdk)\n"
+    "  cophyBD  hbr, hdr, sbr, sdr, host_exp_rate, cosp_rate, time_to_sim,\n"
+    "           numbsim, host_limit = 0, hs_mode = false, sparse_assoc = false\n"
+    "           writes <prefix>.host.trees, <prefix>.symb.trees (or .nex),\n"
+    "           <prefix>.assoc.tsv and <prefix>.events.tsv, or everything to\n"
+    "           <prefix>.tdk\n"
+    "\n"
+    "common settings:\n"
+    "  out          prefix of the output files\n"
+    "  seed         seed of the random number streams (1)\n"
+    "  num_threads  threads simulating replicates (1)\n"
+    "  precision    significant digits of branch lengths (10), binary archives\n"
+    "               store them as single precision floats at 7 or less\n"
+    "  format       newick, nexus or binary (newick), binary writes one tree\n"
+    "               archive that R reads with read_tree_archive\n"
+    "  gzip         gzip every output file and add .gz to its name (false),\n"
+    "               not for binary archives\n"
+    "  config       file of 'name = value' lines, flags take precedence\n";
+
+// output of one replicate, one chunk of text per output file or the records
+// of the archive
+struct ReplicateOutput
+{
+    std::vector<std::string>    text;
+    std::vector<ArchiveRecord>  records;
+};
+typedef std::function<ReplicateOutput(long rep, uint64_t seed)> ReplicateFunction;
+
+// where replicates are written, text files or one archive
+struct OutputFiles
+{
+    std::vector<std::unique_ptr<TreeFile> > files;
+    std::unique_ptr<TreeArchiveWriter>      archive;
+};
+
+// how the output files are written, from the common settings
+struct OutputFormat
+{
+    int     precision;
+    bool    nexus;
+    bool    binary;
+    bool    gzip;
+};
+
+// splitmix64 of the seed and replicate number
+static uint64_t replicateSeed(uint64_t seed, uint64_t rep){
+    uint64_t z = seed + (rep + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Runs numReps replicates in batches of a few per thread. Replicates are
+// handed out one at a time since how long one takes varies a lot, and the
+// output of a batch is written in order once the whole batch is done.
+static void runReplicates(long numReps,
+                          int numThreads,
+                          uint64_t seed,
+                          OutputFiles &files,
+                          ReplicateFunction simulate){
+    if(numReps < 1)
+        throw std::runtime_error("the number of replicates must be at least 1");
+    long batchSize = 64 * (long) numThreads;
+    std::vector<ReplicateOutput> outputs(batchSize);
+    std::vector<std::string> errors(batchSize);
+    for(long first = 0; first < numReps; first += batchSize){
+        int numInBatch = (int) std::min(batchSize, numReps - first);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1) num_threads(numThreads)
+#endif
+        for(int k = 0; k < numInBatch; k++){
+            try{
+                outputs[k] = simulate(first + k, replicateSeed(seed, first + k));
+            }
+            catch(std::exception &e){
+                errors[k] = e.what();
+            }
+        }
+        for(int k = 0; k < numInBatch; k++){
+            if(!(errors[k].empty()))
+                throw std::runtime_error("replicate " + std::to_string(first + k + 1) + ": " + errors[k]);
+            for(size_t f = 0; f < outputs[k].text.size(); f++)
+                files.files[f]->write(outputs[k].text[f]);
+            for(auto &record : outputs[k].records)
+                files.archive->add(record, first + k);
+            outputs[k] = ReplicateOutput();
+        }
+    }
+    for(auto &file : files.files)
+        file->close();
+    if(files.archive)
+        files.archive->close();
+}
+
+// the thread running a replicate in runReplicates, so each thread can keep a
+// simulator of its own and reuse it from one replicate to the next
+static int threadNumber(){
+#ifdef _OPENMP
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+}
+
+// tree files are <prefix><name>.trees or .nex, other files <prefix><name>,
+// binary output is a single archive <prefix>.tdk
+static OutputFiles openOutputs(const std::string &prefix,
+                               const std::vector<std::string> &treeNames,
+                               const std::vector<std::string> &otherNames,
+                               const OutputFormat &format,
+                               ArchiveContent content = ArchiveTrees){
+    OutputFiles files;
+    if(format.binary){
+        files.archive.reset(new TreeArchiveWriter(prefix + ".tdk", content));
+        return files;
+    }
+    std::string gz = format.gzip ? ".gz" : "";
+    for(auto &name : treeNames){
+        std::string path = prefix + name + (format.nexus ? ".nex" : ".trees") + gz;
+        files.files.push_back(std::unique_ptr<TreeFile>(new TreeFile(path, format.nexus)));
+    }
+    for(auto &name : otherNames)
+        files.files.push_back(std::unique_ptr<TreeFile>(new TreeFile(prefix + name + gz)));
+    return files;
+}
+
+// adds the tree to the replicate's next tree file or its archive records
+static void addTree(Tree &tree, long rep, const OutputFormat &format, ReplicateOutput &out){
+    if(format.binary){
+        out.records.push_back(treeRecord(tree, format.precision <= 7));
+        return;
+    }
+    NewickWriter writer(format.precision);
+    out.text.push_back("");
+    if(format.nexus)
+        writer.appendNexus(tree, "tree_" + std::to_string(rep + 1), out.text.back());
+    else
+        writer.append(tree, out.text.back());
+}
+
+static void runStBD(Options &opts, const std::string &prefix,
+                    long numThreads, uint64_t seed, const OutputFormat &format){
+    double sbr = opts.getDouble("sbr");
+    double sdr = opts.getDouble("sdr");
+    long nTips = opts.getInt("n_tips");
+    long numbsim = opts.getInt("numbsim");
+    long gsaStopMult = opts.getInt("gsa_stop_mult", 10);
+    opts.checkAllUsed();
+    if(sbr <= 0.0)
+        throw std::runtime_error("'sbr' must be bigger than 0.0.");
+    if(sbr < sdr)
+        throw std::runtime_error("'sbr' must be greater than 'sdr'");
+    if(sdr < 0.0)
+        throw std::runtime_error("'sdr' must be 0.0 or greater.");
+    if(nTips < 1)
+        throw std::runtime_error("'n_tips' must be greater than 1.");
+    if(gsaStopMult < 1)
+        throw std::runtime_error("'gsa_stop_mult' must be greater than 1.");
+    OutputFiles files = openOutputs(prefix, {""}, {}, format);
+    std::vector<std::unique_ptr<Simulator> > sims(numThreads);
+    runReplicates(numbsim, numThreads, seed, files, [&](long rep, uint64_t repSeed){
+        std::unique_ptr<Simulator> &threadSim = sims[threadNumber()];
+        if(!threadSim){
+            threadSim.reset(new Simulator(nTips, sbr, sdr, 1));
+            threadSim->setGSAStop(gsaStopMult * nTips);
+        }
+        Simulator &sim = *threadSim;
+        sim.setRng(std::make_shared<Rng>(repSeed));
+        sim.simSpeciesTree();
+        ReplicateOutput out;
+        addTree(*(sim.getSpeciesTree()), rep, format, out);
+        return out;
+    });
+}
+
+static void runLtBD(Options &opts, const std::string &prefix,
+                    long numThreads, uint64_t seed, const OutputFormat &format){
+    PhyloTree speciesTree = readTreeFile(opts.getString("species_tree"));
+    double gbr = opts.getDouble("gbr");
+    double gdr = opts.getDouble("gdr");
+    double lgtr = opts.getDouble("lgtr");
+    long numLoci = opts.getInt("num_loci");
+    std::string transferType = opts.getString("transfer_type", "random");
+    opts.checkAllUsed();
+    if(gbr < 0.0)
+        throw std::runtime_error("'gbr' must be a positive number or 0.0");
+    if(gbr < gdr)
+        throw std::runtime_error("'gbr' must be greater than 'gdr'");
+    if(lgtr < 0.0)
+        throw std::runtime_error("'lgtr' must be a positive number or 0.0");
+    if(gdr < 0.0)
+        throw std::runtime_error("'gdr' must be greater than or equal to 0.0");
+    if(transferType != "cladewise" && transferType != "random")
+        throw std::runtime_error("the transfer_type must be set to 'cladewise' or 'random'");
+    OutputFiles files = openOutputs(prefix, {""}, {}, format);
+    std::vector<std::unique_ptr<Simulator> > sims(numThreads);
+    runReplicates(numLoci, numThreads, seed, files, [&](long rep, uint64_t repSeed){
+        std::unique_ptr<Simulator> &threadSim = sims[threadNumber()];
+        if(!threadSim){
+            // the locus tree simulation renumbers the species tree so every
+            // thread gets its own copy
+            auto spTree = std::make_shared<SpeciesTree>(speciesTree);
+            threadSim.reset(new Simulator(spTree->getNumExtant(), 0.0, 0.0, 0.0, 1, gbr, gdr, lgtr, transferType));
+            threadSim->setSpeciesTree(spTree);
+        }
+        Simulator &sim = *threadSim;
+        sim.setRng(std::make_shared<Rng>(repSeed));
+        sim.simLocusTree();
+        ReplicateOutput out;
+        addTree(*(sim.getLocusTree()), rep, format, out);
+        return out;
+    });
+}
+
+static void runMSC(Options &opts, const std::string &prefix,
+                   long numThreads, uint64_t seed, const OutputFormat &format){
+    PhyloTree speciesTree = readTreeFile(opts.getString("species_tree"));
+    double ne = opts.getDouble("ne");
+    long numSampled = opts.getInt("num_sampled_individuals");
+    long numGenes = opts.getInt("num_genes");
+    bool rescale = opts.getBool("rescale", true);
+    double mutationRate = opts.getDouble("mutation_rate", 1.0);
+    double generationTime = opts.getDouble("generation_time", 1.0);
+    opts.checkAllUsed();
+    if(mutationRate <= 0.0)
+        throw std::runtime_error("'mutation_rate' must be greater than 0.0.");
+    if(generationTime <= 0.0)
+        throw std::runtime_error("'generation_time' must be greater than 0.0.");
+    if(ne <= 0.0)
+        throw std::runtime_error("'ne' must be greater than 0.0.");
+    if(numSampled < 1)
+        throw std::runtime_error("'num_sampled_individuals' must be greater than or equal to 1");
+    auto spTree = std::make_shared<SpeciesTree>(speciesTree);
+    double theta = ne;
+    if(rescale){
+        theta = 4 * ne * mutationRate / generationTime;
+        spTree->scaleTree(theta);
+    }
+    // the locus tree is the species tree and is processed once for all genes
+    int ntax = spTree->getNumExtant();
+    Simulator sim(ntax, 0.0, 0.0, 1.0, 1, 0.0, 0.0, 0.0, numSampled, theta, 1.0, 1, 0.0, 1.0, false);
+    sim.setSpeciesTree(spTree);
+    sim.setLocusTree(std::make_shared<LocusTree>(*spTree, ntax, 0.0, 0.0, 0.0));
+    sim.prepareCoalescentSim();
+    OutputFiles files = openOutputs(prefix, {""}, {}, format);
+    runReplicates(numGenes, numThreads, seed, files, [&](long rep, uint64_t repSeed){
+        auto gt = sim.coalescentGeneTree(std::make_shared<Rng>(repSeed));
+        if(gt == nullptr)
+            throw std::runtime_error("the species tree has no epochs to coalesce in");
+        ReplicateOutput out;
+        addTree(*gt, rep, format, out);
+        return out;
+    });
+}
+
+static void runCophyBD(Options &opts, const std::string &prefix,
+                       long numThreads, uint64_t seed, const OutputFormat &format){
+    double hbr = opts.getDouble("hbr");
+    double hdr = opts.getDouble("hdr");
+    double sbr = opts.getDouble("sbr");
+    double sdr = opts.getDouble("sdr");
+    double hostExpRate = opts.getDouble("host_exp_rate");
+    double cospRate = opts.getDouble("cosp_rate");
+    double timeToSim = opts.getDouble("time_to_sim");
+    long numbsim = opts.getInt("numbsim");
+    long hostLimit = opts.getInt("host_limit", 0);
+    bool hsMode = opts.getBool("hs_mode", false);
+    bool sparseAssoc = opts.getBool("sparse_assoc", false);
+    opts.checkAllUsed();
+    if(hbr < 0.0)
+        throw std::runtime_error("'hbr' must be positive or 0.0.");
+    if((hbr + cospRate) < hdr)
+        throw std::runtime_error("'hbr + cosp_rate' must be greater than 'hdr'.");
+    if(hdr < 0.0)
+        throw std::runtime_error("'hdr' must be a positive value or 0.0.");
+    if(hostExpRate < 0.0)
+        throw std::runtime_error("'host_exp_rate' must be a positive value or 0.0.");
+    if(cospRate < 0.0)
+        throw std::runtime_error("'cosp_rate' must be a positive value or 0.0.");
+    if(timeToSim < 0.0)
+        throw std::runtime_error("'time_to_sim' must be a positive value or 0.0.");
+    if(hostLimit < 0)
+        throw std::runtime_error("'host_limit' must be a positive number or 0 (0 turns off the host limit).");
+    OutputFiles files = openOutputs(prefix, {".host", ".symb"}, {".assoc.tsv", ".events.tsv"},
+                                    format, ArchiveCophylo);
+    if(!(format.binary)){
+        files.files[2]->write("replicate\thost\tsymbiont\n");
+        files.files[3]->write("replicate\tsymbiont_index\thost_index\tevent_type\tevent_time\n");
+    }
+    std::vector<std::unique_ptr<Simulator> > sims(numThreads);
+    runReplicates(numbsim, numThreads, seed, files, [&](long rep, uint64_t repSeed){
+        std::unique_ptr<Simulator> &threadSim = sims[threadNumber()];
+        if(!threadSim){
+            threadSim.reset(new Simulator(timeToSim, hbr, hdr, sbr, sdr, hostExpRate, cospRate, 1.0, hostLimit, hsMode));
+            threadSim->setSparseAssociations(sparseAssoc);
+        }
+        Simulator &sim = *threadSim;
+        sim.setRng(std::make_shared<Rng>(repSeed));
+        sim.simHostSymbSpeciesTreePair();
+        ReplicateOutput out;
+        std::vector<std::string> hostNames = sim.getExtantHostNames(sim.getSpeciesTipNames());
+        std::vector<std::string> symbNames = sim.getExtantSymbNames(sim.getSymbiontTipNames());
+        std::vector<int> assoc = sim.getAssociationMatrix();
+        const EventLog &events = sim.getEventLog();
+        if(format.binary){
+            // events refer to the nodes as they are numbered in the archive
+            std::vector<int> hostNumbers, symbNumbers;
+            bool single = format.precision <= 7;
+            out.records.push_back(treeRecord(*(sim.getSpeciesTree()), single, &hostNumbers));
+            out.records.push_back(treeRecord(*(sim.getSymbiontTree()), single, &symbNumbers));
+            out.records.push_back(associationRecord(hostNames, symbNames, assoc));
+            out.records.push_back(eventRecord(events, hostNumbers, symbNumbers));
+            return out;
+        }
+        addTree(*(sim.getSpeciesTree()), rep, format, out);
+        addTree(*(sim.getSymbiontTree()), rep, format, out);
+        // associations as (host, symbiont) pairs of extant tip names
+        std::string repName = std::to_string(rep + 1);
+        out.text.resize(4);
+        for(size_t s = 0; s < symbNames.size(); s++)
+            for(size_t h = 0; h < hostNames.size(); h++)
+                if(assoc[s * hostNames.size() + h])
+                    out.text[2] += repName + "\t" + hostNames[h] + "\t" + symbNames[s] + "\n";
+        // events with the node numbers of the trees above
+        for(unsigned i = 0; i < events.size(); i++){
+            out.text[3] += repName + "\t"
+                + std::to_string(sim.getSymbiontTree()->getIndexFromNodes(events.getSymbiontIndex(i))) + "\t"
+                + std::to_string(sim.getSpeciesTree()->getIndexFromNodes(events.getHostIndex(i))) + "\t"
+                + EventLog::getTypeName(events.getType(i)) + "\t";
+            appendDouble(events.getTime(i), format.precision, out.text[3]);
+            out.text[3] += "\n";
+        }
+        return out;
+    });
+}
+
+int main(int argc, char **argv){
+    if(argc < 2 || std::string(argv[1]) == "--help" || std::string(argv[1]) == "-h"){
+        std::cout << usage;
+        return argc < 2 ? 1 : 0;
+    }
+    std::string model = argv[1];
+    try{
+        Options opts;
+        opts.parseArgs(argc, argv, 2);
+        long numThreads = opts.getInt("num_threads", 1);
+        uint64_t seed = opts.getInt("seed", 1);
+        long precision = opts.getInt("precision", 10);
+        std::string treeFormat = opts.getString("format", "newick");
+        OutputFormat format;
+        format.precision = precision;
+        format.nexus = treeFormat == "nexus";
+        format.binary = treeFormat == "binary";
+        format.gzip = opts.getBool("gzip", false);
+        if(numThreads < 1)
+            throw std::runtime_error("'num_threads' must be greater than or equal to 1");
+        if(precision < 1 || precision > 17)
+            throw std::runtime_error("'precision' must be between 1 and 17");
+        if(treeFormat != "newick" && treeFormat != "nexus" && treeFormat != "binary")
+            throw std::runtime_error("'format' must be 'newick', 'nexus' or 'binary'");
+        if(format.binary && format.gzip)
+            throw std::runtime_error("binary tree archives can not be gzip compressed");
+        std::string prefix = opts.getString("out");
+        if(model == "stBD")
+            runStBD(opts, prefix, numThreads, seed, format);
+        else if(model == "ltBD")
+            runLtBD(opts, prefix, numThreads, seed, format);
+        else if(model == "msc")
+            runMSC(opts, prefix, numThreads, seed, format);
+        else if(model == "cophyBD")
+            runCophyBD(opts, prefix, numThreads, seed, format);
+        else
+            throw std::runtime_error("unknown model '" + model + "'\n\n" + usage);
+    }
+    catch(std::exception &e){
+        std::cerr << "treeducken: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}